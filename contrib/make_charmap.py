@@ -23,6 +23,8 @@
 # CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
 # SOFTWARE.
 
+from __future__ import print_function
+
 import sys
 
 chars = {}
@@ -48,176 +50,203 @@ for file in sys.argv[1:]:
         if '+' in unicode:
             unicode = unicode.split('+')
             unicode[0] = int(unicode[0][2:], 16)
-            unicode[1:] = map(lambda x: int(x, 16), unicode[1:])
+            unicode[1:] = [int(x, 16) for x in unicode[1:]]
         else:
             unicode = [int(unicode[2:], 16)]
         
         # Sort by first-byte.
         chars.setdefault((other >> 8), {})[other & 0xFF] = unicode
-        reverse_table = reverse_chars
-        for char in unicode:
-            reverse_table = reverse_table.setdefault((char >> 16), {})
-            reverse_table = reverse_table.setdefault((char >> 8) & 0xFF, {})
-            if char == unicode[-1]:
-                if reverse_table.get(char & 0xFF, None) is None:
-                    reverse_table[char & 0xFF] = other
-                elif isinstance(reverse_table[char & 0xFF], dict):
-                    reverse_table[char & 0xFF][None] = other
-                else:
-                    # Replace the previous copy.
-                    reverse_table[char & 0xFF] = other
-            else:
-                if reverse_table.get(char & 0xFF, None) is None:
-                    reverse_table = reverse_table.setdefault(char & 0xFF, {})
-                elif isinstance(reverse_table[char & 0xFF], dict):
-                    reverse_table = reverse_table[char & 0xFF]
-                else:
-                    reverse_table[char & 0xFF] = {
-                        None: reverse_table[char & 0xFF]}
-                    reverse_table = reverse_table[char & 0xFF]
+        # Later mappings replace earlier ones.
+        if len(unicode) > 2:
+            raise ValueError("Sequences of more than 2 codepoints " +
+                             "are not supported")
+        reverse_chars[tuple(unicode)] = other
+
+def encodeUTF8(char):
+    if char < 0x80:
+        return [char]
+    elif char < 0x800:
+        return [0xC0 | (char >> 6), 0x80 | (char & 0x3F)]
+    elif char < 0x10000:
+        return [0xE0 | (char >> 12), 0x80 | ((char >> 6) & 0x3F),
+                0x80 | (char & 0x3F)]
+    else:
+        return [0xF0 | (char >> 18), 0x80 | ((char >> 12) & 0x3F),
+                0x80 | ((char >> 6) & 0x3F), 0x80 | (char & 0x3F)]
 
 def formatTable(lobytes, hibyte=None):
     if hibyte is None:
-        print "static const char * const table[256] = {"
+        print("static const char * const table[256] = {")
     else:
-        print "static const char * const table%02X[256] = {" % (hibyte)
+        print("static const char * const table%02X[256] = {" % (hibyte))
     line = '    '
     for byte in range(256):
         line += '"'
         if byte in lobytes:
             for char in lobytes[byte]:
-                if char < 0x10000:
-                    line += ''.join(map(lambda x: '\\x%02X' % (ord(x)),
-                                        unichr(char).encode('utf-8')))
-                else:
-                    hi, lo = divmod(char - 0x10000, 0x400)
-                    char = unichr(0xd800 + hi) + unichr(0xdc00 + lo)
-                    line += ''.join(map(lambda x: '\\x%02X' % (ord(x)),
-                                        char.encode('utf-8')))
+                line += ''.join(['\\x%02X' % (x) for x in encodeUTF8(char)])
         line += '"'
         if byte != 255:
             line += ','
         if byte % 16 != 15:
             line += ' '
         else:
-            print line
+            print(line)
             line = '    '
-    print "};"
-    print
+    print("};")
+    print()
 
-def formatMasterTable(hibytes):
-    print "static const char * const * const master_table[256] = {"
-    line = '    '
-    for byte in range(256):
-        if byte in hibytes:
-            line += "table%02X" % (byte)
-        else:
-            line += "NULL"
-        if byte != 255:
-            line += ','
-        if byte % 16 != 15:
-            line += ' '
-        else:
-            print line
-            line = '    '
-    print "};"
-    print
+def formatCodepointTables(hibytes):
+    # Codepoints which do not fit in 16 bits (or sequences of more
+    # than one codepoint) are escaped with a (never otherwise mapped)
+    # surrogate, 0xD800 plus their index in the sequences table.
+    sequences = []
+    rows = [0] * 256
+    for row, byte in enumerate(hibytes):
+        rows[byte] = row + 1
 
-formatReverseMasterTable = None
+    print("static const uint8_t codepoint_rows[256] = {")
+    for byte in range(0, 256, 16):
+        print('    ' + ', '.join(['%2d' % (rows[i])
+                                  for i in range(byte, byte + 16)]) +
+              (',' if byte != 240 else ''))
+    print("};")
+    print()
 
-def formatReverseSubsubtable(chars, prefix, hi, mid):
-    for lo in chars[hi][mid]:
-        if isinstance(chars[hi][mid][lo], dict):
-            formatReverseMasterTable(chars[hi][mid][lo],
-                                     '%02X%02X%02X' % (hi, mid, lo))
-    
-    print ("static const struct multibyte_codepoint " +
-           "reverse_table%s%02X%02X[256] = {" % (prefix, hi, mid))
-    line = '    '
-    for lo in range(256):
-        if lo in chars[hi][mid]:
-            if isinstance(chars[hi][mid][lo], dict):
-                if chars[hi][mid][lo].get(None, None) is not None:
-                    line += "{1, {0x%02X, 0x%02X}, " % (
-                        chars[hi][mid][lo][None] >> 8,
-                        chars[hi][mid][lo][None] & 0xFF)
-                    line += "reverse_master_table%s%02X%02X%02X}" % (
-                        prefix, hi, mid, lo)
-                else:
-                    line += "{0, {0, 0}, "
-                    line += "reverse_master_table%s%02X%02X%02X}" % (
-                        prefix, hi, mid, lo)
+    print("static const uint16_t codepoint_table[%d][256] = {" %
+          (len(hibytes) + 1))
+    for row, hibyte in enumerate([None] + hibytes):
+        lobytes = chars.get(hibyte, {})
+        values = []
+        for byte in range(256):
+            if byte not in lobytes:
+                values.append(0)
+            elif len(lobytes[byte]) == 1 and lobytes[byte][0] < 0xD800:
+                values.append(lobytes[byte][0])
+            elif (len(lobytes[byte]) == 1 and
+                  0xE000 <= lobytes[byte][0] < 0x10000):
+                values.append(lobytes[byte][0])
             else:
-                line += "{1, {0x%02X, 0x%02X}, NULL}" % (
-                    chars[hi][mid][lo] >> 8,
-                    chars[hi][mid][lo] & 0xFF)
-        else:
-            line += "{0, {0, 0}, NULL}"
-        if lo != 255:
-            line += ','
-        if lo % 16 != 15:
-            line += ' '
+                values.append(0xD800 + len(sequences))
+                sequences.append(lobytes[byte])
+        if hibyte is None:
+            print("    {  /* No table */")
         else:
-            print line
-            line = '    '
-    print "};"
-    print
+            print("    {  /* 0x%02X */" % (hibyte))
+        for byte in range(0, 256, 8):
+            print('\t' + ', '.join(['0x%04X' % (values[i])
+                                    for i in range(byte, byte + 8)]) +
+                  (',' if byte != 248 else ''))
+        print("    }" + (',' if row != len(hibytes) else ''))
+    print("};")
+    print()
 
-def formatReverseSubtable(chars, prefix, hi):
-    for mid in chars[hi]:
-        formatReverseSubsubtable(chars, prefix, hi, mid)
+    if len(sequences) > 0x800:
+        raise ValueError("Too many codepoint sequences to escape")
+    sequence_max = max([len(sequence) for sequence in sequences] + [1])
+    print("#define CODEPOINT_SEQUENCE_MAX %d" % (sequence_max))
+    print()
+    print("static const uint32_t codepoint_sequences[%d][%d] = {" %
+          (len(sequences), sequence_max))
+    for i, sequence in enumerate(sequences):
+        sequence = sequence + [0] * (sequence_max - len(sequence))
+        print('    {' + ', '.join(['0x%05X' % (char)
+                                   for char in sequence]) + '}' +
+              (',' if i != len(sequences) - 1 else ''))
+    print("};")
+    print()
 
-    print ("static const struct multibyte_codepoint " +
-           "*reverse_table%s%02X[256] = {" % (prefix, hi))
-    line = '    '
-    for mid in range(256):
-        if mid in chars[hi]:
-            line += "reverse_table%s%02X%02X" % (prefix, hi, mid)
-        else:
-            line += "NULL"
-        if mid != 255:
-            line += ','
-        if mid % 16 != 15:
-            line += ' '
-        else:
-            print line
-            line = '    '
-    print "};"
-    print
+def formatReverseTables(reverse_chars):
+    # A two-level trie: each run of 256 codepoints which can be
+    # encoded has a row of encodings (0 if none), with row 0 left empty
+    # for runs which cannot.  Codepoints which begin (or end) a sequence
+    # encoded as a single character are flagged in bitmaps of each row,
+    # and the sequences are looked up in a sorted table.
+    singles = dict([(key[0], value)
+                    for key, value in reverse_chars.items()
+                    if len(key) == 1])
+    sequences = sorted([(key, value)
+                        for key, value in reverse_chars.items()
+                        if len(key) == 2])
+    runs = sorted(set([char >> 8 for key in reverse_chars
+                       for char in key]))
+    if len(runs) > 255:
+        raise ValueError("Too many rows of codepoints to encode")
+    rows = [0] * (runs[-1] + 1)
+    for row, run in enumerate(runs):
+        rows[run] = row + 1
 
-def formatReverseMasterTable(chars, prefix=''):
-    for hi in chars:
-        if hi is None:
-            continue
-        formatReverseSubtable(chars, prefix, hi)
+    print("#define REVERSE_ROWS %d" % (len(rows)))
+    print()
+    print("static const uint8_t reverse_rows[REVERSE_ROWS] = {")
+    for run in range(0, len(rows), 16):
+        print('    ' + ', '.join(['%3d' % (row)
+                                  for row in rows[run:run + 16]]) +
+              (',' if run + 16 < len(rows) else ''))
+    print("};")
+    print()
 
-    print ("static const struct multibyte_codepoint * const " +
-           "*reverse_master_table%s[256] = {" % (prefix))
-    line = '    '
-    for hi in range(256):
-        if hi in chars:
-            line += "reverse_table%s%02X" % (prefix, hi)
+    print("static const uint16_t reverse_table[%d][256] = {" %
+          (len(runs) + 1))
+    for row, run in enumerate([None] + runs):
+        if run is None:
+            print("    {  /* No encodings */")
+            values = [0] * 256
         else:
-            line += "NULL"
-        if hi != 255:
-            line += ','
-        if hi % 16 != 15:
-            line += ' '
-        else:
-            print line
-            line = '    '
-    print "};"
-    print
+            print("    {  /* U+%04Xxx */" % (run))
+            values = [singles.get((run << 8) | lo, 0) for lo in range(256)]
+        for lo in range(0, 256, 8):
+            print('\t' + ', '.join(['0x%04X' % (value)
+                                    for value in values[lo:lo + 8]]) +
+                  (',' if lo != 248 else ''))
+        print("    }" + (',' if row != len(runs) else ''))
+    print("};")
+    print()
+
+    for name, index in (('starts', 0), ('ends', 1)):
+        print("static const uint8_t reverse_sequence_%s[%d][32] = {" %
+              (name, len(runs) + 1))
+        for row, run in enumerate([None] + runs):
+            bits = [0] * 32
+            for key, value in sequences:
+                if run is not None and (key[index] >> 8) == run:
+                    bits[(key[index] & 0xFF) >> 3] |= 1 << (key[index] & 0x7)
+            print('    {' + ', '.join(['0x%02X' % (bit) for bit in bits]) +
+                  '}' + (',' if row != len(runs) else ''))
+        print("};")
+        print()
+
+    print("#define REVERSE_SEQUENCES %d" % (len(sequences)))
+    print()
+    # Always declare at least one sequence for the benefit of C.
+    print("static const struct codepoint_sequence reverse_sequences[%d] = {" %
+          (max(len(sequences), 1)))
+    if len(sequences) == 0:
+        print("    {{0, 0}, 0}")
+    for i, ((first, second), value) in enumerate(sequences):
+        print("    {{0x%05X, 0x%05X}, 0x%04X}" % (first, second, value) +
+              (',' if i != len(sequences) - 1 else ''))
+    print("};")
+    print()
+
+    # Whether ASCII (other than NUL and DEL, which the CD-Text variant
+    # of ISO-8859-1 replaces) is encoded as itself, so that runs of it
+    # may be copied verbatim.
+    ascii = all([singles.get(char, 0) == char for char in range(1, 0x7F)])
+
+    print("static const struct reverse_charmap reverse_charmap = {")
+    print("    REVERSE_ROWS, reverse_rows, reverse_table,")
+    print("    reverse_sequence_starts, reverse_sequence_ends,")
+    print("    REVERSE_SEQUENCES, reverse_sequences, %d" % (int(ascii)))
+    print("};")
 
 hibytes = sorted(chars.keys())
 if len(hibytes) == 1 and hibytes[0] == 0:
     # Just need to print out a single table.
     formatTable(chars[0])
 else:
-    # Need to print out a table for each hibyte.
-    for byte in hibytes:
-        formatTable(chars[byte], byte)
-    formatMasterTable(hibytes)
+    # Need to print out a row of codepoints for each hibyte.
+    formatCodepointTables(hibytes)
 
-# Format reverse table and successor tables
-formatReverseMasterTable(reverse_chars)
+# Format reverse tables
+formatReverseTables(reverse_chars)
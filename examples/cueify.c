@@ -218,6 +218,7 @@ int print_cuesheet(const char *device) {
     cueify_sessions *sessions;
     cueify_full_toc *fulltoc;
     cueify_cdtext *cdtext;
+    cueify_disc_indices *all_indices;
     cueify_indices *indices;
     char mcn_isrc[16] = "";
     size_t size;
@@ -508,6 +509,14 @@ int print_cuesheet(const char *device) {
 	    }
 	}
 
+	/* Read the indices of every track in one pass. */
+	all_indices = cueify_disc_indices_new();
+	if (all_indices != NULL &&
+	    cueify_device_read_all_indices(dev, all_indices) != CUEIFY_OK) {
+	    cueify_disc_indices_free(all_indices);
+	    all_indices = NULL;
+	}
+
 	/* And lastly the track stuff. */
 	printf("FILE \"disc.bin\" BINARY\n");
 	for (i = cueify_toc_get_first_track(toc);
@@ -793,10 +802,11 @@ int print_cuesheet(const char *device) {
 		   offset.frm);
 
 	    /* Detect any other indices. */
-	    indices = cueify_indices_new();
-	    if (indices != NULL &&
-		cueify_device_read_track_indices(dev,
-						 indices, i) == CUEIFY_OK) {
+	    indices = NULL;
+	    if (all_indices != NULL) {
+		indices = cueify_disc_indices_get_track_indices(all_indices, i);
+	    }
+	    if (indices != NULL) {
 		for (block_num = 0;
 		     block_num < cueify_indices_get_num_indices(indices);
 		     block_num++) {
@@ -827,7 +837,6 @@ int print_cuesheet(const char *device) {
 			   offset.sec,
 			   offset.frm);
 		}
-		cueify_indices_free(indices);
 	    }
 	}
 
@@ -838,6 +847,9 @@ int print_cuesheet(const char *device) {
 	       offset.sec,
 	       offset.frm);
 
+	if (all_indices != NULL) {
+	    cueify_disc_indices_free(all_indices);
+	}
 	if (cdtext != NULL) {
 	    cueify_cdtext_free(cdtext);
 	}
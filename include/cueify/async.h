@@ -0,0 +1,148 @@
+/* async.h - Header for queueing commands to an optical disc device
+ * without waiting for them to complete.
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CUEIFY_ASYNC_H
+#define _CUEIFY_ASYNC_H
+
+#include <cueify/device.h>
+#include <cueify/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  /* __cplusplus */
+
+/**
+ * Function called when a command submitted with one of the
+ * cueify_device_submit_*() functions completes.
+ *
+ * @param context the context pointer passed when the command was
+ *                submitted
+ * @param status the result of the command, as would have been
+ *               returned by the equivalent synchronous call
+ */
+typedef void (*cueify_completion_callback)(void *context, int status);
+
+
+/**
+ * Queue a read of contiguous raw sectors from the disc in the optical
+ * disc device associated with a device handle, without waiting for it
+ * to complete.  The data returned is the same as that returned by
+ * cueify_device_read_raw_sectors().
+ *
+ * @note On operating systems (or devices) without an asynchronous
+ *       interface, the read is performed before this function returns,
+ *       but the callback is still only called from
+ *       cueify_device_complete().  Asynchronous reads do not use the
+ *       sector cache of the device.
+ *
+ * @pre { d != NULL, buffer must remain valid until the callback is called }
+ * @param d an opened device handle
+ * @param lba the absolute address (LBA) of the first sector to read
+ * @param count the number of sectors to read
+ * @param buffer a buffer of at least count * CUEIFY_RAW_READ_SIZE bytes
+ * @param size the size of the buffer
+ * @param callback the function to call when the read completes
+ * @param context a pointer to pass to the callback
+ * @return CUEIFY_OK if the read was queued; otherwise an error code
+ *         is returned and the callback will not be called
+ */
+int cueify_device_submit_read_raw_sectors(cueify_device *d, uint32_t lba,
+					  uint32_t count, uint8_t *buffer,
+					  size_t size,
+					  cueify_completion_callback callback,
+					  void *context);
+
+
+/**
+ * Queue a read of the International Standard Recording Code (ISRC)
+ * of a track on the disc in the optical disc device associated with a
+ * device handle, without waiting for it to complete.  The result is
+ * the same as that of cueify_device_read_isrc().
+ *
+ * @pre { d != NULL, buffer and size must remain valid until the
+ *        callback is called }
+ * @param d an opened device handle
+ * @param track the number of the track for which the ISRC should be
+ *              retrieved
+ * @param buffer a pointer to a location to write the ISRC to
+ * @param size a pointer to the size of the buffer, which will contain
+ *             the number of bytes written when the callback is called
+ * @param callback the function to call when the read completes
+ * @param context a pointer to pass to the callback
+ * @return CUEIFY_OK if the read was queued; otherwise an error code
+ *         is returned and the callback will not be called
+ */
+int cueify_device_submit_read_isrc(cueify_device *d, uint8_t track,
+				   char *buffer, size_t *size,
+				   cueify_completion_callback callback,
+				   void *context);
+
+
+/**
+ * Call the callbacks of any completed commands submitted to a device.
+ *
+ * @note If the device fails such that submitted commands can never
+ *       complete (e.g. it is removed), they are cancelled and their
+ *       callbacks are called with an error.
+ *
+ * @pre { d != NULL }
+ * @param d an opened device handle
+ * @param wait if non-zero and no submitted command has completed yet,
+ *             block until at least one has
+ * @return CUEIFY_OK if the completed commands were processed;
+ *         otherwise an error code is returned
+ */
+int cueify_device_complete(cueify_device *d, int wait);
+
+
+/**
+ * Get the number of commands submitted to a device whose callbacks
+ * have not yet been called.
+ *
+ * @param d an opened device handle
+ * @return the number of outstanding commands
+ */
+uint32_t cueify_device_get_pending(cueify_device *d);
+
+
+/**
+ * Get a file descriptor which becomes readable when a command
+ * submitted to a device completes, suitable for use with poll() or
+ * select() in an event loop.  When it is readable, call
+ * cueify_device_complete().
+ *
+ * @param d an opened device handle
+ * @return the file descriptor, or -1 if the device has no
+ *         asynchronous interface (in which case submitted commands
+ *         are complete as soon as they are submitted)
+ */
+int cueify_device_get_completion_fd(cueify_device *d);
+
+#ifdef __cplusplus
+};  /* extern "C" */
+#endif  /* __cplusplus */
+
+#endif /* _CUEIFY_ASYNC_H */
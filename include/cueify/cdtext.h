@@ -66,13 +66,16 @@ cueify_cdtext *cueify_cdtext_new();
 
 /**
  * Read the CD-Text data of the disc in the optical disc device
- * associated with a device handle.
+ * associated with a device handle.  PACKs failing their CRC check are
+ * handled as set by cueify_cdtext_set_crc_mode() on t.
  *
  * @pre { d != NULL, t != NULL }
  * @param d an opened device handle
  * @param t a CD-Text instance to populate
  * @return CUEIFY_OK if the CD-Text data was successfully read;
- *         otherwise an error code is returned
+ *         CUEIFY_ERR_CORRUPTED if a PACK failed its CRC check in
+ *         CUEIFY_CDTEXT_CRC_STRICT mode; otherwise an error code is
+ *         returned
  */
 int cueify_device_read_cdtext(cueify_device *d, cueify_cdtext *t);
 
@@ -89,12 +92,69 @@ int cueify_device_read_cdtext(cueify_device *d, cueify_cdtext *t);
  * @param buffer a pointer to the serialized CD-Text data
  * @param size the size of the buffer
  * @return CUEIFY_OK if the CD-Text instance was successfully
- *         deserialized; otherwise an error code is returned
+ *         deserialized; CUEIFY_ERR_CORRUPTED if a PACK failed its CRC
+ *         check in CUEIFY_CDTEXT_CRC_STRICT mode; otherwise an error
+ *         code is returned
  */
 int cueify_cdtext_deserialize(cueify_cdtext *t, const uint8_t * const buffer,
 			      size_t size);
 
 
+/* Ways of handling PACKs which fail their CRC check when deserializing. */
+/** Count PACKs which fail their CRC check, but use them anyway. */
+#define CUEIFY_CDTEXT_CRC_COUNT   0
+/** Fail to deserialize CD-Text with any PACK failing its CRC check. */
+#define CUEIFY_CDTEXT_CRC_STRICT  1
+/** Count PACKs which fail their CRC check, and ignore them. */
+#define CUEIFY_CDTEXT_CRC_DROP    2
+
+
+/**
+ * Set how cueify_cdtext_deserialize() and cueify_device_read_cdtext()
+ * handle PACKs of a CD-Text instance which fail their CRC check.
+ * Every PACK is checked; by default (CUEIFY_CDTEXT_CRC_COUNT)
+ * failures are only counted, as some drives do not return a CRC at
+ * all.
+ *
+ * @pre { t != NULL }
+ * @param t a CD-Text instance
+ * @param mode how to handle PACKs failing their CRC check (one of
+ *             CUEIFY_CDTEXT_CRC_*)
+ * @return CUEIFY_OK if the mode was set; otherwise an error code is
+ *         returned
+ */
+int cueify_cdtext_set_crc_mode(cueify_cdtext *t, int mode);
+
+
+/**
+ * Get the number of PACKs which failed their CRC check when a CD-Text
+ * instance was last deserialized (or read).
+ *
+ * @pre { t != NULL }
+ * @param t a CD-Text instance
+ * @return the number of PACKs failing their CRC check
+ */
+unsigned int cueify_cdtext_get_num_bad_packs(cueify_cdtext *t);
+
+
+/**
+ * Check the CRCs of an array of CD-Text PACKs (descriptors) all at
+ * once, as cueify_cdtext_deserialize() does. Several PACKs are
+ * checked together, so this is faster than checking them one by one.
+ *
+ * @pre { packs != NULL || num_packs == 0 }
+ * @param packs a pointer to num_packs PACKs of 18 bytes each (such as
+ *              serialized CD-Text after its 4-byte header)
+ * @param num_packs the number of PACKs to check
+ * @param bitmap a pointer to (num_packs + 7) / 8 bytes in which bit
+ *               (i % 8) of byte (i / 8) is set if PACK i fails its
+ *               check (and cleared otherwise), or NULL
+ * @return the number of PACKs failing their CRC check
+ */
+size_t cueify_cdtext_check_packs(const uint8_t *packs, size_t num_packs,
+				 uint8_t *bitmap);
+
+
 /**
  * Serialize a CD-Text instance for later deserialization with
  * cueify_cdtext_deserialize().
@@ -117,6 +177,24 @@ int cueify_cdtext_deserialize(cueify_cdtext *t, const uint8_t * const buffer,
 int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer, size_t *size);
 
 
+/**
+ * Serialize a CD-Text instance into a newly-allocated buffer of
+ * exactly the size needed.  Unlike calling cueify_cdtext_serialize()
+ * twice (once to size the buffer), each string is only encoded once.
+ *
+ * @pre { t != NULL, buffer != NULL, size != NULL }
+ * @param t a CD-Text instance to serialize
+ * @param buffer a pointer to set to the serialized CD-Text instance, or
+ *               NULL if it could not be serialized. The buffer must be
+ *               freed.
+ * @param size a pointer to set to the number of bytes in buffer
+ * @return CUEIFY_OK if the CD-Text instance was successfully
+ *         serialized; otherwise an error code is returned
+ */
+int cueify_cdtext_serialize_alloc(cueify_cdtext *t, uint8_t **buffer,
+				  size_t *size);
+
+
 /**
  * Free a CD-Text instance. Deletes the object pointed to by t.
  *
@@ -596,6 +674,222 @@ uint16_t cueify_cdtext_block_get_genre_code(cueify_cdtext_block *b);
  */
 const char *cueify_cdtext_block_get_genre_name(cueify_cdtext_block *b);
 
+
+
+/**
+ * A transparent handle for an index of serialized CD-Text data, from
+ * which single strings may be decoded without deserializing the rest.
+ *
+ * This is returned by cueify_cdtext_view_new() and is passed as the
+ * first parameter to all cueify_cdtext_view_*() functions.
+ */
+typedef void *cueify_cdtext_view;
+
+
+/* Types of CD-Text PACKs which hold strings. */
+#define CUEIFY_CDTEXT_PACK_TITLE       0x80  /** Titles */
+#define CUEIFY_CDTEXT_PACK_PERFORMER   0x81  /** Performers */
+#define CUEIFY_CDTEXT_PACK_SONGWRITER  0x82  /** Songwriters */
+#define CUEIFY_CDTEXT_PACK_COMPOSER    0x83  /** Composers */
+#define CUEIFY_CDTEXT_PACK_ARRANGER    0x84  /** Arrangers */
+#define CUEIFY_CDTEXT_PACK_MESSAGE     0x85  /** Messages */
+#define CUEIFY_CDTEXT_PACK_DISCID      0x86  /** Disc ID (album only) */
+#define CUEIFY_CDTEXT_PACK_GENRE       0x87  /** Genre name (album only) */
+#define CUEIFY_CDTEXT_PACK_PRIVATE     0x8D  /** Private data */
+#define CUEIFY_CDTEXT_PACK_UPC_ISRC    0x8E  /** UPC (album) or ISRCs */
+
+
+/**
+ * Create a new CD-Text view. The view is created with no data, and
+ * should be populated using cueify_cdtext_view_index().
+ *
+ * @return NULL if there was an error allocating memory, else the new
+ *         CD-Text view
+ */
+cueify_cdtext_view *cueify_cdtext_view_new();
+
+
+/**
+ * Index serialized CD-Text data (as read by
+ * cueify_cdtext_deserialize()) in place, in a single pass over its
+ * PACKs.  Nothing is decoded or copied: the buffer is read again
+ * whenever a string is requested, and so must remain valid (and
+ * unchanged) for as long as the view is used.
+ *
+ * @pre { v != NULL, buffer != NULL }
+ * @param v a CD-Text view to populate
+ * @param buffer a pointer to the serialized CD-Text data
+ * @param size the size of the buffer
+ * @return CUEIFY_OK if the CD-Text was successfully indexed; otherwise
+ *         an error code is returned, as for cueify_cdtext_deserialize()
+ */
+int cueify_cdtext_view_index(cueify_cdtext_view *v,
+			     const uint8_t * const buffer, size_t size);
+
+
+/**
+ * Free a CD-Text view. Deletes the object pointed to by v, but not
+ * the buffer it indexes.
+ *
+ * @pre { v != NULL }
+ * @param v a cueify_cdtext_view object created by cueify_cdtext_view_new()
+ */
+void cueify_cdtext_view_free(cueify_cdtext_view *v);
+
+
+/**
+ * Get the number of the blocks in a CD-Text view.
+ *
+ * @pre { v != NULL }
+ * @param v a CD-Text view
+ * @return the number of blocks in v (as for cueify_cdtext_get_num_blocks())
+ */
+uint8_t cueify_cdtext_view_get_num_blocks(cueify_cdtext_view *v);
+
+
+/**
+ * Get the character set of a block in a CD-Text view.
+ *
+ * @pre { v != NULL, 0 <= block < cueify_cdtext_view_get_num_blocks(v) }
+ * @param v a CD-Text view
+ * @param block the number of the block
+ * @return the character set of the block (one of CUEIFY_CDTEXT_CHARSET_*)
+ */
+uint8_t cueify_cdtext_view_get_charset(cueify_cdtext_view *v, uint8_t block);
+
+
+/**
+ * Get the language of a block in a CD-Text view.
+ *
+ * @pre { v != NULL, 0 <= block < cueify_cdtext_view_get_num_blocks(v) }
+ * @param v a CD-Text view
+ * @param block the number of the block
+ * @return the language of the block (one of CUEIFY_CDTEXT_LANG_*)
+ */
+uint8_t cueify_cdtext_view_get_language(cueify_cdtext_view *v, uint8_t block);
+
+
+/**
+ * Decode a single string from a block in a CD-Text view. As with
+ * cueify_cdtext_block_get_title() and friends, a track marked as
+ * repeating the string of the previous track yields that string.
+ *
+ * @pre { v != NULL, size != NULL }
+ * @param v a CD-Text view
+ * @param block the number of the block
+ * @param type the type of PACK holding the string (one of
+ *             CUEIFY_CDTEXT_PACK_*)
+ * @param track the number of the track to decode the string for (or
+ *              CUEIFY_CDTEXT_ALBUM for the album)
+ * @param buffer a pointer to a location to write the string (in UTF-8
+ *               encoding) to, or NULL to determine the size of such
+ *               a buffer
+ * @param size a pointer to the size of the buffer. When called, the
+ *             size must contain the maximum number of bytes that may
+ *             be stored in buffer. When this function is complete,
+ *             the pointer will contain the number of bytes needed
+ *             for the string (including the terminating NUL).
+ * @return CUEIFY_OK if the string was decoded; CUEIFY_NO_DATA if the
+ *         block holds no such string; CUEIFY_ERR_TOOSMALL if it did not
+ *         fit in buffer; otherwise an error code is returned
+ */
+int cueify_cdtext_view_get_string(cueify_cdtext_view *v, uint8_t block,
+				  uint8_t type, uint8_t track,
+				  char *buffer, size_t *size);
+
+
+
+/**
+ * A transparent handle for a parser of serialized CD-Text data which
+ * arrives a piece at a time.
+ *
+ * This is returned by cueify_cdtext_parser_new() and is passed as the
+ * first parameter to all cueify_cdtext_parser_*() functions.
+ */
+typedef void *cueify_cdtext_parser;
+
+
+/**
+ * Function called by a CD-Text parser for each serialized CD-Text it
+ * has parsed.
+ *
+ * @param context the context pointer passed when the parser was created
+ * @param status the result of parsing the CD-Text, as would have been
+ *               returned by cueify_cdtext_deserialize()
+ * @param t the CD-Text parsed, which is owned by the parser and only
+ *          valid until the callback returns
+ */
+typedef void (*cueify_cdtext_parser_callback)(void *context, int status,
+					      cueify_cdtext *t);
+
+
+/**
+ * Create a new CD-Text parser, which expects serialized CD-Text data
+ * (as read by cueify_cdtext_deserialize()), or several such
+ * concatenated together.
+ *
+ * @pre { callback != NULL }
+ * @param callback a function to call with each CD-Text parsed
+ * @param context a pointer to pass to callback
+ * @return NULL if there was an error allocating memory, else the new
+ *         CD-Text parser
+ */
+cueify_cdtext_parser *cueify_cdtext_parser_new(
+    cueify_cdtext_parser_callback callback, void *context);
+
+
+/**
+ * Set how a CD-Text parser handles PACKs which fail their CRC check,
+ * as cueify_cdtext_set_crc_mode() does for cueify_cdtext_deserialize().
+ *
+ * @pre { p != NULL }
+ * @param p a CD-Text parser
+ * @param mode how to handle PACKs failing their CRC check (one of
+ *             CUEIFY_CDTEXT_CRC_*)
+ * @return CUEIFY_OK if the mode was set; otherwise an error code is
+ *         returned
+ */
+int cueify_cdtext_parser_set_crc_mode(cueify_cdtext_parser *p, int mode);
+
+
+/**
+ * Feed the next bytes of serialized CD-Text data to a CD-Text parser.
+ * Each PACK is parsed as soon as it is complete, and the callback of
+ * the parser is called as soon as the last PACK of a CD-Text is.
+ *
+ * @pre { p != NULL, bytes != NULL || n == 0 }
+ * @param p a CD-Text parser
+ * @param bytes a pointer to the next bytes of serialized CD-Text data
+ * @param n the number of bytes to parse
+ * @return CUEIFY_OK if the bytes were parsed; CUEIFY_ERR_CORRUPTED if
+ *         the length of a CD-Text was invalid (after which the parser
+ *         must be reset with cueify_cdtext_parser_finish()); otherwise
+ *         an error code is returned
+ */
+int cueify_cdtext_parser_feed(cueify_cdtext_parser *p, const uint8_t *bytes,
+			      size_t n);
+
+
+/**
+ * Finish parsing with a CD-Text parser, readying it for new data.
+ *
+ * @pre { p != NULL }
+ * @param p a CD-Text parser
+ * @return CUEIFY_OK if the data fed ended with a complete CD-Text;
+ *         CUEIFY_ERR_TRUNCATED if a partial CD-Text was discarded
+ */
+int cueify_cdtext_parser_finish(cueify_cdtext_parser *p);
+
+
+/**
+ * Free a CD-Text parser. Deletes the object pointed to by p.
+ *
+ * @pre { p != NULL }
+ * @param p a cueify_cdtext_parser object created by
+ *          cueify_cdtext_parser_new()
+ */
+void cueify_cdtext_parser_free(cueify_cdtext_parser *p);
+
 #ifdef __cplusplus
 };  /* extern "C" */
 #endif  /* __cplusplus */
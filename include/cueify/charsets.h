@@ -0,0 +1,138 @@
+/* charsets.h - Header for converting strings between UTF-8 and the
+ * character sets of CD-Text.
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CUEIFY_CHARSETS_H
+#define _CUEIFY_CHARSETS_H
+
+#include <cueify/types.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  /* __cplusplus */
+
+/**
+ * Convert a string encoded in ISO-8859-1 (as used by CD-Text) to
+ * UTF-8 in a caller-provided buffer, without allocating anything.
+ *
+ * @param latin1 a pointer to the string containing ISO-8859-1 data
+ * @param size the number of characters to convert.  If -1,
+ *             characters will be converted until a null terminator
+ *             is found.
+ * @param utf8 a pointer to a buffer to write the (terminated) UTF-8
+ *             string to, or NULL to only count its bytes
+ * @param utf8_size the number of bytes in utf8
+ * @return the number of bytes in the UTF-8 string (including the
+ *         terminator).  If this is more than utf8_size, the contents
+ *         of utf8 are undefined, and the conversion should be
+ *         repeated with a buffer of at least this size.
+ */
+size_t cueify_latin1_to_utf8_into(const uint8_t *latin1, int size,
+				  char *utf8, size_t utf8_size);
+
+
+/**
+ * Convert a string encoded in Music Shift-JIS (as used by CD-Text,
+ * big-endian) to UTF-8 in a caller-provided buffer, without
+ * allocating anything.
+ *
+ * @param msjis a pointer to the string containing MS-JIS data
+ * @param size the number of wide characters to convert.  If -1,
+ *             characters will be converted until a null terminator
+ *             or invalid character is found.
+ * @param utf8 a pointer to a buffer to write the (terminated) UTF-8
+ *             string to, or NULL to only count its bytes
+ * @param utf8_size the number of bytes in utf8
+ * @return the number of bytes in the UTF-8 string (including the
+ *         terminator).  If this is more than utf8_size, the contents
+ *         of utf8 are undefined, and the conversion should be
+ *         repeated with a buffer of at least this size.
+ */
+size_t cueify_msjis_to_utf8_into(const uint8_t *msjis, int size,
+				 char *utf8, size_t utf8_size);
+
+
+/**
+ * Convert a UTF-8 string to ASCII in a caller-provided buffer,
+ * without allocating anything.
+ *
+ * @note Characters which cannot be encoded in ASCII will be replaced
+ *       with '?'.
+ *
+ * @param utf8 a pointer to the string containing UTF-8 data
+ * @param output a pointer to a buffer to write the (terminated) ASCII
+ *               string to, or NULL to only count its bytes
+ * @param output_size the number of bytes in output
+ * @return the number of bytes in the ASCII string (including the
+ *         terminator).  If this is more than output_size, the
+ *         contents of output are undefined.
+ */
+size_t cueify_utf8_to_ascii_into(const char *utf8, uint8_t *output,
+				 size_t output_size);
+
+
+/**
+ * Convert a UTF-8 string to ISO-8859-1 (as used by CD-Text) in a
+ * caller-provided buffer, without allocating anything.
+ *
+ * @note Characters which cannot be encoded in ISO-8859-1 will be
+ *       replaced with '?'.
+ *
+ * @param utf8 a pointer to the string containing UTF-8 data
+ * @param output a pointer to a buffer to write the (terminated)
+ *               ISO-8859-1 string to, or NULL to only count its bytes
+ * @param output_size the number of bytes in output
+ * @return the number of bytes in the ISO-8859-1 string (including the
+ *         terminator).  If this is more than output_size, the
+ *         contents of output are undefined.
+ */
+size_t cueify_utf8_to_latin1_into(const char *utf8, uint8_t *output,
+				  size_t output_size);
+
+
+/**
+ * Convert a UTF-8 string to Music Shift-JIS (as used by CD-Text,
+ * big-endian) in a caller-provided buffer, without allocating
+ * anything.
+ *
+ * @note Characters which cannot be encoded in Music Shift-JIS will be
+ *       replaced with '?'.
+ *
+ * @param utf8 a pointer to the string containing UTF-8 data
+ * @param output a pointer to a buffer to write the (terminated)
+ *               MS-JIS string to, or NULL to only count its bytes
+ * @param output_size the number of bytes in output
+ * @return the number of bytes in the MS-JIS string (including the
+ *         two-byte terminator).  If this is more than output_size,
+ *         the contents of output are undefined.
+ */
+size_t cueify_utf8_to_msjis_into(const char *utf8, uint8_t *output,
+				 size_t output_size);
+
+#ifdef __cplusplus
+};  /* extern "C" */
+#endif  /* __cplusplus */
+
+#endif /* _CUEIFY_CHARSETS_H */
@@ -34,8 +34,10 @@
 #include <cueify/sessions.h>
 #include <cueify/full_toc.h>
 #include <cueify/cdtext.h>
+#include <cueify/charsets.h>
 #include <cueify/mcn_isrc.h>
 #include <cueify/track_data.h>
 #include <cueify/discid.h>
+#include <cueify/async.h>
 
 #endif /* _CUEIFY_CUEIFY_H */
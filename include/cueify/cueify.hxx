@@ -26,6 +26,8 @@
 #ifndef _CUEIFY_CUEIFY_HPP
 #define _CUEIFY_CUEIFY_HPP
 
+#include <cstdlib>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <cueify/cueify.h>
@@ -433,18 +435,13 @@ inline uint32_t TOC::freedbID(Sessions *s) const {
 
 
 inline std::string TOC::musicbrainzID(Sessions *s) const {
-    std::string retval;
-    char *discid;
-    if (s == NULL) {
-	discid = cueify_toc_get_musicbrainz_id(_t, NULL);
-    } else {
-	discid = cueify_toc_get_musicbrainz_id(_t, s->_s);
-    }
-    if (discid != NULL) {
-	retval = std::string(discid);
-	free(discid);
+    char discid[CUEIFY_MUSICBRAINZ_ID_SIZE];
+    if (cueify_toc_get_musicbrainz_id_into(_t, s == NULL ? NULL : s->_s,
+					   discid, sizeof(discid)) !=
+	CUEIFY_OK) {
+	return std::string();
     }
-    return retval;
+    return std::string(discid);
 }  /* TOC::musicbrainzID */
 
 
@@ -543,12 +540,13 @@ public:
      * @return the MusicBrainz discid
      */
     const std::string& musicbrainzID() {
-	char *discid = cueify_full_toc_get_musicbrainz_id(_t);
-	if (discid == NULL) {
+	char discid[CUEIFY_MUSICBRAINZ_ID_SIZE];
+	if (cueify_full_toc_get_musicbrainz_id_into(_t, discid,
+						    sizeof(discid)) !=
+	    CUEIFY_OK) {
 	    _musicbrainzID = std::string();
 	} else {
 	    _musicbrainzID = std::string(discid);
-	    free(discid);
 	}
 	return _musicbrainzID;
     };  /* FullTOC::musicbrainzID */
@@ -920,9 +918,43 @@ public:
      *         will be set appropriately
      */
     std::string serialize() {
-	CUEIFY_SERIALIZER(cueify_cdtext_serialize, _t);
+	uint8_t *buffer = NULL;
+	size_t size = 0;
+	std::string serialization;
+
+	if ((_errorCode = cueify_cdtext_serialize_alloc(_t, &buffer,
+							&size)) != CUEIFY_OK) {
+	    return std::string();
+	}
+	serialization = std::string(reinterpret_cast<const char *>(buffer),
+				    size);
+	free(buffer);
+	return serialization;
     };  /* CDText::serialize */
 
+    /**
+     * Set how CDText::deserialize() handles PACKs which fail their CRC
+     * check.
+     *
+     * @param mode how to handle PACKs failing their CRC check (one of
+     *             CUEIFY_CDTEXT_CRC_*)
+     * @return TRUE if the mode was set
+     */
+    bool setCRCMode(int mode) {
+	_errorCode = cueify_cdtext_set_crc_mode(_t, mode);
+	return _errorCode == CUEIFY_OK;
+    };  /* CDText::setCRCMode */
+
+    /**
+     * Get the number of PACKs which failed their CRC check when this
+     * CD-Text instance was last deserialized (or read).
+     *
+     * @return the number of PACKs failing their CRC check
+     */
+    unsigned int numBadPacks() const {
+	return cueify_cdtext_get_num_bad_packs(_t);
+    };  /* CDText::numBadPacks */
+
     /** The table of contents (TOC) stored in CD-Text. */
     class TOC {
     protected:
@@ -1462,6 +1494,101 @@ public:
 };  /* CDText */
 
 
+/** An index of serialized CD-Text, decoding single strings on request. */
+class CDTextView {
+protected:
+    cueify_cdtext_view *_v;
+    int _errorCode;
+public:
+    /**
+     * Create a new CD-Text view. The view is created with no data, and
+     * should be populated using CDTextView::index().
+     */
+    CDTextView() : _v(cueify_cdtext_view_new()), _errorCode(CUEIFY_OK) { }
+    ~CDTextView() { cueify_cdtext_view_free(_v); }
+
+    /**
+     * Get the most recent error code from a call to this CD-Text view.
+     *
+     * @return the most recent error code
+     */
+    int errorCode() const { return _errorCode; };
+
+    /**
+     * Index serialized CD-Text data in place.  The buffer must remain
+     * valid (and unchanged) for as long as the view is used.
+     *
+     * @pre { buffer != NULL }
+     * @param buffer a pointer to the serialized CD-Text data
+     * @param size the size of the buffer
+     * @return TRUE if the CD-Text was successfully indexed
+     */
+    bool index(const uint8_t * const buffer, size_t size) {
+	_errorCode = cueify_cdtext_view_index(_v, buffer, size);
+	return _errorCode == CUEIFY_OK;
+    };  /* CDTextView::index */
+
+    /**
+     * Get the number of blocks in the CD-Text view.
+     *
+     * @return the number of blocks
+     */
+    uint8_t numBlocks() const {
+	return cueify_cdtext_view_get_num_blocks(_v);
+    };  /* CDTextView::numBlocks */
+
+    /**
+     * Get the character set of a block.
+     *
+     * @param block the number of the block
+     * @return the character set of the block (one of CUEIFY_CDTEXT_CHARSET_*)
+     */
+    uint8_t charset(uint8_t block) const {
+	return cueify_cdtext_view_get_charset(_v, block);
+    };  /* CDTextView::charset */
+
+    /**
+     * Get the language of a block.
+     *
+     * @param block the number of the block
+     * @return the language of the block (one of CUEIFY_CDTEXT_LANG_*)
+     */
+    uint8_t language(uint8_t block) const {
+	return cueify_cdtext_view_get_language(_v, block);
+    };  /* CDTextView::language */
+
+    /**
+     * Decode a single string from a block.
+     *
+     * @param block the number of the block
+     * @param type the type of PACK holding the string (one of
+     *             CUEIFY_CDTEXT_PACK_*)
+     * @param track the number of the track to decode the string for (or
+     *              CUEIFY_CDTEXT_ALBUM for the album)
+     * @return the string if it was decoded; otherwise the empty string
+     *         will be returned and errorCode() will be set appropriately
+     */
+    std::string string(uint8_t block, uint8_t type, uint8_t track) {
+	size_t size = 0;
+	std::string data;
+
+	_errorCode = cueify_cdtext_view_get_string(_v, block, type, track,
+						   NULL, &size);
+	if (_errorCode != CUEIFY_OK) {
+	    return std::string();
+	}
+	data.resize(size);
+	_errorCode = cueify_cdtext_view_get_string(_v, block, type, track,
+						   &data[0], &size);
+	if (_errorCode != CUEIFY_OK) {
+	    return std::string();
+	}
+	data.resize(size - 1);
+	return data;
+    };  /* CDTextView::string */
+};  /* CDTextView */
+
+
 /** An index of a track on an audio CD. */
 class TrackIndex {
 public:
@@ -1488,6 +1615,9 @@ class Device {
 protected:
     cueify_device *_d;
     int _errorCode;
+
+    /** Wrap an already opened device handle. */
+    Device(cueify_device *d) : _d(d), _errorCode(CUEIFY_OK) { };
 public:
     /**
      * Create a new handle for the optical disc (CD-ROM) device
@@ -1518,6 +1648,67 @@ public:
 	}
     };  /* Device::Device(const std::string&) */
 
+    /**
+     * Create a new handle for a disc image (a cue sheet or a raw
+     * image) and open it, as with cueify_device_open_image().
+     *
+     * @param path the path of the cue sheet or raw image to open
+     * @return a new handle, which must be deleted, or NULL if the
+     *         image could not be opened
+     */
+    static Device *openImage(const std::string& path) {
+	cueify_device *d = cueify_device_new();
+
+	if (d != NULL &&
+	    cueify_device_open_image(d, path.c_str()) != CUEIFY_OK) {
+	    cueify_device_free(d);
+	    d = NULL;
+	}
+	return (d == NULL) ? NULL : new Device(d);
+    };  /* Device::openImage(const std::string&) */
+
+    /**
+     * Create a new handle for a disc image in a simulated drive and
+     * open it, as with cueify_device_open_simulated().
+     *
+     * @param path the path of the cue sheet or raw image to open
+     * @param latency the latencies of the drive, or NULL to simulate a
+     *                typical 8x drive
+     * @return a new handle, which must be deleted, or NULL if the
+     *         image could not be opened
+     */
+    static Device *openSimulated(const std::string& path,
+				 const cueify_latency_t *latency = NULL) {
+	cueify_device *d = cueify_device_new();
+
+	if (d != NULL &&
+	    cueify_device_open_simulated(d, path.c_str(),
+					 latency) != CUEIFY_OK) {
+	    cueify_device_free(d);
+	    d = NULL;
+	}
+	return (d == NULL) ? NULL : new Device(d);
+    };  /* Device::openSimulated(const std::string&, const cueify_latency_t *) */
+
+    /**
+     * Create a new handle replaying a trace file, as with
+     * cueify_device_open_trace().
+     *
+     * @param path the path of the trace file to replay
+     * @return a new handle, which must be deleted, or NULL if the
+     *         trace could not be opened
+     */
+    static Device *openTrace(const std::string& path) {
+	cueify_device *d = cueify_device_new();
+
+	if (d != NULL &&
+	    cueify_device_open_trace(d, path.c_str()) != CUEIFY_OK) {
+	    cueify_device_free(d);
+	    d = NULL;
+	}
+	return (d == NULL) ? NULL : new Device(d);
+    };  /* Device::openTrace(const std::string&) */
+
     ~Device() {
 	if (_d != NULL) {
 	    cueify_device_close(_d);
@@ -1555,6 +1746,178 @@ public:
 	}
     };  /* Device::defaultDevice */
 
+    /**
+     * Enable, resize or disable the raw sector cache of this device.
+     *
+     * @note Changing the cache discards any cached sectors and resets
+     *       the hit and miss counters.
+     *
+     * @param capacity the maximum number of sectors to cache, or 0 to
+     *                 disable the cache
+     * @param readAhead the number of sectors to read ahead on a cache miss
+     * @return TRUE if the cache was configured
+     */
+    bool setSectorCache(uint32_t capacity, uint32_t readAhead=0) {
+	_errorCode = cueify_device_set_sector_cache(_d, capacity, readAhead);
+	return _errorCode == CUEIFY_OK;
+    };  /* Device::setSectorCache */
+
+    /**
+     * Get the number of raw sectors served from the sector cache of
+     * this device.
+     *
+     * @return the number of cache hits
+     */
+    uint32_t sectorCacheHits() {
+	uint32_t hits, misses;
+	_errorCode = cueify_device_get_sector_cache_stats(_d, &hits, &misses);
+	return (_errorCode == CUEIFY_OK) ? hits : 0;
+    };  /* Device::sectorCacheHits */
+
+    /**
+     * Get the number of raw sectors which had to be read from this
+     * device because they were not in its sector cache.
+     *
+     * @return the number of cache misses
+     */
+    uint32_t sectorCacheMisses() {
+	uint32_t hits, misses;
+	_errorCode = cueify_device_get_sector_cache_stats(_d, &hits, &misses);
+	return (_errorCode == CUEIFY_OK) ? misses : 0;
+    };  /* Device::sectorCacheMisses */
+
+    /**
+     * Get the simulated time consumed by this device, if it is a
+     * simulated drive.
+     *
+     * @param reset if TRUE, reset the simulated time to zero
+     * @return the simulated time (in milliseconds), or 0 if this is
+     *         not a simulated drive
+     */
+    uint32_t simulatedTime(bool reset = false) {
+	uint32_t ms;
+	_errorCode = cueify_device_get_simulated_time(_d, &ms, reset);
+	return (_errorCode == CUEIFY_OK) ? ms : 0;
+    };  /* Device::simulatedTime */
+
+    /**
+     * Record every command sent to this device to a trace file.
+     *
+     * @param path the path of the trace file to create
+     * @return TRUE if the trace was started
+     */
+    bool startTrace(const std::string& path) {
+	return ((_errorCode = cueify_device_start_trace(_d, path.c_str())) ==
+		CUEIFY_OK);
+    };  /* Device::startTrace */
+
+    /**
+     * Stop recording commands sent to this device.
+     *
+     * @return TRUE if the trace was completely written
+     */
+    bool stopTrace() {
+	return ((_errorCode = cueify_device_stop_trace(_d)) == CUEIFY_OK);
+    };  /* Device::stopTrace */
+
+    /**
+     * Get counters for the commands issued to this device since it
+     * was opened or the counters were last reset.
+     *
+     * @return the counters, which are all zero on error
+     */
+    cueify_device_stats_t stats() {
+	cueify_device_stats_t s;
+	_errorCode = cueify_device_get_stats(_d, &s);
+	if (_errorCode != CUEIFY_OK) {
+	    memset(&s, 0, sizeof(s));
+	}
+	return s;
+    };  /* Device::stats */
+
+    /**
+     * Reset the counters returned by Device::stats() to zero.
+     *
+     * @return TRUE if the counters were reset
+     */
+    bool resetStats() {
+	return ((_errorCode = cueify_device_reset_stats(_d)) == CUEIFY_OK);
+    };  /* Device::resetStats */
+
+    /**
+     * Queue a read of contiguous raw sectors from the disc in this
+     * device, without waiting for it to complete.
+     *
+     * @param lba the absolute address (LBA) of the first sector to read
+     * @param count the number of sectors to read
+     * @param buffer a buffer of at least count * CUEIFY_RAW_READ_SIZE
+     *               bytes, which must remain valid until the callback
+     *               is called
+     * @param size the size of the buffer
+     * @param callback the function to call when the read completes
+     * @param context a pointer to pass to the callback
+     * @return TRUE if the read was queued
+     */
+    bool submitReadRawSectors(uint32_t lba, uint32_t count, uint8_t *buffer,
+			      size_t size,
+			      cueify_completion_callback callback,
+			      void *context) {
+	_errorCode = cueify_device_submit_read_raw_sectors(
+	    _d, lba, count, buffer, size, callback, context);
+	return _errorCode == CUEIFY_OK;
+    };  /* Device::submitReadRawSectors */
+
+    /**
+     * Queue a read of the ISRC of a track on the disc in this device,
+     * without waiting for it to complete.
+     *
+     * @param track the number of the track to read the ISRC of
+     * @param buffer a buffer to write the ISRC to, which must remain
+     *               valid until the callback is called
+     * @param size a pointer to the size of the buffer, which will
+     *             contain the number of bytes written when the
+     *             callback is called
+     * @param callback the function to call when the read completes
+     * @param context a pointer to pass to the callback
+     * @return TRUE if the read was queued
+     */
+    bool submitReadISRC(uint8_t track, char *buffer, size_t *size,
+			cueify_completion_callback callback, void *context) {
+	_errorCode = cueify_device_submit_read_isrc(_d, track, buffer, size,
+						    callback, context);
+	return _errorCode == CUEIFY_OK;
+    };  /* Device::submitReadISRC */
+
+    /**
+     * Call the callbacks of any completed commands submitted to this
+     * device.
+     *
+     * @param wait if true and no submitted command has completed yet,
+     *             block until at least one has
+     * @return TRUE if the completed commands were processed
+     */
+    bool complete(bool wait=false) {
+	_errorCode = cueify_device_complete(_d, wait ? 1 : 0);
+	return _errorCode == CUEIFY_OK;
+    };  /* Device::complete */
+
+    /**
+     * Get the number of commands submitted to this device whose
+     * callbacks have not yet been called.
+     *
+     * @return the number of outstanding commands
+     */
+    uint32_t pendingCommands() { return cueify_device_get_pending(_d); };
+
+    /**
+     * Get a file descriptor which becomes readable when a command
+     * submitted to this device completes.
+     *
+     * @return the file descriptor, or -1 if this device has no
+     *         asynchronous interface
+     */
+    int completionFD() { return cueify_device_get_completion_fd(_d); };
+
     /**
      * Get the most recent error code from a call to this Device.
      *
@@ -1745,6 +2108,42 @@ public:
 	return indices;
     };  /* Device::readTrackIndices */
 
+    /**
+     * Read the indices from every track of the disc in the optical
+     * disc device.  This is considerably faster than calling
+     * readTrackIndices() for each track.
+     *
+     * @return an std::vector containing the track indices of each track
+     *         (as returned by readTrackIndices()), starting with the
+     *         first track on the disc (or an empty vector on failure)
+     */
+    const std::vector<std::vector<TrackIndex> > readAllIndices() {
+	cueify_disc_indices *d = cueify_disc_indices_new();
+	cueify_indices *i;
+	int track, j;
+	std::vector<std::vector<TrackIndex> > indices;
+	_errorCode = CUEIFY_ERR_NOMEM;
+	if (d != NULL &&
+	    (_errorCode = cueify_device_read_all_indices(_d, d)) == CUEIFY_OK) {
+	    for (track = cueify_disc_indices_get_first_track(d);
+		 track <= cueify_disc_indices_get_last_track(d);
+		 track++) {
+		i = cueify_disc_indices_get_track_indices(d, track);
+		indices.push_back(std::vector<TrackIndex>());
+		for (j = 0; j < cueify_indices_get_num_indices(i); j++) {
+		    indices.back().push_back(
+			TrackIndex(
+			    cueify_indices_get_index_number(i, j),
+			    MSFAddress(cueify_indices_get_index_offset(i, j))));
+		}
+	    }
+	}
+	if (d != NULL) {
+	    cueify_disc_indices_free(d);
+	}
+	return indices;
+    };  /* Device::readAllIndices */
+
     /**
      * Read the data mode from a track of the disc in the optical disc
      * device.
@@ -1773,6 +2172,30 @@ public:
     uint8_t readTrackControlFlags(uint8_t track) {
 	return cueify_device_read_track_control_flags(_d, track);
     };  /* Device::readTrackControlFlags */
+
+    /**
+     * Read a run of contiguous raw sectors from the disc in the
+     * optical disc device.
+     *
+     * @param lba the absolute address (LBA) of the first sector to read
+     * @param count the number of sectors to read
+     * @return the raw sectors (CUEIFY_RAW_READ_SIZE bytes per sector) if
+     *         successfully read; otherwise the empty string will be
+     *         returned, and errorCode() will be set appropriately
+     */
+    std::string readRawSectors(uint32_t lba, uint32_t count) {
+	std::vector<uint8_t> buffer(count * CUEIFY_RAW_READ_SIZE);
+
+	if (count == 0 ||
+	    (_errorCode = cueify_device_read_raw_sectors(_d, lba, count,
+							 &buffer[0],
+							 buffer.size()))
+	    != CUEIFY_OK) {
+	    return std::string();
+	}
+	return std::string(reinterpret_cast<const char *>(&buffer[0]),
+			   buffer.size());
+    };  /* Device::readRawSectors */
 };  /* Device */
 
 }  /* namespace cueify */
@@ -26,6 +26,8 @@
 #ifndef _CUEIFY_DEVICE_H
 #define _CUEIFY_DEVICE_H
 
+#include <cueify/types.h>
+
 #ifdef __cplusplus
 extern "C" {
 #endif  /* __cplusplus */
@@ -54,6 +56,12 @@ cueify_device *cueify_device_new();
  * This function should be called after cueify_device_new() but before
  * any other cueify_device_*() functions.
  *
+ * The TOC, sessions, full TOC and CD-Text of the disc are read once
+ * and reused until the media in the device changes.
+ *
+ * @note Media changes are detected on Linux, Windows and Mac OS X.
+ *       On FreeBSD they can't be, so every read goes to the disc.
+ *
  * @pre { d != NULL }
  * @param d an unopened device handle
  * @param device an operating-system-specific device identifier of the
@@ -68,11 +76,164 @@ cueify_device *cueify_device_new();
 int cueify_device_open(cueify_device *d, const char *device);
 
 
+/**
+ * Open a disc image and associate it with a device handle, so that it
+ * may be read with the cueify_device_*() functions as though it were
+ * a disc in an optical disc device.
+ *
+ * The image may be a cue sheet (a path ending in ".cue") naming
+ * BINARY files of AUDIO, MODE1/2352, MODE1/2048, MODE2/2352 or
+ * MODE2/2336 tracks, or a raw image of a single track.  If a file
+ * with the same name as the image, but ending in ".sub", holds 96
+ * bytes of subchannel data per sector, the positions of sectors are
+ * read from it; otherwise they are derived from the cue sheet.
+ * TITLE, PERFORMER, SONGWRITER, COMPOSER, ARRANGER and MESSAGE
+ * commands in the cue sheet are returned as CD-Text, unless a
+ * CDTEXTFILE is named.
+ *
+ * @pre { d != NULL }
+ * @param d an unopened device handle
+ * @param path the path of the cue sheet or raw image to open
+ * @return CUEIFY_OK if the image was successfully opened, otherwise,
+ *         an error code is returned. This error code may include:
+ *         CUEIFY_ERR_NO_DEVICE if the image (or a file it names)
+ *         could not be opened, or CUEIFY_ERR_CORRUPTED if the image
+ *         could not be understood.
+ */
+int cueify_device_open_image(cueify_device *d, const char *path);
+
+
+/** Latencies charged by a simulated optical disc drive. */
+typedef struct {
+    /** Time to issue and complete any command (microseconds). */
+    uint32_t command_us;
+    /**
+     * Additional time to read the TOC, CD-Text, MCN or ISRC
+     * (microseconds).
+     */
+    uint32_t toc_us;
+    /** Time of the shortest seek (microseconds). */
+    uint32_t min_seek_us;
+    /** Time of a seek across the whole disc (microseconds). */
+    uint32_t max_seek_us;
+    /** Read speed as a multiple of 1x (75 sectors per second). */
+    uint32_t speed;
+} cueify_latency_t;
+
+
+/**
+ * Open a disc image (as with cueify_device_open_image()) in a
+ * simulated optical disc drive, which charges simulated time for each
+ * command it performs instead of waiting.
+ *
+ * Each command costs latency->command_us.  Reading the TOC, sessions,
+ * full TOC, CD-Text, MCN or an ISRC costs latency->toc_us more.  A
+ * read of raw sectors (including those needed to find indices, data
+ * modes or track control flags) which does not continue where the
+ * previous one stopped costs a seek, linear in the distance between
+ * min_seek_us and max_seek_us, plus half a revolution of the disc at
+ * the new position; every sector read then costs its transfer time at
+ * the given speed.  Sectors served from the sector cache cost nothing.
+ *
+ * The disc is described as for cueify_device_open_image(): positions
+ * come from a .sub file if one is present, and CD-Text from a
+ * CDTEXTFILE.
+ *
+ * @pre { d != NULL }
+ * @param d an unopened device handle
+ * @param path the path of the cue sheet or raw image to open
+ * @param latency the latencies of the drive, or NULL to simulate a
+ *                typical 8x drive
+ * @return CUEIFY_OK if the image was successfully opened;
+ *         CUEIFY_ERR_BADARG if latency has a speed of 0 or a
+ *         min_seek_us greater than its max_seek_us; otherwise an
+ *         error code is returned, as for cueify_device_open_image()
+ */
+int cueify_device_open_simulated(cueify_device *d, const char *path,
+				 const cueify_latency_t *latency);
+
+
+/**
+ * Get the simulated time consumed by a simulated drive since it was
+ * opened or the time was last reset.
+ *
+ * @pre { d != NULL }
+ * @param d a device handle opened with cueify_device_open_simulated()
+ *          or cueify_device_open_trace()
+ * @param ms a pointer to set to the simulated time (in milliseconds)
+ * @param reset if non-zero, reset the simulated time to zero
+ * @return CUEIFY_OK if the time was returned; otherwise
+ *         CUEIFY_ERR_BADARG if d is not a simulated drive
+ */
+int cueify_device_get_simulated_time(cueify_device *d, uint32_t *ms,
+				     int reset);
+
+
+/**
+ * Record every command sent to an optical disc drive to a trace file,
+ * which may later be replayed with cueify_device_open_trace().  Each
+ * record holds the command, the length of its buffer, the data it
+ * returned (or the sense data if it failed) and the time it took.
+ * Any trace already being recorded is stopped first.
+ *
+ * @note Only devices opened with cueify_device_open() on Linux send
+ *       commands which are recorded; tracing other devices produces a
+ *       trace with no commands.  Commands served from the disc
+ *       metadata snapshot or the sector cache are not sent.
+ *
+ * @pre { d != NULL, d is opened }
+ * @param d an opened device handle
+ * @param path the path of the trace file to create
+ * @return CUEIFY_OK if the trace was started; CUEIFY_ERR_NO_DEVICE if
+ *         the file could not be created; otherwise an appropriate
+ *         error code
+ */
+int cueify_device_start_trace(cueify_device *d, const char *path);
+
+
+/**
+ * Stop recording commands sent to a device.  Closing a device also
+ * stops recording.
+ *
+ * @pre { d != NULL, d is being traced }
+ * @param d a device handle passed to cueify_device_start_trace()
+ * @return CUEIFY_OK if the trace was completely written; otherwise
+ *         CUEIFY_ERR_INTERNAL
+ */
+int cueify_device_stop_trace(cueify_device *d);
+
+
+/**
+ * Open a trace recorded with cueify_device_start_trace() and replay it
+ * through a device handle.  Each command is answered with the data
+ * returned by the next matching command in the trace (wrapping around
+ * at its end); raw sectors not read by an identical command are
+ * pieced together from any command which read them.  A command which
+ * failed when recorded fails again, and one which was never recorded
+ * fails with CUEIFY_ERR_INTERNAL.
+ *
+ * Replayed commands take no real time; instead, the time they took
+ * when recorded is charged as simulated time (see
+ * cueify_device_get_simulated_time() and cueify_device_get_stats()).
+ *
+ * @pre { d != NULL }
+ * @param d an unopened device handle
+ * @param path the path of the trace file to replay
+ * @return CUEIFY_OK if the trace was successfully opened; otherwise
+ *         CUEIFY_ERR_NO_DEVICE if it could not be read, or
+ *         CUEIFY_ERR_CORRUPTED if it is not a trace
+ */
+int cueify_device_open_trace(cueify_device *d, const char *path);
+
+
 /**
  * Close the optical disc device associated with a device handle.
  *
  * @note The device handle may be reused with cueify_device_open()
  *       once it has been closed successfully.
+ * @note Any commands still submitted with cueify_device_submit_*()
+ *       are waited for, and their callbacks called, before the
+ *       device is closed.
  *
  * @pre { d != NULL, cueify_device_open(d) last returned CUEIFY_OK }
  * @param d an opened device handle
@@ -127,6 +288,126 @@ void cueify_device_free(cueify_device *d);
 int cueify_device_get_supported_apis(cueify_device *d);
 
 
+/**
+ * Enable, resize or disable the raw sector cache of a device.
+ *
+ * When enabled, raw sectors read from the device (e.g. while
+ * searching for indices or reading data modes and track control
+ * flags) are kept in a cache of up to capacity sectors, and the least
+ * recently used sectors are discarded when it is full.  Whenever
+ * sectors must be read from the device, up to read_ahead following
+ * sectors are read in the same command and cached as well.  The cache
+ * is emptied when the media in the device changes (on FreeBSD, where
+ * changes can't be detected, before every read).
+ *
+ * @note Changing the cache discards any cached sectors and resets the
+ *       hit and miss counters.  The cache is freed when the device is
+ *       closed.
+ *
+ * @pre { d != NULL, cueify_device_open(d) last returned CUEIFY_OK }
+ * @param d an opened device handle
+ * @param capacity the maximum number of sectors to cache, or 0 to
+ *                 disable the cache
+ * @param read_ahead the number of sectors to read ahead on a cache miss
+ * @return CUEIFY_OK if the cache was configured; otherwise an error
+ *         code is returned
+ */
+int cueify_device_set_sector_cache(cueify_device *d, uint32_t capacity,
+				   uint32_t read_ahead);
+
+
+/**
+ * Get the number of raw sectors which were served from the sector
+ * cache of a device and the number which had to be read from the
+ * device since the cache was configured.
+ *
+ * @pre { d != NULL }
+ * @param d an opened device handle
+ * @param hits a pointer to set to the number of cache hits
+ * @param misses a pointer to set to the number of cache misses
+ * @return CUEIFY_OK if the counters were returned; otherwise an error
+ *         code is returned
+ */
+int cueify_device_get_sector_cache_stats(cueify_device *d, uint32_t *hits,
+					 uint32_t *misses);
+
+
+/** READ TOC/PMA/ATIP commands for the TOC (format 0000b). */
+#define CUEIFY_COMMAND_READ_TOC         0
+/** READ TOC/PMA/ATIP commands for the session info (format 0001b). */
+#define CUEIFY_COMMAND_READ_SESSIONS    1
+/** READ TOC/PMA/ATIP commands for the full TOC (format 0010b). */
+#define CUEIFY_COMMAND_READ_FULL_TOC    2
+/** READ TOC/PMA/ATIP commands for the CD-Text (format 0101b). */
+#define CUEIFY_COMMAND_READ_CDTEXT      3
+/** READ SUB-CHANNEL commands (for the MCN or an ISRC). */
+#define CUEIFY_COMMAND_READ_SUBCHANNEL  4
+/** READ CD commands (for raw sectors and positions). */
+#define CUEIFY_COMMAND_READ_CD          5
+/** Number of kinds of commands counted in cueify_device_stats_t. */
+#define CUEIFY_NUM_COMMANDS             6
+
+/**
+ * Number of buckets in a latency histogram.  Bucket 0 counts commands
+ * which took less than 2 microseconds, bucket n (for 0 < n < 23)
+ * those which took at least 2^n but less than 2^(n+1) microseconds,
+ * and bucket 23 all longer commands.
+ */
+#define CUEIFY_LATENCY_BUCKETS  24
+
+/** Counters for one kind of command issued to a device. */
+typedef struct {
+    uint32_t count;  /** Number of commands issued. */
+    /** Number of commands which failed (other than for lack of data). */
+    uint32_t errors;
+    /** Number of bytes of data returned (modulo 2^32). */
+    uint32_t bytes;
+    /** Total time taken by the commands (microseconds, modulo 2^32). */
+    uint32_t total_us;
+    uint32_t max_us;  /** Time taken by the slowest command (microseconds). */
+    /** Number of commands by the time they took (see above). */
+    uint32_t histogram[CUEIFY_LATENCY_BUCKETS];
+} cueify_command_stats_t;
+
+/** Counters for the commands issued to a device. */
+typedef struct {
+    /** Counters for each kind of command (CUEIFY_COMMAND_*). */
+    cueify_command_stats_t commands[CUEIFY_NUM_COMMANDS];
+} cueify_device_stats_t;
+
+
+/**
+ * Get counters for the commands issued to a device since it was
+ * opened or the counters were last reset.
+ *
+ * Commands are counted as libcueify issues them: reads served from
+ * the disc metadata snapshot or the sector cache are not counted, and
+ * a read of raw sectors counts once even if the operating system
+ * splits it.  Times are wall-clock times, except for simulated drives
+ * (see cueify_device_open_simulated()), where they are simulated.
+ * Queued commands (see <cueify/async.h>) are timed from when they are
+ * issued to when their completion is collected.
+ *
+ * @pre { d != NULL, stats != NULL }
+ * @param d an opened device handle
+ * @param stats a pointer to the counters to populate
+ * @return CUEIFY_OK if the counters were returned; otherwise an error
+ *         code is returned
+ */
+int cueify_device_get_stats(cueify_device *d, cueify_device_stats_t *stats);
+
+
+/**
+ * Reset the counters returned by cueify_device_get_stats() to zero.
+ *
+ * @pre { d != NULL }
+ * @param d an opened device handle
+ * @return CUEIFY_OK if the counters were reset; otherwise an error
+ *         code is returned
+ */
+int cueify_device_reset_stats(cueify_device *d);
+
+
 /**
  * Get an operating-system-specific device identifier for the default
  * optical disc (CD-ROM) device in this system.
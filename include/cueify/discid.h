@@ -80,6 +80,35 @@ uint32_t cueify_full_toc_get_freedb_id(cueify_full_toc *t,
 uint32_t cueify_device_get_freedb_id(cueify_device *d, int use_data_tracks);
 
 
+/**
+ * Calculate the freedb discids of many discs at once from a compact
+ * representation of their TOCs, without needing a cueify_toc for
+ * each of them.  The discids are identical to those returned by
+ * cueify_toc_get_freedb_id() for TOCs with the same track and lead-out
+ * addresses.
+ *
+ * @param count the number of discs
+ * @param track_counts an array of the count numbers of tracks (at
+ *                     least 1) of each disc which should be used to
+ *                     calculate its discid
+ * @param track_lbas an array of the LBA addresses of the tracks of
+ *                   every disc, one disc after the other: the
+ *                   track_counts[0] tracks of the first disc, followed
+ *                   by the track_counts[1] tracks of the second disc,
+ *                   and so on
+ * @param leadout_lbas an array of the count LBA addresses of the
+ *                     lead-out of each disc (adjusted, like
+ *                     cueify_toc_get_freedb_id() does, to exclude any
+ *                     data tracks at the end of a multisession disc)
+ * @param ids an array of count integers to write the freedb discids to
+ * @return CUEIFY_OK if the discids were calculated; otherwise an error
+ *         code is returned
+ */
+int cueify_get_freedb_id_batch(size_t count, const uint8_t *track_counts,
+			       const uint32_t *track_lbas,
+			       const uint32_t *leadout_lbas, uint32_t *ids);
+
+
 /**
  * Calculate the MusicBrainz discid from the provided TOC and
  * multisession data.
@@ -101,6 +130,55 @@ uint32_t cueify_device_get_freedb_id(cueify_device *d, int use_data_tracks);
 char *cueify_toc_get_musicbrainz_id(cueify_toc *t, cueify_sessions *s);
 
 
+/** Number of bytes in a MusicBrainz discid (including the terminator). */
+#define CUEIFY_MUSICBRAINZ_ID_SIZE  29
+
+
+/**
+ * Calculate the MusicBrainz discid from the provided TOC and
+ * multisession data into a caller-provided buffer, without allocating
+ * (or formatting) anything.
+ *
+ * @pre { t has been initialized }
+ * @param t the TOC of the disc for which the MusicBrainz discid
+ *          should be calculated
+ * @param s the multisession data of the disc for which the
+ *          MusicBrainz discid should be calculated.  If NULL,
+ *          heuristics will be applied to guess whether or not the
+ *          disc has multiple sessions.
+ * @param id a buffer to write the null-terminated MusicBrainz discid to
+ * @param size the number of bytes in id (at least
+ *             CUEIFY_MUSICBRAINZ_ID_SIZE)
+ * @return CUEIFY_OK if the discid was calculated; otherwise an error
+ *         code is returned
+ */
+int cueify_toc_get_musicbrainz_id_into(cueify_toc *t, cueify_sessions *s,
+				       char *id, size_t size);
+
+
+/**
+ * Calculate the MusicBrainz discids of many TOCs at once, hashing
+ * several of them in parallel where the processor allows (up to 16 at
+ * a time with AVX-512).
+ *
+ * @pre { t[0..count-1] have been initialized }
+ * @param t an array of the count TOCs of the discs for which the
+ *          MusicBrainz discids should be calculated
+ * @param s an array of the count multisession data of the same discs
+ *          (any of which may be NULL), or NULL.  Where NULL,
+ *          heuristics will be applied to guess whether or not the
+ *          disc has multiple sessions.
+ * @param count the number of TOCs in t
+ * @param ids a buffer of count * CUEIFY_MUSICBRAINZ_ID_SIZE bytes to
+ *            write the discids to; the null-terminated discid of t[i]
+ *            is written at ids + i * CUEIFY_MUSICBRAINZ_ID_SIZE
+ * @return CUEIFY_OK if the discids were calculated; otherwise an error
+ *         code is returned
+ */
+int cueify_toc_get_musicbrainz_id_batch(cueify_toc **t, cueify_sessions **s,
+					size_t count, char *ids);
+
+
 /**
  * Calculate the MusicBrainz discid from the provided full TOC.
  *
@@ -113,6 +191,42 @@ char *cueify_toc_get_musicbrainz_id(cueify_toc *t, cueify_sessions *s);
 char *cueify_full_toc_get_musicbrainz_id(cueify_full_toc *t);
 
 
+/**
+ * Calculate the MusicBrainz discid from the provided full TOC into a
+ * caller-provided buffer, without allocating (or formatting) anything.
+ *
+ * @pre { t has been initialized }
+ * @param t the full TOC of the disc for which the MusicBrainz discid
+ *          should be calculated
+ * @param id a buffer to write the null-terminated MusicBrainz discid to
+ * @param size the number of bytes in id (at least
+ *             CUEIFY_MUSICBRAINZ_ID_SIZE)
+ * @return CUEIFY_OK if the discid was calculated; otherwise an error
+ *         code is returned
+ */
+int cueify_full_toc_get_musicbrainz_id_into(cueify_full_toc *t,
+					    char *id, size_t size);
+
+
+/**
+ * Calculate the MusicBrainz discids of many full TOCs at once, hashing
+ * several of them in parallel where the processor allows (up to 16 at
+ * a time with AVX-512).
+ *
+ * @pre { t[0..count-1] have been initialized }
+ * @param t an array of the count full TOCs of the discs for which the
+ *          MusicBrainz discids should be calculated
+ * @param count the number of full TOCs in t
+ * @param ids a buffer of count * CUEIFY_MUSICBRAINZ_ID_SIZE bytes to
+ *            write the discids to; the null-terminated discid of t[i]
+ *            is written at ids + i * CUEIFY_MUSICBRAINZ_ID_SIZE
+ * @return CUEIFY_OK if the discids were calculated; otherwise an error
+ *         code is returned
+ */
+int cueify_full_toc_get_musicbrainz_id_batch(cueify_full_toc **t,
+					     size_t count, char *ids);
+
+
 /**
  * Calculate the MusicBrainz discid from the disc currently in an optical
  * disc (CD-ROM) device.
@@ -114,6 +114,90 @@ uint8_t cueify_indices_get_index_number(cueify_indices *i, uint8_t index);
 cueify_msf_t cueify_indices_get_index_offset(cueify_indices *i, uint8_t index);
 
 
+/**
+ * A transparent handle for the track indices of every track on an
+ * audio CD.
+ *
+ * This is returned by cueify_disc_indices_new() and is passed as the
+ * first parameter to all cueify_disc_indices_*() functions.
+ */
+typedef void *cueify_disc_indices;
+
+
+/**
+ * Create a new disc indices instance. The instance is created with
+ * no data, and should be populated using cueify_device_read_all_indices().
+ *
+ * @return NULL if there was an error allocating memory, else the new
+ *         disc indices instance
+ */
+cueify_disc_indices *cueify_disc_indices_new();
+
+
+/**
+ * Read the track indices of every track on a disc in an optical disc
+ * (CD-ROM) device associated with a device handle.
+ *
+ * @note This reads the TOC only once and visits the tracks in disc
+ *       order, and is considerably faster than calling
+ *       cueify_device_read_track_indices() for each track.
+ *
+ * @pre { d != NULL, i != NULL }
+ * @param d an opened device handle
+ * @param i a disc indices instance to populate
+ * @return CUEIFY_OK if the indices were successfully read; otherwise
+ *         an error code is returned
+ */
+int cueify_device_read_all_indices(cueify_device *d, cueify_disc_indices *i);
+
+
+/**
+ * Free a disc indices instance. Deletes the object pointed to by i,
+ * along with all track indices instances returned by
+ * cueify_disc_indices_get_track_indices().
+ *
+ * @pre { i != NULL }
+ * @param i a cueify_disc_indices object created by cueify_disc_indices_new()
+ */
+void cueify_disc_indices_free(cueify_disc_indices *i);
+
+
+/**
+ * Get the number of the first track in a disc indices instance.
+ *
+ * @pre { i != NULL }
+ * @param i a disc indices instance
+ * @return the number of the first track in i
+ */
+uint8_t cueify_disc_indices_get_first_track(cueify_disc_indices *i);
+
+
+/**
+ * Get the number of the last track in a disc indices instance.
+ *
+ * @pre { i != NULL }
+ * @param i a disc indices instance
+ * @return the number of the last track in i
+ */
+uint8_t cueify_disc_indices_get_last_track(cueify_disc_indices *i);
+
+
+/**
+ * Get the track indices of a track in a disc indices instance.
+ *
+ * @note The returned instance belongs to i and must not be freed.
+ *
+ * @pre { i != NULL, track in range of track numbers in i }
+ * @param i a disc indices instance
+ * @param track the number of the track for which indices should be
+ *              returned
+ * @return the track indices of track number track in i, or NULL if
+ *         there is no such track
+ */
+cueify_indices *cueify_disc_indices_get_track_indices(cueify_disc_indices *i,
+						      uint8_t track);
+
+
 /** Track is CD-DA (Audio) */
 #define CUEIFY_DATA_MODE_CDDA     0x00
 /** Track is Mode 1 */
@@ -155,6 +239,39 @@ int cueify_device_read_data_mode(cueify_device *d, uint8_t track);
 uint8_t cueify_device_read_track_control_flags(cueify_device *d,
 					       uint8_t track);
 
+
+/**
+ * Number of bytes returned for each sector by
+ * cueify_device_read_raw_sectors(): the 2352-byte raw sector followed
+ * by 16 bytes of sub-Q-channel data.
+ */
+#define CUEIFY_RAW_READ_SIZE  2368
+
+/**
+ * Read a run of contiguous raw sectors from the disc in an optical
+ * disc (CD-ROM) device associated with a device handle.
+ *
+ * @note Where the operating system allows it, the sectors are read
+ *       with a single READ CD command (or as few as the maximum
+ *       transfer length of the device allows), which is considerably
+ *       faster than reading them one at a time.
+ *
+ * @pre { d != NULL, buffer != NULL }
+ * @param d an opened device handle
+ * @param lba the absolute address (LBA) of the first sector to read
+ * @param count the number of sectors to read
+ * @param buffer a buffer to read the sectors into.  Sector n is stored
+ *               at offset n * CUEIFY_RAW_READ_SIZE.
+ * @param size the size of buffer, which must be at least
+ *             count * CUEIFY_RAW_READ_SIZE
+ * @return CUEIFY_OK if the sectors were successfully read;
+ *         CUEIFY_ERR_TOOSMALL if buffer cannot hold count sectors;
+ *         otherwise an error code is returned
+ */
+int cueify_device_read_raw_sectors(cueify_device *d, uint32_t lba,
+				   uint32_t count, uint8_t *buffer,
+				   size_t size);
+
 #ifdef __cplusplus
 };  /* extern "C" */
 #endif  /* __cplusplus */
@@ -28,129 +28,124 @@
 
 #include "charsets.h"
 
-size_t ascii_byte_count(char *utf8) {
-    size_t size = 0;
-    uint8_t *bp = (uint8_t *)utf8;
-    uint32_t character;
+#if defined(__GNUC__) && defined(__AVX2__)
+#define ASCII_SPAN_AVX2 1
+#include <immintrin.h>
+#endif
 
-    while (*bp != 0) {
-	character = 0;
-	if (*bp <= 0x7F) {
-	    /* 1-byte codepoint */
-	    character = *bp++;
-	} else if (*bp <= 0xBF) {
-	    /* Invalid codepoint */
-	    character = '?';
-	    bp++;
-	} else if (*bp <= 0xDF) {
-	    /* 2-byte codepoint */
-	    character  = (*bp++ & 0x1F) << 6;
-	    character |= (*bp++ & 0x3F);
-	    if (character <= 0x7F) {
-		character = '?';
-	    }
-	} else if (*bp <= 0xEF) {
-	    /* 3-byte codepoint */
-	    character  = (*bp++ & 0x0F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	} else if (*bp <= 0xF7) {
-	    /* 4-byte codepoint */
-	    character  = (*bp++ & 0x07) << 18;
-	    character |= (*bp++ & 0x3F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	} else if (*bp <= 0xFB) {
-	    /* 5-byte codepoint */
-	    character  = (*bp++ & 0x03) << 24;
-	    character |= (*bp++ & 0x3F) << 18;
-	    character |= (*bp++ & 0x3F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	} else if (*bp <= 0xFD) {
-	    /* 6-byte codepoint */
-	    character  = (*bp++ & 0x01) << 30;
-	    character |= (*bp++ & 0x3F) << 24;
-	    character |= (*bp++ & 0x3F) << 18;
-	    character |= (*bp++ & 0x3F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
+#if defined(__GNUC__) && defined(__SSE2__)
+#define ASCII_SPAN_SSE2 1
+#include <emmintrin.h>
+#elif defined(__GNUC__) && defined(__ARM_NEON) && defined(__aarch64__)
+#define ASCII_SPAN_NEON 1
+#include <arm_neon.h>
+#endif
+
+size_t ascii_span(const uint8_t *bytes, size_t size) {
+    size_t i = 0;
+    uint64_t word;
+#if defined(ASCII_SPAN_AVX2) || defined(ASCII_SPAN_SSE2)
+    unsigned int mask;
+#endif
+
+    /*
+     * Adding 1 (with saturation) sets the top bit of DEL and every
+     * byte above it, which can then be found with a movemask.
+     */
+#ifdef ASCII_SPAN_AVX2
+    for (; i + 32 <= size; i += 32) {
+	mask = (unsigned int)_mm256_movemask_epi8(
+	    _mm256_adds_epu8(_mm256_loadu_si256((const __m256i *)(bytes + i)),
+			     _mm256_set1_epi8(1)));
+	if (mask != 0) {
+	    return i + __builtin_ctz(mask);
 	}
-	if (character > 0x7F) {
-	    character = '?';
+    }
+#endif
+#if defined(ASCII_SPAN_SSE2)
+    for (; i + 16 <= size; i += 16) {
+	mask = (unsigned int)_mm_movemask_epi8(
+	    _mm_adds_epu8(_mm_loadu_si128((const __m128i *)(bytes + i)),
+			  _mm_set1_epi8(1)));
+	if (mask != 0) {
+	    return i + __builtin_ctz(mask);
 	}
-	size++;
     }
-    /* Include the terminator */
-    size++;
+#elif defined(ASCII_SPAN_NEON)
+    for (; i + 16 <= size; i += 16) {
+	if (vmaxvq_u8(vld1q_u8(bytes + i)) >= 0x7F) {
+	    /* Find the byte below. */
+	    break;
+	}
+    }
+#endif
 
-    return size;
+    /* Otherwise test a word at a time, in the same manner. */
+    for (; i + sizeof(word) <= size; i += sizeof(word)) {
+	memcpy(&word, bytes + i, sizeof(word));
+	if ((((word & 0x7F7F7F7F7F7F7F7FULL) + 0x0101010101010101ULL) | word) &
+	    0x8080808080808080ULL) {
+	    break;
+	}
+    }
+    while (i < size && bytes[i] < 0x7F) {
+	i++;
+    }
+
+    return i;
+}  /* ascii_span */
+
+
+size_t ascii_byte_count(char *utf8) {
+    return cueify_utf8_to_ascii_into(utf8, NULL, 0);
 }  /* ascii_byte_count */
 
 
 uint8_t *utf8_to_ascii(char *utf8, size_t *size) {
-    uint8_t *output = NULL, *output_ptr = NULL;
-    uint8_t *bp = (uint8_t *)utf8;
-    uint32_t character;
+    uint8_t *output = NULL;
 
     *size = strlen(utf8) + 1;
     output = malloc(*size);
     if (output == NULL) {
 	return NULL;
     }
-    output_ptr = output;
-
-    while (*bp != 0) {
-	character = 0;
-	if (*bp <= 0x7F) {
-	    /* 1-byte codepoint */
-	    character = *bp++;
-	} else if (*bp <= 0xBF) {
-	    /* Invalid codepoint */
-	    character = '?';
-	    bp++;
-	} else if (*bp <= 0xDF) {
-	    /* 2-byte codepoint */
-	    character  = (*bp++ & 0x1F) << 6;
-	    character |= (*bp++ & 0x3F);
-	    if (character <= 0x7F) {
+
+    *size = cueify_utf8_to_ascii_into(utf8, output, *size);
+
+    return output;
+}  /* utf8_to_ascii */
+
+
+size_t cueify_utf8_to_ascii_into(const char *utf8, uint8_t *output,
+				 size_t output_size) {
+    const uint8_t *bp = (const uint8_t *)utf8, *end = bp + strlen(utf8);
+    uint32_t character;
+    size_t size = 0, run;
+
+    while (bp < end) {
+	/* Runs of ASCII are copied in bulk. */
+	run = ascii_span(bp, end - bp);
+	if (output != NULL && size + run < output_size) {
+	    memcpy(output + size, bp, run);
+	}
+	bp += run;
+	size += run;
+	if (bp < end) {
+	    character = utf8_decode(&bp);
+	    if (character > 0x7F) {
 		character = '?';
 	    }
-	} else if (*bp <= 0xEF) {
-	    /* 3-byte codepoint */
-	    character  = (*bp++ & 0x0F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	} else if (*bp <= 0xF7) {
-	    /* 4-byte codepoint */
-	    character  = (*bp++ & 0x07) << 18;
-	    character |= (*bp++ & 0x3F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	} else if (*bp <= 0xFB) {
-	    /* 5-byte codepoint */
-	    character  = (*bp++ & 0x03) << 24;
-	    character |= (*bp++ & 0x3F) << 18;
-	    character |= (*bp++ & 0x3F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	} else if (*bp <= 0xFD) {
-	    /* 6-byte codepoint */
-	    character  = (*bp++ & 0x01) << 30;
-	    character |= (*bp++ & 0x3F) << 24;
-	    character |= (*bp++ & 0x3F) << 18;
-	    character |= (*bp++ & 0x3F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	}
-	if (character > 0x7F) {
-	    character = '?';
+	    if (output != NULL && size + 1 < output_size) {
+		output[size] = (uint8_t)character;
+	    }
+	    size++;
 	}
-	*output_ptr++ = (uint8_t)character;
     }
     /* Include the terminator */
-    *output_ptr = '\0';
-    *size = (output_ptr - output) + 1;
+    if (output != NULL && size < output_size) {
+	output[size] = '\0';
+    }
+    size++;
 
-    return output;
-}  /* utf8_to_ascii */
+    return size;
+}  /* cueify_utf8_to_ascii_into */
@@ -0,0 +1,410 @@
+/* async.c - Asynchronous command queue for optical disc devices
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <cueify/async.h>
+#include <cueify/error.h>
+#include "device_private.h"
+#include "backend_private.h"
+#include "stats_private.h"
+
+/**
+ * Get the asynchronous state of a device, creating it if needed.
+ *
+ * @param d an opened device handle
+ * @return the asynchronous state, or NULL if it could not be allocated
+ */
+static cueify_async_private *async_state(cueify_device_private *d) {
+    if (d->async == NULL) {
+	d->async = calloc(1, sizeof(cueify_async_private));
+    }
+    return d->async;
+}  /* async_state */
+
+
+/**
+ * Record the result of some of the commands of a request, and move the
+ * request to the list of completed requests once all of its commands
+ * are done.
+ *
+ * @param async the asynchronous state of the device
+ * @param request the request the commands were issued for
+ * @param status the result of the commands
+ * @param commands the number of commands which are done
+ */
+static void request_done(cueify_async_private *async,
+			 cueify_async_request_private *request, int status,
+			 uint32_t commands) {
+    if (request->status == CUEIFY_OK) {
+	request->status = status;
+    }
+    request->remaining -= commands;
+    if (request->remaining > 0) {
+	return;
+    }
+
+    request->next = NULL;
+    if (async->done_tail != NULL) {
+	async->done_tail->next = request;
+    } else {
+	async->done_head = request;
+    }
+    async->done_tail = request;
+}  /* request_done */
+
+
+/**
+ * Record the result of a command.
+ *
+ * @param d the device the command was issued to
+ * @param c the command which completed, which is freed
+ * @param status the result of the command
+ */
+static void command_done(cueify_device_private *d,
+			 cueify_async_command_private *c, int status) {
+    cueify_async_request_private *request = c->request;
+
+    if (c->type == ASYNC_READ_RAW) {
+	if (status == CUEIFY_OK &&
+	    c->transferred < c->count * sizeof(cueify_raw_read_private)) {
+	    /* The rest of the buffer holds no sectors. */
+	    status = CUEIFY_ERR_INTERNAL;
+	}
+	cueify_stats_record(d, CUEIFY_COMMAND_READ_CD, c->start,
+			    c->transferred, status);
+    } else {
+	cueify_stats_record(d, CUEIFY_COMMAND_READ_SUBCHANNEL, c->start,
+			    c->transferred, status);
+    }
+    free(c);
+    request_done(d->async, request, status, 1);
+}  /* command_done */
+
+
+/**
+ * Cancel and fail every command in flight on a device.
+ *
+ * @param d an opened device handle
+ * @param status the result to give the commands
+ */
+static void fail_in_flight(cueify_device_private *d, int status) {
+    cueify_async_command_private *c;
+
+    /* Make sure the device no longer writes into their buffers. */
+    d->backend->cancel(d);
+    while (d->async->in_flight_head != NULL) {
+	c = d->async->in_flight_head;
+	d->async->in_flight_head = c->next;
+	d->async->in_flight--;
+	command_done(d, c, status);
+    }
+}  /* fail_in_flight */
+
+
+/**
+ * Collect a completed command from a device.  If the device fails such
+ * that no command can be collected, every command in flight is failed.
+ *
+ * @param d an opened device handle
+ * @param wait if non-zero, block until a command completes
+ * @return 1 if a command was collected or failed; otherwise 0
+ */
+static int reap_command(cueify_device_private *d, int wait) {
+    cueify_async_command_private *c, **link;
+    int status;
+
+    if (d->async->in_flight == 0) {
+	return 0;
+    }
+    status = d->backend->reap(d, wait, &c);
+    if (c == NULL) {
+	if (status != CUEIFY_OK) {
+	    fail_in_flight(d, status);
+	    return 1;
+	}
+	return 0;
+    }
+
+    for (link = &d->async->in_flight_head; *link != NULL;
+	 link = &(*link)->next) {
+	if (*link == c) {
+	    *link = c->next;
+	    break;
+	}
+    }
+    d->async->in_flight--;
+    command_done(d, c, status);
+    return 1;
+}  /* reap_command */
+
+
+/**
+ * Block until a command in flight on a device completes.  If waiting
+ * makes no progress, the device is assumed never to complete the
+ * commands in flight, and they are failed instead.
+ *
+ * @param d an opened device handle with commands in flight
+ */
+static void wait_command(cueify_device_private *d) {
+    if (reap_command(d, 1) == 0) {
+	fail_in_flight(d, CUEIFY_ERR_INTERNAL);
+    }
+}  /* wait_command */
+
+
+/**
+ * Issue a command to a device, performing it synchronously if the
+ * device has no asynchronous interface.
+ *
+ * @param d an opened device handle
+ * @param c the command to issue, which is owned by the queue from now on
+ */
+static void issue_command(cueify_device_private *d,
+			  cueify_async_command_private *c) {
+    int status;
+
+    if (d->backend->issue != NULL) {
+	/* Make room in the queue of the device. */
+	while (d->async->in_flight >= ASYNC_QUEUE_DEPTH) {
+	    wait_command(d);
+	}
+	c->start = cueify_stats_start(d);
+	status = d->backend->issue(d, c);
+	if (status == CUEIFY_OK) {
+	    c->next = d->async->in_flight_head;
+	    d->async->in_flight_head = c;
+	    d->async->in_flight++;
+	    return;
+	} else if (status != CUEIFY_ERR_NO_DEVICE) {
+	    command_done(d, c, status);
+	    return;
+	}
+    }
+
+    c->start = cueify_stats_start(d);
+    d->transferred = 0;
+    if (c->type == ASYNC_READ_RAW) {
+	status = d->backend->read_raw_sectors(d, c->lba, c->count,
+					      c->sectors);
+    } else {
+	status = d->backend->read_isrc(d, c->track, c->isrc, c->isrc_size);
+    }
+    c->transferred = d->transferred;
+    command_done(d, c, status);
+}  /* issue_command */
+
+
+/**
+ * Create a request.
+ *
+ * @param d an opened device handle
+ * @param callback the function to call when the request completes
+ * @param context a pointer to pass to the callback
+ * @param commands the number of commands the request will be split into
+ * @return the new request, or NULL if it could not be allocated
+ */
+static cueify_async_request_private *request_new(
+    cueify_device_private *d, cueify_completion_callback callback,
+    void *context, uint32_t commands) {
+    cueify_async_request_private *request;
+
+    if (async_state(d) == NULL) {
+	return NULL;
+    }
+    request = calloc(1, sizeof(cueify_async_request_private));
+    if (request == NULL) {
+	return NULL;
+    }
+    request->callback = callback;
+    request->context = context;
+    request->status = CUEIFY_OK;
+    request->remaining = commands;
+    d->async->pending++;
+
+    return request;
+}  /* request_new */
+
+
+int cueify_device_submit_read_raw_sectors(cueify_device *d, uint32_t lba,
+					  uint32_t count, uint8_t *buffer,
+					  size_t size,
+					  cueify_completion_callback callback,
+					  void *context) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+    cueify_raw_read_private *sectors = (cueify_raw_read_private *)buffer;
+    cueify_async_request_private *request;
+    cueify_async_command_private *c;
+    uint32_t max_sectors, commands, length;
+
+    if (d == NULL || buffer == NULL || callback == NULL || count == 0) {
+	return CUEIFY_ERR_BADARG;
+    }
+    if (size / sizeof(cueify_raw_read_private) < count) {
+	return CUEIFY_ERR_TOOSMALL;
+    }
+
+    /* Never ask for more than the device can transfer at once. */
+    max_sectors = dev->max_transfer / sizeof(cueify_raw_read_private);
+    if (max_sectors == 0) {
+	max_sectors = 1;
+    }
+    commands = (count + max_sectors - 1) / max_sectors;
+
+    request = request_new(dev, callback, context, commands);
+    if (request == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+
+    while (count > 0) {
+	length = (count > max_sectors) ? max_sectors : count;
+
+	c = calloc(1, sizeof(cueify_async_command_private));
+	if (c == NULL) {
+	    /* Fail the commands which will never be issued. */
+	    request_done(dev->async, request, CUEIFY_ERR_NOMEM, commands);
+	    break;
+	}
+	c->request = request;
+	c->type = ASYNC_READ_RAW;
+	c->lba = lba;
+	c->count = length;
+	c->sectors = sectors;
+	issue_command(dev, c);
+
+	lba += length;
+	count -= length;
+	sectors += length;
+	commands--;
+    }
+
+    return CUEIFY_OK;
+}  /* cueify_device_submit_read_raw_sectors */
+
+
+int cueify_device_submit_read_isrc(cueify_device *d, uint8_t track,
+				   char *buffer, size_t *size,
+				   cueify_completion_callback callback,
+				   void *context) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+    cueify_async_request_private *request;
+    cueify_async_command_private *c;
+
+    if (d == NULL || buffer == NULL || size == NULL || callback == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    c = calloc(1, sizeof(cueify_async_command_private));
+    if (c == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    request = request_new(dev, callback, context, 1);
+    if (request == NULL) {
+	free(c);
+	return CUEIFY_ERR_NOMEM;
+    }
+    c->request = request;
+    c->type = ASYNC_READ_ISRC;
+    c->track = track;
+    c->isrc = buffer;
+    c->isrc_size = size;
+    issue_command(dev, c);
+
+    return CUEIFY_OK;
+}  /* cueify_device_submit_read_isrc */
+
+
+int cueify_device_complete(cueify_device *d, int wait) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+    cueify_async_private *async;
+    cueify_async_request_private *request;
+
+    if (d == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+    async = dev->async;
+    if (async == NULL) {
+	return CUEIFY_OK;
+    }
+
+    /* Collect whatever has finished, blocking only if nothing has. */
+    while (reap_command(dev, 0));
+    while (wait && async->done_head == NULL && async->in_flight > 0) {
+	wait_command(dev);
+    }
+
+    /* Callbacks may submit more requests, so detach the list first. */
+    request = async->done_head;
+    async->done_head = NULL;
+    async->done_tail = NULL;
+    while (request != NULL) {
+	cueify_async_request_private *next = request->next;
+
+	async->pending--;
+	request->callback(request->context, request->status);
+	free(request);
+	request = next;
+    }
+
+    return CUEIFY_OK;
+}  /* cueify_device_complete */
+
+
+uint32_t cueify_device_get_pending(cueify_device *d) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+
+    if (d == NULL || dev->async == NULL) {
+	return 0;
+    }
+    return dev->async->pending;
+}  /* cueify_device_get_pending */
+
+
+int cueify_device_get_completion_fd(cueify_device *d) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+
+    if (d == NULL || dev->backend->get_completion_fd == NULL) {
+	return -1;
+    }
+    return dev->backend->get_completion_fd(dev);
+}  /* cueify_device_get_completion_fd */
+
+
+void cueify_async_free(cueify_device_private *d) {
+    if (d->async == NULL) {
+	return;
+    }
+
+    /*
+     * The device may still be writing into the buffers of requests,
+     * which may be freed as soon as they are called back.
+     */
+    while (d->async->in_flight > 0) {
+	wait_command(d);
+    }
+    cueify_device_complete((cueify_device *)d, 0);
+    free(d->async);
+    d->async = NULL;
+}  /* cueify_async_free */
@@ -0,0 +1,154 @@
+/* async_private.h - Private asynchronous command queue API
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CUEIFY_ASYNC_PRIVATE_H
+#define _CUEIFY_ASYNC_PRIVATE_H
+
+#include <cueify/types.h>
+#include <cueify/async.h>
+#include "device_private.h"
+
+/** Internal structure for a request submitted with cueify_device_submit_*(). */
+typedef struct cueify_async_request_private {
+    cueify_completion_callback callback;  /** Function to call when done. */
+    void *context;  /** Context to pass to the callback. */
+    int status;  /** Result of the first failed command, or CUEIFY_OK. */
+    uint32_t remaining;  /** Number of commands still in flight. */
+    /** Next request in the list of completed requests. */
+    struct cueify_async_request_private *next;
+} cueify_async_request_private;
+
+
+/** Maximum number of commands to have in flight on a device at once. */
+#define ASYNC_QUEUE_DEPTH  16
+
+/* Types of asynchronous commands. */
+#define ASYNC_READ_RAW   0  /** A READ CD of contiguous raw sectors. */
+#define ASYNC_READ_ISRC  1  /** A READ SUB-CHANNEL of the ISRC of a track. */
+
+/**
+ * Internal structure for a single command issued to the device on
+ * behalf of a request.  A request for more raw sectors than the device
+ * can transfer at once is split into several commands.
+ */
+typedef struct cueify_async_command_private {
+    cueify_async_request_private *request;  /** The request served. */
+    int type;  /** The ASYNC_* type of the command. */
+    uint32_t lba;  /** First sector to read (ASYNC_READ_RAW). */
+    uint32_t count;  /** Number of sectors to read (ASYNC_READ_RAW). */
+    /** Buffer to read the sectors into (ASYNC_READ_RAW). */
+    cueify_raw_read_private *sectors;
+    uint8_t track;  /** Track to read the ISRC of (ASYNC_READ_ISRC). */
+    char *isrc;  /** Buffer to write the ISRC to (ASYNC_READ_ISRC). */
+    /** Size of the ISRC buffer, and then of the ISRC (ASYNC_READ_ISRC). */
+    size_t *isrc_size;
+    /** Raw response of a READ SUB-CHANNEL command. */
+    uint8_t response[24];
+    uint8_t sense[32];  /** Sense data of a failed command. */
+    uint32_t start;  /** Time the command was issued (see stats.c). */
+    size_t transferred;  /** Number of bytes of data the command returned. */
+    /** Next command in the list of commands in flight. */
+    struct cueify_async_command_private *next;
+} cueify_async_command_private;
+
+
+/** Internal structure holding the asynchronous state of a device. */
+typedef struct cueify_async_private {
+    uint32_t pending;  /** Number of requests not yet called back. */
+    uint32_t in_flight;  /** Number of commands issued to the device. */
+    /** Commands issued to the device which have not been collected. */
+    cueify_async_command_private *in_flight_head;
+    /** Oldest request which has completed but not been called back. */
+    cueify_async_request_private *done_head;
+    /** Newest request which has completed but not been called back. */
+    cueify_async_request_private *done_tail;
+} cueify_async_private;
+
+
+#ifdef DEVICE_SUPPORTS_ASYNC
+/**
+ * Unportable issue of a command to a device without waiting for it to
+ * complete.
+ *
+ * @param d the cueify device handle to issue the command to
+ * @param c the command to issue, which must remain valid until it is
+ *          returned by cueify_device_reap_unportable()
+ * @return CUEIFY_OK if the command was issued; CUEIFY_ERR_NO_DEVICE if
+ *         the device has no asynchronous interface, in which case the
+ *         command must be performed synchronously instead; otherwise
+ *         an appropriate error code
+ */
+int cueify_device_issue_unportable(cueify_device_private *d,
+				   cueify_async_command_private *c);
+
+
+/**
+ * Unportable collection of a command issued with
+ * cueify_device_issue_unportable() which has completed.
+ *
+ * @param d the cueify device handle to collect a command from
+ * @param wait if non-zero, block until a command completes
+ * @param c a pointer to set to the completed command, or NULL if none
+ *          has completed
+ * @return the result of the completed command; CUEIFY_OK if none has
+ *         completed yet; or an error code (with *c set to NULL) if the
+ *         device failed such that no command can be collected from it
+ */
+int cueify_device_reap_unportable(cueify_device_private *d, int wait,
+				  cueify_async_command_private **c);
+
+
+/**
+ * Unportable cancellation of every command issued with
+ * cueify_device_issue_unportable() which has not been collected.
+ * Once cancelled, the commands are never returned by
+ * cueify_device_reap_unportable(), nor is anything written to their
+ * buffers, and every later command is performed synchronously.
+ *
+ * @param d the cueify device handle to cancel the commands of
+ */
+void cueify_device_cancel_unportable(cueify_device_private *d);
+
+
+/**
+ * Unportable version of cueify_device_get_completion_fd().
+ *
+ * @param d the cueify device handle
+ * @return a file descriptor readable when an issued command completes,
+ *         or -1 if the device has no asynchronous interface
+ */
+int cueify_device_get_completion_fd_unportable(cueify_device_private *d);
+#endif  /* DEVICE_SUPPORTS_ASYNC */
+
+
+/**
+ * Call back any outstanding requests and free the asynchronous state
+ * of a device.
+ *
+ * @param d the device handle whose asynchronous state should be freed
+ */
+void cueify_async_free(cueify_device_private *d);
+
+#endif  /* _CUEIFY_ASYNC_PRIVATE_H */
@@ -0,0 +1,171 @@
+/* backend_private.h - Private device backend interface
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CUEIFY_BACKEND_PRIVATE_H
+#define _CUEIFY_BACKEND_PRIVATE_H
+
+#include <cueify/types.h>
+#include "device_private.h"
+#include "toc_private.h"
+#include "sessions_private.h"
+#include "full_toc_private.h"
+#include "cdtext_private.h"
+#include "indices_private.h"
+#include "async_private.h"
+
+/**
+ * Operations through which a device handle reaches whatever is
+ * behind it.  Each has the same meaning as the *_unportable()
+ * function of the same name.
+ */
+typedef struct cueify_device_backend {
+    /** Close the device (see cueify_device_close_unportable()). */
+    int (*close)(cueify_device_private *d);
+    /** See cueify_device_media_changed_unportable(). */
+    int (*media_changed)(cueify_device_private *d);
+    /** See cueify_device_get_supported_apis_unportable(). */
+    int (*get_supported_apis)(cueify_device_private *d);
+    /** See cueify_device_read_toc_unportable(). */
+    int (*read_toc)(cueify_device_private *d, cueify_toc_private *t);
+    /** See cueify_device_read_sessions_unportable(). */
+    int (*read_sessions)(cueify_device_private *d,
+			 cueify_sessions_private *s);
+    /** See cueify_device_read_full_toc_unportable(). */
+    int (*read_full_toc)(cueify_device_private *d,
+			 cueify_full_toc_private *t);
+    /** See cueify_device_read_cdtext_unportable(). */
+    int (*read_cdtext)(cueify_device_private *d, cueify_cdtext_private *t);
+    /** See cueify_device_read_mcn_unportable(). */
+    int (*read_mcn)(cueify_device_private *d, char *buffer, size_t *size);
+    /** See cueify_device_read_isrc_unportable(). */
+    int (*read_isrc)(cueify_device_private *d, uint8_t track,
+		     char *buffer, size_t *size);
+    /** See cueify_device_read_position_unportable(). */
+    int (*read_position)(cueify_device_private *d, uint8_t track,
+			 uint32_t lba, cueify_position_t *pos);
+    /** See cueify_device_read_raw_sectors_unportable(). */
+    int (*read_raw_sectors)(cueify_device_private *d, uint32_t lba,
+			    uint32_t count, cueify_raw_read_private *buffer);
+    /**
+     * See cueify_device_issue_unportable(), or NULL if commands are
+     * always performed synchronously.
+     */
+    int (*issue)(cueify_device_private *d, cueify_async_command_private *c);
+    /** See cueify_device_reap_unportable(), or NULL as for issue. */
+    int (*reap)(cueify_device_private *d, int wait,
+		cueify_async_command_private **c);
+    /** See cueify_device_cancel_unportable(), or NULL as for issue. */
+    void (*cancel)(cueify_device_private *d);
+    /**
+     * See cueify_device_get_completion_fd_unportable(), or NULL as
+     * for issue.
+     */
+    int (*get_completion_fd)(cueify_device_private *d);
+} cueify_device_backend;
+
+
+/** Backend for optical disc devices, using the *_unportable() functions. */
+extern const cueify_device_backend cueify_os_backend;
+
+/** Backend for disc images (see cueify_device_open_image()). */
+extern const cueify_device_backend cueify_image_backend;
+
+/**
+ * Backend for disc images in a simulated drive (see
+ * cueify_device_open_simulated()), which charges simulated time and
+ * then defers to cueify_image_backend.
+ */
+extern const cueify_device_backend cueify_simulated_backend;
+
+
+/**
+ * Backend replaying a trace of the commands sent to an optical disc
+ * drive (see cueify_device_open_trace()).
+ */
+extern const cueify_device_backend cueify_trace_backend;
+
+
+/**
+ * Start simulating time for a device.  The state is freed by the
+ * backend when the device is closed.
+ *
+ * @param d the cueify device handle to simulate time for
+ * @param latency the latencies of the drive
+ * @return CUEIFY_OK if the simulation started; otherwise CUEIFY_ERR_NOMEM
+ */
+int cueify_simulation_start(cueify_device_private *d,
+			    const cueify_latency_t *latency);
+
+
+/**
+ * Charge simulated time to a device.
+ *
+ * @param d a device handle for which time is simulated
+ * @param us the time to charge (in microseconds)
+ */
+void cueify_simulation_charge(cueify_device_private *d, uint32_t us);
+
+
+/**
+ * Get the simulated time consumed by a simulated drive.
+ *
+ * @param d a device handle opened with cueify_device_open_simulated()
+ * @return the simulated time (in microseconds, modulo 2^32)
+ */
+uint32_t cueify_simulation_now_us(cueify_device_private *d);
+
+
+/**
+ * Open a disc image for the image backend.
+ *
+ * @param d the cueify device handle to open
+ * @param path the path of a cue sheet or a raw image
+ * @return CUEIFY_OK if the image was opened; CUEIFY_ERR_NO_DEVICE if
+ *         it (or a file it names) could not be opened;
+ *         CUEIFY_ERR_CORRUPTED if it could not be understood; otherwise
+ *         another appropriate error code
+ */
+int cueify_image_open(cueify_device_private *d, const char *path);
+
+
+/**
+ * Find the position of a sector of an image opened by the image
+ * backend, from the raw sector if it has already been read.  The
+ * sub-Q-channel of the sector is used if the image has subchannel
+ * data; otherwise the position comes from the layout of the image.
+ *
+ * @param d the cueify device handle of the image
+ * @param lba the address of the sector
+ * @param sector the raw sector read from lba, or NULL if it has not
+ *               been read (in which case the layout is used)
+ * @param pos the position to populate
+ * @return CUEIFY_OK if the position was found; otherwise
+ *         CUEIFY_ERR_INTERNAL
+ */
+int cueify_image_sector_position(cueify_device_private *d, uint32_t lba,
+				 const cueify_raw_read_private *sector,
+				 cueify_position_t *pos);
+
+#endif  /* _CUEIFY_BACKEND_PRIVATE_H */
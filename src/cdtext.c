@@ -29,6 +29,7 @@
 #include <cueify/error.h>
 #include "device_private.h"
 #include "cdtext_private.h"
+#include "disc_private.h"
 #include "cdtext_crc.h"
 #include "charsets.h"
 
@@ -40,170 +41,64 @@ cueify_cdtext *cueify_cdtext_new() {
 int cueify_device_read_cdtext(cueify_device *d, cueify_cdtext *t) {
     cueify_device_private *dev = (cueify_device_private *)d;
     cueify_cdtext_private *cdtext = (cueify_cdtext_private *)t;
+    cueify_cdtext_private *cached;
+    int retval;
 
     if (d == NULL || t == NULL) {
 	return CUEIFY_ERR_BADARG;
     }
 
-    return cueify_device_read_cdtext_unportable(dev, cdtext);
-}  /* cueify_device_read_cdtext */
-
-
-/** Structure representing the contents of a CD-Text descriptor. */
-struct cdtext_descriptor {
-    uint8_t pack_type;  /** Type of the PACK */
-    /** Track number or PACK element number; extension flag in the MSB. */
-    uint8_t track_number;
-    uint8_t sequence_number;  /** Number of this PACK in sequence. */
-    /**
-     * Double-byte char-code flag in the MSB;
-     * BLOCK number in next 3 highest bits;
-     * Character position in the 4 least significant bits.
-     */
-    uint8_t block_number;
-    /* Data of the PACK. */
-    uint8_t data[12];
-    /* CRC checksum of the PACK ~(X^16 + X^12 + X^5 + 1) */
-    uint8_t crc[2];
-};
-
-
-/** Extract the extension flag from a track_number in a cdtext_descriptor. */
-#define EXTENSION_FLAG(x)  (x >> 7)
-/** Extract the track number from a track_number in a cdtext_descriptor. */
-#define TRACK_NUMBER(x)  (x & 0x7F)
-/** Extract the double-byte flag from a block_number in a cdtext_descriptor. */
-#define DOUBLE_BYTE(x)  (x >> 7)
-/** Extract the block number from a block_number in a cdtext_descriptor. */
-#define BLOCK_NUMBER(x)  ((x >> 4) & 0x7)
-/** Extract the character offset from a block_number in a cdtext_descriptor. */
-#define CHAR_POSITION(x)  (x & 0xF)
-
-
-int cueify_cdtext_deserialize(cueify_cdtext *t, const uint8_t * const buffer,
-			      size_t size) {
-    cueify_cdtext_private *cdtext = (cueify_cdtext_private *)t;
-    uint16_t toc_length;
-    const uint8_t *bp;
-    int block, pack_type, track;
-    unsigned char *pack_data[MAX_BLOCKS][16];
-    unsigned char *pack;
-    size_t pack_sizes[MAX_BLOCKS][16];
-    size_t pack_size;
-    struct cdtext_descriptor *descriptor;
-
-    if (t == NULL || buffer == NULL) {
-	return CUEIFY_ERR_BADARG;
-    }
-    if (size < 4) {
-	return CUEIFY_ERR_TRUNCATED;
+    cueify_device_check_media(dev);
+    retval = cueify_disc_get_cdtext(dev, cdtext->crc_mode, &cached);
+    if (retval != CUEIFY_OK) {
+	return retval;
     }
 
-    /* CD-TEXT Data Length */
-    toc_length = ((buffer[0] << 8) | buffer[1]);
-    if (size - 2 < toc_length) {
-	return CUEIFY_ERR_TRUNCATED;
-    }
-    if ((toc_length - 2) % 18 != 0) {
-	return CUEIFY_ERR_CORRUPTED;
-    }
+    return cueify_cdtext_copy(cdtext, cached);
+}  /* cueify_device_read_cdtext */
 
-    /* Reserved */
 
-    /* Zero out the pack data. */
-    for (block = 0; block < MAX_BLOCKS; block++) {
-	for (pack_type = 0; pack_type < 16; pack_type++) {
-	    pack_data[block][pack_type] = NULL;
-	    pack_sizes[block][pack_type] = 0;
-	}
-    }
-
-    /* Zero out the cdtext data (so it can be freed) */
-    for (track = 0; track < MAX_TRACKS; track++) {
-	for (block = 0; block < MAX_BLOCKS; block++) {
-	    free(cdtext->blocks[block].titles[track]);
-	    cdtext->blocks[block].titles[track] = NULL;
-	    free(cdtext->blocks[block].performers[track]);
-	    cdtext->blocks[block].performers[track] = NULL;
-	    free(cdtext->blocks[block].songwriters[track]);
-	    cdtext->blocks[block].songwriters[track] = NULL;
-	    free(cdtext->blocks[block].composers[track]);
-	    cdtext->blocks[block].composers[track] = NULL;
-	    free(cdtext->blocks[block].arrangers[track]);
-	    cdtext->blocks[block].arrangers[track] = NULL;
-	    free(cdtext->blocks[block].messages[track]);
-	    cdtext->blocks[block].messages[track] = NULL;
-	    free(cdtext->blocks[block].private[track]);
-	    cdtext->blocks[block].private[track] = NULL;
-	    free(cdtext->blocks[block].upc_isrcs[track]);
-	    cdtext->blocks[block].upc_isrcs[track] = NULL;
-	    if (cdtext->blocks[block].discid != NULL) {
-		free(cdtext->blocks[block].discid);
-		cdtext->blocks[block].discid = NULL;
-	    }
-	    if (cdtext->blocks[block].genre_name != NULL) {
-		free(cdtext->blocks[block].genre_name);
-		cdtext->blocks[block].genre_name = NULL;
-	    }
-	}
-
-	free(cdtext->toc.intervals[track]);
-	cdtext->toc.intervals[track] = NULL;
-	cdtext->toc.num_intervals[track] = 0;
+/** Decode the contents of a type of PACK into the arena of CD-Text data.
+ *
+ * @param cdtext the CD-Text data to decode into
+ * @param charset the character set of the contents (CUEIFY_CDTEXT_CHARSET_*)
+ * @param data the contents of the PACKs
+ * @param size the number of bytes in data
+ * @param decoded_size a pointer to set to the number of bytes decoded
+ *                     (including the terminator)
+ * @return the decoded (NUL-separated) strings, or NULL if there was
+ *         not enough memory
+ */
+static char *decode_cdtext_data(cueify_cdtext_private *cdtext,
+				uint8_t charset, uint8_t *data, size_t size,
+				size_t *decoded_size) {
+    char *decoded;
+
+    /* Size the decoding exactly, then decode in place. */
+    if (charset == CUEIFY_CDTEXT_CHARSET_MSJIS) {
+	/* NOTE: MS-JIS is a two-byte encoding. */
+	*decoded_size = cueify_msjis_to_utf8_into(data, size / 2, NULL, 0);
+    } else {
+	*decoded_size = cueify_latin1_to_utf8_into(data, size, NULL, 0);
     }
-
-    /* Count all of the PACKs by BLOCK, so we know how much space to
-     * allocate. */
-    for (bp = buffer + 4; bp < buffer + (toc_length - 2); bp += 18) {
-	descriptor = (struct cdtext_descriptor *)bp;
-
-	/* Ignore extension blocks. */
-	if (EXTENSION_FLAG(descriptor->track_number) ||
-	    descriptor->pack_type < 0x80 ||
-	    descriptor->pack_type > 0x8F) {
-	    continue;
-	}
-
-	pack_sizes[BLOCK_NUMBER(descriptor->block_number)]
-	    [descriptor->pack_type - 0x80] += 12;
+    decoded = cueify_cdtext_alloc(cdtext, *decoded_size);
+    if (decoded == NULL) {
+	return NULL;
     }
-
-    /* Allocate the aggregate PACK space. */
-    for (block = 0; block < MAX_BLOCKS; block++) {
-	for (pack_type = 0; pack_type < 16; pack_type++) {
-	    if (pack_sizes[block][pack_type] > 0) {
-		pack_data[block][pack_type] =
-		    malloc(pack_sizes[block][pack_type]);
-		if (pack_data[block][pack_type] == NULL) {
-		    goto error;
-		}
-		/* Reset the size count, so that we can use it as a pointer. */
-		pack_sizes[block][pack_type] = 0;
-	    }
-	}
+    if (charset == CUEIFY_CDTEXT_CHARSET_MSJIS) {
+	cueify_msjis_to_utf8_into(data, size / 2, decoded, *decoded_size);
+    } else {
+	cueify_latin1_to_utf8_into(data, size, decoded, *decoded_size);
     }
 
-    /* Aggregate all PACKs. */
-    /* NOTE: We assume that PACKs in a given PACK type are in order!! */
-    for (bp = buffer + 4; bp < buffer + (toc_length - 2); bp += 18) {
-	descriptor = (struct cdtext_descriptor *)bp;
-
-	/* Ignore extension blocks. */
-	if (EXTENSION_FLAG(descriptor->track_number) ||
-	    descriptor->pack_type < 0x80 ||
-	    descriptor->pack_type > 0x8F) {
-	    continue;
-	}
+    return decoded;
+}  /* decode_cdtext_data */
 
-	block = BLOCK_NUMBER(descriptor->block_number);
-	pack_type = descriptor->pack_type - 0x80;
 
-	pack = pack_data[block][pack_type];
-	pack_size = pack_sizes[block][pack_type];
-	memcpy(pack + pack_size, descriptor->data, 12);
-	pack_sizes[block][pack_type] += 12;
-	/* TODO: Check CRC */
-    }
+int cueify_cdtext_decode_packs(cueify_cdtext_private *cdtext,
+			       unsigned char *pack_data[MAX_BLOCKS][16],
+			       size_t pack_sizes[MAX_BLOCKS][16]) {
+    int block, pack_type, track;
 
     /*
      * Now that we have collected all of the PACKs by BLOCK and type,
@@ -241,6 +136,7 @@ int cueify_cdtext_deserialize(cueify_cdtext *t, const uint8_t * const buffer,
 	    if (pack_sizes[block][pack_type] > 0) {
 		char **datum;
 		char *data = NULL, *data_ptr = NULL;
+		size_t data_size;
 
 		switch (pack_type) {
 		case 0:   /* 0x80 = TITLE */
@@ -258,18 +154,14 @@ int cueify_cdtext_deserialize(cueify_cdtext *t, const uint8_t * const buffer,
 		    switch (cdtext->blocks[block].charset) {
 		    case CUEIFY_CDTEXT_CHARSET_ASCII:
 		    case CUEIFY_CDTEXT_CHARSET_ISO8859_1:
-			data = latin1_to_utf8(pack_data[block][pack_type],
-					      pack_sizes[block][pack_type]);
-			if (data == NULL) {
-			    goto error;
-			}
-			break;
 		    case CUEIFY_CDTEXT_CHARSET_MSJIS:
-			/* NOTE: MS-JIS is a two-byte encoding. */
-			data = msjis_to_utf8(pack_data[block][pack_type],
-					     pack_sizes[block][pack_type] / 2);
+			data = decode_cdtext_data(cdtext,
+						  cdtext->blocks[block].charset,
+						  pack_data[block][pack_type],
+						  pack_sizes[block][pack_type],
+						  &data_size);
 			if (data == NULL) {
-			    goto error;
+			    return CUEIFY_ERR_NOMEM;
 			}
 			break;
 		    default:
@@ -305,42 +197,44 @@ int cueify_cdtext_deserialize(cueify_cdtext *t, const uint8_t * const buffer,
 			datum = cdtext->blocks[block].upc_isrcs;
 			break;
 		    default:
+			datum = NULL;
 			break;
 		    }
 
-		    /* Copy the decoded text */
+		    /*
+		     * The decoded text already lives in the arena, so
+		     * each string simply points into it.
+		     */
 		    /* NOTE: This is probably broken for things which
 		     * skip tracks. */
-		    if (data != NULL) {
+		    if (data != NULL && datum != NULL) {
 			data_ptr = data;
 			/* First do the album-wide value. */
-			datum[0] = strdup(data_ptr);
-			if (datum[0] == NULL) {
-			    /* Failed to strdup */
-			    goto error;
-			}
+			datum[0] = data_ptr;
 			/* NOTE: We assume all tracks are included! */
 			for (track = cdtext->blocks[block].first_track_number;
 			     track <= cdtext->blocks[block].last_track_number;
 			     track++) {
-			    /* Skip to next track entry. */
-			    data_ptr += strlen(data_ptr) + 1;
-			    datum[track] = strdup(data_ptr);
-			    if (datum[track] == NULL) {
-				/* Failed to strdup */
-				goto error;
+			    /* Skip to next track entry (if there is one). */
+			    if (data_ptr + strlen(data_ptr) + 1 <
+				data + data_size) {
+				data_ptr += strlen(data_ptr) + 1;
+			    } else {
+				data_ptr = data + data_size - 1;
 			    }
+			    datum[track] = data_ptr;
 			}
-
-			/* All done with the decoded value. We can free it. */
-			free(data);
 		    }
 		    break;
 		case 6:   /* 0x86 = DISCID */
 		    /* According to Red Book, only ISO 8859-1 may be used. */
-		    cdtext->blocks[block].discid =
-			latin1_to_utf8(pack_data[block][pack_type],
-				       pack_sizes[block][pack_type]);
+		    cdtext->blocks[block].discid = decode_cdtext_data(
+			cdtext, CUEIFY_CDTEXT_CHARSET_ISO8859_1,
+			pack_data[block][pack_type],
+			pack_sizes[block][pack_type], &data_size);
+		    if (cdtext->blocks[block].discid == NULL) {
+			return CUEIFY_ERR_NOMEM;
+		    }
 		    break;
 		case 7:   /* 0x87 = GENRE */
 		    /* Genre includes a genre code in addition to text. */
@@ -348,9 +242,13 @@ int cueify_cdtext_deserialize(cueify_cdtext *t, const uint8_t * const buffer,
 			((uint16_t)pack_data[block][pack_type][0] << 8) |
 			((uint16_t)pack_data[block][pack_type][1]);
 		    /* No particular reason to believe this is Latin1 only?? */
-		    cdtext->blocks[block].genre_name =
-			latin1_to_utf8(pack_data[block][pack_type] + 2,
-				       pack_sizes[block][pack_type] - 2);
+		    cdtext->blocks[block].genre_name = decode_cdtext_data(
+			cdtext, CUEIFY_CDTEXT_CHARSET_ISO8859_1,
+			pack_data[block][pack_type] + 2,
+			pack_sizes[block][pack_type] - 2, &data_size);
+		    if (cdtext->blocks[block].genre_name == NULL) {
+			return CUEIFY_ERR_NOMEM;
+		    }
 		    break;
 		case 8:   /* 0x88 = TOCINFO */
 		    /* This basically encodes another (short) TOC. */
@@ -393,63 +291,204 @@ int cueify_cdtext_deserialize(cueify_cdtext *t, const uint8_t * const buffer,
 	}
     }
 
-    /* Finally, we go back and do the TOCINFO2 packets. */
+    return CUEIFY_OK;
+}  /* cueify_cdtext_decode_packs */
+
+
+int cueify_cdtext_read_tocinfo2(cueify_cdtext_private *cdtext,
+				const struct cdtext_descriptor *descriptor) {
+    int track = TRACK_NUMBER(descriptor->track_number);
+
+    cdtext->toc.num_intervals[track] = descriptor->data[1];
+    if (cdtext->toc.intervals[track] == NULL) {
+	cdtext->toc.intervals[track] = cueify_cdtext_alloc(
+	    cdtext, cdtext->toc.num_intervals[track] *
+	    sizeof(cueify_cdtext_toc_track_interval_private));
+	if (cdtext->toc.intervals[track] == NULL) {
+	    return CUEIFY_ERR_NOMEM;
+	}
+    }
+
+    cdtext->toc.intervals[track][descriptor->data[0] - 1].start.min =
+	descriptor->data[6];
+    cdtext->toc.intervals[track][descriptor->data[0] - 1].start.sec =
+	descriptor->data[7];
+    cdtext->toc.intervals[track][descriptor->data[0] - 1].start.frm =
+	descriptor->data[8];
+    cdtext->toc.intervals[track][descriptor->data[0] - 1].end.min =
+	descriptor->data[9];
+    cdtext->toc.intervals[track][descriptor->data[0] - 1].end.sec =
+	descriptor->data[10];
+    cdtext->toc.intervals[track][descriptor->data[0] - 1].end.frm =
+	descriptor->data[11];
+
+    return CUEIFY_OK;
+}  /* cueify_cdtext_read_tocinfo2 */
+
+
+int cueify_cdtext_deserialize(cueify_cdtext *t, const uint8_t * const buffer,
+			      size_t size) {
+    cueify_cdtext_private *cdtext = (cueify_cdtext_private *)t;
+    uint16_t toc_length;
+    const uint8_t *bp;
+    int block, pack_type;
+    unsigned char *pack_data[MAX_BLOCKS][16];
+    unsigned char *pack, *packs = NULL;
+    size_t pack_sizes[MAX_BLOCKS][16];
+    size_t pack_size, packs_size = 0, interval_size = 0;
+    struct cdtext_descriptor *descriptor;
+    uint8_t bad_packs[(MAX_PACKS + 7) / 8];
+
+    if (t == NULL || buffer == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+    if (size < 4) {
+	return CUEIFY_ERR_TRUNCATED;
+    }
+
+    /* CD-TEXT Data Length */
+    toc_length = ((buffer[0] << 8) | buffer[1]);
+    if (size - 2 < toc_length) {
+	return CUEIFY_ERR_TRUNCATED;
+    }
+    if ((toc_length - 2) % 18 != 0) {
+	return CUEIFY_ERR_CORRUPTED;
+    }
+
+    /* Reserved */
+
+    /* Zero out the pack data. */
+    for (block = 0; block < MAX_BLOCKS; block++) {
+	for (pack_type = 0; pack_type < 16; pack_type++) {
+	    pack_data[block][pack_type] = NULL;
+	    pack_sizes[block][pack_type] = 0;
+	}
+    }
+
+    /* Free the previous cdtext data (strings, intervals, and all). */
+    cueify_cdtext_clear(cdtext);
+
+    /* Check the CRCs of every PACK at once. */
+    cdtext->num_bad_packs = cdtext_crc_check_packs(buffer + 4,
+						   (toc_length - 2) / 18,
+						   bad_packs);
+    if (cdtext->num_bad_packs > 0 &&
+	cdtext->crc_mode == CUEIFY_CDTEXT_CRC_STRICT) {
+	cueify_cdtext_clear(cdtext);
+	return CUEIFY_ERR_CORRUPTED;
+    }
+
+    /* Count all of the PACKs by BLOCK, so we know how much space to
+     * allocate. */
     for (bp = buffer + 4; bp < buffer + (toc_length - 2); bp += 18) {
 	descriptor = (struct cdtext_descriptor *)bp;
 
-	/* Ignore extension blocks. */
+	/* Ignore extension blocks (and bad PACKs, if so asked). */
 	if (EXTENSION_FLAG(descriptor->track_number) ||
 	    descriptor->pack_type < 0x80 ||
-	    descriptor->pack_type > 0x8F) {
+	    descriptor->pack_type > 0x8F ||
+	    (cdtext->crc_mode == CUEIFY_CDTEXT_CRC_DROP &&
+	     BAD_PACK(bad_packs, (bp - buffer - 4) / 18))) {
 	    continue;
 	}
 
-	block = BLOCK_NUMBER(descriptor->block_number);
-	pack_type = descriptor->pack_type;
+	pack_sizes[BLOCK_NUMBER(descriptor->block_number)]
+	    [descriptor->pack_type - 0x80] += 12;
+	if (descriptor->pack_type == 0x89) {
+	    interval_size += descriptor->data[1] *
+		sizeof(cueify_cdtext_toc_track_interval_private);
+	}
+    }
 
-	/* NOTE: We assume that the TOC-2 only occurs once. */
-	if (pack_type == 0x89) {
-	    track = TRACK_NUMBER(descriptor->track_number);
-
-	    cdtext->toc.num_intervals[track] = descriptor->data[1];
-	    if (cdtext->toc.intervals[track] == NULL) {
-		cdtext->toc.intervals[track] =
-		    malloc(cdtext->toc.num_intervals[track] *
-			   sizeof(cueify_cdtext_toc_track_interval_private));
-		if (cdtext->toc.intervals[track] == NULL) {
-		    goto error;
-		}
+    /*
+     * Carve the aggregate PACK space for every BLOCK and type out of
+     * a single buffer.
+     */
+    for (block = 0; block < MAX_BLOCKS; block++) {
+	for (pack_type = 0; pack_type < 16; pack_type++) {
+	    packs_size += pack_sizes[block][pack_type];
+	}
+    }
+    if (packs_size > 0) {
+	packs = malloc(packs_size);
+	if (packs == NULL) {
+	    goto error;
+	}
+    }
+    packs_size = 0;
+    for (block = 0; block < MAX_BLOCKS; block++) {
+	for (pack_type = 0; pack_type < 16; pack_type++) {
+	    if (pack_sizes[block][pack_type] > 0) {
+		pack_data[block][pack_type] = packs + packs_size;
+		packs_size += pack_sizes[block][pack_type];
+		/* Reset the size count, so that we can use it as a pointer. */
+		pack_sizes[block][pack_type] = 0;
 	    }
+	}
+    }
+
+    /*
+     * Reserve room for every string in one chunk of the arena.
+     * Decoded text is rarely more than twice the size of its PACKs
+     * (and the arena grows if it is).
+     */
+    if (cueify_cdtext_reserve(cdtext, packs_size * 2 + interval_size) !=
+	CUEIFY_OK) {
+	goto error;
+    }
 
-	    cdtext->toc.intervals[track][descriptor->data[0] - 1].start.min =
-		descriptor->data[6];
-	    cdtext->toc.intervals[track][descriptor->data[0] - 1].start.sec =
-		descriptor->data[7];
-	    cdtext->toc.intervals[track][descriptor->data[0] - 1].start.frm =
-		descriptor->data[8];
-	    cdtext->toc.intervals[track][descriptor->data[0] - 1].end.min =
-		descriptor->data[9];
-	    cdtext->toc.intervals[track][descriptor->data[0] - 1].end.sec =
-		descriptor->data[10];
-	    cdtext->toc.intervals[track][descriptor->data[0] - 1].end.frm =
-		descriptor->data[11];
+    /* Aggregate all PACKs. */
+    /* NOTE: We assume that PACKs in a given PACK type are in order!! */
+    for (bp = buffer + 4; bp < buffer + (toc_length - 2); bp += 18) {
+	descriptor = (struct cdtext_descriptor *)bp;
+
+	/* Ignore extension blocks (and bad PACKs, if so asked). */
+	if (EXTENSION_FLAG(descriptor->track_number) ||
+	    descriptor->pack_type < 0x80 ||
+	    descriptor->pack_type > 0x8F ||
+	    (cdtext->crc_mode == CUEIFY_CDTEXT_CRC_DROP &&
+	     BAD_PACK(bad_packs, (bp - buffer - 4) / 18))) {
+	    continue;
 	}
+
+	block = BLOCK_NUMBER(descriptor->block_number);
+	pack_type = descriptor->pack_type - 0x80;
+
+	pack = pack_data[block][pack_type];
+	pack_size = pack_sizes[block][pack_type];
+	memcpy(pack + pack_size, descriptor->data, 12);
+	pack_sizes[block][pack_type] += 12;
     }
 
-    for (block = 0; block < MAX_BLOCKS; block++) {
-	for (pack_type = 0; pack_type < 16; pack_type++) {
-	    free(pack_data[block][pack_type]);
+    if (cueify_cdtext_decode_packs(cdtext, pack_data, pack_sizes) !=
+	CUEIFY_OK) {
+	goto error;
+    }
+
+    /* Finally, we go back and do the TOCINFO2 packets. */
+    for (bp = buffer + 4; bp < buffer + (toc_length - 2); bp += 18) {
+	descriptor = (struct cdtext_descriptor *)bp;
+
+	/* Ignore extension blocks (and bad PACKs, if so asked). */
+	if (EXTENSION_FLAG(descriptor->track_number) ||
+	    descriptor->pack_type != 0x89 ||
+	    (cdtext->crc_mode == CUEIFY_CDTEXT_CRC_DROP &&
+	     BAD_PACK(bad_packs, (bp - buffer - 4) / 18))) {
+	    continue;
+	}
+
+	/* NOTE: We assume that the TOC-2 only occurs once. */
+	if (cueify_cdtext_read_tocinfo2(cdtext, descriptor) != CUEIFY_OK) {
+	    goto error;
 	}
     }
 
+    free(packs);
+
     return CUEIFY_OK;
 
 error:
-    for (block = 0; block < MAX_BLOCKS; block++) {
-	for (pack_type = 0; pack_type < 16; pack_type++) {
-	    free(pack_data[block][pack_type]);
-	}
-    }
+    free(packs);
 
     /* Almost always a memory error. */
     return CUEIFY_ERR_NOMEM;
@@ -460,6 +499,7 @@ error:
 struct cueify_cdtext_writer {
     cueify_cdtext_private *cdtext;  /** The CD-Text being written. */
     uint8_t *bp;  /** A pointer to output buffer of the writer */
+    uint8_t *end;  /** The end of the output buffer of the writer. */
     uint8_t track;  /** The track at the start of the internal buffer. */
     uint8_t buffer[12];  /** The internal buffer. */
     size_t size;  /** The length of data in the buffer. */
@@ -476,7 +516,8 @@ struct cueify_cdtext_writer {
 /** Flush any unwritten contents in a CD-Text writer to its output.
  *
  * @param writer the writer to flush
- * @return CUEIFY_OK if the flush was successful
+ * @return CUEIFY_OK if the flush was successful, or CUEIFY_ERR_CORRUPTED
+ *         if the output buffer has no room for another PACK
  */
 static int flush_cdtext_writer(struct cueify_cdtext_writer *writer) {
     cdtext_crc_t crc;
@@ -486,6 +527,11 @@ static int flush_cdtext_writer(struct cueify_cdtext_writer *writer) {
 	return CUEIFY_OK;
     }
 
+    /* More PACKs than were counted (e.g. from a malformed TOCINFO). */
+    if (writer->end - writer->bp < 18) {
+	return CUEIFY_ERR_CORRUPTED;
+    }
+
     /* Pad the buffer with zeroes. */
     while (writer->size < 12) {
 	writer->buffer[writer->size++] = 0;
@@ -528,11 +574,13 @@ static int flush_cdtext_writer(struct cueify_cdtext_writer *writer) {
  * @param data a pointer to the data to write
  * @param size the amount of data to write
  * @param track the track/PACK element for which data is being written
- * @return CUEIFY_OK if the write was successful
+ * @return CUEIFY_OK if the write was successful; otherwise the error
+ *         flushing the writer
  */
 static int write_cdtext_track_data(struct cueify_cdtext_writer *writer,
 				   uint8_t *data, size_t size, uint8_t track) {
     uint8_t *data_ptr = data;
+    int retval;
 
     if (writer->size == 0) {
 	writer->charpos = 0;
@@ -543,8 +591,9 @@ static int write_cdtext_track_data(struct cueify_cdtext_writer *writer,
 	data_ptr += 12 - writer->size;
 	size -= 12 - writer->size;
 	writer->size = 12;
-	if (flush_cdtext_writer(writer) != CUEIFY_OK) {
-	    return CUEIFY_ERR_INTERNAL;
+	retval = flush_cdtext_writer(writer);
+	if (retval != CUEIFY_OK) {
+	    return retval;
 	}
 	/* Need to reset charpos and track if we are still writing... */
 	if (size >= 12 - writer->size) {
@@ -576,10 +625,12 @@ static int write_cdtext_track_data(struct cueify_cdtext_writer *writer,
  * called after all other PACKs in the block have been written.
  *
  * @param writer the writer to write SIZEINFO PACKs for
- * @return CUEIFY_OK if the write succeeded
+ * @return CUEIFY_OK if the write succeeded; otherwise the error writing
+ *         the PACKs
  */
 static int finish_writing_cdtext_block(struct cueify_cdtext_writer *writer) {
     uint8_t data[12];
+    int retval;
 
     writer->track = 0;
 
@@ -601,8 +652,9 @@ static int finish_writing_cdtext_block(struct cueify_cdtext_writer *writer) {
     data[9] = writer->pack_count[5];
     data[10] = writer->pack_count[6];
     data[11] = writer->pack_count[7];
-    if (write_cdtext_track_data(writer, data, 12, 0) != CUEIFY_OK) {
-	return CUEIFY_ERR_INTERNAL;
+    retval = write_cdtext_track_data(writer, data, 12, 0);
+    if (retval != CUEIFY_OK) {
+	return retval;
     }
 
     /* PACK element 2 */
@@ -618,8 +670,9 @@ static int finish_writing_cdtext_block(struct cueify_cdtext_writer *writer) {
     data[9] = writer->block_descriptors[1];
     data[10] = writer->block_descriptors[2];
     data[11] = writer->block_descriptors[3];
-    if (write_cdtext_track_data(writer, data, 12, 1) != CUEIFY_OK) {
-	return CUEIFY_ERR_INTERNAL;
+    retval = write_cdtext_track_data(writer, data, 12, 1);
+    if (retval != CUEIFY_OK) {
+	return retval;
     }
 
     /* PACK element 3 */
@@ -635,42 +688,186 @@ static int finish_writing_cdtext_block(struct cueify_cdtext_writer *writer) {
     data[9] = writer->cdtext->blocks[5].language;
     data[10] = writer->cdtext->blocks[6].language;
     data[11] = writer->cdtext->blocks[7].language;
-    if (write_cdtext_track_data(writer, data, 12, 2) != CUEIFY_OK) {
-	return CUEIFY_ERR_INTERNAL;
+    retval = write_cdtext_track_data(writer, data, 12, 2);
+    if (retval != CUEIFY_OK) {
+	return retval;
     }
 
     return CUEIFY_OK;
 }  /* finish_writing_cdtext_block */
 
 
-int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
-			    size_t *size) {
-    cueify_cdtext_private *cdtext = (cueify_cdtext_private *)t;
+/** Encoded strings of CD-Text, in the order they are serialized. */
+struct cdtext_encoding {
+    /** Each encoded string, preceded by its size (as a size_t). */
+    uint8_t *data;
+    size_t size;  /** Number of bytes in data. */
+    size_t capacity;  /** Number of bytes allocated for data. */
+    size_t next;  /** Offset of the next string to be written in data. */
+    int error;  /** CUEIFY_OK, or the error encountered encoding strings. */
+};
+
+
+/** Encode a string in the character set of a CD-Text block, keeping the
+ * encoding to be written later by next_cdtext_string().
+ *
+ * @param encoding the encoded strings to add the string to
+ * @param charset the character set of the block (CUEIFY_CDTEXT_CHARSET_*)
+ * @param utf8 the string to encode
+ * @return the number of bytes in the encoding, or 0 if the character
+ *         set is not supported (or the string could not be encoded)
+ */
+static size_t encode_cdtext_string(struct cdtext_encoding *encoding,
+				   uint8_t charset, char *utf8) {
+    uint8_t *data, *grown;
+    size_t data_size, room, capacity;
+
+    for (;;) {
+	/* Encode straight into whatever room is left after the size. */
+	data = NULL;
+	room = 0;
+	if (encoding->size + sizeof(size_t) < encoding->capacity) {
+	    data = encoding->data + encoding->size + sizeof(size_t);
+	    room = encoding->capacity - encoding->size - sizeof(size_t);
+	}
+
+	switch (charset) {
+	case CUEIFY_CDTEXT_CHARSET_ASCII:
+	    data_size = cueify_utf8_to_ascii_into(utf8, data, room);
+	    break;
+	case CUEIFY_CDTEXT_CHARSET_ISO8859_1:
+	    data_size = cueify_utf8_to_latin1_into(utf8, data, room);
+	    break;
+	case CUEIFY_CDTEXT_CHARSET_MSJIS:
+	    data_size = cueify_utf8_to_msjis_into(utf8, data, room);
+	    break;
+	default:
+	    /* Ignore this block encoding! */
+	    return 0;
+	}
+	if (data_size <= room) {
+	    break;
+	}
+
+	/* Not enough room; grow, and encode again. */
+	capacity = encoding->capacity;
+	while (encoding->size + sizeof(size_t) + data_size > capacity) {
+	    capacity = capacity == 0 ? 1024 : capacity * 2;
+	}
+	grown = realloc(encoding->data, capacity);
+	if (grown == NULL) {
+	    encoding->error = CUEIFY_ERR_NOMEM;
+	    return 0;
+	}
+	encoding->data = grown;
+	encoding->capacity = capacity;
+    }
+
+    memcpy(encoding->data + encoding->size, &data_size, sizeof(size_t));
+    encoding->size += sizeof(size_t) + data_size;
+
+    return data_size;
+}  /* encode_cdtext_string */
+
+
+/** Get the next string encoded by encode_cdtext_string().
+ *
+ * @param encoding the encoded strings
+ * @param size a pointer to set to the number of bytes in the string
+ * @return a pointer to the encoded string
+ */
+static uint8_t *next_cdtext_string(struct cdtext_encoding *encoding,
+				   size_t *size) {
+    uint8_t *data;
+
+    memcpy(size, encoding->data + encoding->next, sizeof(size_t));
+    data = encoding->data + encoding->next + sizeof(size_t);
+    encoding->next += sizeof(size_t) + *size;
+
+    return data;
+}  /* next_cdtext_string */
+
+
+/** Get the aggregate track-wise strings of a type in a CD-Text block.
+ *
+ * @param block the CD-Text block
+ * @param pack_type the index (0-15) of the type of PACK
+ * @return the strings of the album and each track, or NULL if the
+ *         type of PACK does not hold track-wise strings
+ */
+static char **cdtext_track_strings(cueify_cdtext_block_private *block,
+				   int pack_type) {
+    switch (pack_type) {
+    case 0:   /* 0x80 = TITLE */
+	return block->titles;
+    case 1:   /* 0x81 = PERFORMER */
+	return block->performers;
+    case 2:   /* 0x82 = SONGWRITER */
+	return block->songwriters;
+    case 3:   /* 0x83 = COMPOSER */
+	return block->composers;
+    case 4:   /* 0x84 = ARRANGER */
+	return block->arrangers;
+    case 5:   /* 0x85 = MESSAGE */
+	return block->messages;
+    /* NOTE: 0x8D/0x8E probably break in MS-JIS!! */
+    case 13:  /* 0x8D = PRIVATE */
+	return block->private;
+    case 14:  /* 0x8E = UPC/ISRC */
+	return block->upc_isrcs;
+    default:
+	return NULL;
+    }
+}  /* cdtext_track_strings */
+
+
+/** Serialize CD-Text, encoding each string only once.
+ *
+ * @param cdtext the CD-Text to serialize
+ * @param buffer a pointer to a location to serialize data to, or NULL
+ *               (if allocated is also NULL) to determine its size
+ * @param size a pointer to the size of the buffer, which is set to the
+ *             number of bytes needed to serialize the CD-Text
+ * @param allocated a pointer to set to a newly-allocated buffer to
+ *                  serialize data to, or NULL to use buffer
+ * @return CUEIFY_OK if the CD-Text was successfully serialized;
+ *         otherwise an error code is returned
+ */
+static int serialize_cdtext(cueify_cdtext_private *cdtext, uint8_t *buffer,
+			    size_t *size, uint8_t **allocated) {
     uint16_t toc_length;
     uint8_t *bp, *data;
     uint16_t num_descriptors = 0, block_descriptors[MAX_BLOCKS];
     uint16_t pack_type_len;
-    size_t data_size;
+    size_t data_size, width;
     int block, pack_type, track, already_wrote_track, interval;
+    int retval = CUEIFY_ERR_INTERNAL;
     char **datum;
     uint8_t terminator[2] = { '\0', '\0' };
-    uint8_t trk;
+    uint8_t charset, trk;
     struct cueify_cdtext_writer writer;
+    struct cdtext_encoding encoding;
 
     /* NOTE: This doesn't yet enforce the rule that single-byte
      * charsets should come before double-byte charsets. */
 
-    if (t == NULL || size == NULL) {
-	return CUEIFY_ERR_BADARG;
-    }
+    memset(&encoding, 0, sizeof(encoding));
 
-    /* How many descriptors do we need? */
+    /*
+     * How many descriptors do we need?  Every string is encoded (and
+     * kept) to find out, in the same order as it will be written.
+     */
     for (block = 0; block < MAX_BLOCKS; block++) {
 	block_descriptors[block] = 0;
-	if (cdtext->blocks[block].valid) {
-	    /* 3 descriptors per block (SIZEINFO) */
-	    block_descriptors[block] += 3;
+	if (!cdtext->blocks[block].valid) {
+	    /* Nothing will be written for the block. */
+	    continue;
 	}
+	/* 3 descriptors per block (SIZEINFO) */
+	block_descriptors[block] += 3;
+	charset = cdtext->blocks[block].charset;
+	/* NOTE: MS-JIS is a two-byte encoding. */
+	width = (charset == CUEIFY_CDTEXT_CHARSET_MSJIS) ? 2 : 1;
 	for (pack_type = 0; pack_type < 16; pack_type++) {
 	    pack_type_len = 0;
 
@@ -684,101 +881,36 @@ int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
 	    case 13:  /* 0x8D = PRIVATE */
 	    case 14:  /* 0x8E = UPC/ISRC */
 		/* Textual track-wise PACKs. */
-
-		/* Count the data length. */
-		switch (pack_type) {
-		case 0:   /* 0x80 = TITLE */
-		    datum = cdtext->blocks[block].titles;
-		    break;
-		case 1:   /* 0x81 = PERFORMER */
-		    datum = cdtext->blocks[block].performers;
-		    break;
-		case 2:   /* 0x82 = SONGWRITER */
-		    datum = cdtext->blocks[block].songwriters;
-		    break;
-		case 3:   /* 0x83 = COMPOSER */
-		    datum = cdtext->blocks[block].composers;
-		    break;
-		case 4:   /* 0x84 = ARRANGER */
-		    datum = cdtext->blocks[block].arrangers;
-		    break;
-		case 5:   /* 0x85 = MESSAGE */
-		    datum = cdtext->blocks[block].messages;
-		    break;
-		/* NOTE: 0x8D/0x8E probably break in MS-JIS!! */
-		case 13:  /* 0x8D = PRIVATE */
-		    datum = cdtext->blocks[block].private;
-		    break;
-		case 14:  /* 0x8E = UPC/ISRC */
-		    datum = cdtext->blocks[block].upc_isrcs;
-		    break;
-		default:
-		    break;
-		}
+		datum = cdtext_track_strings(&cdtext->blocks[block],
+					     pack_type);
 
 		if (datum[0] && datum[0][0] != '\0') {
-		    /* Count the number of bytes we'd need to encode
-		     * the value. */
-		    switch (cdtext->blocks[block].charset) {
-		    case CUEIFY_CDTEXT_CHARSET_ASCII:
-			pack_type_len += ascii_byte_count(datum[0]);
-			break;
-		    case CUEIFY_CDTEXT_CHARSET_ISO8859_1:
-			pack_type_len += latin1_byte_count(datum[0]);
-			break;
-		    case CUEIFY_CDTEXT_CHARSET_MSJIS:
-			pack_type_len += msjis_byte_count(datum[0]);
-			break;
-		    default:
-			/* Ignore this block encoding! */
-			break;
-		    }
+		    /* Encode the value to count its bytes. */
+		    pack_type_len += encode_cdtext_string(&encoding, charset,
+							  datum[0]);
 		}
 		for (track = cdtext->blocks[block].first_track_number;
 		     track <= cdtext->blocks[block].last_track_number;
 		     track++) {
-		    /* Count the number of bytes we'd need to encode
-		     * the value. */
+		    if (charset != CUEIFY_CDTEXT_CHARSET_ASCII &&
+			charset != CUEIFY_CDTEXT_CHARSET_ISO8859_1 &&
+			charset != CUEIFY_CDTEXT_CHARSET_MSJIS) {
+			/* Ignore this block encoding! */
+			break;
+		    }
 		    if (datum[track] &&
 			(datum[track][0] != '\0' || pack_type_len > 0)) {
-			switch (cdtext->blocks[block].charset) {
-			case CUEIFY_CDTEXT_CHARSET_ASCII:
-			    if (pack_type_len == 0) {
-				/* We must encode terminators for
-				 * everything we don't care about. */
-				pack_type_len +=
-				    (track -
-				     cdtext->blocks[block]
-				     .first_track_number) + 1;
-			    }
-			    pack_type_len += ascii_byte_count(datum[track]);
-			    break;
-			case CUEIFY_CDTEXT_CHARSET_ISO8859_1:
-			    if (pack_type_len == 0) {
-				/* We must encode terminators for
-				 * everything we don't care about. */
-				pack_type_len +=
-				    (track -
-				     cdtext->blocks[block]
-				     .first_track_number) + 1;
-			    }
-			    pack_type_len += latin1_byte_count(datum[track]);
-			    break;
-			case CUEIFY_CDTEXT_CHARSET_MSJIS:
-			    if (pack_type_len == 0) {
-				/* We must encode terminators for
-				 * everything we don't care about. */
-				pack_type_len +=
-				    (track -
-				     cdtext->blocks[block].first_track_number +
-				     1) * 2;
-			    }
-			    pack_type_len += msjis_byte_count(datum[track]);
-			    break;
-			default:
-			    /* Ignore this block encoding! */
-			    break;
+			if (pack_type_len == 0) {
+			    /* We must encode terminators for
+			     * everything we don't care about. */
+			    pack_type_len +=
+				(track -
+				 cdtext->blocks[block].first_track_number +
+				 1) * width;
 			}
+			pack_type_len += encode_cdtext_string(&encoding,
+							      charset,
+							      datum[track]);
 		    }
 		}
 
@@ -791,7 +923,8 @@ int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
 	    case 6:   /* 0x86 = DISCID */
 		/* According to Red Book, only ISO 8859-1 may be used. */
 		if (cdtext->blocks[block].discid != NULL) {
-		    pack_type_len = latin1_byte_count(
+		    pack_type_len = encode_cdtext_string(
+			&encoding, CUEIFY_CDTEXT_CHARSET_ISO8859_1,
 			cdtext->blocks[block].discid);
 		    block_descriptors[block] += pack_type_len / 12 +
 			((pack_type_len % 12 > 0) ? 1 : 0);
@@ -800,7 +933,8 @@ int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
 	    case 7:   /* 0x87 = GENRE */
 		/* No particular reason to believe this is Latin1 only?? */
 		if (cdtext->blocks[block].genre_name != NULL) {
-		    pack_type_len += latin1_byte_count(
+		    pack_type_len += encode_cdtext_string(
+			&encoding, CUEIFY_CDTEXT_CHARSET_ISO8859_1,
 			cdtext->blocks[block].genre_name);
 		}
 		/* Genre includes a genre code in addition to text. */
@@ -819,12 +953,22 @@ int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
 		break;
 	    }
 	}
+	if (encoding.error != CUEIFY_OK) {
+	    retval = encoding.error;
+	    goto error;
+	}
 	if (block_descriptors[block] > 256) {
 	    /* Maximum of 256 descriptors per block. */
-	    return CUEIFY_ERR_INVALID_CDTEXT;
+	    retval = CUEIFY_ERR_INVALID_CDTEXT;
+	    goto error;
 	}
 	num_descriptors += block_descriptors[block];
     }
+    if (cdtext->toc.first_track_number > cdtext->toc.last_track_number) {
+	/* A TOCINFO can't be counted (or written) backwards. */
+	retval = CUEIFY_ERR_CORRUPTED;
+	goto error;
+    }
     if (cdtext->toc.first_track_number != 0 &&
 	cdtext->toc.last_track_number != 0) {
 	if (num_descriptors == 0) {
@@ -863,19 +1007,32 @@ int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
     if (block_descriptors[0] > 256) {
 	/* Maximum of 256 descriptors per block (including the first
 	 * with its TOCINFO. */
-	return CUEIFY_ERR_INVALID_CDTEXT;
+	retval = CUEIFY_ERR_INVALID_CDTEXT;
+	goto error;
     }
     if (num_descriptors > 2048) {
 	/* Maximum of 2048 descriptors. */
-	return CUEIFY_ERR_INVALID_CDTEXT;
+	retval = CUEIFY_ERR_INVALID_CDTEXT;
+	goto error;
     }
 
     toc_length = num_descriptors * 18 + 4;
+    if (allocated != NULL) {
+	buffer = malloc(toc_length);
+	if (buffer == NULL) {
+	    retval = CUEIFY_ERR_NOMEM;
+	    goto error;
+	}
+	*allocated = buffer;
+    } else if (buffer != NULL && *size < toc_length) {
+	*size = toc_length;
+	retval = CUEIFY_ERR_TOOSMALL;
+	goto error;
+    }
     *size = toc_length;
     if (buffer == NULL) {
+	free(encoding.data);
 	return CUEIFY_OK;
-    } else if (*size < toc_length) {
-	return CUEIFY_ERR_TOOSMALL;
     }
 
     /* TOC Data Length */
@@ -893,6 +1050,7 @@ int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
     /* Initialize the CD-TEXT PACK writer. */
     writer.cdtext = cdtext;
     writer.bp = bp;
+    writer.end = buffer + *size;
     writer.track = 0;
     writer.size = 0;
     for (block = 0; block < MAX_BLOCKS; block++) {
@@ -903,6 +1061,12 @@ int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
 	}
     }
 
+    /*
+     * Writing can only fail by running out of the PACKs counted above,
+     * which would mean the CD-Text is inconsistent.
+     */
+    retval = CUEIFY_ERR_CORRUPTED;
+
     /* Iterate through each block and PACK type in turn. */
     for (block = 0; block < MAX_BLOCKS; block++) {
 	if (!cdtext->blocks[block].valid) {
@@ -911,6 +1075,8 @@ int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
 
 	writer.block = block;
 	writer.seq_number = 0;
+	charset = cdtext->blocks[block].charset;
+	width = (charset == CUEIFY_CDTEXT_CHARSET_MSJIS) ? 2 : 1;
 	for (pack_type = 0; pack_type < 16; pack_type++) {
 	    /* Initialize the CD-Text PACK writer at the current position. */
 	    writer.pack_count[pack_type] = 0;
@@ -927,196 +1093,56 @@ int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
 	    case 14:  /* 0x8E = UPC/ISRC */
 		/* Textual track-wise PACKs. */
 		already_wrote_track = 0;
-
-		switch (pack_type) {
-		case 0:   /* 0x80 = TITLE */
-		    datum = cdtext->blocks[block].titles;
-		    break;
-		case 1:   /* 0x81 = PERFORMER */
-		    datum = cdtext->blocks[block].performers;
-		    break;
-		case 2:   /* 0x82 = SONGWRITER */
-		    datum = cdtext->blocks[block].songwriters;
-		    break;
-		case 3:   /* 0x83 = COMPOSER */
-		    datum = cdtext->blocks[block].composers;
-		    break;
-		case 4:   /* 0x84 = ARRANGER */
-		    datum = cdtext->blocks[block].arrangers;
-		    break;
-		case 5:   /* 0x85 = MESSAGE */
-		    datum = cdtext->blocks[block].messages;
-		    break;
-		case 13:  /* 0x8D = PRIVATE */
-		    datum = cdtext->blocks[block].private;
-		    break;
-		case 14:  /* 0x8E = UPC/ISRC */
-		    datum = cdtext->blocks[block].upc_isrcs;
-		    break;
-		default:
-		    break;
-		}
+		datum = cdtext_track_strings(&cdtext->blocks[block],
+					     pack_type);
 
 		if (datum[0] && datum[0][0] != '\0') {
 		    already_wrote_track = 1;
-		    switch (cdtext->blocks[block].charset) {
-		    case CUEIFY_CDTEXT_CHARSET_ASCII:
-			data = utf8_to_ascii(datum[0], &data_size);
-			if (data == NULL) {
-			    goto error;
-			}
-			if (write_cdtext_track_data(&writer, data, data_size,
-						    0) != CUEIFY_OK) {
-			    free(data);
-			    goto error;
-			}
-			free(data);
-			data = NULL;
-			break;
-		    case CUEIFY_CDTEXT_CHARSET_ISO8859_1:
-			data = utf8_to_latin1(datum[0], &data_size);
-			if (data == NULL) {
-			    goto error;
-			}
-			if (write_cdtext_track_data(&writer, data, data_size,
-						    0) != CUEIFY_OK) {
-			    free(data);
-			    goto error;
-			}
-			free(data);
-			data = NULL;
-			break;
-		    case CUEIFY_CDTEXT_CHARSET_MSJIS:
-			data = utf8_to_msjis(datum[0], &data_size);
-			if (data == NULL) {
-			    goto error;
-			}
+		    if (charset == CUEIFY_CDTEXT_CHARSET_ASCII ||
+			charset == CUEIFY_CDTEXT_CHARSET_ISO8859_1 ||
+			charset == CUEIFY_CDTEXT_CHARSET_MSJIS) {
+			data = next_cdtext_string(&encoding, &data_size);
 			if (write_cdtext_track_data(&writer, data, data_size,
 						    0) != CUEIFY_OK) {
-			    free(data);
 			    goto error;
 			}
-			free(data);
-			data = NULL;
-			break;
-		    default:
+		    } else {
 			/* Ignore this block encoding! */
-			break;
 		    }
 		}
 		for (track = cdtext->blocks[block].first_track_number;
 		     track <= cdtext->blocks[block].last_track_number;
 		     track++) {
-		    /* Count the number of bytes we'd need to encode
-		     * the value. */
+		    if (charset != CUEIFY_CDTEXT_CHARSET_ASCII &&
+			charset != CUEIFY_CDTEXT_CHARSET_ISO8859_1 &&
+			charset != CUEIFY_CDTEXT_CHARSET_MSJIS) {
+			/* Ignore this block encoding! */
+			break;
+		    }
 		    if (datum[track] &&
 			(datum[track][0] != '\0' || already_wrote_track)) {
-			switch (cdtext->blocks[block].charset) {
-			case CUEIFY_CDTEXT_CHARSET_ASCII:
-			    if (!already_wrote_track) {
-				/* We must encode terminators for
-				 * everything we don't care about. */
-				already_wrote_track = 1;
-				data = terminator;
-				for (trk = 0; trk < track; trk++) {
-				    if (write_cdtext_track_data(
-					    &writer, data, 1, trk) !=
-					CUEIFY_OK) {
-					data = NULL;
-					goto error;
-				    }
-				    if (trk == 0) {
-					trk = cdtext->blocks[block]
-					    .first_track_number;
-				    }
+			if (!already_wrote_track) {
+			    /* We must encode terminators for
+			     * everything we don't care about. */
+			    already_wrote_track = 1;
+			    for (trk = 0; trk < track; trk++) {
+				if (write_cdtext_track_data(
+					&writer, terminator, width, trk) !=
+				    CUEIFY_OK) {
+				    goto error;
 				}
-				data = NULL;
-			    }
-
-			    data = utf8_to_ascii(datum[track], &data_size);
-			    if (data == NULL) {
-				goto error;
-			    }
-			    if (write_cdtext_track_data(&writer, data,
-							data_size, track) !=
-				CUEIFY_OK) {
-				free(data);
-				goto error;
-			    }
-			    free(data);
-			    data = NULL;
-			    break;
-			case CUEIFY_CDTEXT_CHARSET_ISO8859_1:
-			    if (!already_wrote_track) {
-				/* We must encode terminators for
-				 * everything we don't care about. */
-				already_wrote_track = 1;
-				data = terminator;
-				for (trk = 0; trk < track; trk++) {
-				    if (write_cdtext_track_data(
-					    &writer, data, 1, trk) !=
-					CUEIFY_OK) {
-					data = NULL;
-					goto error;
-				    }
-				    if (trk == 0) {
-					trk = cdtext->blocks[block]
-					    .first_track_number;
-				    }
+				if (trk == 0) {
+				    trk = cdtext->blocks[block]
+					.first_track_number;
 				}
-				data = NULL;
-			    }
-
-			    data = utf8_to_latin1(datum[track], &data_size);
-			    if (data == NULL) {
-				goto error;
-			    }
-			    if (write_cdtext_track_data(&writer, data,
-							data_size, track) !=
-				CUEIFY_OK) {
-				free(data);
-				goto error;
-			    }
-			    free(data);
-			    data = NULL;
-			    break;
-			case CUEIFY_CDTEXT_CHARSET_MSJIS:
-			    if (!already_wrote_track) {
-				/* We must encode terminators for
-				 * everything we don't care about. */
-				already_wrote_track = 1;
-				data = terminator;
-				for (trk = 0; trk < track; trk++) {
-				    if (write_cdtext_track_data(
-					    &writer, data, 2, trk) !=
-					CUEIFY_OK) {
-					data = NULL;
-					goto error;
-				    }
-				    if (trk == 0) {
-					trk = cdtext->blocks[block]
-					    .first_track_number;
-				    }
-				}
-				data = NULL;
 			    }
+			}
 
-			    data = utf8_to_msjis(datum[track], &data_size);
-			    if (data == NULL) {
-				goto error;
-			    }
-			    if (write_cdtext_track_data(&writer, data,
-							data_size, track) !=
-				CUEIFY_OK) {
-				free(data);
-				goto error;
-			    }
-			    free(data);
-			    data = NULL;
-			    break;
-			default:
-			    /* Ignore this block encoding! */
-			    break;
+			data = next_cdtext_string(&encoding, &data_size);
+			if (write_cdtext_track_data(&writer, data,
+						    data_size, track) !=
+			    CUEIFY_OK) {
+			    goto error;
 			}
 		    }
 		}
@@ -1130,17 +1156,11 @@ int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
 	    case 6:   /* 0x86 = DISCID */
 		/* According to Red Book, only ISO 8859-1 may be used. */
 		if (cdtext->blocks[block].discid != NULL) {
-		    data = utf8_to_latin1(cdtext->blocks[block].discid,
-					  &data_size);
-		    if (data == NULL) {
-			goto error;
-		    }
+		    data = next_cdtext_string(&encoding, &data_size);
 		    if (write_cdtext_track_data(&writer, data, data_size, 0) !=
 			CUEIFY_OK) {
-			free(data);
 			goto error;
 		    }
-		    free(data);
 		    if (flush_cdtext_writer(&writer) != CUEIFY_OK) {
 			goto error;
 		    }
@@ -1162,17 +1182,11 @@ int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
 		    terminator[0] = terminator[1] = '\0';
 		}
 		if (cdtext->blocks[block].genre_name != NULL) {
-		    data = utf8_to_latin1(cdtext->blocks[block].genre_name,
-					  &data_size);
-		    if (data == NULL) {
-			goto error;
-		    }
+		    data = next_cdtext_string(&encoding, &data_size);
 		    if (write_cdtext_track_data(&writer, data, data_size, 0) !=
 			CUEIFY_OK) {
-			free(data);
 			goto error;
 		    }
-		    free(data);
 		}
 		if (cdtext->blocks[block].genre_name != NULL ||
 		    cdtext->blocks[block].genre_code != 0) {
@@ -1287,51 +1301,239 @@ int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
 	    }
 	}
     }
+    if (writer.bp != writer.end) {
+	/* Fewer PACKs than were counted. */
+	goto error;
+    }
 
+    free(encoding.data);
     return CUEIFY_OK;
 
 error:
-    return CUEIFY_ERR_INTERNAL;
+    free(encoding.data);
+    if (allocated != NULL) {
+	free(*allocated);
+	*allocated = NULL;
+    }
+    return retval;
+}  /* serialize_cdtext */
+
+
+int cueify_cdtext_serialize(cueify_cdtext *t, uint8_t *buffer,
+			    size_t *size) {
+    if (t == NULL || size == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    return serialize_cdtext((cueify_cdtext_private *)t, buffer, size, NULL);
 }  /* cueify_cdtext_serialize */
 
 
-void cueify_cdtext_free(cueify_cdtext *t) {
-    cueify_cdtext_private *cdtext = (cueify_cdtext_private *)t;
-    int track, block;
+int cueify_cdtext_serialize_alloc(cueify_cdtext *t, uint8_t **buffer,
+				  size_t *size) {
+    if (t == NULL || buffer == NULL || size == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    *buffer = NULL;
+    return serialize_cdtext((cueify_cdtext_private *)t, NULL, size, buffer);
+}  /* cueify_cdtext_serialize_alloc */
+
+
+int cueify_cdtext_reserve(cueify_cdtext_private *t, size_t size) {
+    cueify_cdtext_arena_private *chunk;
+
+    if (t->arena != NULL && t->arena->size - t->arena->used >= size) {
+	return CUEIFY_OK;
+    }
+
+    if (size < CDTEXT_ARENA_CHUNK_SIZE) {
+	size = CDTEXT_ARENA_CHUNK_SIZE;
+    }
+    chunk = malloc(sizeof(cueify_cdtext_arena_private) + size);
+    if (chunk == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    chunk->next = t->arena;
+    chunk->size = size;
+    chunk->used = 0;
+    t->arena = chunk;
+
+    return CUEIFY_OK;
+}  /* cueify_cdtext_reserve */
+
+
+void *cueify_cdtext_alloc(cueify_cdtext_private *t, size_t size) {
+    void *memory;
+
+    if (cueify_cdtext_reserve(t, size) != CUEIFY_OK) {
+	return NULL;
+    }
+    memory = t->arena->data + t->arena->used;
+    t->arena->used += size;
+    return memory;
+}  /* cueify_cdtext_alloc */
+
+
+char *cueify_cdtext_strdup(cueify_cdtext_private *t, const char *s) {
+    char *copy;
+
+    if (s == NULL) {
+	return NULL;
+    }
+    copy = cueify_cdtext_alloc(t, strlen(s) + 1);
+    if (copy != NULL) {
+	strcpy(copy, s);
+    }
+    return copy;
+}  /* cueify_cdtext_strdup */
+
+
+void cueify_cdtext_clear(cueify_cdtext_private *cdtext) {
+    cueify_cdtext_arena_private *chunk, *next;
+    int crc_mode = cdtext->crc_mode;
+
+    /* Every string and interval lives in the arena. */
+    for (chunk = cdtext->arena; chunk != NULL; chunk = next) {
+	next = chunk->next;
+	free(chunk);
+    }
+
+    memset(cdtext, 0, sizeof(cueify_cdtext_private));
+    /* The CRC mode is a setting, not data. */
+    cdtext->crc_mode = crc_mode;
+}  /* cueify_cdtext_clear */
+
+
+/**
+ * Copy a string into the arena of CD-Text data, preserving NULL.
+ *
+ * @param t the CD-Text data to copy the string into
+ * @param dst a pointer to set to the copy
+ * @param src the string to copy, or NULL
+ * @return CUEIFY_OK if the string was copied; otherwise
+ *         CUEIFY_ERR_NOMEM
+ */
+static int cdtext_strdup(cueify_cdtext_private *t, char **dst,
+			 const char *src) {
+    *dst = cueify_cdtext_strdup(t, src);
+    if (src != NULL && *dst == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    return CUEIFY_OK;
+}  /* cdtext_strdup */
+
+
+int cueify_cdtext_copy(cueify_cdtext_private *dst,
+		       const cueify_cdtext_private *src) {
+    const cueify_cdtext_block_private *from;
+    cueify_cdtext_block_private *to;
+    const cueify_cdtext_arena_private *chunk;
+    int track, block, crc_mode, retval = CUEIFY_OK;
+    size_t size = 0;
+
+    cueify_cdtext_clear(dst);
+    /* Copy the scalar fields, then replace every pointer with a copy. */
+    crc_mode = dst->crc_mode;
+    memcpy(dst, src, sizeof(cueify_cdtext_private));
+    dst->arena = NULL;
+    dst->crc_mode = crc_mode;
+
+    /* Everything copied fits in what the source arena holds. */
+    for (chunk = src->arena; chunk != NULL; chunk = chunk->next) {
+	size += chunk->used;
+    }
+    if (size > 0) {
+	retval |= cueify_cdtext_reserve(dst, size);
+    }
+
+    for (block = 0; block < MAX_BLOCKS; block++) {
+	from = &src->blocks[block];
+	to = &dst->blocks[block];
+	for (track = 0; track < MAX_TRACKS; track++) {
+	    retval |= cdtext_strdup(dst, &to->titles[track],
+				    from->titles[track]);
+	    retval |= cdtext_strdup(dst, &to->performers[track],
+				    from->performers[track]);
+	    retval |= cdtext_strdup(dst, &to->songwriters[track],
+				    from->songwriters[track]);
+	    retval |= cdtext_strdup(dst, &to->composers[track],
+				    from->composers[track]);
+	    retval |= cdtext_strdup(dst, &to->arrangers[track],
+				    from->arrangers[track]);
+	    retval |= cdtext_strdup(dst, &to->messages[track],
+				    from->messages[track]);
+	    retval |= cdtext_strdup(dst, &to->private[track],
+				    from->private[track]);
+	    retval |= cdtext_strdup(dst, &to->upc_isrcs[track],
+				    from->upc_isrcs[track]);
+	}
+	retval |= cdtext_strdup(dst, &to->discid, from->discid);
+	retval |= cdtext_strdup(dst, &to->genre_name, from->genre_name);
+    }
 
     for (track = 0; track < MAX_TRACKS; track++) {
-	for (block = 0; block < MAX_BLOCKS; block++) {
-	    free(cdtext->blocks[block].titles[track]);
-	    cdtext->blocks[block].titles[track] = NULL;
-	    free(cdtext->blocks[block].performers[track]);
-	    cdtext->blocks[block].performers[track] = NULL;
-	    free(cdtext->blocks[block].songwriters[track]);
-	    cdtext->blocks[block].songwriters[track] = NULL;
-	    free(cdtext->blocks[block].composers[track]);
-	    cdtext->blocks[block].composers[track] = NULL;
-	    free(cdtext->blocks[block].arrangers[track]);
-	    cdtext->blocks[block].arrangers[track] = NULL;
-	    free(cdtext->blocks[block].messages[track]);
-	    cdtext->blocks[block].messages[track] = NULL;
-	    free(cdtext->blocks[block].private[track]);
-	    cdtext->blocks[block].private[track] = NULL;
-	    free(cdtext->blocks[block].upc_isrcs[track]);
-	    cdtext->blocks[block].upc_isrcs[track] = NULL;
-	    if (cdtext->blocks[block].discid != NULL) {
-		free(cdtext->blocks[block].discid);
-		cdtext->blocks[block].discid = NULL;
-	    }
-	    if (cdtext->blocks[block].genre_name != NULL) {
-		free(cdtext->blocks[block].genre_name);
-		cdtext->blocks[block].genre_name = NULL;
-	    }
+	dst->toc.intervals[track] = NULL;
+	if (src->toc.intervals[track] == NULL) {
+	    continue;
 	}
+	size = src->toc.num_intervals[track] *
+	    sizeof(cueify_cdtext_toc_track_interval_private);
+	dst->toc.intervals[track] = cueify_cdtext_alloc(dst, size);
+	if (dst->toc.intervals[track] == NULL) {
+	    retval = CUEIFY_ERR_NOMEM;
+	    continue;
+	}
+	memcpy(dst->toc.intervals[track], src->toc.intervals[track], size);
+    }
 
-	free(cdtext->toc.intervals[track]);
-	cdtext->toc.intervals[track] = NULL;
-	cdtext->toc.num_intervals[track] = 0;
+    if (retval != CUEIFY_OK) {
+	cueify_cdtext_clear(dst);
+	return CUEIFY_ERR_NOMEM;
     }
 
+    return CUEIFY_OK;
+}  /* cueify_cdtext_copy */
+
+
+size_t cueify_cdtext_check_packs(const uint8_t *packs, size_t num_packs,
+				 uint8_t *bitmap) {
+    if (packs == NULL && num_packs > 0) {
+	return 0;
+    }
+
+    return cdtext_crc_check_packs(packs, num_packs, bitmap);
+}  /* cueify_cdtext_check_packs */
+
+
+int cueify_cdtext_set_crc_mode(cueify_cdtext *t, int mode) {
+    cueify_cdtext_private *cdtext = (cueify_cdtext_private *)t;
+
+    if (t == NULL ||
+	(mode != CUEIFY_CDTEXT_CRC_COUNT &&
+	 mode != CUEIFY_CDTEXT_CRC_STRICT &&
+	 mode != CUEIFY_CDTEXT_CRC_DROP)) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    cdtext->crc_mode = mode;
+    return CUEIFY_OK;
+}  /* cueify_cdtext_set_crc_mode */
+
+
+unsigned int cueify_cdtext_get_num_bad_packs(cueify_cdtext *t) {
+    cueify_cdtext_private *cdtext = (cueify_cdtext_private *)t;
+
+    if (t == NULL) {
+	return 0;
+    }
+
+    return cdtext->num_bad_packs;
+}  /* cueify_cdtext_get_num_bad_packs */
+
+
+void cueify_cdtext_free(cueify_cdtext *t) {
+    cueify_cdtext_clear((cueify_cdtext_private *)t);
     free(t);
 }  /* cueify_cdtext_free */
 
@@ -28,6 +28,8 @@ extern "C" {
  * The definition of the used algorithm.
  *****************************************************************************/
 #define CRC_ALGO_TABLE_DRIVEN 1
+/** Tables are sliced eight bytes at a time. */
+#define CRC_ALGO_SLICE_BY 8
 
 
 /**
@@ -61,6 +63,20 @@ cdtext_crc_t cdtext_crc_update(cdtext_crc_t crc, const unsigned char *data,
 			       size_t data_len);
 
 
+/**
+ * Check the crcs of an array of CD-Text PACKs.
+ *
+ * \param packs     Pointer to \a num_packs PACKs of 18 bytes.
+ * \param num_packs Number of PACKs in the \a packs array.
+ * \param bitmap    Pointer to (num_packs + 7) / 8 bytes to set bit
+ *                  (i % 8) of byte (i / 8) in for every failing PACK i
+ *                  (and clear for every other), or NULL.
+ * \return          The number of PACKs failing their check.
+ *****************************************************************************/
+size_t cdtext_crc_check_packs(const unsigned char *packs, size_t num_packs,
+			      unsigned char *bitmap);
+
+
 /**
  * Calculate the final CD-Text crc value.
  *
@@ -0,0 +1,305 @@
+/* cdtext_parser.c - Streaming parser of serialized CD-Text
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <cueify/cdtext.h>
+#include <cueify/error.h>
+#include "cdtext_private.h"
+#include "cdtext_crc.h"
+
+/** Size of the header of serialized CD-Text. */
+#define HEADER_SIZE  4
+
+cueify_cdtext_parser *cueify_cdtext_parser_new(
+    cueify_cdtext_parser_callback callback, void *context) {
+    cueify_cdtext_parser_private *parser;
+
+    if (callback == NULL) {
+	return NULL;
+    }
+
+    parser = calloc(1, sizeof(cueify_cdtext_parser_private));
+    if (parser == NULL) {
+	return NULL;
+    }
+    parser->cdtext = (cueify_cdtext_private *)cueify_cdtext_new();
+    if (parser->cdtext == NULL) {
+	free(parser);
+	return NULL;
+    }
+    parser->callback = callback;
+    parser->context = context;
+
+    return (cueify_cdtext_parser *)parser;
+}  /* cueify_cdtext_parser_new */
+
+
+int cueify_cdtext_parser_set_crc_mode(cueify_cdtext_parser *p, int mode) {
+    cueify_cdtext_parser_private *parser = (cueify_cdtext_parser_private *)p;
+
+    if (p == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    /* The mode is kept (and checked) by the CD-Text being parsed. */
+    return cueify_cdtext_set_crc_mode((cueify_cdtext *)parser->cdtext, mode);
+}  /* cueify_cdtext_parser_set_crc_mode */
+
+
+/**
+ * Start parsing a new CD-Text with a CD-Text parser.
+ *
+ * @param parser the CD-Text parser
+ * @param header the header of the serialized CD-Text
+ * @return CUEIFY_OK if the header was valid, else CUEIFY_ERR_CORRUPTED
+ */
+static int start_cdtext(cueify_cdtext_parser_private *parser,
+			const uint8_t *header) {
+    uint16_t toc_length;
+    int block, pack_type;
+
+    /* CD-TEXT Data Length */
+    toc_length = ((header[0] << 8) | header[1]);
+    if (toc_length < 2 || (toc_length - 2) % PACK_SIZE != 0) {
+	return CUEIFY_ERR_CORRUPTED;
+    }
+
+    /* Free the previous cdtext data (strings, intervals, and all). */
+    cueify_cdtext_clear(parser->cdtext);
+    for (block = 0; block < MAX_BLOCKS; block++) {
+	for (pack_type = 0; pack_type < NUM_PACK_TYPES; pack_type++) {
+	    parser->pack_sizes[block][pack_type] = 0;
+	}
+    }
+    parser->remaining = toc_length - 2;
+    parser->status = CUEIFY_OK;
+
+    return CUEIFY_OK;
+}  /* start_cdtext */
+
+
+/**
+ * Parse a single PACK of the CD-Text being parsed by a CD-Text parser.
+ *
+ * @param parser the CD-Text parser
+ * @param bp a pointer to the PACK
+ */
+static void parse_pack(cueify_cdtext_parser_private *parser,
+		       const uint8_t *bp) {
+    const struct cdtext_descriptor *descriptor =
+	(const struct cdtext_descriptor *)bp;
+    int block, pack_type;
+    size_t capacity;
+    unsigned char *pack;
+
+    if (parser->status != CUEIFY_OK) {
+	/* Skip the rest of a CD-Text we have given up on. */
+	return;
+    }
+
+    if (cdtext_crc_check_packs(bp, 1, NULL) > 0) {
+	parser->cdtext->num_bad_packs++;
+	if (parser->cdtext->crc_mode == CUEIFY_CDTEXT_CRC_STRICT) {
+	    parser->status = CUEIFY_ERR_CORRUPTED;
+	    return;
+	} else if (parser->cdtext->crc_mode == CUEIFY_CDTEXT_CRC_DROP) {
+	    return;
+	}
+    }
+
+    /* Ignore extension blocks. */
+    if (EXTENSION_FLAG(descriptor->track_number) ||
+	descriptor->pack_type < 0x80 ||
+	descriptor->pack_type > 0x8F) {
+	return;
+    }
+
+    /* Intervals need the track number from the PACK itself. */
+    if (descriptor->pack_type == 0x89) {
+	parser->status = cueify_cdtext_read_tocinfo2(parser->cdtext,
+						     descriptor);
+	return;
+    }
+
+    block = BLOCK_NUMBER(descriptor->block_number);
+    pack_type = descriptor->pack_type - 0x80;
+
+    /* Aggregate the PACK with the others of its BLOCK and type. */
+    /* NOTE: We assume that PACKs in a given PACK type are in order!! */
+    if (parser->pack_sizes[block][pack_type] + 12 >
+	parser->pack_capacities[block][pack_type]) {
+	capacity = parser->pack_capacities[block][pack_type] * 2;
+	if (capacity == 0) {
+	    capacity = 12 * 16;
+	}
+	pack = realloc(parser->pack_data[block][pack_type], capacity);
+	if (pack == NULL) {
+	    parser->status = CUEIFY_ERR_NOMEM;
+	    return;
+	}
+	parser->pack_data[block][pack_type] = pack;
+	parser->pack_capacities[block][pack_type] = capacity;
+    }
+    memcpy(parser->pack_data[block][pack_type] +
+	   parser->pack_sizes[block][pack_type], descriptor->data, 12);
+    parser->pack_sizes[block][pack_type] += 12;
+}  /* parse_pack */
+
+
+/**
+ * Finish parsing the CD-Text being parsed by a CD-Text parser, and
+ * pass it to the callback of the parser.
+ *
+ * @param parser the CD-Text parser
+ */
+static void end_cdtext(cueify_cdtext_parser_private *parser) {
+    unsigned char *pack_data[MAX_BLOCKS][NUM_PACK_TYPES];
+    size_t packs_size = 0;
+    int block, pack_type;
+
+    /* Only aggregates with PACKs in this CD-Text are decoded. */
+    for (block = 0; block < MAX_BLOCKS; block++) {
+	for (pack_type = 0; pack_type < NUM_PACK_TYPES; pack_type++) {
+	    pack_data[block][pack_type] = NULL;
+	    if (parser->pack_sizes[block][pack_type] > 0) {
+		pack_data[block][pack_type] =
+		    parser->pack_data[block][pack_type];
+		packs_size += parser->pack_sizes[block][pack_type];
+	    }
+	}
+    }
+
+    if (parser->status == CUEIFY_OK) {
+	/* As in cueify_cdtext_deserialize(). */
+	parser->status = cueify_cdtext_reserve(parser->cdtext,
+					       packs_size * 2);
+    }
+    if (parser->status == CUEIFY_OK) {
+	parser->status = cueify_cdtext_decode_packs(parser->cdtext,
+						    pack_data,
+						    parser->pack_sizes);
+    }
+    if (parser->status != CUEIFY_OK) {
+	/* Pass along nothing, as cueify_cdtext_deserialize() would. */
+	cueify_cdtext_clear(parser->cdtext);
+    }
+
+    parser->callback(parser->context, parser->status,
+		     (cueify_cdtext *)parser->cdtext);
+}  /* end_cdtext */
+
+
+int cueify_cdtext_parser_feed(cueify_cdtext_parser *p, const uint8_t *bytes,
+			      size_t n) {
+    cueify_cdtext_parser_private *parser = (cueify_cdtext_parser_private *)p;
+    size_t wanted, length;
+    const uint8_t *bp;
+    int retval;
+
+    if (p == NULL || (bytes == NULL && n > 0)) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    while (n > 0) {
+	/* Headers precede CD-Text; PACKs follow until it is complete. */
+	wanted = parser->remaining == 0 ? HEADER_SIZE : PACK_SIZE;
+
+	if (parser->partial_size == 0 && n >= wanted) {
+	    /* Parse in place. */
+	    bp = bytes;
+	    bytes += wanted;
+	    n -= wanted;
+	} else {
+	    /* Gather a header or PACK split between calls. */
+	    length = wanted - parser->partial_size;
+	    if (length > n) {
+		length = n;
+	    }
+	    memcpy(parser->partial + parser->partial_size, bytes, length);
+	    parser->partial_size += length;
+	    bytes += length;
+	    n -= length;
+	    if (parser->partial_size < wanted) {
+		break;
+	    }
+	    parser->partial_size = 0;
+	    bp = parser->partial;
+	}
+
+	if (parser->remaining == 0) {
+	    retval = start_cdtext(parser, bp);
+	    if (retval != CUEIFY_OK) {
+		return retval;
+	    }
+	} else {
+	    parse_pack(parser, bp);
+	    parser->remaining -= PACK_SIZE;
+	}
+
+	if (parser->remaining == 0) {
+	    end_cdtext(parser);
+	}
+    }
+
+    return CUEIFY_OK;
+}  /* cueify_cdtext_parser_feed */
+
+
+int cueify_cdtext_parser_finish(cueify_cdtext_parser *p) {
+    cueify_cdtext_parser_private *parser = (cueify_cdtext_parser_private *)p;
+    int retval = CUEIFY_OK;
+
+    if (p == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    if (parser->remaining > 0 || parser->partial_size > 0) {
+	retval = CUEIFY_ERR_TRUNCATED;
+    }
+    parser->remaining = 0;
+    parser->partial_size = 0;
+    cueify_cdtext_clear(parser->cdtext);
+
+    return retval;
+}  /* cueify_cdtext_parser_finish */
+
+
+void cueify_cdtext_parser_free(cueify_cdtext_parser *p) {
+    cueify_cdtext_parser_private *parser = (cueify_cdtext_parser_private *)p;
+    int block, pack_type;
+
+    if (p == NULL) {
+	return;
+    }
+
+    for (block = 0; block < MAX_BLOCKS; block++) {
+	for (pack_type = 0; pack_type < NUM_PACK_TYPES; pack_type++) {
+	    free(parser->pack_data[block][pack_type]);
+	}
+    }
+    cueify_cdtext_free((cueify_cdtext *)parser->cdtext);
+    free(parser);
+}  /* cueify_cdtext_parser_free */
@@ -27,10 +27,13 @@
 #define _CUEIFY_CDTEXT_PRIVATE_H
 
 #include <cueify/types.h>
+#include <cueify/cdtext.h>
 #include "device_private.h"
 
 #define MAX_TRACKS  100  /** Maximum number of tracks on a CD. */
 #define MAX_BLOCKS  8  /** Maximum number of CD-Text blocks. */
+/** Maximum number of PACKs in serialized CD-Text (by its 16-bit length). */
+#define MAX_PACKS  ((0xFFFF - 2) / 18)
 
 /** Internal structure to hold CD-Text block data. */
 typedef struct {
@@ -86,14 +89,114 @@ typedef struct {
 } cueify_cdtext_toc_private;
 
 
+/**
+ * Internal structure for a chunk of memory from which the strings and
+ * intervals of CD-Text data are allocated.
+ */
+typedef struct cueify_cdtext_arena_private {
+    /** The chunk allocated before this one, or NULL if none. */
+    struct cueify_cdtext_arena_private *next;
+    size_t size;  /** Number of bytes in data. */
+    size_t used;  /** Number of bytes of data already allocated. */
+    char data[];  /** Memory to allocate from. */
+} cueify_cdtext_arena_private;
+
+/** Smallest chunk of memory to add to a CD-Text arena. */
+#define CDTEXT_ARENA_CHUNK_SIZE  4096
+
+
 /** Internal structure to hold CD-Text data. */
 typedef struct {
     /** Blocks in the CD-Text data. */
     cueify_cdtext_block_private blocks[MAX_BLOCKS];
     /** TOC data in the CD-Text data. */
     cueify_cdtext_toc_private toc;
+    /**
+     * Most recent chunk of the memory holding every string and
+     * interval in the CD-Text data, or NULL if none are held.
+     */
+    cueify_cdtext_arena_private *arena;
+    /** How PACKs failing their CRC check are handled (CUEIFY_CDTEXT_CRC_*). */
+    int crc_mode;
+    /** Number of PACKs which failed their CRC check when deserialized. */
+    unsigned int num_bad_packs;
 } cueify_cdtext_private;
 
+/** Structure representing the contents of a CD-Text descriptor. */
+struct cdtext_descriptor {
+    uint8_t pack_type;  /** Type of the PACK */
+    /** Track number or PACK element number; extension flag in the MSB. */
+    uint8_t track_number;
+    uint8_t sequence_number;  /** Number of this PACK in sequence. */
+    /**
+     * Double-byte char-code flag in the MSB;
+     * BLOCK number in next 3 highest bits;
+     * Character position in the 4 least significant bits.
+     */
+    uint8_t block_number;
+    /* Data of the PACK. */
+    uint8_t data[12];
+    /* CRC checksum of the PACK ~(X^16 + X^12 + X^5 + 1) */
+    uint8_t crc[2];
+};
+
+
+/** Extract the extension flag from a track_number in a cdtext_descriptor. */
+#define EXTENSION_FLAG(x)  (x >> 7)
+/** Extract the track number from a track_number in a cdtext_descriptor. */
+#define TRACK_NUMBER(x)  (x & 0x7F)
+/** Extract the double-byte flag from a block_number in a cdtext_descriptor. */
+#define DOUBLE_BYTE(x)  (x >> 7)
+/** Extract the block number from a block_number in a cdtext_descriptor. */
+#define BLOCK_NUMBER(x)  ((x >> 4) & 0x7)
+/** Extract the character offset from a block_number in a cdtext_descriptor. */
+#define CHAR_POSITION(x)  (x & 0xF)
+
+
+/** Non-zero if PACK i is marked as failing its CRC check in a bitmap. */
+#define BAD_PACK(bitmap, i)  (((bitmap)[(i) / 8] >> ((i) % 8)) & 1)
+
+/** Number of PACK types (0x80-0x8F) in CD-Text. */
+#define NUM_PACK_TYPES  16
+
+/** Internal structure to hold an index of CD-Text PACKs in place. */
+typedef struct {
+    /** First PACK in the indexed buffer, which is owned by the caller. */
+    const uint8_t *packs;
+    size_t num_packs;  /** Number of PACKs in the buffer. */
+    /** Index of the first PACK of each BLOCK and type. */
+    uint16_t first[MAX_BLOCKS][NUM_PACK_TYPES];
+    /** Number of PACKs of each BLOCK and type. */
+    uint16_t count[MAX_BLOCKS][NUM_PACK_TYPES];
+} cueify_cdtext_view_private;
+
+
+/** Size of a serialized CD-Text PACK, including its CRC. */
+#define PACK_SIZE  18
+
+/** Internal structure to hold the state of a streaming CD-Text parser. */
+typedef struct {
+    /** Function to call with each CD-Text parsed. */
+    cueify_cdtext_parser_callback callback;
+    void *context;  /** Context pointer to pass to callback. */
+    /** The CD-Text being parsed (and passed to the callback). */
+    cueify_cdtext_private *cdtext;
+    /** Bytes of PACKs of the current CD-Text not yet received. */
+    size_t remaining;
+    /** Status of the current CD-Text, reported when it ends. */
+    int status;
+    /** A partially-received header or PACK. */
+    uint8_t partial[PACK_SIZE];
+    size_t partial_size;  /** Number of bytes in partial. */
+    /** Aggregate PACK data received by BLOCK and type. */
+    unsigned char *pack_data[MAX_BLOCKS][NUM_PACK_TYPES];
+    /** Number of bytes of aggregate PACK data by BLOCK and type. */
+    size_t pack_sizes[MAX_BLOCKS][NUM_PACK_TYPES];
+    /** Number of bytes allocated for pack_data by BLOCK and type. */
+    size_t pack_capacities[MAX_BLOCKS][NUM_PACK_TYPES];
+} cueify_cdtext_parser_private;
+
+
 /**
  * Unportable read of the CD-Text of the disc in the optical disc device
  * associated with a device handle.
@@ -106,4 +209,85 @@ typedef struct {
 int cueify_device_read_cdtext_unportable(cueify_device_private *d,
 					 cueify_cdtext_private *t);
 
+
+/**
+ * Make sure that the arena of CD-Text data can allocate a number of
+ * bytes without adding another chunk.
+ *
+ * @param t the CD-Text data to reserve memory in
+ * @param size the number of bytes to reserve
+ * @return CUEIFY_OK if the memory was reserved; otherwise
+ *         CUEIFY_ERR_NOMEM
+ */
+int cueify_cdtext_reserve(cueify_cdtext_private *t, size_t size);
+
+
+/**
+ * Allocate memory from the arena of CD-Text data.  The memory is freed
+ * (with everything else in the arena) by cueify_cdtext_clear().
+ *
+ * @param t the CD-Text data to allocate memory in
+ * @param size the number of bytes to allocate
+ * @return the memory allocated, or NULL if there was not enough memory
+ */
+void *cueify_cdtext_alloc(cueify_cdtext_private *t, size_t size);
+
+
+/**
+ * Copy a NUL-terminated string into the arena of CD-Text data.
+ *
+ * @param t the CD-Text data to copy the string into
+ * @param s the string to copy, or NULL
+ * @return the copy, or NULL if s is NULL or there was not enough memory
+ */
+char *cueify_cdtext_strdup(cueify_cdtext_private *t, const char *s);
+
+
+/**
+ * Free all strings and intervals held by CD-Text data and reset it to
+ * an empty state.
+ *
+ * @param t the CD-Text data to clear
+ */
+void cueify_cdtext_clear(cueify_cdtext_private *t);
+
+
+/**
+ * Replace CD-Text data with a deep copy of other CD-Text data.
+ *
+ * @param dst the CD-Text data to replace
+ * @param src the CD-Text data to copy
+ * @return CUEIFY_OK if the data was copied; otherwise
+ *         CUEIFY_ERR_NOMEM, in which case dst is left empty
+ */
+int cueify_cdtext_copy(cueify_cdtext_private *dst,
+		       const cueify_cdtext_private *src);
+
+
+/**
+ * Decode the PACKs of CD-Text data, aggregated by BLOCK and type, into
+ * its blocks and TOC (all but the intervals of TOCINFO2 PACKs).
+ *
+ * @param t the CD-Text data to decode into
+ * @param pack_data the aggregate data of the PACKs of each BLOCK and type
+ * @param pack_sizes the number of bytes in each of pack_data
+ * @return CUEIFY_OK if the PACKs were decoded; otherwise
+ *         CUEIFY_ERR_NOMEM
+ */
+int cueify_cdtext_decode_packs(cueify_cdtext_private *t,
+			       unsigned char *pack_data[MAX_BLOCKS][16],
+			       size_t pack_sizes[MAX_BLOCKS][16]);
+
+
+/**
+ * Read the interval in a TOCINFO2 PACK into CD-Text data.
+ *
+ * @param t the CD-Text data to read the interval into
+ * @param descriptor the TOCINFO2 PACK
+ * @return CUEIFY_OK if the interval was read; otherwise
+ *         CUEIFY_ERR_NOMEM
+ */
+int cueify_cdtext_read_tocinfo2(cueify_cdtext_private *t,
+				const struct cdtext_descriptor *descriptor);
+
 #endif  /* _CUEIFY_CDTEXT_PRIVATE_H */
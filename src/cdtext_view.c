@@ -0,0 +1,412 @@
+/* cdtext_view.c - Decoding of single CD-Text strings in place
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <cueify/cdtext.h>
+#include <cueify/error.h>
+#include "cdtext_private.h"
+#include "charsets.h"
+
+/** Index of the SIZEINFO PACK type (0x8F). */
+#define SIZEINFO  15
+/** Number of SIZEINFO PACKs in a block. */
+#define SIZEINFO_PACKS  3
+
+/** Internal structure for reading the text of a PACK type in order. */
+typedef struct {
+    const cueify_cdtext_view_private *view;  /** The view being read. */
+    int block;  /** BLOCK of the PACKs being read. */
+    int pack_type;  /** Index of the PACK type being read. */
+    size_t next;  /** Index of the next PACK to consider. */
+    uint16_t remaining;  /** Number of PACKs not yet read. */
+    const uint8_t *data;  /** Data of the current PACK. */
+    int offset;  /** Offset of the next byte in data. */
+} pack_reader_t;
+
+
+cueify_cdtext_view *cueify_cdtext_view_new() {
+    return calloc(1, sizeof(cueify_cdtext_view_private));
+}  /* cueify_cdtext_view_new */
+
+
+int cueify_cdtext_view_index(cueify_cdtext_view *v,
+			     const uint8_t * const buffer, size_t size) {
+    cueify_cdtext_view_private *view = (cueify_cdtext_view_private *)v;
+    const struct cdtext_descriptor *descriptor;
+    uint16_t toc_length;
+    size_t i;
+    int block, pack_type;
+
+    if (v == NULL || buffer == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+    if (size < 4) {
+	return CUEIFY_ERR_TRUNCATED;
+    }
+
+    /* CD-TEXT Data Length */
+    toc_length = ((buffer[0] << 8) | buffer[1]);
+    if (size - 2 < toc_length) {
+	return CUEIFY_ERR_TRUNCATED;
+    }
+    if ((toc_length - 2) % 18 != 0) {
+	return CUEIFY_ERR_CORRUPTED;
+    }
+
+    memset(view, 0, sizeof(cueify_cdtext_view_private));
+    view->packs = buffer + 4;
+    view->num_packs = (toc_length - 2) / 18;
+
+    /* Note where the PACKs of each BLOCK and type start, and how many. */
+    for (i = 0; i < view->num_packs; i++) {
+	descriptor = (const struct cdtext_descriptor *)(view->packs + i * 18);
+
+	/* Ignore extension blocks. */
+	if (EXTENSION_FLAG(descriptor->track_number) ||
+	    descriptor->pack_type < 0x80 ||
+	    descriptor->pack_type > 0x8F) {
+	    continue;
+	}
+
+	block = BLOCK_NUMBER(descriptor->block_number);
+	pack_type = descriptor->pack_type - 0x80;
+	if (view->count[block][pack_type] == 0) {
+	    view->first[block][pack_type] = i;
+	}
+	view->count[block][pack_type]++;
+    }
+
+    return CUEIFY_OK;
+}  /* cueify_cdtext_view_index */
+
+
+void cueify_cdtext_view_free(cueify_cdtext_view *v) {
+    free(v);
+}  /* cueify_cdtext_view_free */
+
+
+/**
+ * Start reading the PACKs of a BLOCK and type in a CD-Text view.
+ *
+ * @param reader the reader to start
+ * @param view the CD-Text view to read
+ * @param block the BLOCK of the PACKs to read
+ * @param pack_type the index (0-15) of the type of the PACKs to read
+ */
+static void start_reading(pack_reader_t *reader,
+			  const cueify_cdtext_view_private *view,
+			  int block, int pack_type) {
+    reader->view = view;
+    reader->block = block;
+    reader->pack_type = pack_type;
+    reader->next = view->first[block][pack_type];
+    reader->remaining = view->count[block][pack_type];
+    reader->data = NULL;
+    reader->offset = 12;
+}  /* start_reading */
+
+
+/**
+ * Read the next byte of the PACKs of a BLOCK and type.
+ *
+ * @param reader the reader to read from
+ * @param byte a pointer to set to the byte read
+ * @return 1 if a byte was read, or 0 if there are no more
+ */
+static int read_byte(pack_reader_t *reader, uint8_t *byte) {
+    const struct cdtext_descriptor *descriptor;
+
+    while (reader->offset == 12) {
+	if (reader->remaining == 0) {
+	    return 0;
+	}
+	/* Find the next PACK of the type (which may be interleaved). */
+	do {
+	    descriptor = (const struct cdtext_descriptor *)
+		(reader->view->packs + reader->next++ * 18);
+	} while (EXTENSION_FLAG(descriptor->track_number) ||
+		 descriptor->pack_type != 0x80 + reader->pack_type ||
+		 BLOCK_NUMBER(descriptor->block_number) != reader->block);
+	reader->remaining--;
+	reader->data = descriptor->data;
+	reader->offset = 0;
+    }
+
+    *byte = reader->data[reader->offset++];
+    return 1;
+}  /* read_byte */
+
+
+/**
+ * Find the BLOCK number of a block in a CD-Text view.  As with
+ * cueify_cdtext_get_block(), only blocks with size information count.
+ *
+ * @param view the CD-Text view
+ * @param block the number of the block among those counted
+ * @return the BLOCK number, or -1 if there is no such block
+ */
+static int find_block(const cueify_cdtext_view_private *view,
+		      uint8_t block) {
+    int i;
+
+    for (i = 0; i < MAX_BLOCKS; i++) {
+	if (view->count[i][SIZEINFO] == SIZEINFO_PACKS) {
+	    if (block == 0) {
+		return i;
+	    }
+	    block--;
+	}
+    }
+    return -1;
+}  /* find_block */
+
+
+/**
+ * Read a byte of the size information of a BLOCK in a CD-Text view.
+ *
+ * @param view the CD-Text view
+ * @param block the BLOCK number, which must have size information
+ * @param offset the offset of the byte in the size information
+ * @return the byte
+ */
+static uint8_t sizeinfo_byte(const cueify_cdtext_view_private *view,
+			     int block, int offset) {
+    pack_reader_t reader;
+    uint8_t byte = 0;
+
+    start_reading(&reader, view, block, SIZEINFO);
+    do {
+	read_byte(&reader, &byte);
+    } while (offset-- > 0);
+    return byte;
+}  /* sizeinfo_byte */
+
+
+uint8_t cueify_cdtext_view_get_num_blocks(cueify_cdtext_view *v) {
+    cueify_cdtext_view_private *view = (cueify_cdtext_view_private *)v;
+    uint8_t num_blocks = 0;
+
+    if (v == NULL) {
+	return 0;
+    }
+
+    while (find_block(view, num_blocks) >= 0) {
+	num_blocks++;
+    }
+    return num_blocks;
+}  /* cueify_cdtext_view_get_num_blocks */
+
+
+uint8_t cueify_cdtext_view_get_charset(cueify_cdtext_view *v, uint8_t block) {
+    cueify_cdtext_view_private *view = (cueify_cdtext_view_private *)v;
+    int i;
+
+    if (v == NULL || (i = find_block(view, block)) < 0) {
+	return 0;
+    }
+    return sizeinfo_byte(view, i, 0);
+}  /* cueify_cdtext_view_get_charset */
+
+
+uint8_t cueify_cdtext_view_get_language(cueify_cdtext_view *v,
+					uint8_t block) {
+    cueify_cdtext_view_private *view = (cueify_cdtext_view_private *)v;
+    int i;
+
+    if (v == NULL || (i = find_block(view, block)) < 0) {
+	return 0;
+    }
+    /* NOTE: This might not work if the language codes aren't in
+     * EVERY info block */
+    return sizeinfo_byte(view, i, i + 28);
+}  /* cueify_cdtext_view_get_language */
+
+
+/**
+ * Decode one string from the PACKs of a BLOCK and type in a CD-Text view.
+ *
+ * Characters of earlier strings are only counted, not decoded.  As in
+ * cueify_cdtext_deserialize(), untranslatable characters end strings.
+ *
+ * @param view the CD-Text view
+ * @param block the BLOCK number of the PACKs
+ * @param pack_type the index (0-15) of the type of the PACKs
+ * @param skip the number of bytes preceding the text in the PACKs
+ * @param wide 1 if characters are two bytes wide (MS-JIS), else 0
+ * @param string the number of the string to decode
+ * @param buffer a pointer to a location to write the string to, or NULL
+ * @param size the size of buffer
+ * @param length a pointer to set to the length of the decoded string
+ * @return CUEIFY_OK if the string was decoded, or CUEIFY_NO_DATA if
+ *         there are fewer strings in the PACKs
+ */
+static int decode_string(const cueify_cdtext_view_private *view,
+			 int block, int pack_type, int skip, int wide,
+			 int string, char *buffer, size_t size,
+			 size_t *length) {
+    pack_reader_t reader;
+    uint8_t hi = 0, lo;
+    const char *character;
+    char wide_character[MSJIS_CHAR_UTF8_MAX];
+    size_t character_length;
+
+    *length = 0;
+    start_reading(&reader, view, block, pack_type);
+    while (skip-- > 0) {
+	read_byte(&reader, &lo);
+    }
+
+    for (;;) {
+	if ((wide && !read_byte(&reader, &hi)) || !read_byte(&reader, &lo)) {
+	    if (string > 0) {
+		return CUEIFY_NO_DATA;
+	    }
+	    /* The last string may be unterminated. */
+	    break;
+	}
+	if (wide) {
+	    character_length = msjis_char_to_utf8(hi, lo, wide_character);
+	    character = wide_character;
+	} else {
+	    character = latin1_char_to_utf8(lo);
+	    character_length = strlen(character);
+	}
+
+	if (character_length == 0) {
+	    if (string == 0) {
+		break;
+	    }
+	    string--;
+	} else if (string == 0) {
+	    if (buffer != NULL && *length + character_length < size) {
+		memcpy(buffer + *length, character, character_length);
+	    }
+	    *length += character_length;
+	}
+    }
+
+    if (buffer != NULL && *length < size) {
+	buffer[*length] = '\0';
+    }
+    return CUEIFY_OK;
+}  /* decode_string */
+
+
+int cueify_cdtext_view_get_string(cueify_cdtext_view *v, uint8_t block,
+				  uint8_t type, uint8_t track,
+				  char *buffer, size_t *size) {
+    cueify_cdtext_view_private *view = (cueify_cdtext_view_private *)v;
+    int i, skip = 0, wide, string, result;
+    uint8_t charset, first_track, last_track;
+    char tab[2];
+    size_t length;
+
+    if (v == NULL || size == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+    if ((i = find_block(view, block)) < 0) {
+	return CUEIFY_NO_DATA;
+    }
+    if (type < 0x80 || type > 0x8F) {
+	return CUEIFY_ERR_BADARG;
+    }
+    if (view->count[i][type - 0x80] == 0) {
+	return CUEIFY_NO_DATA;
+    }
+    charset = sizeinfo_byte(view, i, 0);
+    first_track = sizeinfo_byte(view, i, 1);
+    last_track = sizeinfo_byte(view, i, 2);
+
+    switch (type) {
+    case CUEIFY_CDTEXT_PACK_GENRE:
+	/* Skip the genre code. */
+	skip = 2;
+	/* Fall through */
+    case CUEIFY_CDTEXT_PACK_DISCID:
+	/* According to Red Book, only ISO 8859-1 may be used. */
+	if (track != CUEIFY_CDTEXT_ALBUM) {
+	    return CUEIFY_NO_DATA;
+	}
+	wide = 0;
+	string = 0;
+	break;
+    case CUEIFY_CDTEXT_PACK_TITLE:
+    case CUEIFY_CDTEXT_PACK_PERFORMER:
+    case CUEIFY_CDTEXT_PACK_SONGWRITER:
+    case CUEIFY_CDTEXT_PACK_COMPOSER:
+    case CUEIFY_CDTEXT_PACK_ARRANGER:
+    case CUEIFY_CDTEXT_PACK_MESSAGE:
+    case CUEIFY_CDTEXT_PACK_PRIVATE:
+    case CUEIFY_CDTEXT_PACK_UPC_ISRC:
+	if (charset == CUEIFY_CDTEXT_CHARSET_ASCII ||
+	    charset == CUEIFY_CDTEXT_CHARSET_ISO8859_1) {
+	    wide = 0;
+	} else if (charset == CUEIFY_CDTEXT_CHARSET_MSJIS) {
+	    /* NOTE: MS-JIS is a two-byte encoding. */
+	    wide = 1;
+	} else {
+	    /* Ignore! */
+	    return CUEIFY_NO_DATA;
+	}
+
+	/* The album string comes first, then one per track. */
+	if (track == CUEIFY_CDTEXT_ALBUM) {
+	    string = 0;
+	} else if (track >= first_track && track <= last_track) {
+	    string = track - first_track + 1;
+	} else {
+	    return CUEIFY_NO_DATA;
+	}
+
+	/* A lone TAB repeats the string of the previous track. */
+	while (string > 0) {
+	    result = decode_string(view, i, type - 0x80, 0, wide, string,
+				   tab, sizeof(tab), &length);
+	    if (result != CUEIFY_OK) {
+		return result;
+	    }
+	    if (length != 1 || tab[0] != '\t') {
+		break;
+	    }
+	    string--;
+	}
+	break;
+    default:
+	return CUEIFY_ERR_BADARG;
+    }
+
+    result = decode_string(view, i, type - 0x80, skip, wide, string,
+			   buffer, *size, &length);
+    if (result != CUEIFY_OK) {
+	return result;
+    }
+    if (buffer != NULL && length + 1 > *size) {
+	*size = length + 1;
+	return CUEIFY_ERR_TOOSMALL;
+    }
+    *size = length + 1;
+    return CUEIFY_OK;
+}  /* cueify_cdtext_view_get_string */
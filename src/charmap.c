@@ -0,0 +1,279 @@
+/* charmap.c - Encoding of UTF-8 through two-level reverse character maps
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#include <stdlib.h>
+
+#include "charsets.h"
+
+uint32_t utf8_decode(const uint8_t **bp) {
+    const uint8_t *p = *bp;
+    uint32_t character, minimum;
+    int length, i;
+
+    if (*p <= 0x7F) {
+	/* 1-byte codepoint */
+	*bp = p + 1;
+	return *p;
+    } else if (*p <= 0xBF) {
+	/* Invalid codepoint */
+	*bp = p + 1;
+	return '?';
+    } else if (*p <= 0xDF) {
+	/* 2-byte codepoint */
+	character = *p & 0x1F;
+	length = 2;
+	minimum = 0x80;
+    } else if (*p <= 0xEF) {
+	/* 3-byte codepoint */
+	character = *p & 0x0F;
+	length = 3;
+	minimum = 0x800;
+    } else if (*p <= 0xF7) {
+	/* 4-byte codepoint */
+	character = *p & 0x07;
+	length = 4;
+	minimum = 0x10000;
+    } else if (*p <= 0xFB) {
+	/* 5-byte codepoint (never valid) */
+	character = 0;
+	length = 5;
+	minimum = 0xFFFFFFFF;
+    } else if (*p <= 0xFD) {
+	/* 6-byte codepoint (never valid) */
+	character = 0;
+	length = 6;
+	minimum = 0xFFFFFFFF;
+    } else {
+	/* Invalid codepoint */
+	*bp = p + 1;
+	return '?';
+    }
+
+    for (i = 1; i < length; i++) {
+	if ((p[i] & 0xC0) != 0x80) {
+	    /* Truncated codepoint; leave the next one be. */
+	    *bp = p + i;
+	    return '?';
+	}
+	character = (character << 6) | (p[i] & 0x3F);
+    }
+    *bp = p + length;
+
+    if (character < minimum || character > 0x10FFFF) {
+	return '?';
+    }
+    return character;
+}  /* utf8_decode */
+
+
+/** Decode the next codepoint of a UTF-8 string, if any.
+ *
+ * @param bp a pointer to the next byte of the UTF-8 string, which will
+ *           be advanced past the codepoint
+ * @return the decoded codepoint, or 0 at the end of the string
+ */
+static inline uint32_t next_codepoint(const uint8_t **bp) {
+    const uint8_t *p = *bp;
+    uint32_t character;
+
+    if (p[0] == '\0') {
+	return 0;
+    } else if (p[0] <= 0x7F) {
+	/* 1-byte codepoint */
+	*bp = p + 1;
+	return p[0];
+    } else if (p[0] >= 0xC2 && p[0] <= 0xDF && (p[1] & 0xC0) == 0x80) {
+	/* 2-byte codepoint */
+	*bp = p + 2;
+	return ((p[0] & 0x1F) << 6) | (p[1] & 0x3F);
+    } else if ((p[0] & 0xF0) == 0xE0 && (p[1] & 0xC0) == 0x80 &&
+	       (p[2] & 0xC0) == 0x80) {
+	/* 3-byte codepoint */
+	character = ((p[0] & 0x0F) << 12) | ((p[1] & 0x3F) << 6) |
+	    (p[2] & 0x3F);
+	if (character >= 0x800) {
+	    *bp = p + 3;
+	    return character;
+	}
+    }
+    /* Longer, overlong or invalid codepoints. */
+    return utf8_decode(bp);
+}  /* next_codepoint */
+
+
+/** Get the row of a codepoint in the tables of a character set.
+ *
+ * @param charmap the tables of the character set
+ * @param character the codepoint
+ * @return the row of the codepoint (0 if it has none)
+ */
+static inline uint8_t charmap_row(const struct reverse_charmap *charmap,
+				  uint32_t character) {
+    if ((character >> 8) < charmap->num_rows) {
+	return charmap->rows[character >> 8];
+    }
+    return 0;
+}  /* charmap_row */
+
+
+/** Test the bit of a codepoint in a row of a bitmap.
+ *
+ * @param bitmap the bitmap of the character set
+ * @param row the row of the codepoint
+ * @param character the codepoint
+ * @return non-zero if the bit is set
+ */
+static inline int charmap_bit(const uint8_t (*bitmap)[32], uint8_t row,
+			      uint32_t character) {
+    return (bitmap[row][(character & 0xFF) >> 3] >> (character & 0x7)) & 1;
+}  /* charmap_bit */
+
+
+/** Compare two codepoint sequences (for bsearch). */
+static int compare_sequences(const void *a, const void *b) {
+    const struct codepoint_sequence *x = a, *y = b;
+
+    if (x->codepoints[0] != y->codepoints[0]) {
+	return x->codepoints[0] < y->codepoints[0] ? -1 : 1;
+    } else if (x->codepoints[1] != y->codepoints[1]) {
+	return x->codepoints[1] < y->codepoints[1] ? -1 : 1;
+    }
+    return 0;
+}  /* compare_sequences */
+
+
+/** Look up the encoding of a sequence of two codepoints.
+ *
+ * @param charmap the tables of the character set
+ * @param first the first codepoint of the sequence
+ * @param second the second codepoint of the sequence
+ * @return the encoding of the sequence, or 0 if there is none
+ */
+static uint16_t encode_sequence(const struct reverse_charmap *charmap,
+				uint32_t first, uint32_t second) {
+    struct codepoint_sequence key;
+    const struct codepoint_sequence *sequence;
+
+    key.codepoints[0] = first;
+    key.codepoints[1] = second;
+    sequence = bsearch(&key, charmap->sequences, charmap->num_sequences,
+		       sizeof(struct codepoint_sequence), compare_sequences);
+    if (sequence == NULL) {
+	return 0;
+    }
+    return sequence->encoding;
+}  /* encode_sequence */
+
+
+size_t charmap_encode(const struct reverse_charmap *charmap,
+		      const char *utf8, uint8_t *output,
+		      size_t capacity, int width) {
+    const uint8_t *bp = (const uint8_t *)utf8, *end, *next_bp;
+    const uint16_t (*table)[256] = charmap->table;
+    const uint16_t *ascii = table[charmap_row(charmap, 0)];
+    size_t characters = 0, run, i;
+    uint16_t encoding, replacement;
+    uint32_t character, next;
+    uint8_t row;
+
+    replacement = table[charmap_row(charmap, '?')]['?'];
+
+    end = bp + strlen(utf8);
+    while (bp < end) {
+	/*
+	 * Runs of ASCII need no decoding, and never begin or end a
+	 * sequence, so are encoded in bulk.
+	 */
+	if (*bp < 0x7F) {
+	    run = ascii_span(bp, end - bp);
+	    if (characters + run > capacity) {
+		/* Out of room; only count the rest. */
+		output = NULL;
+	    }
+	    if (output != NULL && charmap->ascii && width == 1) {
+		memcpy(output, bp, run);
+		output += run;
+	    } else if (output != NULL) {
+		for (i = 0; i < run; i++) {
+		    encoding = ascii[bp[i]];
+		    if (encoding == 0) {
+			/* No encoding. */
+			encoding = replacement;
+		    }
+		    if (width == 2) {
+			*output++ = encoding >> 8;
+		    }
+		    *output++ = encoding & 0xFF;
+		}
+	    }
+	    bp += run;
+	    characters += run;
+	    if (bp == end) {
+		break;
+	    }
+	}
+
+	character = next_codepoint(&bp);
+	row = charmap_row(charmap, character);
+
+	encoding = 0;
+	if (charmap_bit(charmap->sequence_starts, row, character)) {
+	    /* Decode one codepoint ahead to find sequences. */
+	    next_bp = bp;
+	    next = next_codepoint(&next_bp);
+	    if (next > 0x7F &&
+		charmap_bit(charmap->sequence_ends,
+			    charmap_row(charmap, next), next)) {
+		/* The codepoints may be encoded as a single character. */
+		encoding = encode_sequence(charmap, character, next);
+		if (encoding != 0) {
+		    bp = next_bp;
+		}
+	    }
+	}
+	if (encoding == 0) {
+	    encoding = table[row][character & 0xFF];
+	}
+	if (encoding == 0) {
+	    /* No encoding. */
+	    encoding = replacement;
+	}
+
+	if (characters >= capacity) {
+	    /* Out of room; only count the rest. */
+	    output = NULL;
+	}
+	if (output != NULL) {
+	    if (width == 2) {
+		*output++ = encoding >> 8;
+	    }
+	    *output++ = encoding & 0xFF;
+	}
+	characters++;
+    }
+
+    return characters;
+}  /* charmap_encode */
@@ -23,22 +23,88 @@
  * SOFTWARE.
  */
 
-#ifndef _CUEIFY_CHARSETS_H
-#define _CUEIFY_CHARSETS_H
+#ifndef _CUEIFY_CHARSETS_PRIVATE_H
+#define _CUEIFY_CHARSETS_PRIVATE_H
 
 #include <cueify/types.h>
+#include <cueify/charsets.h>
 
-/** Multi-byte codepoint data for encoding. */
-struct multibyte_codepoint {
-    /** Has an encoding of the codepoint */
-    int has_encoding;
-    /** Encoding of the codepoint */
-    uint8_t value[2];
-    /** Master table for successor characters */
-    const struct multibyte_codepoint * const * const *successor_master_table;
+/** A sequence of codepoints encoded as a single character. */
+struct codepoint_sequence {
+    /** The codepoints of the sequence */
+    uint32_t codepoints[2];
+    /** Encoding of the sequence */
+    uint16_t encoding;
 };
 
 
+/** Two-level tables mapping codepoints to their encoding. */
+struct reverse_charmap {
+    /** Number of runs of 256 codepoints in rows */
+    size_t num_rows;
+    /** Row of table for each run of 256 codepoints (0 if none) */
+    const uint8_t *rows;
+    /** Encoding of each codepoint in a row, or 0 if none */
+    const uint16_t (*table)[256];
+    /** Bitmap of the codepoints in a row which begin a sequence */
+    const uint8_t (*sequence_starts)[32];
+    /** Bitmap of the codepoints in a row which end a sequence */
+    const uint8_t (*sequence_ends)[32];
+    /** Number of sequences */
+    size_t num_sequences;
+    /** Sequences encoded as a single character, sorted by codepoint */
+    const struct codepoint_sequence *sequences;
+    /** Non-zero if ASCII (other than NUL and DEL) encodes as itself */
+    int ascii;
+};
+
+
+/** Get the length of the run of ASCII bytes at the start of a buffer.
+ *
+ * DEL (0x7F) ends the run as well, as the CD-Text variant of
+ * ISO-8859-1 does not encode it as itself.
+ *
+ * @param bytes a pointer to the buffer
+ * @param size the number of bytes in the buffer
+ * @return the number of bytes before the first byte of 0x7F or above
+ *         (or size if there is none)
+ */
+size_t ascii_span(const uint8_t *bytes, size_t size);
+
+
+/** Decode the next codepoint of a UTF-8 string.
+ *
+ * Invalid, overlong or truncated encodings (including those
+ * interrupted by the terminator) are decoded as '?'.
+ *
+ * @pre { **bp != '\0' }
+ * @param bp a pointer to the next byte of the UTF-8 string, which will
+ *           be advanced past the codepoint
+ * @return the decoded codepoint
+ */
+uint32_t utf8_decode(const uint8_t **bp);
+
+
+/** Encode a UTF-8 string in a character set.
+ *
+ * @note Characters which cannot be encoded will be replaced with the
+ *       encoding of '?'.
+ *
+ * @param charmap the tables of the character set to encode in
+ * @param utf8 the UTF-8 string to encode
+ * @param output a pointer to a buffer of width bytes for each of
+ *               capacity characters to write the (unterminated)
+ *               encoding to, or NULL to only count the characters
+ * @param capacity the number of characters output can hold.  If the
+ *                 encoding needs more, the rest are only counted.
+ * @param width the number of bytes in each encoded character (1 or 2)
+ * @return the number of characters in the encoding
+ */
+size_t charmap_encode(const struct reverse_charmap *charmap,
+		      const char *utf8, uint8_t *output,
+		      size_t capacity, int width);
+
+
 /** Allocate and populate a character buffer with the UTF-8
  *  translation of a string encoded with the ISO-8859-1 codec.
  *
@@ -70,6 +136,34 @@ char *latin1_to_utf8(uint8_t *latin1, int size);
 char *msjis_to_utf8(uint8_t *msjis, int size);
 
 
+/** Get the UTF-8 translation of a single character encoded with the
+ *  ISO-8859-1 codec.
+ *
+ * @param c the ISO-8859-1 character
+ * @return the UTF-8 encoding of c (an empty string for NUL)
+ */
+const char *latin1_char_to_utf8(uint8_t c);
+
+
+/** The maximum number of bytes in the UTF-8 translation of a single
+ *  (wide) MS-JIS character. */
+#define MSJIS_CHAR_UTF8_MAX 8
+
+
+/** Get the UTF-8 translation of a single (wide) character encoded
+ *  with the Music Shift-JIS codec.
+ *
+ * @param hi the high byte of the MS-JIS character
+ * @param lo the low byte of the MS-JIS character
+ * @param utf8 a pointer to at least MSJIS_CHAR_UTF8_MAX bytes to write
+ *             the (unterminated) UTF-8 encoding of the character to,
+ *             or NULL to only count them
+ * @return the number of bytes in the UTF-8 encoding of the character,
+ *         or 0 if it is NUL or has no translation
+ */
+size_t msjis_char_to_utf8(uint8_t hi, uint8_t lo, char *utf8);
+
+
 /** Get the number of bytes that would be needed to encode a UTF-8
  *  string in ASCII.
  *
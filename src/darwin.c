@@ -27,6 +27,7 @@
 #include <fcntl.h>
 #include <unistd.h>
 #include <sys/ioctl.h>
+#include <sys/disk.h>
 #include <CoreFoundation/CoreFoundation.h>
 #include <DiskArbitration/DiskArbitration.h>
 #include <IOKit/storage/IOCDMedia.h>
@@ -43,6 +44,7 @@
 #include "full_toc_private.h"
 #include "cdtext_private.h"
 #include "indices_private.h"
+#include "sector_cache_private.h"
 
 #define min(x, y)  ((x > y) ? y : x)  /** Return the minimum of x and y. */
 
@@ -69,6 +71,18 @@ int cueify_device_close_unportable(cueify_device_private *d) {
 }  /* cueify_device_close_unportable */
 
 
+int cueify_device_media_changed_unportable(cueify_device_private *d) {
+    uint64_t blocks;
+
+    /*
+     * The BSD node of a disc only lasts as long as the disc is in the
+     * drive, so once it is changed the handle fails (and a failed
+     * check is treated as a change, so nothing stale is reused).
+     */
+    return ioctl(d->handle, DKIOCGETBLOCKCOUNT, &blocks) < 0;
+}  /* cueify_device_media_changed_unportable */
+
+
 int cueify_device_get_supported_apis_unportable(cueify_device_private *d) {
     /* Suppress error about d. */
     d++;
@@ -127,6 +141,7 @@ int cueify_device_read_toc_unportable(cueify_device_private *d,
     if (ioctl(d->handle, DKIOCCDREADTOC, &toc) < 0) {
 	return CUEIFY_ERR_INTERNAL;
     }
+    d->transferred += toc.bufferLength;
 
     return cueify_toc_deserialize((cueify_toc *)t, toc.buffer,
 				  toc.bufferLength);
@@ -149,6 +164,7 @@ int cueify_device_read_sessions_unportable(cueify_device_private *d,
     if (ioctl(d->handle, DKIOCCDREADTOC, &toc) < 0) {
 	return CUEIFY_ERR_INTERNAL;
     }
+    d->transferred += toc.bufferLength;
 
     return cueify_sessions_deserialize((cueify_sessions *)s, toc.buffer,
 				       toc.bufferLength);
@@ -171,6 +187,7 @@ int cueify_device_read_full_toc_unportable(cueify_device_private *d,
     if (ioctl(d->handle, DKIOCCDREADTOC, &toc) < 0) {
 	return CUEIFY_ERR_INTERNAL;
     }
+    d->transferred += toc.bufferLength;
 
     return cueify_full_toc_deserialize((cueify_full_toc *)t, toc.buffer,
 				       toc.bufferLength);
@@ -193,6 +210,7 @@ int cueify_device_read_cdtext_unportable(cueify_device_private *d,
     if (ioctl(d->handle, DKIOCCDREADTOC, &toc) < 0) {
 	return CUEIFY_ERR_INTERNAL;
     }
+    d->transferred += toc.bufferLength;
 
     return cueify_cdtext_deserialize((cueify_cdtext *)t, toc.buffer,
 				     toc.bufferLength);
@@ -216,6 +234,7 @@ int cueify_device_read_mcn_unportable(cueify_device_private *d,
 	}
 	return CUEIFY_ERR_INTERNAL;
     }
+    d->transferred += sizeof(mcn.mcn);
 
     *size = min(kCDMCNMaxLength + 1, *size);
     memcpy(buffer, mcn.mcn, *size - 1);
@@ -247,6 +266,7 @@ int cueify_device_read_isrc_unportable(cueify_device_private *d, uint8_t track,
 	}
 	return CUEIFY_ERR_INTERNAL;
     }
+    d->transferred += sizeof(isrc.isrc);
 
     *size = min(kCDISRCMaxLength + 1, *size);
     memcpy(buffer, isrc.isrc, *size - 1);
@@ -282,7 +302,7 @@ int cueify_device_read_position_unportable(cueify_device_private *d,
 	 * We can actually get the position from reading the Q subchannel
 	 * during our raw read, rather than doing a subchannel ioctl!
 	 */
-	if (cueify_device_read_raw_unportable(d, lba, &buffer) != CUEIFY_OK) {
+	if (cueify_sector_cache_read(d, lba, 1, &buffer) != CUEIFY_OK) {
 	    return CUEIFY_ERR_INTERNAL;
 	}
 	lba--;
@@ -298,7 +318,7 @@ int cueify_device_read_position_unportable(cueify_device_private *d,
 
     /* Adjust the absolute time by 2 seconds for the lead-in. */
     if (pos->abs.sec < 2) {
-	pos->abs.sec += 75;
+	pos->abs.sec += 60;
 	pos->abs.min--;
     }
     pos->abs.sec -= 2;
@@ -331,6 +351,7 @@ int cueify_device_read_raw_unportable(cueify_device_private *d, uint32_t lba,
     if (ioctl(d->handle, DKIOCCDREAD, &read) < 0) {
 	return CUEIFY_ERR_INTERNAL;
     }
+    d->transferred += read.bufferLength;
 
     return CUEIFY_OK;
 }  /* cueify_device_read_raw_unportable */
@@ -28,15 +28,80 @@
 #include <cueify/device.h>
 #include <cueify/error.h>
 #include "device_private.h"
+#include "disc_private.h"
+#include "sector_cache_private.h"
+#include "async_private.h"
+#include "mcn_isrc_private.h"
+#include "backend_private.h"
+#include "trace_private.h"
+
+const cueify_device_backend cueify_os_backend = {
+    cueify_device_close_unportable,
+    cueify_device_media_changed_unportable,
+    cueify_device_get_supported_apis_unportable,
+    cueify_device_read_toc_unportable,
+    cueify_device_read_sessions_unportable,
+    cueify_device_read_full_toc_unportable,
+    cueify_device_read_cdtext_unportable,
+    cueify_device_read_mcn_unportable,
+    cueify_device_read_isrc_unportable,
+    cueify_device_read_position_unportable,
+    cueify_device_read_raw_sectors_unportable,
+#ifdef DEVICE_SUPPORTS_ASYNC
+    cueify_device_issue_unportable,
+    cueify_device_reap_unportable,
+    cueify_device_cancel_unportable,
+    cueify_device_get_completion_fd_unportable
+#else
+    NULL,
+    NULL,
+    NULL,
+    NULL
+#endif
+};
 
 cueify_device *cueify_device_new() {
     return calloc(1, sizeof(cueify_device_private));
 }  /* cueify_device_new */
 
 
+/**
+ * Associate a device handle with a backend and open it.
+ *
+ * @param dev an unopened device handle
+ * @param path the identifier of the device or image to open
+ * @param backend the backend serving the device
+ * @param open the function which opens path for the backend
+ * @return CUEIFY_OK if the device was successfully opened; otherwise
+ *         an appropriate error code
+ */
+static int device_open(cueify_device_private *dev, const char *path,
+		       const cueify_device_backend *backend,
+		       int (*open)(cueify_device_private *, const char *)) {
+    int retval;
+
+    memset(dev, 0, sizeof(cueify_device_private));
+    dev->backend = backend;
+    dev->path = malloc(strlen(path) + 1);
+    if (dev->path == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    strcpy(dev->path, path);
+
+    retval = open(dev, path);
+    if (retval != CUEIFY_OK) {
+	free(dev->path);
+	dev->path = NULL;
+    } else {
+	/* Clear any change already pending so the next check is fresh. */
+	backend->media_changed(dev);
+    }
+    return retval;
+}  /* device_open */
+
+
 int cueify_device_open(cueify_device *d, const char *device) {
     cueify_device_private *dev = (cueify_device_private *)d;
-    int retval = CUEIFY_OK;
 
     /* Must have a defined device instance */
     if (dev == NULL) {
@@ -54,19 +119,31 @@ int cueify_device_open(cueify_device *d, const char *device) {
 	return CUEIFY_ERR_BADARG;
     }
 
-    memset(dev, 0, sizeof(cueify_device_private));
-    dev->path = malloc(strlen(device) + 1);
-    if (dev->path == NULL) {
-	return CUEIFY_ERR_NOMEM;
+    return device_open(dev, device, &cueify_os_backend,
+		       cueify_device_open_unportable);
+}  /* cueify_device_open */
+
+
+int cueify_device_open_image(cueify_device *d, const char *path) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+
+    if (dev == NULL || path == NULL || path[0] == '\0') {
+	return CUEIFY_ERR_BADARG;
     }
-    strcpy(dev->path, device);
 
-    retval = cueify_device_open_unportable(dev, device);
-    if (retval != CUEIFY_OK) {
-	free(dev->path);
+    return device_open(dev, path, &cueify_image_backend, cueify_image_open);
+}  /* cueify_device_open_image */
+
+
+int cueify_device_open_trace(cueify_device *d, const char *path) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+
+    if (dev == NULL || path == NULL || path[0] == '\0') {
+	return CUEIFY_ERR_BADARG;
     }
-    return retval;
-}  /* cueify_device_open */
+
+    return device_open(dev, path, &cueify_trace_backend, cueify_trace_open);
+}  /* cueify_device_open_trace */
 
 
 int cueify_device_close(cueify_device *d) {
@@ -75,9 +152,13 @@ int cueify_device_close(cueify_device *d) {
     if (dev == NULL) {
 	return CUEIFY_ERR_BADARG;
     }
+    cueify_async_free(dev);
+    cueify_trace_stop(dev);
     free(dev->path);
+    cueify_disc_invalidate(dev);
+    cueify_sector_cache_free(dev);
 
-    return cueify_device_close_unportable(dev);
+    return dev->backend->close(dev);
 }  /* cueify_device_close */
 
 
@@ -93,10 +174,37 @@ int cueify_device_get_supported_apis(cueify_device *d) {
 	return 0;
     }
 
-    return cueify_device_get_supported_apis_unportable(dev);
+    return dev->backend->get_supported_apis(dev);
 }  /* cueify_device_get_supported_apis */
 
 
+void cueify_device_check_media(cueify_device_private *d) {
+    if (d->backend->media_changed(d)) {
+	cueify_disc_invalidate(d);
+	cueify_sector_cache_flush(d);
+    }
+}  /* cueify_device_check_media */
+
+
 const char *cueify_device_get_default_device() {
     return cueify_device_get_default_device_unportable();
 }  /* cueify_device_get_default_device */
+
+
+#ifndef READ_RAW_SUPPORTS_MULTIPLE
+int cueify_device_read_raw_sectors_unportable(cueify_device_private *d,
+					      uint32_t lba, uint32_t count,
+					      cueify_raw_read_private *buffer) {
+    uint32_t i;
+
+    /* No batched READ CD on this OS, so read one sector at a time. */
+    for (i = 0; i < count; i++) {
+	if (cueify_device_read_raw_unportable(d, lba + i,
+					      &buffer[i]) != CUEIFY_OK) {
+	    return CUEIFY_ERR_INTERNAL;
+	}
+    }
+
+    return CUEIFY_OK;
+}  /* cueify_device_read_raw_sectors_unportable */
+#endif  /* !READ_RAW_SUPPORTS_MULTIPLE */
@@ -27,6 +27,7 @@
 #define _CUEIFY_DEVICE_PRIVATE_H
 
 #include <cueify/types.h>
+#include <cueify/device.h>
 
 /** OS-specific device handle types. */
 #ifdef _WIN32
@@ -35,10 +36,62 @@
 #define device_handle int     /* file descriptor */
 #endif
 
+#if defined(linux)
+/*
+ * Commands may be issued without waiting for them to complete (via
+ * the SCSI generic driver).
+ */
+#define DEVICE_SUPPORTS_ASYNC  1
+#endif
+
+struct cueify_disc_private;
+struct cueify_sector_cache_private;
+struct cueify_async_private;
+struct cueify_simulation_private;
+struct cueify_trace_private;
+struct cueify_device_backend;
+
 /** Internal version of the cueify_device structure. */
 typedef struct {
+    /** Operations used to reach the device (or image) behind the handle. */
+    const struct cueify_device_backend *backend;
+    /** Private state of the backend, if it is not an OS device. */
+    void *backend_data;
     device_handle handle;  /** OS-specific device handle */
     char *path;  /** OS-specific identifier used to open the handle. */
+    /**
+     * Largest number of bytes the device will transfer in a single
+     * command, or 0 if unknown.
+     */
+    size_t max_transfer;
+    /**
+     * Metadata cached from the disc in the device, or NULL if nothing
+     * has been read since the device was opened or the media changed.
+     */
+    struct cueify_disc_private *disc;
+    /** Cache of raw sectors read from the disc, or NULL if disabled. */
+    struct cueify_sector_cache_private *cache;
+    /** Queue of asynchronous requests, or NULL if none were submitted. */
+    struct cueify_async_private *async;
+    /** State of the simulated drive, or NULL if it is not simulated. */
+    struct cueify_simulation_private *simulation;
+    /** Trace the commands sent are recorded to, or NULL if not traced. */
+    struct cueify_trace_private *trace;
+    cueify_device_stats_t stats;  /** Counters for the commands issued. */
+    /**
+     * Number of bytes of data returned by the commands the backend
+     * issued since it was last cleared.  Every backend adds to it, and
+     * callers clear it before each backend call they count.
+     */
+    size_t transferred;
+#ifdef DEVICE_SUPPORTS_ASYNC
+    /** Handle used to issue asynchronous commands, or -1 if none. */
+    device_handle async_handle;
+#endif
+#ifdef _WIN32
+    /** Count of media changes the OS gave when last checked. */
+    ULONG media_change_count;
+#endif
 } cueify_device_private;
 
 #define RAW_SECTOR_SIZE  2352  /** Number of bytes in a raw CD sector. */
@@ -69,6 +122,21 @@ typedef struct {
 #endif
 } cueify_raw_read_private;
 
+#if defined(linux)
+/*
+ * Raw reads of multiple contiguous sectors are issued as a single
+ * command.  Otherwise, cueify_device_read_raw_sectors_unportable()
+ * falls back to reading one sector at a time.
+ */
+#define READ_RAW_SUPPORTS_MULTIPLE 1
+#endif
+
+/**
+ * Number of bytes assumed to be transferable in a single command if
+ * the device does not report a limit.
+ */
+#define DEFAULT_MAX_TRANSFER  65536
+
 /** Unportable version of cueify_device_open().
  *
  * @param d the cueify device handle to open
@@ -101,6 +169,48 @@ int cueify_device_read_raw_unportable(cueify_device_private *d, uint32_t lba,
 				      cueify_raw_read_private *buffer);
 
 
+/** Unportable read of contiguous raw sectors from a disc in an
+ * optical disc drive.
+ *
+ * @note This returns the same data as cueify_device_read_raw_unportable()
+ *       for each of the count sectors starting at lba.  Where
+ *       READ_RAW_SUPPORTS_MULTIPLE is defined, the sectors are read
+ *       with as few READ CD commands as the maximum transfer length of
+ *       the device allows.
+ *
+ * @param d the cueify device handle to read from
+ * @param lba the absolute address (LBA) of the first sector to read
+ * @param count the number of sectors to read
+ * @param buffer an array of at least count raw sectors to read into
+ * @return CUEIFY_OK if the read succeeded; otherwise, an appropriate error code.
+ */
+int cueify_device_read_raw_sectors_unportable(cueify_device_private *d,
+					      uint32_t lba, uint32_t count,
+					      cueify_raw_read_private *buffer);
+
+
+/** Unportable check for whether the media in a device has changed.
+ *
+ * @note Implementations which cannot detect media changes should
+ *       always return 1, so that nothing read from the disc is reused.
+ *
+ * @param d the cueify device handle to check
+ * @return 1 if the media may have changed since the last call;
+ *         otherwise 0
+ */
+int cueify_device_media_changed_unportable(cueify_device_private *d);
+
+
+/**
+ * Discard everything cached from the disc in a device if the media
+ * has changed.  Called once on entry to each public function which
+ * reads cached data, so that a single call sees a consistent disc.
+ *
+ * @param d the device handle to check
+ */
+void cueify_device_check_media(cueify_device_private *d);
+
+
 /** Unportable version of cueify_device_close().
  *
  * @param d the cueify device handle to close
@@ -0,0 +1,170 @@
+/* disc.c - Per-device snapshot of disc metadata
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <cueify/error.h>
+#include <cueify/toc.h>
+#include <cueify/sessions.h>
+#include <cueify/full_toc.h>
+#include <cueify/cdtext.h>
+#include "device_private.h"
+#include "disc_private.h"
+#include "backend_private.h"
+#include "stats_private.h"
+
+/**
+ * Get the snapshot of the disc in a device, creating it if needed.
+ *
+ * @param d an opened device handle
+ * @return the snapshot of the disc, or NULL if it could not be allocated
+ */
+static cueify_disc_private *disc_snapshot(cueify_device_private *d) {
+    if (d->disc == NULL) {
+	d->disc = calloc(1, sizeof(cueify_disc_private));
+    }
+    return d->disc;
+}  /* disc_snapshot */
+
+
+int cueify_disc_get_toc(cueify_device_private *d, cueify_toc_private **t) {
+    cueify_disc_private *disc = disc_snapshot(d);
+    uint32_t start;
+    int retval;
+
+    if (disc == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    if (!(disc->valid & DISC_HAS_TOC)) {
+	memset(&disc->toc, 0, sizeof(cueify_toc_private));
+	start = cueify_stats_start(d);
+	d->transferred = 0;
+	retval = d->backend->read_toc(d, &disc->toc);
+	cueify_stats_record(d, CUEIFY_COMMAND_READ_TOC, start,
+			    d->transferred, retval);
+	if (retval != CUEIFY_OK) {
+	    return retval;
+	}
+	disc->valid |= DISC_HAS_TOC;
+    }
+
+    *t = &disc->toc;
+    return CUEIFY_OK;
+}  /* cueify_disc_get_toc */
+
+
+int cueify_disc_get_sessions(cueify_device_private *d,
+			     cueify_sessions_private **s) {
+    cueify_disc_private *disc = disc_snapshot(d);
+    uint32_t start;
+    int retval;
+
+    if (disc == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    if (!(disc->valid & DISC_HAS_SESSIONS)) {
+	memset(&disc->sessions, 0, sizeof(cueify_sessions_private));
+	start = cueify_stats_start(d);
+	d->transferred = 0;
+	retval = d->backend->read_sessions(d, &disc->sessions);
+	cueify_stats_record(d, CUEIFY_COMMAND_READ_SESSIONS, start,
+			    d->transferred, retval);
+	if (retval != CUEIFY_OK) {
+	    return retval;
+	}
+	disc->valid |= DISC_HAS_SESSIONS;
+    }
+
+    *s = &disc->sessions;
+    return CUEIFY_OK;
+}  /* cueify_disc_get_sessions */
+
+
+int cueify_disc_get_full_toc(cueify_device_private *d,
+			     cueify_full_toc_private **t) {
+    cueify_disc_private *disc = disc_snapshot(d);
+    uint32_t start;
+    int retval;
+
+    if (disc == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    if (!(disc->valid & DISC_HAS_FULL_TOC)) {
+	memset(&disc->full_toc, 0, sizeof(cueify_full_toc_private));
+	start = cueify_stats_start(d);
+	d->transferred = 0;
+	retval = d->backend->read_full_toc(d, &disc->full_toc);
+	cueify_stats_record(d, CUEIFY_COMMAND_READ_FULL_TOC, start,
+			    d->transferred, retval);
+	if (retval != CUEIFY_OK) {
+	    return retval;
+	}
+	disc->valid |= DISC_HAS_FULL_TOC;
+    }
+
+    *t = &disc->full_toc;
+    return CUEIFY_OK;
+}  /* cueify_disc_get_full_toc */
+
+
+int cueify_disc_get_cdtext(cueify_device_private *d, int crc_mode,
+			   cueify_cdtext_private **t) {
+    cueify_disc_private *disc = disc_snapshot(d);
+    uint32_t start;
+    int retval;
+
+    if (disc == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    if (!(disc->valid & DISC_HAS_CDTEXT) ||
+	disc->cdtext.crc_mode != crc_mode) {
+	/* Bad PACKs are only seen in the response, so read it again. */
+	disc->valid &= ~DISC_HAS_CDTEXT;
+	cueify_cdtext_clear(&disc->cdtext);
+	disc->cdtext.crc_mode = crc_mode;
+	start = cueify_stats_start(d);
+	d->transferred = 0;
+	retval = d->backend->read_cdtext(d, &disc->cdtext);
+	cueify_stats_record(d, CUEIFY_COMMAND_READ_CDTEXT, start,
+			    d->transferred, retval);
+	if (retval != CUEIFY_OK) {
+	    cueify_cdtext_clear(&disc->cdtext);
+	    return retval;
+	}
+	disc->valid |= DISC_HAS_CDTEXT;
+    }
+
+    *t = &disc->cdtext;
+    return CUEIFY_OK;
+}  /* cueify_disc_get_cdtext */
+
+
+void cueify_disc_invalidate(cueify_device_private *d) {
+    if (d->disc != NULL) {
+	cueify_cdtext_clear(&d->disc->cdtext);
+	free(d->disc);
+	d->disc = NULL;
+    }
+}  /* cueify_disc_invalidate */
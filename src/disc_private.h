@@ -0,0 +1,123 @@
+/* disc_private.h - Private per-device snapshot of disc metadata
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CUEIFY_DISC_PRIVATE_H
+#define _CUEIFY_DISC_PRIVATE_H
+
+#include <cueify/types.h>
+#include "device_private.h"
+#include "toc_private.h"
+#include "sessions_private.h"
+#include "full_toc_private.h"
+#include "cdtext_private.h"
+
+/* Bits of cueify_disc_private.valid marking which tables are cached. */
+#define DISC_HAS_TOC       0x01  /** The TOC has been read. */
+#define DISC_HAS_SESSIONS  0x02  /** The session data has been read. */
+#define DISC_HAS_FULL_TOC  0x04  /** The full TOC has been read. */
+#define DISC_HAS_CDTEXT    0x08  /** The CD-Text has been read. */
+
+/**
+ * Internal structure holding the metadata read from the disc in a
+ * device.  Each table is read from the device the first time it is
+ * needed and then served from here until cueify_device_check_media()
+ * finds that the media has changed.
+ */
+typedef struct cueify_disc_private {
+    int valid;  /** Bitmask of the DISC_HAS_* tables which are cached. */
+    cueify_toc_private toc;  /** The TOC of the disc. */
+    cueify_sessions_private sessions;  /** The session data of the disc. */
+    cueify_full_toc_private full_toc;  /** The full TOC of the disc. */
+    cueify_cdtext_private cdtext;  /** The CD-Text of the disc. */
+} cueify_disc_private;
+
+
+/**
+ * Get the TOC of the disc in a device, reading it only if it is not
+ * already cached.
+ *
+ * @param d an opened device handle
+ * @param t a pointer to set to the cached TOC, which remains owned by
+ *          the device and is valid until the next call to any
+ *          cueify_disc_get_*() function or cueify_disc_invalidate()
+ * @return CUEIFY_OK if the TOC is available; otherwise an appropriate
+ *         error code is returned
+ */
+int cueify_disc_get_toc(cueify_device_private *d, cueify_toc_private **t);
+
+
+/**
+ * Get the session data of the disc in a device, reading it only if it
+ * is not already cached.
+ *
+ * @param d an opened device handle
+ * @param s a pointer to set to the cached session data, owned by the
+ *          device as in cueify_disc_get_toc()
+ * @return CUEIFY_OK if the session data is available; otherwise an
+ *         appropriate error code is returned
+ */
+int cueify_disc_get_sessions(cueify_device_private *d,
+			     cueify_sessions_private **s);
+
+
+/**
+ * Get the full TOC of the disc in a device, reading it only if it is
+ * not already cached.
+ *
+ * @param d an opened device handle
+ * @param t a pointer to set to the cached full TOC, owned by the
+ *          device as in cueify_disc_get_toc()
+ * @return CUEIFY_OK if the full TOC is available; otherwise an
+ *         appropriate error code is returned
+ */
+int cueify_disc_get_full_toc(cueify_device_private *d,
+			     cueify_full_toc_private **t);
+
+
+/**
+ * Get the CD-Text of the disc in a device, reading it only if it is
+ * not already cached with the same treatment of bad PACKs.
+ *
+ * @param d an opened device handle
+ * @param crc_mode how to treat PACKs whose CRC does not match (one of
+ *                 CUEIFY_CDTEXT_CRC_*)
+ * @param t a pointer to set to the cached CD-Text, owned by the
+ *          device as in cueify_disc_get_toc()
+ * @return CUEIFY_OK if the CD-Text is available; otherwise an
+ *         appropriate error code is returned
+ */
+int cueify_disc_get_cdtext(cueify_device_private *d, int crc_mode,
+			   cueify_cdtext_private **t);
+
+
+/**
+ * Discard everything cached about the disc in a device and release
+ * the snapshot.
+ *
+ * @param d the device handle whose snapshot should be discarded
+ */
+void cueify_disc_invalidate(cueify_device_private *d);
+
+#endif  /* _CUEIFY_DISC_PRIVATE_H */
@@ -23,38 +23,19 @@
  * SOFTWARE.
  */
 
-#include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <cueify/error.h>
 #include <cueify/device.h>
 #include <cueify/toc.h>
 #include <cueify/sessions.h>
 #include <cueify/full_toc.h>
+#include <cueify/discid.h>
 #include "sha1.h"
 #include "toc_private.h"
 #include "sessions_private.h"
 #include "full_toc_private.h"
 
-/**
- * Convert an LBA absolute address to an MSF time address.
- *
- * @param lba the LBA address to convert
- * @param msf the MSF address to populate
- */
-static inline void lba_to_msf(uint32_t lba, cueify_msf_t *msf) {
-    msf->min = lba / 75 / 60;
-    msf->sec = lba / 75 % 60;
-    msf->frm = lba % 75;
-
-    /* It really should be the MSF value. */
-    msf->sec += 2;
-    if (msf->sec > 59) {
-	msf->min++;
-	msf->sec -= 60;
-    }
-}  /* lba_to_msf */
-
-
 /**
  * Convert an MSF time address to an LBA absolute address.
  *
@@ -73,15 +54,69 @@ static inline uint32_t msf_to_lba(cueify_msf_t msf) {
 }  /* msf_to_lba */
 
 
+/** The sums of the decimal digits of 0 to 99. */
+static const uint8_t digit_sums[100] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+    1, 2, 3, 4, 5, 6, 7, 8, 9, 10,
+    2, 3, 4, 5, 6, 7, 8, 9, 10, 11,
+    3, 4, 5, 6, 7, 8, 9, 10, 11, 12,
+    4, 5, 6, 7, 8, 9, 10, 11, 12, 13,
+    5, 6, 7, 8, 9, 10, 11, 12, 13, 14,
+    6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+    7, 8, 9, 10, 11, 12, 13, 14, 15, 16,
+    8, 9, 10, 11, 12, 13, 14, 15, 16, 17,
+    9, 10, 11, 12, 13, 14, 15, 16, 17, 18
+};
+
+
+/**
+ * Calculate the sum of the decimal digits of a freedb track address
+ * (in seconds) without dividing by 10 per digit.
+ *
+ * @pre { seconds < 100000000 }
+ * @param seconds the address to sum the digits of
+ * @return the sum of the decimal digits of seconds
+ */
+static inline uint32_t freedb_digit_sum(uint32_t seconds) {
+    return digit_sums[seconds % 100] +
+	digit_sums[seconds / 100 % 100] +
+	digit_sums[seconds / 10000 % 100] +
+	digit_sums[seconds / 1000000];
+}  /* freedb_digit_sum */
+
+
+/**
+ * Convert an LBA absolute address to the whole seconds of its MSF
+ * time address (min * 60 + sec), as used by freedb.
+ *
+ * @param lba the LBA address to convert
+ * @return the MSF address of lba, in whole seconds
+ */
+static inline uint32_t freedb_seconds(uint32_t lba) {
+    return lba / 75 + 2;
+}  /* freedb_seconds */
+
+
+/**
+ * Assemble a freedb discid from its parts.
+ *
+ * @param n the sum of the digits of the track addresses
+ * @param time the length of the disc in seconds
+ * @param tracks the number of tracks on the disc
+ * @return the freedb discid
+ */
+static inline uint32_t freedb_id(uint32_t n, uint32_t time, uint8_t tracks) {
+    return (n % 0xff) << 24 | (time & 0xFFFF) << 8 | tracks;
+}  /* freedb_id */
+
+
 uint32_t cueify_toc_get_freedb_id(cueify_toc *t, cueify_sessions *s) {
     cueify_toc_private *toc = (cueify_toc_private *)t;
     cueify_sessions_private *sessions = (cueify_sessions_private *)s;
     /* NOTE: May behave different in cases where the tracks start past 1 */
     uint8_t tracks = toc->last_track_number - toc->first_track_number + 1;
-    uint8_t n = 0;
-    uint16_t time = 0;
-    int i, freedb_address;
-    cueify_msf_t address;
+    uint32_t n = 0, time;
+    int i;
     uint32_t leadout;
 
     if (sessions != NULL &&
@@ -97,20 +132,14 @@ uint32_t cueify_toc_get_freedb_id(cueify_toc *t, cueify_sessions *s) {
     }
 
     for (i = 0; i < tracks; i++) {
-	lba_to_msf(toc->tracks[toc->first_track_number + i].lba, &address);
-	freedb_address = (address.min * 60) + address.sec;
-	while (freedb_address > 0) {
-	    n += freedb_address % 10;
-	    freedb_address /= 10;
-	}
+	n += freedb_digit_sum(
+	    freedb_seconds(toc->tracks[toc->first_track_number + i].lba));
     }
 
-    lba_to_msf(leadout, &address);
-    time = (address.min * 60) + address.sec;
-    lba_to_msf(toc->tracks[toc->first_track_number].lba, &address);
-    time -= (address.min * 60) + address.sec;
+    time = freedb_seconds(leadout) -
+	freedb_seconds(toc->tracks[toc->first_track_number].lba);
 
-    return ((n % 0xff) << 24 | time << 8 | tracks);
+    return freedb_id(n, time, tracks);
 }  /* cueify_toc_get_freedb_id */
 
 
@@ -119,9 +148,8 @@ uint32_t cueify_full_toc_get_freedb_id(cueify_full_toc *t,
     cueify_full_toc_private *toc = (cueify_full_toc_private *)t;
     /* NOTE: May behave different in cases where the tracks start past 1 */
     uint8_t tracks = toc->last_track_number - toc->first_track_number + 1;
-    uint8_t n = 0;
-    uint16_t time = 0;
-    int i, freedb_address;
+    uint32_t n = 0, time;
+    int i;
     cueify_msf_t leadout;
 
     if (use_data_tracks == 0 &&
@@ -135,23 +163,59 @@ uint32_t cueify_full_toc_get_freedb_id(cueify_full_toc *t,
     }
 
     for (i = 0; i < tracks; i++) {
-	freedb_address =
+	n += freedb_digit_sum(
 	    (toc->tracks[toc->first_track_number + i].offset.min * 60) +
-	    toc->tracks[toc->first_track_number + i].offset.sec;
-	while (freedb_address > 0) {
-	    n += freedb_address % 10;
-	    freedb_address /= 10;
-	}
+	    toc->tracks[toc->first_track_number + i].offset.sec);
     }
 
     time = (leadout.min * 60) + leadout.sec;
     time -= (toc->tracks[toc->first_track_number].offset.min * 60) +
 	toc->tracks[toc->first_track_number].offset.sec;
 
-    return ((n % 0xff) << 24 | time << 8 | tracks);
+    return freedb_id(n, time, tracks);
 }  /* cueify_full_toc_get_freedb_id */
 
 
+int cueify_get_freedb_id_batch(size_t count, const uint8_t *track_counts,
+			       const uint32_t *track_lbas,
+			       const uint32_t *leadout_lbas, uint32_t *ids) {
+    const uint32_t *lbas = track_lbas;
+    size_t i;
+    uint8_t j, tracks;
+    uint32_t n;
+
+    if (count == 0) {
+	return CUEIFY_OK;
+    }
+    if (track_counts == NULL || track_lbas == NULL ||
+	leadout_lbas == NULL || ids == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+    for (i = 0; i < count; i++) {
+	if (track_counts[i] == 0) {
+	    return CUEIFY_ERR_BADARG;
+	}
+    }
+
+    /*
+     * The inner loop has no branches: the digit sums are table
+     * lookups, and the divisions by constants become multiplications.
+     */
+    for (i = 0; i < count; i++) {
+	tracks = track_counts[i];
+	n = 0;
+	for (j = 0; j < tracks; j++) {
+	    n += freedb_digit_sum(freedb_seconds(lbas[j]));
+	}
+	ids[i] = freedb_id(n, freedb_seconds(leadout_lbas[i]) -
+			   freedb_seconds(lbas[0]), tracks);
+	lbas += tracks;
+    }
+
+    return CUEIFY_OK;
+}  /* cueify_get_freedb_id_batch */
+
+
 uint32_t cueify_device_get_freedb_id(cueify_device *d, int use_data_tracks) {
     uint32_t discid = 0;
     int supported_apis = cueify_device_get_supported_apis(d);
@@ -195,8 +259,8 @@ uint32_t cueify_device_get_freedb_id(cueify_device *d, int use_data_tracks) {
 
 /* TODO: write tests for CD-XA, Enhanced CD, Audio CD, and also for SWIG, and a discid example */
 /**
- * Encode a binary buffer using Base64 encoding.  The returned value
- * must be freed.
+ * Encode a binary buffer using Base64 encoding into a caller-provided
+ * buffer.
  *
  * @param buffer the buffer to encode
  * @param len the number of bytes to encode
@@ -204,10 +268,13 @@ uint32_t cueify_device_get_freedb_id(cueify_device *d, int use_data_tracks) {
  *              values 62, 63, and for padding respectively (if NULL,
  *              the values '+', '/', and '=' from standard Base64 will
  *              be used)
- * @return the Base64 encoded representation of the first len bytes of buffer.
+ * @param base64 a buffer of at least ((len + 2) / 3 * 4 + 1) bytes to
+ *               write the (null-terminated) Base64 encoded
+ *               representation of the first len bytes of buffer to
  */
-char *base64_encode(uint8_t *buffer, size_t len, char *extra) {
-    char *base64 = NULL, *bp;
+static void base64_encode_into(const uint8_t *buffer, size_t len,
+			       const char *extra, char *base64) {
+    char *bp;
     size_t i = 0;
     uint8_t residual = 0;
     char b64chars[66] =
@@ -220,12 +287,6 @@ char *base64_encode(uint8_t *buffer, size_t len, char *extra) {
 	b64chars[64] = extra[2];
     }
 
-    /* 4 Base64 bytes for every group of 3 bytes */
-    base64 = malloc(len / 3 * 4 + ((len % 3 > 0) ? 4 : 0) + 1);
-    if (base64 == NULL) {
-	return base64;
-    }
-
     /* Iterate through buffer. */
     bp = base64;
     for (i = 0; i < len; i++) {
@@ -265,20 +326,262 @@ char *base64_encode(uint8_t *buffer, size_t len, char *extra) {
 	}
     }
     *bp = '\0';
+}  /* base64_encode_into */
+
+
+/**
+ * Encode a binary buffer using Base64 encoding.  The returned value
+ * must be freed.
+ *
+ * @param buffer the buffer to encode
+ * @param len the number of bytes to encode
+ * @param extra an array of at least 3 bytes, to be used to encode
+ *              values 62, 63, and for padding respectively (if NULL,
+ *              the values '+', '/', and '=' from standard Base64 will
+ *              be used)
+ * @return the Base64 encoded representation of the first len bytes of buffer.
+ */
+char *base64_encode(uint8_t *buffer, size_t len, char *extra) {
+    char *base64 = NULL;
+
+    /* 4 Base64 bytes for every group of 3 bytes */
+    base64 = malloc(len / 3 * 4 + ((len % 3 > 0) ? 4 : 0) + 1);
+    if (base64 == NULL) {
+	return base64;
+    }
+
+    base64_encode_into(buffer, len, extra, base64);
 
     return base64;
 }  /* base64_encode */
 
 
-char *cueify_toc_get_musicbrainz_id(cueify_toc *t, cueify_sessions *s) {
-    cueify_toc_private *toc = (cueify_toc_private *)t;
-    cueify_sessions_private *sessions = (cueify_sessions_private *)s;
-    char temp[9];
+/** Upper-case hexadecimal digits of every byte, in pairs. */
+static const char hex_pairs[513] =
+    "000102030405060708090A0B0C0D0E0F"
+    "101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F"
+    "303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F"
+    "505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F"
+    "707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F"
+    "909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAF"
+    "B0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECF"
+    "D0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEF"
+    "F0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+
+/** Number of bytes of hexadecimal TOC hashed for a MusicBrainz discid. */
+#define MUSICBRAINZ_PREIMAGE_SIZE  (2 + 2 + MAX_TRACKS * 8)
+
+/** Number of SHA-1 blocks the padded preimage of a MusicBrainz discid fills. */
+#define MUSICBRAINZ_PREIMAGE_BLOCKS  ((MUSICBRAINZ_PREIMAGE_SIZE + 9 + 63) / 64)
+
+
+/**
+ * Write the upper-case hexadecimal representation of a byte.
+ *
+ * @param value the byte to write
+ * @param hex a pointer to at least 2 bytes to write the digits to
+ * @return a pointer past the digits written
+ */
+static inline uint8_t *hex_byte(uint8_t value, uint8_t *hex) {
+    memcpy(hex, hex_pairs + value * 2, 2);
+    return hex + 2;
+}  /* hex_byte */
+
+
+/**
+ * Write the upper-case hexadecimal representation of a 32-bit word.
+ *
+ * @param value the word to write
+ * @param hex a pointer to at least 8 bytes to write the digits to
+ * @return a pointer past the digits written
+ */
+static inline uint8_t *hex_word(uint32_t value, uint8_t *hex) {
+    hex = hex_byte((value >> 24) & 0xFF, hex);
+    hex = hex_byte((value >> 16) & 0xFF, hex);
+    hex = hex_byte((value >> 8) & 0xFF, hex);
+    return hex_byte(value & 0xFF, hex);
+}  /* hex_word */
+
+
+/** Number of bytes in the padded preimage of a MusicBrainz discid. */
+#define MUSICBRAINZ_PREIMAGE_BYTES  (MUSICBRAINZ_PREIMAGE_BLOCKS * 64)
+
+
+/**
+ * Build the padded preimage of a MusicBrainz discid.
+ *
+ * The fixed-size hexadecimal preimage is built (and padded) in place,
+ * to be hashed a whole SHA-1 block at a time.
+ *
+ * @param first_track the number of the first track
+ * @param last_track the number of the last (audio) track
+ * @param offsets the offset of the lead-out, then of every track
+ *                (0 for any before first_track or after last_track),
+ *                as LBA + 150
+ * @param preimage a buffer of MUSICBRAINZ_PREIMAGE_BYTES bytes to
+ *                 write the preimage to
+ */
+static void musicbrainz_preimage(uint8_t first_track, uint8_t last_track,
+				 const uint32_t offsets[MAX_TRACKS],
+				 uint8_t *preimage) {
+    uint8_t *hex = preimage;
+    uint64_t bits = MUSICBRAINZ_PREIMAGE_SIZE * 8;
+    int i;
+
+    hex = hex_byte(first_track, hex);
+    hex = hex_byte(last_track, hex);
+    for (i = 0; i < MAX_TRACKS; i++) {
+	hex = hex_word(offsets[i], hex);
+    }
+
+    /* Pad to whole blocks, ending in the (big-endian) length in bits. */
+    memset(hex, 0, MUSICBRAINZ_PREIMAGE_BYTES - MUSICBRAINZ_PREIMAGE_SIZE);
+    *hex = 0x80;
+    for (i = 0; i < 8; i++) {
+	preimage[MUSICBRAINZ_PREIMAGE_BYTES - 1 - i] = (bits >> (i * 8)) & 0xFF;
+    }
+}  /* musicbrainz_preimage */
+
+
+/**
+ * Encode the SHA-1 state after hashing a preimage as a MusicBrainz discid.
+ *
+ * @param state the SHA-1 state, with word i at state[i * stride]
+ * @param stride the distance between the words of the state
+ * @param id a buffer of at least CUEIFY_MUSICBRAINZ_ID_SIZE bytes to
+ *           write the discid to
+ */
+static void musicbrainz_encode(const uint32_t *state, size_t stride,
+			       char *id) {
+    uint8_t digest[SHA1_DIGEST_SIZE];
+    int i;
+
+    for (i = 0; i < SHA1_DIGEST_SIZE; i++) {
+	digest[i] = (state[(i >> 2) * stride] >> ((3 - (i & 3)) * 8)) & 0xFF;
+    }
+
+    base64_encode_into(digest, SHA1_DIGEST_SIZE, "._-", id);
+}  /* musicbrainz_encode */
+
+
+/**
+ * Calculate a MusicBrainz discid from its preimage.
+ *
+ * @param preimage the padded preimage of the discid
+ * @param id a buffer of at least CUEIFY_MUSICBRAINZ_ID_SIZE bytes to
+ *           write the discid to
+ */
+static void musicbrainz_id(const uint8_t *preimage, char *id) {
     SHA1_CTX sha;
+    int i;
+
+    cueify_sha1_init(&sha);
+    for (i = 0; i < MUSICBRAINZ_PREIMAGE_BLOCKS; i++) {
+	cueify_sha1_transform(sha.state, preimage + i * 64);
+    }
+
+    musicbrainz_encode(sha.state, 1, id);
+}  /* musicbrainz_id */
+
+
+/**
+ * Calculate the MusicBrainz discids of several preimages at once, one
+ * to each lane of a multi-message SHA-1 transform.
+ *
+ * @param transform the SHA-1 transform to hash the preimages with
+ * @param preimages the transform->lanes padded preimages of the discids
+ * @param ids a buffer of transform->lanes * CUEIFY_MUSICBRAINZ_ID_SIZE
+ *            bytes to write the discids to
+ */
+static void musicbrainz_ids(const SHA1_LANES_TRANSFORM *transform,
+			    uint8_t preimages[][MUSICBRAINZ_PREIMAGE_BYTES],
+			    char *ids) {
+    uint32_t state[5 * SHA1_MAX_LANES];
+    const uint8_t *blocks[SHA1_MAX_LANES];
+    size_t lanes = transform->lanes;
+    SHA1_CTX sha;
+    size_t i, j;
+
+    cueify_sha1_init(&sha);
+    for (i = 0; i < 5; i++) {
+	for (j = 0; j < lanes; j++) {
+	    state[i * lanes + j] = sha.state[i];
+	}
+    }
+
+    for (i = 0; i < MUSICBRAINZ_PREIMAGE_BLOCKS; i++) {
+	for (j = 0; j < lanes; j++) {
+	    blocks[j] = preimages[j] + i * 64;
+	}
+	transform->transform(state, blocks);
+    }
+
+    for (j = 0; j < lanes; j++) {
+	musicbrainz_encode(state + j, lanes,
+			   ids + j * CUEIFY_MUSICBRAINZ_ID_SIZE);
+    }
+}  /* musicbrainz_ids */
+
+
+/**
+ * Choose the multi-message SHA-1 transform to hash the next discids of
+ * a batch with: the fastest whose lanes they would all fill.
+ *
+ * @param transforms the transforms this processor supports, fastest
+ *                   first, one of which has a single lane
+ * @param count the number of discids left in the batch (at least 1)
+ * @return the transform to hash the next discids with
+ */
+static const SHA1_LANES_TRANSFORM *musicbrainz_transform(
+    const SHA1_LANES_TRANSFORM *transforms, size_t count) {
+    while (transforms->lanes > count && transforms->lanes > 1) {
+	transforms++;
+    }
+
+    return transforms;
+}  /* musicbrainz_transform */
+
+
+char *cueify_toc_get_musicbrainz_id(cueify_toc *t, cueify_sessions *s) {
+    char *discid = malloc(CUEIFY_MUSICBRAINZ_ID_SIZE);
+
+    if (discid == NULL) {
+	return NULL;
+    }
+    if (cueify_toc_get_musicbrainz_id_into(t, s, discid,
+					   CUEIFY_MUSICBRAINZ_ID_SIZE) !=
+	CUEIFY_OK) {
+	free(discid);
+	return NULL;
+    }
+
+    return discid;
+}  /* cueify_toc_get_musicbrainz_id */
+
+
+/**
+ * Build the preimage of the MusicBrainz discid of a TOC.
+ *
+ * @param toc the TOC of the disc
+ * @param sessions the multisession data of the disc, or NULL to guess
+ * @param preimage a buffer of MUSICBRAINZ_PREIMAGE_BYTES bytes to
+ *                 write the preimage to
+ */
+static void toc_musicbrainz_preimage(cueify_toc_private *toc,
+				     cueify_sessions_private *sessions,
+				     uint8_t *preimage) {
+    uint32_t offsets[MAX_TRACKS];
     uint8_t last_track;
     uint32_t leadout;
     int i;
-    uint8_t digest[SHA1_DIGEST_SIZE];
 
     if (sessions != NULL &&
 	sessions->first_session_number != sessions->last_session_number) {
@@ -302,36 +605,103 @@ char *cueify_toc_get_musicbrainz_id(cueify_toc *t, cueify_sessions *s) {
 	leadout = toc->tracks[0].lba;
     }
 
-    cueify_sha1_init(&sha);
-    sprintf(temp, "%02X", toc->first_track_number);
-    cueify_sha1_update(&sha, (uint8_t *)temp, 2);
-    sprintf(temp, "%02X", last_track);
-    cueify_sha1_update(&sha, (uint8_t *)temp, 2);
     for (i = 0; i < MAX_TRACKS; i++) {
 	if (i == 0) {
-	    sprintf(temp, "%08X", leadout + 150);
+	    offsets[i] = leadout + 150;
 	} else if (i >= toc->first_track_number &&
 		   i <= last_track) {
-	    sprintf(temp, "%08X", toc->tracks[i].lba + 150);
+	    offsets[i] = toc->tracks[i].lba + 150;
 	} else {
-	    sprintf(temp, "%08X", 0);
+	    offsets[i] = 0;
 	}
-	cueify_sha1_update(&sha, (uint8_t *)temp, 8);
     }
-    cueify_sha1_final(&sha, digest);
+    musicbrainz_preimage(toc->first_track_number, last_track, offsets,
+			 preimage);
+}  /* toc_musicbrainz_preimage */
 
-    return base64_encode(digest, SHA1_DIGEST_SIZE, "._-");
-}  /* cueify_toc_get_musicbrainz_id */
+
+int cueify_toc_get_musicbrainz_id_into(cueify_toc *t, cueify_sessions *s,
+				       char *id, size_t size) {
+    uint8_t preimage[MUSICBRAINZ_PREIMAGE_BYTES];
+
+    if (t == NULL || id == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+    if (size < CUEIFY_MUSICBRAINZ_ID_SIZE) {
+	return CUEIFY_ERR_TOOSMALL;
+    }
+
+    toc_musicbrainz_preimage((cueify_toc_private *)t,
+			     (cueify_sessions_private *)s, preimage);
+    musicbrainz_id(preimage, id);
+
+    return CUEIFY_OK;
+}  /* cueify_toc_get_musicbrainz_id_into */
+
+
+int cueify_toc_get_musicbrainz_id_batch(cueify_toc **t, cueify_sessions **s,
+					size_t count, char *ids) {
+    SHA1_LANES_TRANSFORM transforms[SHA1_MAX_LANES_TRANSFORMS];
+    const SHA1_LANES_TRANSFORM *transform;
+    uint8_t preimages[SHA1_MAX_LANES][MUSICBRAINZ_PREIMAGE_BYTES];
+    size_t i, j;
+
+    if ((t == NULL || ids == NULL) && count > 0) {
+	return CUEIFY_ERR_BADARG;
+    }
+    for (i = 0; i < count; i++) {
+	if (t[i] == NULL) {
+	    return CUEIFY_ERR_BADARG;
+	}
+    }
+
+    cueify_sha1_get_lanes_transforms(transforms);
+    for (i = 0; i < count; i += j) {
+	transform = musicbrainz_transform(transforms, count - i);
+	for (j = 0; j < transform->lanes; j++) {
+	    toc_musicbrainz_preimage(
+		(cueify_toc_private *)t[i + j],
+		(cueify_sessions_private *)(s != NULL ? s[i + j] : NULL),
+		preimages[j]);
+	}
+	musicbrainz_ids(transform, preimages,
+			ids + i * CUEIFY_MUSICBRAINZ_ID_SIZE);
+    }
+
+    return CUEIFY_OK;
+}  /* cueify_toc_get_musicbrainz_id_batch */
 
 
 char *cueify_full_toc_get_musicbrainz_id(cueify_full_toc *t) {
-    cueify_full_toc_private *toc = (cueify_full_toc_private *)t;
-    char temp[9];
-    SHA1_CTX sha;
+    char *discid = malloc(CUEIFY_MUSICBRAINZ_ID_SIZE);
+
+    if (discid == NULL) {
+	return NULL;
+    }
+    if (cueify_full_toc_get_musicbrainz_id_into(t, discid,
+						CUEIFY_MUSICBRAINZ_ID_SIZE) !=
+	CUEIFY_OK) {
+	free(discid);
+	return NULL;
+    }
+
+    return discid;
+}  /* cueify_full_toc_get_musicbrainz_id */
+
+
+/**
+ * Build the preimage of the MusicBrainz discid of a full TOC.
+ *
+ * @param toc the full TOC of the disc
+ * @param preimage a buffer of MUSICBRAINZ_PREIMAGE_BYTES bytes to
+ *                 write the preimage to
+ */
+static void full_toc_musicbrainz_preimage(cueify_full_toc_private *toc,
+					  uint8_t *preimage) {
+    uint32_t offsets[MAX_TRACKS];
     uint8_t last_track;
     uint32_t leadout;
     int i;
-    uint8_t digest[SHA1_DIGEST_SIZE];
 
     if (toc->first_session_number != toc->last_session_number) {
 	last_track =
@@ -343,26 +713,68 @@ char *cueify_full_toc_get_musicbrainz_id(cueify_full_toc *t) {
 	leadout = msf_to_lba(toc->sessions[toc->last_session_number].leadout);
     }
 
-    cueify_sha1_init(&sha);
-    sprintf(temp, "%02X", toc->first_track_number);
-    cueify_sha1_update(&sha, (uint8_t *)temp, 2);
-    sprintf(temp, "%02X", last_track);
-    cueify_sha1_update(&sha, (uint8_t *)temp, 2);
     for (i = 0; i < MAX_TRACKS; i++) {
 	if (i == 0) {
-	    sprintf(temp, "%08X", leadout + 150);
+	    offsets[i] = leadout + 150;
 	} else if (i >= toc->first_track_number &&
 		   i <= last_track) {
-	    sprintf(temp, "%08X", msf_to_lba(toc->tracks[i].offset) + 150);
+	    offsets[i] = msf_to_lba(toc->tracks[i].offset) + 150;
 	} else {
-	    sprintf(temp, "%08X", 0);
+	    offsets[i] = 0;
 	}
-	cueify_sha1_update(&sha, (uint8_t *)temp, 8);
     }
-    cueify_sha1_final(&sha, digest);
+    musicbrainz_preimage(toc->first_track_number, last_track, offsets,
+			 preimage);
+}  /* full_toc_musicbrainz_preimage */
 
-    return base64_encode(digest, SHA1_DIGEST_SIZE, "._-");
-}  /* cueify_full_toc_get_musicbrainz_id */
+
+int cueify_full_toc_get_musicbrainz_id_into(cueify_full_toc *t,
+					    char *id, size_t size) {
+    uint8_t preimage[MUSICBRAINZ_PREIMAGE_BYTES];
+
+    if (t == NULL || id == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+    if (size < CUEIFY_MUSICBRAINZ_ID_SIZE) {
+	return CUEIFY_ERR_TOOSMALL;
+    }
+
+    full_toc_musicbrainz_preimage((cueify_full_toc_private *)t, preimage);
+    musicbrainz_id(preimage, id);
+
+    return CUEIFY_OK;
+}  /* cueify_full_toc_get_musicbrainz_id_into */
+
+
+int cueify_full_toc_get_musicbrainz_id_batch(cueify_full_toc **t,
+					     size_t count, char *ids) {
+    SHA1_LANES_TRANSFORM transforms[SHA1_MAX_LANES_TRANSFORMS];
+    const SHA1_LANES_TRANSFORM *transform;
+    uint8_t preimages[SHA1_MAX_LANES][MUSICBRAINZ_PREIMAGE_BYTES];
+    size_t i, j;
+
+    if ((t == NULL || ids == NULL) && count > 0) {
+	return CUEIFY_ERR_BADARG;
+    }
+    for (i = 0; i < count; i++) {
+	if (t[i] == NULL) {
+	    return CUEIFY_ERR_BADARG;
+	}
+    }
+
+    cueify_sha1_get_lanes_transforms(transforms);
+    for (i = 0; i < count; i += j) {
+	transform = musicbrainz_transform(transforms, count - i);
+	for (j = 0; j < transform->lanes; j++) {
+	    full_toc_musicbrainz_preimage((cueify_full_toc_private *)t[i + j],
+					  preimages[j]);
+	}
+	musicbrainz_ids(transform, preimages,
+			ids + i * CUEIFY_MUSICBRAINZ_ID_SIZE);
+    }
+
+    return CUEIFY_OK;
+}  /* cueify_full_toc_get_musicbrainz_id_batch */
 
 
 char *cueify_device_get_musicbrainz_id(cueify_device *d) {
@@ -45,6 +45,7 @@
 #include "full_toc_private.h"
 #include "cdtext_private.h"
 #include "indices_private.h"
+#include "sector_cache_private.h"
 
 #define READ_TOC  0x43  /** MMC op code for READ TOC/PMA/ATIP */
 #define READ_CD   0xBE  /** MMC op code for READ CD */
@@ -100,6 +101,17 @@ int cueify_device_close_unportable(cueify_device_private *d) {
 }  /* cueify_device_close_unportable */
 
 
+int cueify_device_media_changed_unportable(cueify_device_private *d) {
+    /* Suppress error about d. */
+    d++;
+    /*
+     * cd(4) has no media change notification or count, so assume it
+     * changed (and re-read everything).
+     */
+    return 1;
+}  /* cueify_device_media_changed_unportable */
+
+
 int cueify_device_get_supported_apis_unportable(cueify_device_private *d) {
     /* Suppress error about d. */
     d++;
@@ -156,6 +168,10 @@ int cueify_device_read_toc_unportable(cueify_device_private *d,
     if (ioctl(d->handle, CDIOREADTOCENTRYS, &toc) < 0) {
 	return CUEIFY_ERR_INTERNAL;
     }
+    /* The header, and an entry for each track and the lead-out. */
+    d->transferred += sizeof(hdr) +
+	min((hdr.ending_track - hdr.starting_track + 2) *
+	    sizeof(struct cd_toc_entry), sizeof(entries));
 
     for (i = 0; i < MAX_TRACKS; i++) {
 	if (toc.data[i].track == 0xAA) {
@@ -240,6 +256,7 @@ int cueify_device_read_sessions_unportable(cueify_device_private *d,
 	cam_close_device(camdev);
 	return CUEIFY_ERR_INTERNAL;
     }
+    d->transferred += csio->dxfer_len - csio->resid;
 
     /* We serialize to the format of the TOC response for a reason... */
     if (cueify_sessions_deserialize((cueify_sessions *)s,
@@ -314,6 +331,7 @@ int cueify_device_read_full_toc_unportable(cueify_device_private *d,
 	cam_close_device(camdev);
 	return CUEIFY_ERR_INTERNAL;
     }
+    d->transferred += csio->dxfer_len - csio->resid;
 
     /* We serialize to the format of the TOC response for a reason... */
     if (cueify_full_toc_deserialize((cueify_full_toc *)t,
@@ -389,6 +407,7 @@ int cueify_device_read_cdtext_unportable(cueify_device_private *d,
 	cam_close_device(camdev);
 	return CUEIFY_ERR_INTERNAL;
     }
+    d->transferred += csio->dxfer_len - csio->resid;
 
     /* We serialize to the format of the TOC response for a reason... */
     if (cueify_cdtext_deserialize((cueify_cdtext *)t,
@@ -420,7 +439,9 @@ int cueify_device_read_mcn_unportable(cueify_device_private *d,
 
     if (ioctl(d->handle, CDIOCREADSUBCHANNEL, &subchannel) < 0) {
 	return CUEIFY_ERR_INTERNAL;
-    } else if (!info.what.media_catalog.mc_valid) {
+    }
+    d->transferred += subchannel.data_len;
+    if (!info.what.media_catalog.mc_valid) {
 	if (*size > 0) {
 	    *size = 1;
 	    buffer[0] = '\0';
@@ -453,7 +474,9 @@ int cueify_device_read_isrc_unportable(cueify_device_private *d, uint8_t track,
 
     if (ioctl(d->handle, CDIOCREADSUBCHANNEL, &subchannel) < 0) {
 	return CUEIFY_ERR_INTERNAL;
-    } else if (!info.what.track_info.ti_valid) {
+    }
+    d->transferred += subchannel.data_len;
+    if (!info.what.track_info.ti_valid) {
 	if (*size > 0) {
 	    *size = 1;
 	    buffer[0] = '\0';
@@ -493,7 +516,7 @@ int cueify_device_read_position_unportable(cueify_device_private *d,
 	 * We can actually get the position from reading the Q subchannel
 	 * during our raw read, rather than doing a subchannel ioctl!
 	 */
-	if (cueify_device_read_raw_unportable(d, lba, &buffer) != CUEIFY_OK) {
+	if (cueify_sector_cache_read(d, lba, 1, &buffer) != CUEIFY_OK) {
 	    return CUEIFY_ERR_INTERNAL;
 	}
 	lba--;
@@ -509,7 +532,7 @@ int cueify_device_read_position_unportable(cueify_device_private *d,
 
     /* Adjust the absolute time by 2 seconds for the lead-in. */
     if (pos->abs.sec < 2) {
-	pos->abs.sec += 75;
+	pos->abs.sec += 60;
 	pos->abs.min--;
     }
     pos->abs.sec -= 2;
@@ -588,6 +611,7 @@ int cueify_device_read_raw_unportable(cueify_device_private *d, uint32_t lba,
 	cam_close_device(camdev);
 	return CUEIFY_ERR_INTERNAL;
     }
+    d->transferred += csio->dxfer_len - csio->resid;
 
     cam_freeccb(ccb);
     cam_close_device(camdev);
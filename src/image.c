@@ -0,0 +1,1352 @@
+/* image.c - Device backend serving a disc image
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+#include <cueify/device.h>
+#include <cueify/cdtext.h>
+#include <cueify/constants.h>
+#include <cueify/full_toc.h>
+#include <cueify/track_data.h>
+#include <cueify/error.h>
+#include "device_private.h"
+#include "backend_private.h"
+#include "sector_cache_private.h"
+#include "cdtext_crc.h"
+
+/** Number of frames before LBA 0 (the pregap of the first track). */
+#define LEADIN_FRAMES  150
+/** Number of bytes of subchannel data per sector in a .sub file. */
+#define SUBCHANNEL_SIZE  96
+/** Offset of the Q subchannel in the subchannel data of a sector. */
+#define SUBCHANNEL_Q  12
+/** Number of bytes in a sector header (sync pattern, address, mode). */
+#define HEADER_SIZE  16
+/** Marker for an index which is not present in a track. */
+#define NO_INDEX  0xFFFFFFFF
+/** Maximum number of indices in a track. */
+#define MAX_INDICES  100
+/** Number of bytes a drive returns for a READ SUB-CHANNEL MCN or ISRC. */
+#define SUBCHANNEL_CODE_RESPONSE_SIZE  24
+
+/** Return the binary representation of a binary-coded decimal. */
+#define BCD2BIN(x)  ((((x) >> 4) & 0xF) * 10 + ((x) & 0xF))
+/** Return the binary-coded decimal representation of a binary number. */
+#define BIN2BCD(x)  ((((x) / 10) << 4) | ((x) % 10))
+
+/** A file mapped into memory. */
+typedef struct {
+    uint8_t *data;  /** Contents of the file. */
+    size_t size;  /** Size of the file. */
+} image_map_t;
+
+
+/** A run of consecutive sectors stored the same way in an image. */
+typedef struct {
+    uint32_t lba;  /** Address of the first sector of the run. */
+    uint32_t count;  /** Number of sectors in the run. */
+    int file;  /** File holding the run, or -1 for generated silence. */
+    size_t offset;  /** Offset of the first sector in the file. */
+    uint16_t sector_size;  /** Number of bytes per sector in the file. */
+    uint8_t mode;  /** Data mode of the sectors (0 for audio). */
+} image_extent_t;
+
+
+/** A track described by an image. */
+typedef struct {
+    int file;  /** File holding the track. */
+    uint8_t control;  /** Track control flags. */
+    uint8_t mode;  /** Data mode of the track (0 for audio). */
+    uint16_t sector_size;  /** Number of bytes per sector in the file. */
+    uint32_t pregap;  /** Frames of silence to insert before the track. */
+    uint32_t postgap;  /** Frames of silence to insert after the track. */
+    /** Offset of each index in the file (frames), or NO_INDEX. */
+    uint32_t index_frame[MAX_INDICES];
+    /** Address of each index on the disc (LBA), or NO_INDEX. */
+    uint32_t index_lba[MAX_INDICES];
+    char isrc[13];  /** ISRC of the track, or empty. */
+} image_track_t;
+
+
+/** Internal structure holding an opened disc image. */
+typedef struct {
+    int num_files;  /** Number of files holding sectors. */
+    image_map_t files[MAX_TRACKS];  /** Files holding sectors. */
+    int num_extents;  /** Number of runs of sectors on the disc. */
+    /** Runs of sectors on the disc (a pregap, body and postgap per track). */
+    image_extent_t extents[3 * MAX_TRACKS];
+    uint8_t first_track_number;  /** Number of the first track. */
+    uint8_t last_track_number;  /** Number of the last track. */
+    image_track_t tracks[MAX_TRACKS];  /** Tracks of the disc. */
+    uint32_t leadout;  /** Address of the lead-out (LBA). */
+    char mcn[14];  /** Media Catalog Number of the disc, or empty. */
+    int has_cdtext;  /** 1 if the image has CD-Text. */
+    int cdtext_file;  /** 1 if the CD-Text was read from a CDTEXTFILE. */
+    cueify_cdtext_private cdtext;  /** CD-Text of the image. */
+    /**
+     * CD-Text read from a CDTEXTFILE, as a READ TOC/PMA/ATIP response,
+     * so that bad PACKs are treated as each reader asks; or NULL.
+     */
+    uint8_t *cdtext_response;
+    size_t cdtext_size;  /** Number of bytes in the CD-Text, serialized. */
+    image_map_t subchannel;  /** Subchannel data, if present. */
+} cueify_image_private;
+
+
+/**
+ * Map a file into memory.
+ *
+ * @param path the path of the file to map
+ * @param map the mapping to populate
+ * @return CUEIFY_OK if the file was mapped; otherwise
+ *         CUEIFY_ERR_NO_DEVICE or CUEIFY_ERR_NOMEM
+ */
+static int map_file(const char *path, image_map_t *map) {
+#ifdef _WIN32
+    FILE *fp;
+    long size;
+
+    fp = fopen(path, "rb");
+    if (fp == NULL) {
+	return CUEIFY_ERR_NO_DEVICE;
+    }
+    if (fseek(fp, 0, SEEK_END) != 0 || (size = ftell(fp)) < 0 ||
+	fseek(fp, 0, SEEK_SET) != 0) {
+	fclose(fp);
+	return CUEIFY_ERR_NO_DEVICE;
+    }
+    map->size = size;
+    map->data = malloc(size + 1);
+    if (map->data == NULL) {
+	fclose(fp);
+	return CUEIFY_ERR_NOMEM;
+    }
+    if (fread(map->data, 1, size, fp) != (size_t)size) {
+	free(map->data);
+	map->data = NULL;
+	fclose(fp);
+	return CUEIFY_ERR_NO_DEVICE;
+    }
+    fclose(fp);
+#else
+    struct stat buf;
+    int fd;
+
+    fd = open(path, O_RDONLY);
+    if (fd < 0) {
+	return CUEIFY_ERR_NO_DEVICE;
+    }
+    if (fstat(fd, &buf) < 0) {
+	close(fd);
+	return CUEIFY_ERR_NO_DEVICE;
+    }
+    map->size = buf.st_size;
+    map->data = NULL;
+    if (map->size > 0) {
+	map->data = mmap(NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+	if (map->data == MAP_FAILED) {
+	    map->data = NULL;
+	    close(fd);
+	    return CUEIFY_ERR_NOMEM;
+	}
+    }
+    close(fd);
+#endif
+
+    return CUEIFY_OK;
+}  /* map_file */
+
+
+/**
+ * Unmap a file mapped with map_file().
+ *
+ * @param map the mapping to release
+ */
+static void unmap_file(image_map_t *map) {
+    if (map->data != NULL) {
+#ifdef _WIN32
+	free(map->data);
+#else
+	munmap(map->data, map->size);
+#endif
+    }
+    map->data = NULL;
+    map->size = 0;
+}  /* unmap_file */
+
+
+/**
+ * Compare two words, ignoring case.
+ *
+ * @param a the first word
+ * @param b the second word, in upper case
+ * @return 1 if the words are equal; otherwise 0
+ */
+static int word_equal(const char *a, const char *b) {
+    while (*a != '\0' && toupper((unsigned char)*a) == *b) {
+	a++;
+	b++;
+    }
+    return *a == '\0' && *b == '\0';
+}  /* word_equal */
+
+
+/**
+ * Split the next (possibly quoted) token off a line of a cue sheet.
+ *
+ * @param line a pointer to the rest of the line, advanced past the token
+ * @return the token, or NULL if the line has no more tokens
+ */
+static char *cue_token(char **line) {
+    char *p = *line, *token;
+
+    while (*p == ' ' || *p == '\t') {
+	p++;
+    }
+    if (*p == '\0') {
+	return NULL;
+    }
+
+    if (*p == '"') {
+	token = ++p;
+	while (*p != '\0' && *p != '"') {
+	    p++;
+	}
+    } else {
+	token = p;
+	while (*p != '\0' && *p != ' ' && *p != '\t') {
+	    p++;
+	}
+    }
+    if (*p != '\0') {
+	*p++ = '\0';
+    }
+    *line = p;
+    return token;
+}  /* cue_token */
+
+
+/**
+ * Parse an mm:ss:ff time in a cue sheet.
+ *
+ * @param token the time to parse
+ * @param frames a pointer to set to the time in frames
+ * @return 1 if the time was parsed; otherwise 0
+ */
+static int cue_time(const char *token, uint32_t *frames) {
+    unsigned int min, sec, frm;
+    char extra;
+
+    if (token == NULL ||
+	sscanf(token, "%u:%u:%u%c", &min, &sec, &frm, &extra) != 3 ||
+	sec >= 60 || frm >= 75) {
+	return 0;
+    }
+    *frames = (min * 60 + sec) * 75 + frm;
+    return 1;
+}  /* cue_time */
+
+
+/**
+ * Build the path of a file named in a cue sheet.
+ *
+ * @param cue_path the path of the cue sheet
+ * @param name the name of the file, relative to the cue sheet
+ * @return the path of the file, which must be freed, or NULL
+ */
+static char *cue_path_of(const char *cue_path, const char *name) {
+    const char *slash = NULL, *p;
+    size_t dir_length = 0;
+    char *path;
+
+    for (p = cue_path; *p != '\0'; p++) {
+	if (*p == '/' || *p == '\\') {
+	    slash = p;
+	}
+    }
+    if (slash != NULL && name[0] != '/') {
+	dir_length = slash - cue_path + 1;
+    }
+
+    path = malloc(dir_length + strlen(name) + 1);
+    if (path != NULL) {
+	memcpy(path, cue_path, dir_length);
+	strcpy(path + dir_length, name);
+    }
+    return path;
+}  /* cue_path_of */
+
+
+/**
+ * Set the data mode, sector size and control flags of a track from
+ * the type named in a cue sheet.
+ *
+ * @param track the track to set up
+ * @param type the type of the track (e.g. AUDIO or MODE1/2352)
+ * @return 1 if the type is supported; otherwise 0
+ */
+static int cue_track_type(image_track_t *track, const char *type) {
+    if (word_equal(type, "AUDIO")) {
+	track->mode = CUEIFY_DATA_MODE_CDDA;
+	track->sector_size = RAW_SECTOR_SIZE;
+	return 1;
+    }
+
+    track->control = CUEIFY_TOC_TRACK_IS_DATA;
+    if (word_equal(type, "MODE1/2352")) {
+	track->mode = CUEIFY_DATA_MODE_MODE_1;
+	track->sector_size = RAW_SECTOR_SIZE;
+    } else if (word_equal(type, "MODE1/2048")) {
+	track->mode = CUEIFY_DATA_MODE_MODE_1;
+	track->sector_size = 2048;
+    } else if (word_equal(type, "MODE2/2352")) {
+	track->mode = CUEIFY_DATA_MODE_MODE_2;
+	track->sector_size = RAW_SECTOR_SIZE;
+    } else if (word_equal(type, "MODE2/2336")) {
+	track->mode = CUEIFY_DATA_MODE_MODE_2;
+	track->sector_size = 2336;
+    } else {
+	return 0;
+    }
+    return 1;
+}  /* cue_track_type */
+
+
+/**
+ * Store a CD-Text string from a cue sheet in the first CD-Text block.
+ *
+ * @param img the image being parsed
+ * @param keyword the cue sheet command naming the string
+ * @param track the track the string applies to, or 0 for the album
+ * @param value the string
+ * @return CUEIFY_OK if the string was stored (or is not CD-Text);
+ *         otherwise CUEIFY_ERR_NOMEM
+ */
+static int cue_cdtext(cueify_image_private *img, const char *keyword,
+		      uint8_t track, const char *value) {
+    cueify_cdtext_block_private *block = &img->cdtext.blocks[0];
+    char **field;
+
+    if (word_equal(keyword, "TITLE")) {
+	field = &block->titles[track];
+    } else if (word_equal(keyword, "PERFORMER")) {
+	field = &block->performers[track];
+    } else if (word_equal(keyword, "SONGWRITER")) {
+	field = &block->songwriters[track];
+    } else if (word_equal(keyword, "COMPOSER")) {
+	field = &block->composers[track];
+    } else if (word_equal(keyword, "ARRANGER")) {
+	field = &block->arrangers[track];
+    } else if (word_equal(keyword, "MESSAGE")) {
+	field = &block->messages[track];
+    } else {
+	return CUEIFY_OK;
+    }
+
+    /* Any string replaced stays in the arena until it is cleared. */
+    *field = cueify_cdtext_strdup(&img->cdtext, value);
+    if (*field == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    img->has_cdtext = 1;
+    return CUEIFY_OK;
+}  /* cue_cdtext */
+
+
+/**
+ * Load a CD-Text file (the raw packs, optionally preceded by the
+ * header of a READ TOC/PMA/ATIP response) named in a cue sheet.
+ *
+ * @param img the image being parsed
+ * @param path the path of the CD-Text file
+ * @return CUEIFY_OK if the CD-Text was loaded; otherwise an
+ *         appropriate error code
+ */
+static int load_cdtext(cueify_image_private *img, const char *path) {
+    image_map_t map;
+    const uint8_t *packs;
+    uint8_t *buffer;
+    size_t length;
+    int retval;
+
+    retval = map_file(path, &map);
+    if (retval != CUEIFY_OK) {
+	return retval;
+    }
+
+    if (map.size % 18 == 0) {
+	packs = map.data;
+	length = map.size;
+    } else if (map.size >= 4 && (map.size - 4) % 18 == 0) {
+	packs = map.data + 4;
+	length = map.size - 4;
+    } else if (map.size >= 5 && (map.size - 5) % 18 == 0) {
+	/* Some tools add a trailing NUL. */
+	packs = map.data + 4;
+	length = map.size - 5;
+    } else {
+	unmap_file(&map);
+	return CUEIFY_ERR_CORRUPTED;
+    }
+
+    buffer = malloc(length + 4);
+    if (buffer == NULL) {
+	unmap_file(&map);
+	return CUEIFY_ERR_NOMEM;
+    }
+    buffer[0] = ((length + 2) >> 8) & 0xFF;
+    buffer[1] = (length + 2) & 0xFF;
+    buffer[2] = buffer[3] = 0;
+    memcpy(buffer + 4, packs, length);
+    unmap_file(&map);
+
+    cueify_cdtext_clear(&img->cdtext);
+    retval = cueify_cdtext_deserialize((cueify_cdtext *)&img->cdtext,
+				       buffer, length + 4);
+    if (retval != CUEIFY_OK) {
+	free(buffer);
+	return retval;
+    }
+    free(img->cdtext_response);
+    img->cdtext_response = buffer;
+    img->cdtext_size = length + 4;
+    img->has_cdtext = 1;
+    img->cdtext_file = 1;
+    return CUEIFY_OK;
+}  /* load_cdtext */
+
+
+/**
+ * Parse a cue sheet, filling in the files and tracks of an image.
+ *
+ * @param img the image to populate
+ * @param cue_path the path of the cue sheet
+ * @param text the contents of the cue sheet, which are modified
+ * @return CUEIFY_OK if the cue sheet was parsed; otherwise an
+ *         appropriate error code
+ */
+static int parse_cue(cueify_image_private *img, const char *cue_path,
+		     char *text) {
+    char *line, *next, *keyword, *arg, *arg2, *path;
+    image_track_t *track = NULL;
+    int file = -1, retval;
+    unsigned int number;
+    uint32_t frames;
+
+    /* Skip a UTF-8 byte order mark. */
+    if (strncmp(text, "\xEF\xBB\xBF", 3) == 0) {
+	text += 3;
+    }
+
+    for (line = text; line != NULL; line = next) {
+	next = strchr(line, '\n');
+	if (next != NULL) {
+	    *next++ = '\0';
+	}
+	if (strchr(line, '\r') != NULL) {
+	    *strchr(line, '\r') = '\0';
+	}
+
+	keyword = cue_token(&line);
+	if (keyword == NULL) {
+	    continue;
+	}
+	arg = cue_token(&line);
+	arg2 = cue_token(&line);
+
+	if (word_equal(keyword, "FILE")) {
+	    if (arg == NULL || arg2 == NULL || !word_equal(arg2, "BINARY") ||
+		img->num_files == MAX_TRACKS) {
+		/* Only raw (little-endian) sector data is supported. */
+		return CUEIFY_ERR_CORRUPTED;
+	    }
+	    path = cue_path_of(cue_path, arg);
+	    if (path == NULL) {
+		return CUEIFY_ERR_NOMEM;
+	    }
+	    retval = map_file(path, &img->files[img->num_files]);
+	    free(path);
+	    if (retval != CUEIFY_OK) {
+		return retval;
+	    }
+	    file = img->num_files++;
+	} else if (word_equal(keyword, "TRACK")) {
+	    if (arg == NULL || arg2 == NULL || file < 0 ||
+		sscanf(arg, "%u", &number) != 1 ||
+		number < 1 || number >= MAX_TRACKS ||
+		(img->last_track_number != 0 &&
+		 number != img->last_track_number + 1U)) {
+		return CUEIFY_ERR_CORRUPTED;
+	    }
+	    track = &img->tracks[number];
+	    memset(track->index_frame, 0xFF, sizeof(track->index_frame));
+	    memset(track->index_lba, 0xFF, sizeof(track->index_lba));
+	    track->file = file;
+	    if (!cue_track_type(track, arg2)) {
+		return CUEIFY_ERR_CORRUPTED;
+	    }
+	    if (img->first_track_number == 0) {
+		img->first_track_number = number;
+	    }
+	    img->last_track_number = number;
+	} else if (word_equal(keyword, "INDEX")) {
+	    if (track == NULL || arg == NULL ||
+		sscanf(arg, "%u", &number) != 1 || number >= MAX_INDICES ||
+		!cue_time(arg2, &frames) ||
+		track->file != file) {
+		return CUEIFY_ERR_CORRUPTED;
+	    }
+	    track->index_frame[number] = frames;
+	} else if (word_equal(keyword, "PREGAP") ||
+		   word_equal(keyword, "POSTGAP")) {
+	    if (track == NULL || !cue_time(arg, &frames)) {
+		return CUEIFY_ERR_CORRUPTED;
+	    }
+	    if (word_equal(keyword, "PREGAP")) {
+		track->pregap = frames;
+	    } else {
+		track->postgap = frames;
+	    }
+	} else if (word_equal(keyword, "FLAGS")) {
+	    if (track == NULL) {
+		return CUEIFY_ERR_CORRUPTED;
+	    }
+	    for (; arg != NULL; arg = arg2, arg2 = cue_token(&line)) {
+		if (word_equal(arg, "DCP")) {
+		    track->control |= CUEIFY_TOC_TRACK_PERMITS_COPYING;
+		} else if (word_equal(arg, "4CH")) {
+		    track->control |= CUEIFY_TOC_TRACK_IS_QUADRAPHONIC;
+		} else if (word_equal(arg, "PRE")) {
+		    track->control |= CUEIFY_TOC_TRACK_HAS_PREEMPHASIS;
+		}
+	    }
+	} else if (word_equal(keyword, "ISRC")) {
+	    if (track == NULL || arg == NULL || strlen(arg) != 12) {
+		return CUEIFY_ERR_CORRUPTED;
+	    }
+	    strcpy(track->isrc, arg);
+	} else if (word_equal(keyword, "CATALOG")) {
+	    if (arg == NULL || strlen(arg) != 13) {
+		return CUEIFY_ERR_CORRUPTED;
+	    }
+	    strcpy(img->mcn, arg);
+	} else if (word_equal(keyword, "CDTEXTFILE")) {
+	    if (arg == NULL) {
+		return CUEIFY_ERR_CORRUPTED;
+	    }
+	    path = cue_path_of(cue_path, arg);
+	    if (path == NULL) {
+		return CUEIFY_ERR_NOMEM;
+	    }
+	    retval = load_cdtext(img, path);
+	    free(path);
+	    if (retval != CUEIFY_OK) {
+		return retval;
+	    }
+	} else if (arg != NULL && !img->cdtext_file) {
+	    retval = cue_cdtext(img, keyword,
+				(track == NULL) ? CUEIFY_CDTEXT_ALBUM :
+				img->last_track_number, arg);
+	    if (retval != CUEIFY_OK) {
+		return retval;
+	    }
+	}
+    }
+
+    if (img->first_track_number == 0) {
+	return CUEIFY_ERR_CORRUPTED;
+    }
+    return CUEIFY_OK;
+}  /* parse_cue */
+
+
+/**
+ * Describe a raw image without a cue sheet as a single track.
+ *
+ * @param img the image to populate, with the image in its first file
+ * @return CUEIFY_OK if the image could be described; otherwise
+ *         CUEIFY_ERR_CORRUPTED
+ */
+static int describe_raw(cueify_image_private *img) {
+    static const uint8_t sync[12] = {
+	0x00, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0x00
+    };
+    image_track_t *track = &img->tracks[1];
+    image_map_t *map = &img->files[0];
+
+    memset(track->index_frame, 0xFF, sizeof(track->index_frame));
+    memset(track->index_lba, 0xFF, sizeof(track->index_lba));
+    track->index_frame[1] = 0;
+
+    if (map->size > 0 && map->size % RAW_SECTOR_SIZE == 0) {
+	if (memcmp(map->data, sync, sizeof(sync)) == 0) {
+	    cue_track_type(track, (map->data[15] == 2) ? "MODE2/2352" :
+			   "MODE1/2352");
+	} else {
+	    cue_track_type(track, "AUDIO");
+	}
+    } else if (map->size > 0 && map->size % 2048 == 0) {
+	cue_track_type(track, "MODE1/2048");
+    } else {
+	return CUEIFY_ERR_CORRUPTED;
+    }
+
+    img->first_track_number = img->last_track_number = 1;
+    return CUEIFY_OK;
+}  /* describe_raw */
+
+
+/**
+ * Append a run of sectors to the layout of an image.
+ *
+ * @param img the image being laid out
+ * @param lba a pointer to the address of the run, advanced past it
+ * @param count the number of sectors in the run
+ * @param file the file holding the run, or -1 for silence
+ * @param offset the offset of the run in the file
+ * @param track the track the run belongs to
+ */
+static void add_extent(cueify_image_private *img, uint32_t *lba,
+		       uint32_t count, int file, size_t offset,
+		       image_track_t *track) {
+    image_extent_t *extent = &img->extents[img->num_extents++];
+
+    extent->lba = *lba;
+    extent->count = count;
+    extent->file = file;
+    extent->offset = offset;
+    extent->sector_size = track->sector_size;
+    extent->mode = track->mode;
+    *lba += count;
+}  /* add_extent */
+
+
+/**
+ * Lay out the tracks of an image on a virtual disc, computing the
+ * address of each index and of the lead-out.
+ *
+ * @param img the image to lay out
+ * @return CUEIFY_OK if the image was laid out; otherwise
+ *         CUEIFY_ERR_CORRUPTED
+ */
+static int layout(cueify_image_private *img) {
+    image_track_t *track, *prev = NULL, *next;
+    uint32_t lba = 0, start, end, file_frame = 0;
+    size_t file_offset = 0;
+    int i, j;
+
+    for (i = img->first_track_number; i <= img->last_track_number;
+	 i++, prev = track) {
+	track = &img->tracks[i];
+	next = (i < img->last_track_number) ? &img->tracks[i + 1] : NULL;
+	if (track->index_frame[1] == NO_INDEX) {
+	    return CUEIFY_ERR_CORRUPTED;
+	}
+
+	/* A track starts at its first index, and runs to the next track. */
+	start = track->index_frame[1];
+	if (track->index_frame[0] != NO_INDEX) {
+	    start = track->index_frame[0];
+	}
+	if (prev == NULL || prev->file != track->file) {
+	    file_frame = 0;
+	    file_offset = 0;
+	    prev = track;
+	}
+	if (start < file_frame) {
+	    return CUEIFY_ERR_CORRUPTED;
+	}
+	/* Earlier tracks in the file may have had other sector sizes. */
+	file_offset += (size_t)(start - file_frame) * prev->sector_size;
+	file_frame = start;
+	if (file_offset > img->files[track->file].size) {
+	    return CUEIFY_ERR_CORRUPTED;
+	}
+
+	if (next != NULL && next->file == track->file) {
+	    end = (next->index_frame[0] != NO_INDEX) ?
+		next->index_frame[0] : next->index_frame[1];
+	} else {
+	    end = start + (img->files[track->file].size - file_offset) /
+		track->sector_size;
+	}
+	if (end <= start) {
+	    return CUEIFY_ERR_CORRUPTED;
+	}
+
+	/* The first track's pregap lies before LBA 0, outside the image. */
+	if (track->pregap > 0 && i != img->first_track_number) {
+	    if (track->index_frame[0] == NO_INDEX) {
+		track->index_lba[0] = lba;
+	    }
+	    add_extent(img, &lba, track->pregap, -1, 0, track);
+	}
+	for (j = 0; j < MAX_INDICES; j++) {
+	    if (track->index_frame[j] != NO_INDEX) {
+		if (track->index_frame[j] < start ||
+		    track->index_frame[j] >= end) {
+		    return CUEIFY_ERR_CORRUPTED;
+		}
+		track->index_lba[j] = lba + track->index_frame[j] - start;
+	    }
+	}
+	add_extent(img, &lba, end - start, track->file, file_offset, track);
+	if (track->postgap > 0) {
+	    add_extent(img, &lba, track->postgap, -1, 0, track);
+	}
+    }
+
+    img->leadout = lba;
+    return CUEIFY_OK;
+}  /* layout */
+
+
+/**
+ * Convert an LBA address to a binary-coded-decimal MSF address.
+ *
+ * @param frames the address to convert (in frames)
+ * @param msf the minute, second, and frame bytes to populate
+ */
+static void frames_to_bcd(uint32_t frames, uint8_t *msf) {
+    msf[0] = BIN2BCD(frames / 75 / 60 % 100);
+    msf[1] = BIN2BCD(frames / 75 % 60);
+    msf[2] = BIN2BCD(frames % 75);
+}  /* frames_to_bcd */
+
+
+/**
+ * Compute the position of a sector from the layout of an image.
+ *
+ * @param img the image to examine
+ * @param lba the address of the sector
+ * @param pos the position to populate
+ * @param control a pointer to set to the control flags of the track
+ */
+static void image_position(cueify_image_private *img, uint32_t lba,
+			   cueify_position_t *pos, uint8_t *control) {
+    image_track_t *track;
+    uint32_t rel;
+    int i, index = 1;
+
+    /* Find the last track starting at or before the sector. */
+    for (i = img->last_track_number; i > img->first_track_number; i--) {
+	track = &img->tracks[i];
+	if ((track->index_lba[0] != NO_INDEX &&
+	     track->index_lba[0] <= lba) || track->index_lba[1] <= lba) {
+	    break;
+	}
+    }
+    track = &img->tracks[i];
+
+    if (lba < track->index_lba[1]) {
+	/* The relative time counts down through the pregap. */
+	index = 0;
+	rel = track->index_lba[1] - lba - 1;
+    } else {
+	while (index + 1 < MAX_INDICES &&
+	       track->index_lba[index + 1] != NO_INDEX &&
+	       track->index_lba[index + 1] <= lba) {
+	    index++;
+	}
+	rel = lba - track->index_lba[1];
+    }
+
+    pos->track = i;
+    pos->index = index;
+    pos->rel.min = rel / 75 / 60;
+    pos->rel.sec = rel / 75 % 60;
+    pos->rel.frm = rel % 75;
+    /* Positions are reported relative to LBA 0, like the drives do. */
+    pos->abs.min = lba / 75 / 60;
+    pos->abs.sec = lba / 75 % 60;
+    pos->abs.frm = lba % 75;
+    *control = track->control;
+}  /* image_position */
+
+
+/**
+ * Find the run of sectors holding a sector of an image.
+ *
+ * @param img the image to search
+ * @param lba the address of the sector
+ * @return the run holding the sector, or NULL if it lies past the
+ *         lead-out
+ */
+static image_extent_t *find_extent(cueify_image_private *img, uint32_t lba) {
+    int left = 0, right = img->num_extents, middle;
+
+    if (lba >= img->leadout) {
+	return NULL;
+    }
+    /* Runs are sorted and contiguous, so bisect on their start. */
+    while (right - left > 1) {
+	middle = (left + right) / 2;
+	if (img->extents[middle].lba <= lba) {
+	    left = middle;
+	} else {
+	    right = middle;
+	}
+    }
+    return &img->extents[left];
+}  /* find_extent */
+
+
+/**
+ * Build the raw contents of a sector of an image.
+ *
+ * @param img the image to read from
+ * @param extent the run holding the sector
+ * @param lba the address of the sector
+ * @param sector the raw sector to populate
+ */
+static void read_sector(cueify_image_private *img, image_extent_t *extent,
+			uint32_t lba, cueify_raw_read_private *sector) {
+    uint8_t *raw = (uint8_t *)sector;
+    image_map_t *map;
+    size_t offset, length = extent->sector_size, start = 0;
+
+    memset(sector, 0, sizeof(*sector));
+
+    if (extent->file >= 0 && extent->sector_size == RAW_SECTOR_SIZE) {
+	length = RAW_SECTOR_SIZE;
+    } else if (extent->mode != CUEIFY_DATA_MODE_CDDA) {
+	/* Sync pattern and header, which cooked images leave out. */
+	memset(raw + 1, 0xFF, 10);
+	frames_to_bcd(lba + LEADIN_FRAMES, raw + 12);
+	raw[15] = extent->mode;
+	start = HEADER_SIZE;
+    }
+
+    if (extent->file >= 0) {
+	map = &img->files[extent->file];
+	offset = extent->offset +
+	    (size_t)(lba - extent->lba) * extent->sector_size;
+	if (offset < map->size) {
+	    if (length > map->size - offset) {
+		length = map->size - offset;
+	    }
+	    memcpy(raw + start, map->data + offset, length);
+	}
+    }
+}  /* read_sector */
+
+
+/**
+ * Fill in the sub-Q-channel of a sector read from an image.
+ *
+ * @param img the image to read from
+ * @param lba the address of the sector
+ * @param sector the raw sector to populate
+ */
+static void read_subchannel_q(cueify_image_private *img, uint32_t lba,
+			      cueify_raw_read_private *sector) {
+#ifdef READ_RAW_SUPPORTS_SUBQ
+    uint8_t *q = &sector->control_adr;
+    size_t offset = (size_t)lba * SUBCHANNEL_SIZE + SUBCHANNEL_Q;
+    cueify_position_t pos;
+    cdtext_crc_t crc;
+    uint8_t control;
+
+    if (offset + 12 <= img->subchannel.size) {
+	memcpy(q, img->subchannel.data + offset, 12);
+	return;
+    }
+
+    image_position(img, lba, &pos, &control);
+    q[0] = (control << 4) | 0x1;
+    q[1] = BIN2BCD(pos.track);
+    q[2] = BIN2BCD(pos.index);
+    frames_to_bcd((pos.rel.min * 60 + pos.rel.sec) * 75 + pos.rel.frm, q + 3);
+    q[6] = 0;
+    frames_to_bcd(lba + LEADIN_FRAMES, q + 7);
+    crc = cdtext_crc_finalize(cdtext_crc_update(cdtext_crc_init(), q, 10));
+    q[10] = crc >> 8;
+    q[11] = crc & 0xFF;
+#else
+    /* Suppress errors about unused arguments. */
+    img++;
+    lba++;
+    sector++;
+#endif
+}  /* read_subchannel_q */
+
+
+/**
+ * Read contiguous raw sectors from an image.
+ *
+ * @param d the device handle of the image
+ * @param lba the address of the first sector to read
+ * @param count the number of sectors to read
+ * @param buffer an array of at least count raw sectors to read into
+ * @return CUEIFY_OK if the sectors were read; otherwise
+ *         CUEIFY_ERR_INTERNAL if any lies past the lead-out
+ */
+static int image_read_raw_sectors(cueify_device_private *d, uint32_t lba,
+				  uint32_t count,
+				  cueify_raw_read_private *buffer) {
+    cueify_image_private *img = d->backend_data;
+    image_extent_t *extent;
+    uint32_t i;
+
+    for (i = 0; i < count; i++) {
+	extent = find_extent(img, lba + i);
+	if (extent == NULL) {
+	    return CUEIFY_ERR_INTERNAL;
+	}
+	read_sector(img, extent, lba + i, &buffer[i]);
+	read_subchannel_q(img, lba + i, &buffer[i]);
+	d->transferred += sizeof(cueify_raw_read_private);
+    }
+
+    return CUEIFY_OK;
+}  /* image_read_raw_sectors */
+
+
+int cueify_image_sector_position(cueify_device_private *d, uint32_t lba,
+				 const cueify_raw_read_private *sector,
+				 cueify_position_t *pos) {
+    cueify_image_private *img = d->backend_data;
+    uint8_t control;
+
+#ifdef READ_RAW_SUPPORTS_SUBQ
+    if (sector != NULL && img->subchannel.size > 0) {
+	/* Subchannel data may disagree with the cue sheet; prefer it. */
+	pos->track = BCD2BIN(sector->track);
+	pos->index = BCD2BIN(sector->index);
+	lba = (BCD2BIN(sector->amin) * 60 + BCD2BIN(sector->asec)) * 75 +
+	    BCD2BIN(sector->afrm) - LEADIN_FRAMES;
+	pos->abs.min = lba / 75 / 60;
+	pos->abs.sec = lba / 75 % 60;
+	pos->abs.frm = lba % 75;
+	pos->rel.min = BCD2BIN(sector->min);
+	pos->rel.sec = BCD2BIN(sector->sec);
+	pos->rel.frm = BCD2BIN(sector->frm);
+	return CUEIFY_OK;
+    }
+#else
+    /* Suppress error about sector. */
+    sector++;
+#endif
+
+    if (lba >= img->leadout) {
+	return CUEIFY_ERR_INTERNAL;
+    }
+    image_position(img, lba, pos, &control);
+    return CUEIFY_OK;
+}  /* cueify_image_sector_position */
+
+
+/**
+ * Read the position of a sector of an image.  Only images with
+ * subchannel data need the sector itself to be read.
+ *
+ * @param d the device handle of the image
+ * @param track the track the sector is expected to lie in (unused)
+ * @param lba the address of the sector
+ * @param pos the position to populate
+ * @return CUEIFY_OK if the position was read; otherwise
+ *         CUEIFY_ERR_INTERNAL
+ */
+static int image_read_position(cueify_device_private *d, uint8_t track,
+			       uint32_t lba, cueify_position_t *pos) {
+#ifdef READ_RAW_SUPPORTS_SUBQ
+    cueify_image_private *img = d->backend_data;
+    cueify_raw_read_private buffer;
+
+    if (img->subchannel.size > 0) {
+	if (cueify_sector_cache_read(d, lba, 1, &buffer) != CUEIFY_OK) {
+	    return CUEIFY_ERR_INTERNAL;
+	}
+	return cueify_image_sector_position(d, lba, &buffer, pos);
+    }
+#endif
+
+    /* Suppress error about track. */
+    track++;
+    return cueify_image_sector_position(d, lba, NULL, pos);
+}  /* image_read_position */
+
+
+/** Close an image, releasing its files. */
+static int image_close(cueify_device_private *d) {
+    cueify_image_private *img = d->backend_data;
+    int i;
+
+    if (img != NULL) {
+	for (i = 0; i < img->num_files; i++) {
+	    unmap_file(&img->files[i]);
+	}
+	unmap_file(&img->subchannel);
+	cueify_cdtext_clear(&img->cdtext);
+	free(img->cdtext_response);
+	free(img);
+	d->backend_data = NULL;
+    }
+
+    return CUEIFY_OK;
+}  /* image_close */
+
+
+/** Images never change, so report no media change. */
+static int image_media_changed(cueify_device_private *d) {
+    /* Suppress error about d. */
+    d++;
+    return 0;
+}  /* image_media_changed */
+
+
+/** Report that images support every API. */
+static int image_get_supported_apis(cueify_device_private *d) {
+    /* Suppress error about d. */
+    d++;
+    return (CUEIFY_DEVICE_SUPPORTS_TOC       |
+	    CUEIFY_DEVICE_SUPPORTS_SESSIONS  |
+	    CUEIFY_DEVICE_SUPPORTS_FULL_TOC  |
+	    CUEIFY_DEVICE_SUPPORTS_CDTEXT    |
+	    CUEIFY_DEVICE_SUPPORTS_MCN_ISRC  |
+	    CUEIFY_DEVICE_SUPPORTS_INDICES   |
+	    CUEIFY_DEVICE_SUPPORTS_DATA_MODE |
+	    CUEIFY_DEVICE_SUPPORTS_TRACK_CONTROL);
+}  /* image_get_supported_apis */
+
+
+/** Build the TOC of an image from its layout. */
+static int image_read_toc(cueify_device_private *d, cueify_toc_private *t) {
+    cueify_image_private *img = d->backend_data;
+    int i;
+
+    t->first_track_number = img->first_track_number;
+    t->last_track_number = img->last_track_number;
+    for (i = img->first_track_number; i <= img->last_track_number; i++) {
+	t->tracks[i].adr = 0x1;
+	t->tracks[i].control = img->tracks[i].control;
+	t->tracks[i].lba = img->tracks[i].index_lba[1];
+    }
+
+    /* The lead-out is stored in track 0. */
+    t->tracks[0].adr = 0x1;
+    t->tracks[0].control = img->tracks[img->last_track_number].control;
+    t->tracks[0].lba = img->leadout;
+
+    /* As a drive would return: a header and a descriptor per track. */
+    d->transferred += 4 + 8 * (img->last_track_number -
+			      img->first_track_number + 2);
+
+    return CUEIFY_OK;
+}  /* image_read_toc */
+
+
+/** Build the (single-session) session data of an image. */
+static int image_read_sessions(cueify_device_private *d,
+			       cueify_sessions_private *s) {
+    cueify_image_private *img = d->backend_data;
+    image_track_t *track = &img->tracks[img->first_track_number];
+
+    s->first_session_number = s->last_session_number = 1;
+    s->track_adr = 0x1;
+    s->track_control = track->control;
+    s->track_number = img->first_track_number;
+    s->track_lba = track->index_lba[1];
+    d->transferred += 12;
+
+    return CUEIFY_OK;
+}  /* image_read_sessions */
+
+
+/** Convert an LBA address to an absolute MSF address. */
+static void lba_to_msf(uint32_t lba, cueify_msf_t *msf) {
+    lba += LEADIN_FRAMES;
+    msf->min = lba / 75 / 60;
+    msf->sec = lba / 75 % 60;
+    msf->frm = lba % 75;
+}  /* lba_to_msf */
+
+
+/**
+ * Fill in a pseudotrack of the full TOC of an image.
+ *
+ * @param track the pseudotrack to fill in
+ * @param control the control flags of the pseudotrack
+ * @param pmin the PMIN field of the pseudotrack
+ * @param psec the PSEC field of the pseudotrack
+ */
+static void set_pseudotrack(cueify_full_toc_track_private *track,
+			    uint8_t control, uint8_t pmin, uint8_t psec) {
+    track->session = 1;
+    track->adr = 0x1;
+    track->control = control;
+    track->offset.min = pmin;
+    track->offset.sec = psec;
+}  /* set_pseudotrack */
+
+
+/** Build the (single-session) full TOC of an image. */
+static int image_read_full_toc(cueify_device_private *d,
+			       cueify_full_toc_private *t) {
+    cueify_image_private *img = d->backend_data;
+    cueify_full_toc_session_private *session = &t->sessions[1];
+    uint8_t session_type = CUEIFY_SESSION_MODE_1;
+    int i;
+
+    t->first_session_number = t->last_session_number = 1;
+    t->first_track_number = img->first_track_number;
+    t->last_track_number = img->last_track_number;
+    for (i = img->first_track_number; i <= img->last_track_number; i++) {
+	t->tracks[i].session = 1;
+	t->tracks[i].adr = 0x1;
+	t->tracks[i].control = img->tracks[i].control;
+	lba_to_msf(img->tracks[i].index_lba[1], &t->tracks[i].offset);
+	if (img->tracks[i].mode == CUEIFY_DATA_MODE_MODE_2) {
+	    session_type = CUEIFY_SESSION_MODE_2;
+	}
+    }
+
+    session->first_track_number = img->first_track_number;
+    session->last_track_number = img->last_track_number;
+    session->session_type = session_type;
+    lba_to_msf(img->leadout, &session->leadout);
+    set_pseudotrack(&session->pseudotracks[1],
+		    img->tracks[img->first_track_number].control,
+		    img->first_track_number, session_type);
+    set_pseudotrack(&session->pseudotracks[2],
+		    img->tracks[img->last_track_number].control,
+		    img->last_track_number, 0);
+    set_pseudotrack(&session->pseudotracks[0],
+		    img->tracks[img->last_track_number].control, 0, 0);
+    session->pseudotracks[0].offset = session->leadout;
+
+    /* A header, and a descriptor per track and per pseudotrack. */
+    d->transferred += 4 + 11 * (img->last_track_number -
+			       img->first_track_number + 4);
+
+    return CUEIFY_OK;
+}  /* image_read_full_toc */
+
+
+/** Copy the CD-Text of an image, if it has any. */
+static int image_read_cdtext(cueify_device_private *d,
+			     cueify_cdtext_private *t) {
+    cueify_image_private *img = d->backend_data;
+
+    if (!img->has_cdtext) {
+	return CUEIFY_NO_DATA;
+    }
+    d->transferred += img->cdtext_size;
+    if (img->cdtext_response != NULL) {
+	return cueify_cdtext_deserialize((cueify_cdtext *)t,
+					 img->cdtext_response,
+					 img->cdtext_size);
+    }
+    return cueify_cdtext_copy(t, &img->cdtext);
+}  /* image_read_cdtext */
+
+
+/**
+ * Copy an MCN or ISRC of an image into a caller's buffer.
+ *
+ * @param value the MCN or ISRC, or an empty string if there is none
+ * @param buffer a pointer to a buffer in which to write the value
+ * @param size a pointer to the size of the buffer, set to the number
+ *             of bytes set in the buffer on output
+ * @return CUEIFY_OK if the value was copied, or CUEIFY_NO_DATA if
+ *         there is none
+ */
+static int copy_code(const char *value, char *buffer, size_t *size) {
+    if (value[0] == '\0') {
+	/* No data. */
+	if (*size > 0) {
+	    *size = 1;
+	    buffer[0] = '\0';
+	}
+	return CUEIFY_NO_DATA;
+    }
+
+    if (*size > strlen(value) + 1) {
+	*size = strlen(value) + 1;
+    }
+    if (*size > 0) {
+	memcpy(buffer, value, *size - 1);
+	buffer[*size - 1] = '\0';
+    }
+
+    return CUEIFY_OK;
+}  /* copy_code */
+
+
+/** Read the Media Catalog Number of an image. */
+static int image_read_mcn(cueify_device_private *d, char *buffer,
+			  size_t *size) {
+    cueify_image_private *img = d->backend_data;
+
+    d->transferred += SUBCHANNEL_CODE_RESPONSE_SIZE;
+    return copy_code(img->mcn, buffer, size);
+}  /* image_read_mcn */
+
+
+/** Read the ISRC of a track of an image. */
+static int image_read_isrc(cueify_device_private *d, uint8_t track,
+			   char *buffer, size_t *size) {
+    cueify_image_private *img = d->backend_data;
+
+    if (track < img->first_track_number || track > img->last_track_number) {
+	return CUEIFY_ERR_BADARG;
+    }
+    d->transferred += SUBCHANNEL_CODE_RESPONSE_SIZE;
+    return copy_code(img->tracks[track].isrc, buffer, size);
+}  /* image_read_isrc */
+
+
+/**
+ * Test whether a path names a cue sheet.
+ *
+ * @param path the path to test
+ * @return 1 if the path ends in ".cue" (in any case); otherwise 0
+ */
+static int is_cue_path(const char *path) {
+    size_t length = strlen(path);
+
+    return length > 4 && path[length - 4] == '.' &&
+	word_equal(path + length - 3, "CUE");
+}  /* is_cue_path */
+
+
+/**
+ * Map the subchannel data of an image, if there is any: a file with
+ * the same name as the image, but ending in ".sub" (as written by
+ * CloneCD and cdrdao).
+ *
+ * @param img the image to populate
+ * @param path the path of the cue sheet or raw image
+ */
+static void map_subchannel(cueify_image_private *img, const char *path) {
+    const char *dot = strrchr(path, '.');
+    size_t length = (dot != NULL && strpbrk(dot, "/\\") == NULL) ?
+	(size_t)(dot - path) : strlen(path);
+    char *sub_path;
+
+    sub_path = malloc(length + sizeof(".sub"));
+    if (sub_path == NULL) {
+	return;
+    }
+    memcpy(sub_path, path, length);
+    strcpy(sub_path + length, ".sub");
+
+    if (map_file(sub_path, &img->subchannel) == CUEIFY_OK &&
+	img->subchannel.size < (size_t)img->leadout * SUBCHANNEL_SIZE) {
+	/* Incomplete subchannel data is no use; synthesize it all. */
+	unmap_file(&img->subchannel);
+    }
+    free(sub_path);
+}  /* map_subchannel */
+
+
+int cueify_image_open(cueify_device_private *d, const char *path) {
+    cueify_image_private *img;
+    cueify_cdtext_block_private *block;
+    image_map_t map;
+    char *text;
+    int retval;
+
+    img = calloc(1, sizeof(cueify_image_private));
+    if (img == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    d->backend_data = img;
+
+    retval = map_file(path, &map);
+    if (retval != CUEIFY_OK) {
+	image_close(d);
+	return retval;
+    }
+
+    if (is_cue_path(path)) {
+	text = malloc(map.size + 1);
+	if (text == NULL) {
+	    unmap_file(&map);
+	    image_close(d);
+	    return CUEIFY_ERR_NOMEM;
+	}
+	memcpy(text, map.data, map.size);
+	text[map.size] = '\0';
+	unmap_file(&map);
+
+	retval = parse_cue(img, path, text);
+	free(text);
+    } else {
+	img->files[0] = map;
+	img->num_files = 1;
+	retval = describe_raw(img);
+    }
+    if (retval == CUEIFY_OK) {
+	retval = layout(img);
+    }
+    if (retval != CUEIFY_OK) {
+	image_close(d);
+	return retval;
+    }
+
+    if (img->has_cdtext && !img->cdtext_file) {
+	/* Strings from the cue sheet go in a single English block. */
+	block = &img->cdtext.blocks[0];
+	block->valid = 1;
+	block->charset = CUEIFY_CDTEXT_CHARSET_ISO8859_1;
+	block->language = CUEIFY_CDTEXT_LANG_ENGLISH;
+	block->first_track_number = img->first_track_number;
+	block->last_track_number = img->last_track_number;
+	cueify_cdtext_serialize((cueify_cdtext *)&img->cdtext, NULL,
+				&img->cdtext_size);
+    }
+    map_subchannel(img, path);
+
+    return CUEIFY_OK;
+}  /* cueify_image_open */
+
+
+const cueify_device_backend cueify_image_backend = {
+    image_close,
+    image_media_changed,
+    image_get_supported_apis,
+    image_read_toc,
+    image_read_sessions,
+    image_read_full_toc,
+    image_read_cdtext,
+    image_read_mcn,
+    image_read_isrc,
+    image_read_position,
+    image_read_raw_sectors,
+    /* Image reads are served from memory, so never queue them. */
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
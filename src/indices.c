@@ -30,6 +30,9 @@
 #include <cueify/error.h>
 #include "device_private.h"
 #include "full_toc_private.h"
+#include "disc_private.h"
+#include "sector_cache_private.h"
+#include "backend_private.h"
 #include "indices_private.h"
 
 cueify_indices *cueify_indices_new() {
@@ -75,173 +78,547 @@ static inline uint32_t msf_to_lba(cueify_msf_t msf) {
 }  /* msf_to_lba */
 
 
-int cueify_device_read_track_indices(cueify_device *d, cueify_indices *i,
-				     uint8_t track) {
-    cueify_device_private *dev = (cueify_device_private *)d;
-    cueify_indices_private *indices = (cueify_indices_private *)i;
-    cueify_full_toc_private toc;
+/** Return the binary representation of a binary-coded decimal. */
+#define BCD2BIN(x)  (((x >> 4) & 0xF) * 10 + (x & 0xF))
+
+/**
+ * Number of sectors read with a single batched read once a boundary
+ * search has narrowed down to a small enough range.
+ */
+#define SCAN_WINDOW  32
+
+/** An index number no track can reach, used to search for pregaps. */
+#define PREGAP_INDEX  100
+
+/** Length of the usual (two-second) pregap in sectors. */
+#define STANDARD_PREGAP  150
+
+/**
+ * Largest distance (in sectors) between the address a sector was read
+ * from and the absolute time in its sub-Q-channel for which the
+ * absolute time is still trusted.
+ */
+#define MAX_SUBQ_SKEW  SCAN_WINDOW
+
+
+/** Internal state shared by the boundary searches over a disc. */
+typedef struct {
+    cueify_device_private *dev;  /** The device being searched. */
+    cueify_full_toc_private *toc;  /** The full TOC of the disc. */
+    cueify_raw_read_private *window;  /** SCAN_WINDOW sectors of scratch. */
+} cueify_index_scan_t;
+
+
+/**
+ * Decode the position in the sub-Q-channel data of a raw sector.
+ *
+ * @param buffer the raw sector to decode
+ * @param pos the position to populate
+ * @return 1 if the sector carried a position; 0 if the sub-Q-channel
+ *         was empty or held other data (e.g. an MCN or ISRC)
+ */
+static int decode_position(cueify_raw_read_private *buffer,
+			   cueify_position_t *pos) {
+#ifdef READ_RAW_SUPPORTS_SUBQ
+    if (buffer->track == 0 || (buffer->control_adr & 0x0F) != 1) {
+	return 0;
+    }
+
+    pos->track = BCD2BIN(buffer->track);
+    pos->index = BCD2BIN(buffer->index);
+    pos->rel.min = BCD2BIN(buffer->min);
+    pos->rel.sec = BCD2BIN(buffer->sec);
+    pos->rel.frm = BCD2BIN(buffer->frm);
+    pos->abs.min = BCD2BIN(buffer->amin);
+    pos->abs.sec = BCD2BIN(buffer->asec);
+    pos->abs.frm = BCD2BIN(buffer->afrm);
+
+    /* Adjust the absolute time by 2 seconds for the lead-in. */
+    if (pos->abs.sec < 2) {
+	pos->abs.sec += 60;
+	pos->abs.min--;
+    }
+    pos->abs.sec -= 2;
+
+    return 1;
+#else
+    /* Suppress unused variable errors. */
+    buffer++;
+    pos++;
+    return 0;
+#endif
+}  /* decode_position */
+
+
+/**
+ * Get the address of the sector a position was actually read from.
+ *
+ * Drives do not always return the sub-Q-channel of the sector that
+ * was asked for, so the absolute time is preferred when it is close
+ * enough to be believable.
+ *
+ * @param pos the position to locate
+ * @param lba the address the position was read from
+ * @return the address of the sector described by pos
+ */
+static uint32_t position_lba(cueify_position_t *pos, uint32_t lba) {
+    uint32_t abs_lba = (pos->abs.min * 60 + pos->abs.sec) * 75 + pos->abs.frm;
+
+    if (abs_lba + MAX_SUBQ_SKEW < lba || abs_lba > lba + MAX_SUBQ_SKEW) {
+	return lba;
+    }
+    return abs_lba;
+}  /* position_lba */
+
+
+/**
+ * Test whether a position lies at or past a boundary: either past the
+ * end of track, or at an index of track numbered at least index.
+ */
+static inline int is_past(cueify_position_t *pos, uint8_t track,
+			  uint8_t index) {
+    return pos->track > track ||
+	(pos->track == track && pos->index >= index);
+}  /* is_past */
+
+
+/**
+ * Narrow the range of a boundary search by the position of one
+ * sector.
+ *
+ * @param pos the position read
+ * @param lba the address the position was read from
+ * @param past whether pos lies at or past the boundary
+ * @param left the first sector which may start the boundary
+ * @param right the sector after the last which may start the boundary
+ */
+static void narrow_range(cueify_position_t *pos, uint32_t lba, int past,
+			 uint32_t *left, uint32_t *right) {
+    uint32_t pos_lba = position_lba(pos, lba);
+
+    /* Only trust the absolute time if it still makes progress. */
+    if (pos_lba < *left || pos_lba >= *right) {
+	pos_lba = lba;
+    }
+
+    if (past) {
+	*right = pos_lba;
+    } else {
+	*left = pos_lba + 1;
+    }
+}  /* narrow_range */
 
-    if (cueify_device_read_full_toc_unportable(dev, &toc) != CUEIFY_OK) {
+
+/**
+ * Check a predicted boundary by reading the sectors on either side of
+ * it with a single command.
+ *
+ * @param scan the search state
+ * @param track the track the boundary follows
+ * @param index the index number which starts the boundary
+ * @param predicted the predicted first sector of the boundary
+ * @param left the first sector which may start the boundary, narrowed
+ *             if the prediction was too early
+ * @param right the sector after the last which may start the boundary,
+ *              narrowed if the prediction was too late
+ * @return CUEIFY_OK if the prediction was checked (it was right if
+ *         left == right afterwards); otherwise an appropriate error
+ *         code is returned
+ */
+static int check_prediction(cueify_index_scan_t *scan, uint8_t track,
+			    uint8_t index, uint32_t predicted,
+			    uint32_t *left, uint32_t *right) {
+    cueify_position_t before, after;
+    uint32_t lba;
+
+    if (predicted <= *left || predicted >= *right) {
+	/* Nothing to check. */
+	return CUEIFY_OK;
+    }
+
+    if (cueify_sector_cache_read(scan->dev, predicted - 1, 2,
+				 scan->window) != CUEIFY_OK) {
 	return CUEIFY_ERR_INTERNAL;
     }
+    if (!decode_position(&scan->window[0], &before) ||
+	!decode_position(&scan->window[1], &after)) {
+	/* Nothing learned; leave it to the search. */
+	return CUEIFY_OK;
+    }
 
-    if ((track >= toc.first_track_number &&
-	 track <= toc.last_track_number) ||
-	track == CUEIFY_LEAD_OUT_TRACK) {
-	/* First, see if there appears to be more than one index. */
-	cueify_msf_t msf;
-	cueify_position_t pos;
-	int lba, first_lba, left_lba, right_lba, last_lba;
-	int index;
-
-	first_lba = left_lba = msf_to_lba(toc.tracks[track].offset);
-	if (track ==
-	    toc.sessions[toc.tracks[track].session].last_track_number) {
-	    last_lba = right_lba =
-		msf_to_lba(toc.sessions[toc.tracks[track].session].leadout);
-	} else {
-	    last_lba = right_lba = msf_to_lba(toc.tracks[track + 1].offset);
+    if (!is_past(&before, track, index) && is_past(&after, track, index)) {
+	/* Spot on. */
+	lba = position_lba(&after, predicted);
+	if (lba < *left || lba > *right) {
+	    lba = predicted;
 	}
+	*left = *right = lba;
+    } else if (is_past(&before, track, index)) {
+	narrow_range(&before, predicted - 1, 1, left, right);
+    } else {
+	narrow_range(&after, predicted, 0, left, right);
+    }
 
-	/* Get the index of the penultimate second of the track. */
-	lba = last_lba - 1;
-	if (lba < left_lba) {
-	    lba = (left_lba + last_lba) / 2;
-	}
+    return CUEIFY_OK;
+}  /* check_prediction */
 
-	/* And the MSF of the first. */
-	lba_to_msf(first_lba, &msf);
 
-	if (cueify_device_read_position_unportable(
-		dev, track, lba, &pos) != CUEIFY_OK) {
+/**
+ * Find the first sector in [left, right) whose position lies at or
+ * past a boundary (see is_past()).
+ *
+ * If a prediction is given, it (and the whole second beyond it in
+ * whichever direction it was wrong) is checked first.  Otherwise, or
+ * if both guesses miss, the range is bisected one sector at a time
+ * until it fits in SCAN_WINDOW sectors, which are then read with a
+ * single command and scanned.
+ *
+ * @param scan the search state
+ * @param track the track the boundary follows
+ * @param index the index number which starts the boundary, or
+ *              PREGAP_INDEX to find the end of the track
+ * @param left the first sector which may start the boundary
+ * @param right the sector after the last which may start the boundary
+ * @param predicted the predicted first sector of the boundary, or any
+ *                  address outside (left, right) if there is none
+ * @param boundary the address to populate with the start of the boundary
+ *                 (or right if there is no such sector)
+ * @return CUEIFY_OK if the search succeeded; otherwise an
+ *         appropriate error code is returned
+ */
+static int find_boundary(cueify_index_scan_t *scan, uint8_t track,
+			 uint8_t index, uint32_t left, uint32_t right,
+			 uint32_t predicted, uint32_t *boundary) {
+    cueify_position_t pos;
+    uint32_t lba, i;
+    int found_position = 0;
+
+    if (predicted > left && predicted < right) {
+	if (check_prediction(scan, track, index, predicted,
+			     &left, &right) != CUEIFY_OK) {
 	    return CUEIFY_ERR_INTERNAL;
 	}
+	/* Boundaries tend to fall on whole seconds; try one more. */
+	if (left < right && predicted >= right && predicted >= 75) {
+	    predicted -= 75;
+	} else if (left < right && predicted < left) {
+	    predicted += 75;
+	} else {
+	    /* Either spot on, or nothing was learned. */
+	    predicted = left;
+	}
+	if (check_prediction(scan, track, index, predicted,
+			     &left, &right) != CUEIFY_OK) {
+	    return CUEIFY_ERR_INTERNAL;
+	}
+    }
 
-	if (pos.track == track &&
-	    pos.index != 1) {
-	    indices->num_indices = pos.index;
-	    indices->has_pregap = 0;
-	    indices->indices = calloc(indices->num_indices,
-				      sizeof(cueify_msf_t));
-	    if (indices->indices == NULL) {
+    while (left < right) {
+	if (right - left > SCAN_WINDOW) {
+	    lba = left + (right - left) / 2;
+	    if (scan->dev->backend->read_position(scan->dev, track, lba,
+						  &pos) != CUEIFY_OK) {
 		return CUEIFY_ERR_INTERNAL;
 	    }
-	    indices->indices[0] = msf;
-	} else if (pos.track == track + 1) {
-	    indices->num_indices = 2;
-	    indices->has_pregap = 1;
-	    indices->indices = calloc(indices->num_indices,
-				      sizeof(cueify_msf_t));
-	    if (indices->indices == NULL) {
+	    narrow_range(&pos, lba, is_past(&pos, track, index),
+			 &left, &right);
+	    continue;
+	}
+
+	/* Close enough: scan the rest in one go. */
+	if (cueify_sector_cache_read(scan->dev, left, right - left,
+				     scan->window) != CUEIFY_OK) {
+	    return CUEIFY_ERR_INTERNAL;
+	}
+	for (i = 0; i < right - left; i++) {
+	    if (decode_position(&scan->window[i], &pos)) {
+		found_position = 1;
+		if (is_past(&pos, track, index)) {
+		    right = left + i;
+		    break;
+		}
+	    }
+	}
+	if (found_position) {
+	    break;
+	}
+
+	/* No sub-Q-channel in the window; bisect the rest of the way. */
+	while (left < right) {
+	    lba = left + (right - left) / 2;
+	    if (scan->dev->backend->read_position(scan->dev, track, lba,
+						  &pos) != CUEIFY_OK) {
 		return CUEIFY_ERR_INTERNAL;
 	    }
-	    indices->indices[0] = msf;
+	    if (is_past(&pos, track, index)) {
+		right = lba;
+	    } else {
+		left = lba + 1;
+	    }
+	}
+    }
 
-	    /* Detect the pre-gap. */
-	    while (left_lba != right_lba) {
-		lba = (left_lba + right_lba) / 2;
+    *boundary = right;
+    return CUEIFY_OK;
+}  /* find_boundary */
 
-		if (cueify_device_read_position_unportable(
-			dev, track, lba, &pos) != CUEIFY_OK) {
-		    free(indices->indices);
-		    indices->indices = NULL;
-		    return CUEIFY_ERR_INTERNAL;
-		}
 
-		if (pos.track == track) {
-		    /* Choose the right half. */
-		    left_lba = lba + 1;
-		} else {
-		    /* Choose the left half. */
-		    right_lba = lba;
-		}
-	    }
+/**
+ * Read the indices of a single track, including the pregap of the
+ * following track if it has one.
+ *
+ * @param scan the search state
+ * @param track the number of the track to read indices for
+ * @param indices the track indices to populate
+ * @return CUEIFY_OK if the indices were successfully read; otherwise
+ *         an appropriate error code is returned
+ */
+static int scan_track_indices(cueify_index_scan_t *scan, uint8_t track,
+			      cueify_indices_private *indices) {
+    cueify_full_toc_private *toc = scan->toc;
+    cueify_full_toc_session_private *session;
+    cueify_position_t pos;
+    uint32_t first_lba, last_lba, end_lba, lba, next_lba;
+    uint8_t num_indices = 1, has_pregap = 0, index;
+
+    session = &toc->sessions[toc->tracks[track].session];
+    first_lba = msf_to_lba(toc->tracks[track].offset);
+    if (track == session->last_track_number) {
+	last_lba = msf_to_lba(session->leadout);
+    } else {
+	last_lba = msf_to_lba(toc->tracks[track + 1].offset);
+    }
+    if (last_lba <= first_lba) {
+	return CUEIFY_ERR_INTERNAL;
+    }
+    end_lba = last_lba;
+
+    /* The last sector tells us about the pregap and the index count. */
+    if (scan->dev->backend->read_position(scan->dev, track, last_lba - 1,
+					  &pos) != CUEIFY_OK) {
+	return CUEIFY_ERR_INTERNAL;
+    }
 
-	    /* Found the start address. */
-	    lba_to_msf(left_lba, &msf);
-	    indices->indices[1] = msf;
+    if (pos.track == track + 1 && track != session->last_track_number) {
+	/* The end of the track is the pregap of the next one. */
+	has_pregap = 1;
+
+	/*
+	 * The relative time counts down through the pregap, reaching
+	 * zero on its last sector, so it gives the exact start of the
+	 * next track.  Guess that the pregap is the usual two seconds.
+	 */
+	next_lba = position_lba(&pos, last_lba - 1) + 1 +
+	    (pos.rel.min * 60 + pos.rel.sec) * 75 + pos.rel.frm;
+	if (find_boundary(scan, track, PREGAP_INDEX, first_lba, last_lba,
+			  next_lba - STANDARD_PREGAP, &end_lba) != CUEIFY_OK) {
+	    return CUEIFY_ERR_INTERNAL;
+	}
+	if (end_lba > first_lba &&
+	    scan->dev->backend->read_position(scan->dev, track, end_lba - 1,
+					      &pos) != CUEIFY_OK) {
+	    return CUEIFY_ERR_INTERNAL;
+	}
+    }
 
-	    /* Reset the right and left sides. */
-	    last_lba = right_lba = lba;
-	    left_lba = first_lba;
+    if (pos.track == track && pos.index > 1) {
+	num_indices = pos.index;
+    }
 
-	    /* And calculate the TRUE index count. */
-	    lba = last_lba - 1;
-	    if (lba < left_lba) {
-		lba = (left_lba + last_lba) / 2;
-	    }
+    indices->num_indices = num_indices + has_pregap;
+    indices->has_pregap = has_pregap;
+    indices->indices = calloc(indices->num_indices, sizeof(cueify_msf_t));
+    if (indices->indices == NULL) {
+	indices->num_indices = 0;
+	return CUEIFY_ERR_NOMEM;
+    }
 
-	    if (cueify_device_read_position_unportable(
-		    dev, track, lba, &pos) != CUEIFY_OK) {
-		free(indices->indices);
-		indices->indices = NULL;
-		return CUEIFY_ERR_INTERNAL;
-	    }
+    lba_to_msf(first_lba, &indices->indices[0]);
+    lba = first_lba;
+    for (index = 1; index < num_indices; index++) {
+	/* There is nothing to predict index points from. */
+	if (find_boundary(scan, track, index + 1, lba, end_lba, lba,
+			  &lba) != CUEIFY_OK) {
+	    free(indices->indices);
+	    indices->indices = NULL;
+	    indices->num_indices = 0;
+	    return CUEIFY_ERR_INTERNAL;
+	}
+	lba_to_msf(lba, &indices->indices[index]);
+    }
+    if (has_pregap) {
+	lba_to_msf(end_lba, &indices->indices[num_indices]);
+    }
 
-	    if (pos.track == track &&
-		pos.index != 1) {
-		indices->num_indices = pos.index + 1;
-		indices->indices = realloc(indices->indices,
-					   indices->num_indices *
-					   sizeof(cueify_msf_t));
-		if (indices->indices == NULL) {
-		    return CUEIFY_ERR_INTERNAL;
-		}
+    return CUEIFY_OK;
+}  /* scan_track_indices */
 
-		/* TODO: Test me. */
-		/* Copy the pre-gap indices over. */
-		memcpy(&(indices->indices[indices->num_indices]),
-		       &(indices->indices[1]),
-		       sizeof(cueify_msf_t));
-	    } else {
-		/* That's it. */
-		return CUEIFY_OK;
-	    }
+
+/**
+ * Prepare the state for searching the indices of the disc in a device.
+ *
+ * @param scan the search state to populate
+ * @param dev the device to search
+ * @return CUEIFY_OK if the search may begin; otherwise an appropriate
+ *         error code is returned
+ */
+static int scan_begin(cueify_index_scan_t *scan, cueify_device_private *dev) {
+    scan->dev = dev;
+    scan->toc = NULL;
+    scan->window = NULL;
+
+    cueify_device_check_media(dev);
+    if (cueify_disc_get_full_toc(dev, &scan->toc) != CUEIFY_OK) {
+	return CUEIFY_ERR_INTERNAL;
+    }
+
+    scan->window = malloc(SCAN_WINDOW * sizeof(cueify_raw_read_private));
+    if (scan->window == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+
+    return CUEIFY_OK;
+}  /* scan_begin */
+
+
+int cueify_device_read_track_indices(cueify_device *d, cueify_indices *i,
+				     uint8_t track) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+    cueify_indices_private *indices = (cueify_indices_private *)i;
+    cueify_index_scan_t scan;
+    int retval;
+
+    if (d == NULL || i == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    free(indices->indices);
+    memset(indices, 0, sizeof(cueify_indices_private));
+
+    retval = scan_begin(&scan, dev);
+    if (retval == CUEIFY_OK) {
+	if (track >= scan.toc->first_track_number &&
+	    track <= scan.toc->last_track_number) {
+	    retval = scan_track_indices(&scan, track, indices);
 	} else {
-	    indices->num_indices = 1;
-	    indices->has_pregap = 0;
-	    indices->indices = calloc(1, sizeof(cueify_msf_t));
-	    if (indices->indices == NULL) {
-		return 0;
-	    }
-	    indices->indices[0] = msf;
-	    return CUEIFY_OK;
+	    retval = CUEIFY_ERR_BADARG;
 	}
+    }
+    free(scan.window);
 
-	for (index = 1; index < indices->num_indices; index++) {
-	    /* Detect the given index by binary search. */
-	    while (left_lba != right_lba) {
-		lba = (left_lba + right_lba) / 2;
+    return retval;
+}  /* cueify_device_read_track_indices */
 
-		if (cueify_device_read_position_unportable(
-			dev, track, lba, &pos) != CUEIFY_OK) {
-		    free(indices->indices);
-		    indices->indices = NULL;
-		    return CUEIFY_ERR_INTERNAL;
-		}
 
-		if (pos.index >= index + 1) {
-		    /* Choose the left half. */
-		    right_lba = lba;
-		} else {
-		    /* Choose the right half. */
-		    left_lba = lba + 1;
-		}
-	    }
+cueify_disc_indices *cueify_disc_indices_new() {
+    return calloc(1, sizeof(cueify_disc_indices_private));
+}  /* cueify_disc_indices_new */
+
+
+/**
+ * Free the track indices held by a disc indices instance, leaving it
+ * empty.
+ *
+ * @param indices the disc indices instance to clear
+ */
+static void disc_indices_clear(cueify_disc_indices_private *indices) {
+    int track;
+
+    for (track = 0; track < MAX_TRACKS; track++) {
+	free(indices->tracks[track].indices);
+    }
+    memset(indices, 0, sizeof(cueify_disc_indices_private));
+}  /* disc_indices_clear */
 
-	    /* Found the start address. */
-	    lba_to_msf(left_lba, &msf);
-	    indices->indices[index] = msf;
 
-	    /* Reset the right side. */
-	    right_lba = last_lba;
+int cueify_device_read_all_indices(cueify_device *d, cueify_disc_indices *i) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+    cueify_disc_indices_private *indices = (cueify_disc_indices_private *)i;
+    cueify_index_scan_t scan;
+    int retval, track;
+
+    if (d == NULL || i == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    disc_indices_clear(indices);
+
+    /*
+     * Read the TOC once and walk the disc in order, so that each
+     * track's pregap is found on the way to the next track.
+     */
+    retval = scan_begin(&scan, dev);
+    if (retval == CUEIFY_OK) {
+	for (track = scan.toc->first_track_number;
+	     track <= scan.toc->last_track_number;
+	     track++) {
+	    retval = scan_track_indices(&scan, track,
+					&indices->tracks[track]);
+	    if (retval != CUEIFY_OK) {
+		break;
+	    }
 	}
-	
-	return CUEIFY_OK;
-    } else {
-	return CUEIFY_ERR_INTERNAL;
     }
-}  /* cueify_device_read_track_indices */
+    free(scan.window);
+
+    if (retval != CUEIFY_OK) {
+	disc_indices_clear(indices);
+	return retval;
+    }
+
+    indices->first_track_number = scan.toc->first_track_number;
+    indices->last_track_number = scan.toc->last_track_number;
+
+    return CUEIFY_OK;
+}  /* cueify_device_read_all_indices */
+
+
+void cueify_disc_indices_free(cueify_disc_indices *i) {
+    cueify_disc_indices_private *indices = (cueify_disc_indices_private *)i;
+
+    if (i != NULL) {
+	disc_indices_clear(indices);
+    }
+
+    free(i);
+}  /* cueify_disc_indices_free */
+
+
+uint8_t cueify_disc_indices_get_first_track(cueify_disc_indices *i) {
+    cueify_disc_indices_private *indices = (cueify_disc_indices_private *)i;
+
+    if (i == NULL) {
+	return 0;
+    }
+
+    return indices->first_track_number;
+}  /* cueify_disc_indices_get_first_track */
+
+
+uint8_t cueify_disc_indices_get_last_track(cueify_disc_indices *i) {
+    cueify_disc_indices_private *indices = (cueify_disc_indices_private *)i;
+
+    if (i == NULL) {
+	return 0;
+    }
+
+    return indices->last_track_number;
+}  /* cueify_disc_indices_get_last_track */
+
+
+cueify_indices *cueify_disc_indices_get_track_indices(cueify_disc_indices *i,
+						      uint8_t track) {
+    cueify_disc_indices_private *indices = (cueify_disc_indices_private *)i;
+
+    if (i == NULL) {
+	return NULL;
+    } else if (track < indices->first_track_number ||
+	       track > indices->last_track_number) {
+	return NULL;
+    }
+
+    return (cueify_indices *)&indices->tracks[track];
+}  /* cueify_disc_indices_get_track_indices */
 
 
 void cueify_indices_free(cueify_indices *i) {
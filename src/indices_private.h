@@ -28,6 +28,7 @@
 
 #include <cueify/types.h>
 #include "device_private.h"
+#include "full_toc_private.h"
 
 /** Internal structure to hold track index data. */
 typedef struct {
@@ -42,6 +43,14 @@ typedef struct {
 } cueify_indices_private;
 
 
+/** Internal structure to hold the track indices of a whole disc. */
+typedef struct {
+    uint8_t first_track_number;  /** Number of the first track on the disc. */
+    uint8_t last_track_number;  /** Number of the last track on the disc. */
+    cueify_indices_private tracks[MAX_TRACKS];  /** Indices of each track. */
+} cueify_disc_indices_private;
+
+
 /** Internal structure to hold position data from an optical disc drive. */
 typedef struct {
     uint8_t track;  /** The track of a position. */
@@ -17,136 +17,247 @@ static const char * const table[256] = {
     "\xC3\xB0", "\xC3\xB1", "\xC3\xB2", "\xC3\xB3", "\xC3\xB4", "\xC3\xB5", "\xC3\xB6", "\xC3\xB7", "\xC3\xB8", "\xC3\xB9", "\xC3\xBA", "\xC3\xBB", "\xC3\xBC", "\xC3\xBD", "\xC3\xBE", "\xC3\xBF"
 };
 
-static const struct multibyte_codepoint reverse_table0000[256] = {
-    {1, {0x00, 0x00}, NULL}, {1, {0x00, 0x01}, NULL}, {1, {0x00, 0x02}, NULL}, {1, {0x00, 0x03}, NULL}, {1, {0x00, 0x04}, NULL}, {1, {0x00, 0x05}, NULL}, {1, {0x00, 0x06}, NULL}, {1, {0x00, 0x07}, NULL}, {1, {0x00, 0x08}, NULL}, {1, {0x00, 0x09}, NULL}, {1, {0x00, 0x0A}, NULL}, {1, {0x00, 0x0B}, NULL}, {1, {0x00, 0x0C}, NULL}, {1, {0x00, 0x0D}, NULL}, {1, {0x00, 0x0E}, NULL}, {1, {0x00, 0x0F}, NULL},
-    {1, {0x00, 0x10}, NULL}, {1, {0x00, 0x11}, NULL}, {1, {0x00, 0x12}, NULL}, {1, {0x00, 0x13}, NULL}, {1, {0x00, 0x14}, NULL}, {1, {0x00, 0x15}, NULL}, {1, {0x00, 0x16}, NULL}, {1, {0x00, 0x17}, NULL}, {1, {0x00, 0x18}, NULL}, {1, {0x00, 0x19}, NULL}, {1, {0x00, 0x1A}, NULL}, {1, {0x00, 0x1B}, NULL}, {1, {0x00, 0x1C}, NULL}, {1, {0x00, 0x1D}, NULL}, {1, {0x00, 0x1E}, NULL}, {1, {0x00, 0x1F}, NULL},
-    {1, {0x00, 0x20}, NULL}, {1, {0x00, 0x21}, NULL}, {1, {0x00, 0x22}, NULL}, {1, {0x00, 0x23}, NULL}, {1, {0x00, 0x24}, NULL}, {1, {0x00, 0x25}, NULL}, {1, {0x00, 0x26}, NULL}, {1, {0x00, 0x27}, NULL}, {1, {0x00, 0x28}, NULL}, {1, {0x00, 0x29}, NULL}, {1, {0x00, 0x2A}, NULL}, {1, {0x00, 0x2B}, NULL}, {1, {0x00, 0x2C}, NULL}, {1, {0x00, 0x2D}, NULL}, {1, {0x00, 0x2E}, NULL}, {1, {0x00, 0x2F}, NULL},
-    {1, {0x00, 0x30}, NULL}, {1, {0x00, 0x31}, NULL}, {1, {0x00, 0x32}, NULL}, {1, {0x00, 0x33}, NULL}, {1, {0x00, 0x34}, NULL}, {1, {0x00, 0x35}, NULL}, {1, {0x00, 0x36}, NULL}, {1, {0x00, 0x37}, NULL}, {1, {0x00, 0x38}, NULL}, {1, {0x00, 0x39}, NULL}, {1, {0x00, 0x3A}, NULL}, {1, {0x00, 0x3B}, NULL}, {1, {0x00, 0x3C}, NULL}, {1, {0x00, 0x3D}, NULL}, {1, {0x00, 0x3E}, NULL}, {1, {0x00, 0x3F}, NULL},
-    {1, {0x00, 0x40}, NULL}, {1, {0x00, 0x41}, NULL}, {1, {0x00, 0x42}, NULL}, {1, {0x00, 0x43}, NULL}, {1, {0x00, 0x44}, NULL}, {1, {0x00, 0x45}, NULL}, {1, {0x00, 0x46}, NULL}, {1, {0x00, 0x47}, NULL}, {1, {0x00, 0x48}, NULL}, {1, {0x00, 0x49}, NULL}, {1, {0x00, 0x4A}, NULL}, {1, {0x00, 0x4B}, NULL}, {1, {0x00, 0x4C}, NULL}, {1, {0x00, 0x4D}, NULL}, {1, {0x00, 0x4E}, NULL}, {1, {0x00, 0x4F}, NULL},
-    {1, {0x00, 0x50}, NULL}, {1, {0x00, 0x51}, NULL}, {1, {0x00, 0x52}, NULL}, {1, {0x00, 0x53}, NULL}, {1, {0x00, 0x54}, NULL}, {1, {0x00, 0x55}, NULL}, {1, {0x00, 0x56}, NULL}, {1, {0x00, 0x57}, NULL}, {1, {0x00, 0x58}, NULL}, {1, {0x00, 0x59}, NULL}, {1, {0x00, 0x5A}, NULL}, {1, {0x00, 0x5B}, NULL}, {1, {0x00, 0x5C}, NULL}, {1, {0x00, 0x5D}, NULL}, {1, {0x00, 0x5E}, NULL}, {1, {0x00, 0x5F}, NULL},
-    {1, {0x00, 0x60}, NULL}, {1, {0x00, 0x61}, NULL}, {1, {0x00, 0x62}, NULL}, {1, {0x00, 0x63}, NULL}, {1, {0x00, 0x64}, NULL}, {1, {0x00, 0x65}, NULL}, {1, {0x00, 0x66}, NULL}, {1, {0x00, 0x67}, NULL}, {1, {0x00, 0x68}, NULL}, {1, {0x00, 0x69}, NULL}, {1, {0x00, 0x6A}, NULL}, {1, {0x00, 0x6B}, NULL}, {1, {0x00, 0x6C}, NULL}, {1, {0x00, 0x6D}, NULL}, {1, {0x00, 0x6E}, NULL}, {1, {0x00, 0x6F}, NULL},
-    {1, {0x00, 0x70}, NULL}, {1, {0x00, 0x71}, NULL}, {1, {0x00, 0x72}, NULL}, {1, {0x00, 0x73}, NULL}, {1, {0x00, 0x74}, NULL}, {1, {0x00, 0x75}, NULL}, {1, {0x00, 0x76}, NULL}, {1, {0x00, 0x77}, NULL}, {1, {0x00, 0x78}, NULL}, {1, {0x00, 0x79}, NULL}, {1, {0x00, 0x7A}, NULL}, {1, {0x00, 0x7B}, NULL}, {1, {0x00, 0x7C}, NULL}, {1, {0x00, 0x7D}, NULL}, {1, {0x00, 0x7E}, NULL}, {0, {0, 0}, NULL},
-    {1, {0x00, 0x80}, NULL}, {1, {0x00, 0x81}, NULL}, {1, {0x00, 0x82}, NULL}, {1, {0x00, 0x83}, NULL}, {1, {0x00, 0x84}, NULL}, {1, {0x00, 0x85}, NULL}, {1, {0x00, 0x86}, NULL}, {1, {0x00, 0x87}, NULL}, {1, {0x00, 0x88}, NULL}, {1, {0x00, 0x89}, NULL}, {1, {0x00, 0x8A}, NULL}, {1, {0x00, 0x8B}, NULL}, {1, {0x00, 0x8C}, NULL}, {1, {0x00, 0x8D}, NULL}, {1, {0x00, 0x8E}, NULL}, {1, {0x00, 0x8F}, NULL},
-    {1, {0x00, 0x90}, NULL}, {1, {0x00, 0x91}, NULL}, {1, {0x00, 0x92}, NULL}, {1, {0x00, 0x93}, NULL}, {1, {0x00, 0x94}, NULL}, {1, {0x00, 0x95}, NULL}, {1, {0x00, 0x96}, NULL}, {1, {0x00, 0x97}, NULL}, {1, {0x00, 0x98}, NULL}, {1, {0x00, 0x99}, NULL}, {1, {0x00, 0x9A}, NULL}, {1, {0x00, 0x9B}, NULL}, {1, {0x00, 0x9C}, NULL}, {1, {0x00, 0x9D}, NULL}, {1, {0x00, 0x9E}, NULL}, {1, {0x00, 0x9F}, NULL},
-    {0, {0, 0}, NULL}, {1, {0x00, 0xA1}, NULL}, {1, {0x00, 0xA2}, NULL}, {1, {0x00, 0xA3}, NULL}, {1, {0x00, 0xA4}, NULL}, {1, {0x00, 0xA5}, NULL}, {1, {0x00, 0xA6}, NULL}, {1, {0x00, 0xA7}, NULL}, {0, {0, 0}, NULL}, {1, {0x00, 0xA9}, NULL}, {1, {0x00, 0xAA}, NULL}, {1, {0x00, 0xAB}, NULL}, {1, {0x00, 0xAC}, NULL}, {0, {0, 0}, NULL}, {1, {0x00, 0xAE}, NULL}, {1, {0x00, 0xAF}, NULL},
-    {1, {0x00, 0xB0}, NULL}, {1, {0x00, 0xB1}, NULL}, {1, {0x00, 0xB2}, NULL}, {1, {0x00, 0xB3}, NULL}, {1, {0x00, 0xB4}, NULL}, {1, {0x00, 0xB5}, NULL}, {1, {0x00, 0xB6}, NULL}, {1, {0x00, 0xB7}, NULL}, {0, {0, 0}, NULL}, {1, {0x00, 0xB9}, NULL}, {1, {0x00, 0xBA}, NULL}, {1, {0x00, 0xBB}, NULL}, {1, {0x00, 0xBC}, NULL}, {1, {0x00, 0xBD}, NULL}, {1, {0x00, 0xBE}, NULL}, {1, {0x00, 0xBF}, NULL},
-    {1, {0x00, 0xC0}, NULL}, {1, {0x00, 0xC1}, NULL}, {1, {0x00, 0xC2}, NULL}, {1, {0x00, 0xC3}, NULL}, {1, {0x00, 0xC4}, NULL}, {1, {0x00, 0xC5}, NULL}, {1, {0x00, 0xC6}, NULL}, {1, {0x00, 0xC7}, NULL}, {1, {0x00, 0xC8}, NULL}, {1, {0x00, 0xC9}, NULL}, {1, {0x00, 0xCA}, NULL}, {1, {0x00, 0xCB}, NULL}, {1, {0x00, 0xCC}, NULL}, {1, {0x00, 0xCD}, NULL}, {1, {0x00, 0xCE}, NULL}, {1, {0x00, 0xCF}, NULL},
-    {1, {0x00, 0xD0}, NULL}, {1, {0x00, 0xD1}, NULL}, {1, {0x00, 0xD2}, NULL}, {1, {0x00, 0xD3}, NULL}, {1, {0x00, 0xD4}, NULL}, {1, {0x00, 0xD5}, NULL}, {1, {0x00, 0xD6}, NULL}, {1, {0x00, 0xD7}, NULL}, {1, {0x00, 0xD8}, NULL}, {1, {0x00, 0xD9}, NULL}, {1, {0x00, 0xDA}, NULL}, {1, {0x00, 0xDB}, NULL}, {1, {0x00, 0xDC}, NULL}, {1, {0x00, 0xDD}, NULL}, {1, {0x00, 0xDE}, NULL}, {1, {0x00, 0xDF}, NULL},
-    {1, {0x00, 0xE0}, NULL}, {1, {0x00, 0xE1}, NULL}, {1, {0x00, 0xE2}, NULL}, {1, {0x00, 0xE3}, NULL}, {1, {0x00, 0xE4}, NULL}, {1, {0x00, 0xE5}, NULL}, {1, {0x00, 0xE6}, NULL}, {1, {0x00, 0xE7}, NULL}, {1, {0x00, 0xE8}, NULL}, {1, {0x00, 0xE9}, NULL}, {1, {0x00, 0xEA}, NULL}, {1, {0x00, 0xEB}, NULL}, {1, {0x00, 0xEC}, NULL}, {1, {0x00, 0xED}, NULL}, {1, {0x00, 0xEE}, NULL}, {1, {0x00, 0xEF}, NULL},
-    {1, {0x00, 0xF0}, NULL}, {1, {0x00, 0xF1}, NULL}, {1, {0x00, 0xF2}, NULL}, {1, {0x00, 0xF3}, NULL}, {1, {0x00, 0xF4}, NULL}, {1, {0x00, 0xF5}, NULL}, {1, {0x00, 0xF6}, NULL}, {1, {0x00, 0xF7}, NULL}, {1, {0x00, 0xF8}, NULL}, {1, {0x00, 0xF9}, NULL}, {1, {0x00, 0xFA}, NULL}, {1, {0x00, 0xFB}, NULL}, {1, {0x00, 0xFC}, NULL}, {1, {0x00, 0xFD}, NULL}, {1, {0x00, 0xFE}, NULL}, {1, {0x00, 0xFF}, NULL}
-};
+#define REVERSE_ROWS 39
 
-static const struct multibyte_codepoint reverse_table0021[256] = {
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {1, {0x00, 0xAD}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}
+static const uint8_t reverse_rows[REVERSE_ROWS] = {
+      1,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,   0,
+      2,   3,   0,   0,   0,   4,   5
 };
 
-static const struct multibyte_codepoint reverse_table0025[256] = {
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {1, {0x00, 0xA0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {1, {0x00, 0x7F}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}
+static const uint16_t reverse_table[6][256] = {
+    {  /* No encodings */
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000
+    },
+    {  /* U+0000xx */
+	0x0000, 0x0001, 0x0002, 0x0003, 0x0004, 0x0005, 0x0006, 0x0007,
+	0x0008, 0x0009, 0x000A, 0x000B, 0x000C, 0x000D, 0x000E, 0x000F,
+	0x0010, 0x0011, 0x0012, 0x0013, 0x0014, 0x0015, 0x0016, 0x0017,
+	0x0018, 0x0019, 0x001A, 0x001B, 0x001C, 0x001D, 0x001E, 0x001F,
+	0x0020, 0x0021, 0x0022, 0x0023, 0x0024, 0x0025, 0x0026, 0x0027,
+	0x0028, 0x0029, 0x002A, 0x002B, 0x002C, 0x002D, 0x002E, 0x002F,
+	0x0030, 0x0031, 0x0032, 0x0033, 0x0034, 0x0035, 0x0036, 0x0037,
+	0x0038, 0x0039, 0x003A, 0x003B, 0x003C, 0x003D, 0x003E, 0x003F,
+	0x0040, 0x0041, 0x0042, 0x0043, 0x0044, 0x0045, 0x0046, 0x0047,
+	0x0048, 0x0049, 0x004A, 0x004B, 0x004C, 0x004D, 0x004E, 0x004F,
+	0x0050, 0x0051, 0x0052, 0x0053, 0x0054, 0x0055, 0x0056, 0x0057,
+	0x0058, 0x0059, 0x005A, 0x005B, 0x005C, 0x005D, 0x005E, 0x005F,
+	0x0060, 0x0061, 0x0062, 0x0063, 0x0064, 0x0065, 0x0066, 0x0067,
+	0x0068, 0x0069, 0x006A, 0x006B, 0x006C, 0x006D, 0x006E, 0x006F,
+	0x0070, 0x0071, 0x0072, 0x0073, 0x0074, 0x0075, 0x0076, 0x0077,
+	0x0078, 0x0079, 0x007A, 0x007B, 0x007C, 0x007D, 0x007E, 0x0000,
+	0x0080, 0x0081, 0x0082, 0x0083, 0x0084, 0x0085, 0x0086, 0x0087,
+	0x0088, 0x0089, 0x008A, 0x008B, 0x008C, 0x008D, 0x008E, 0x008F,
+	0x0090, 0x0091, 0x0092, 0x0093, 0x0094, 0x0095, 0x0096, 0x0097,
+	0x0098, 0x0099, 0x009A, 0x009B, 0x009C, 0x009D, 0x009E, 0x009F,
+	0x0000, 0x00A1, 0x00A2, 0x00A3, 0x00A4, 0x00A5, 0x00A6, 0x00A7,
+	0x0000, 0x00A9, 0x00AA, 0x00AB, 0x00AC, 0x0000, 0x00AE, 0x00AF,
+	0x00B0, 0x00B1, 0x00B2, 0x00B3, 0x00B4, 0x00B5, 0x00B6, 0x00B7,
+	0x0000, 0x00B9, 0x00BA, 0x00BB, 0x00BC, 0x00BD, 0x00BE, 0x00BF,
+	0x00C0, 0x00C1, 0x00C2, 0x00C3, 0x00C4, 0x00C5, 0x00C6, 0x00C7,
+	0x00C8, 0x00C9, 0x00CA, 0x00CB, 0x00CC, 0x00CD, 0x00CE, 0x00CF,
+	0x00D0, 0x00D1, 0x00D2, 0x00D3, 0x00D4, 0x00D5, 0x00D6, 0x00D7,
+	0x00D8, 0x00D9, 0x00DA, 0x00DB, 0x00DC, 0x00DD, 0x00DE, 0x00DF,
+	0x00E0, 0x00E1, 0x00E2, 0x00E3, 0x00E4, 0x00E5, 0x00E6, 0x00E7,
+	0x00E8, 0x00E9, 0x00EA, 0x00EB, 0x00EC, 0x00ED, 0x00EE, 0x00EF,
+	0x00F0, 0x00F1, 0x00F2, 0x00F3, 0x00F4, 0x00F5, 0x00F6, 0x00F7,
+	0x00F8, 0x00F9, 0x00FA, 0x00FB, 0x00FC, 0x00FD, 0x00FE, 0x00FF
+    },
+    {  /* U+0020xx */
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x00B8, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000
+    },
+    {  /* U+0021xx */
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x00AD,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000
+    },
+    {  /* U+0025xx */
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x00A0, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x007F, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000
+    },
+    {  /* U+0026xx */
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x00A8, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000,
+	0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000, 0x0000
+    }
 };
 
-static const struct multibyte_codepoint reverse_table0026[256] = {
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {1, {0x00, 0xA8}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}
+static const uint8_t reverse_sequence_starts[6][32] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
 };
 
-static const struct multibyte_codepoint reverse_table0020[256] = {
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {1, {0x00, 0xB8}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL},
-    {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}, {0, {0, 0}, NULL}
+static const uint8_t reverse_sequence_ends[6][32] = {
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00},
+    {0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00}
 };
 
-static const struct multibyte_codepoint *reverse_table00[256] = {
-    reverse_table0000, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    reverse_table0020, reverse_table0021, NULL, NULL, NULL, reverse_table0025, reverse_table0026, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
-};
+#define REVERSE_SEQUENCES 0
 
-static const struct multibyte_codepoint * const *reverse_master_table[256] = {
-    reverse_table00, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
-    NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL
+static const struct codepoint_sequence reverse_sequences[1] = {
+    {{0, 0}, 0}
 };
 
+static const struct reverse_charmap reverse_charmap = {
+    REVERSE_ROWS, reverse_rows, reverse_table,
+    reverse_sequence_starts, reverse_sequence_ends,
+    REVERSE_SEQUENCES, reverse_sequences, 1
+};
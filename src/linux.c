@@ -23,12 +23,20 @@
  * SOFTWARE.
  */
 
+#include <stdio.h>
 #include <string.h>
+#include <limits.h>
+#include <errno.h>
 #include <fcntl.h>
 #include <unistd.h>
+#include <dirent.h>
+#include <poll.h>
 #include <sys/stat.h>
 #include <sys/ioctl.h>
+#include <sys/sysmacros.h>
+#include <linux/fs.h>
 #include <linux/cdrom.h>
+#include <scsi/sg.h>
 #include <cueify/toc.h>
 #include <cueify/sessions.h>
 #include <cueify/full_toc.h>
@@ -41,6 +49,11 @@
 #include "full_toc_private.h"
 #include "cdtext_private.h"
 #include "indices_private.h"
+#include "sector_cache_private.h"
+#include "mcn_isrc_private.h"
+#include "async_private.h"
+#include "stats_private.h"
+#include "trace_private.h"
 
 /** Struct representing READ TOC/PMA/ATIP command structure */
 struct scsi_read_toc {
@@ -135,9 +148,94 @@ union subchannel_data {
 
 #define min(x, y)  ((x > y) ? y : x)  /** Return the minimum of x and y. */
 
+/**
+ * Send a packet command to a device, appending it to the trace of the
+ * device if it is being traced.
+ *
+ * @param d the device handle to send the command to
+ * @param gpcmd the command to send, with its buffer and sense set
+ * @param cdb_length the number of bytes in the command descriptor block
+ * @return CUEIFY_OK if the command succeeded; otherwise CUEIFY_ERR_INTERNAL
+ */
+static int send_packet(cueify_device_private *d,
+		       struct cdrom_generic_command *gpcmd,
+		       size_t cdb_length) {
+    uint32_t start = 0;
+    int status = CUEIFY_OK;
+
+    if (d->trace != NULL) {
+	memset(gpcmd->sense, 0, sizeof(*gpcmd->sense));
+	start = cueify_stats_start(d);
+    }
+
+    if (ioctl(d->handle, CDROM_SEND_PACKET, gpcmd) < 0) {
+	status = CUEIFY_ERR_INTERNAL;
+    } else {
+	d->transferred += cueify_trace_response_length(gpcmd->cmd,
+						      gpcmd->buffer,
+						      gpcmd->buflen);
+    }
+
+    if (d->trace != NULL) {
+	cueify_trace_record(d, gpcmd->cmd, cdb_length, gpcmd->buflen,
+			    gpcmd->buffer, (uint8_t *)gpcmd->sense,
+			    sizeof(*gpcmd->sense),
+			    cueify_stats_start(d) - start, status);
+    }
+    return status;
+}  /* send_packet */
+
+
+/**
+ * Open the SCSI generic (sg) device node of the same drive as a CD-ROM
+ * block device, through which commands can be queued without waiting
+ * for them to complete.
+ *
+ * @param fd an open file descriptor of the CD-ROM block device
+ * @return an open file descriptor of the sg device node, or -1 if it
+ *         could not be found or opened
+ */
+static int open_scsi_generic(int fd) {
+    struct stat buf;
+    struct dirent *entry;
+    char path[sizeof("/sys/dev/block/4294967295:4294967295/device/"
+		     "scsi_generic") + sizeof(entry->d_name)];
+    DIR *dir;
+    int sg = -1, version;
+
+    if (fstat(fd, &buf) < 0 || !S_ISBLK(buf.st_mode)) {
+	return -1;
+    }
+
+    snprintf(path, sizeof(path), "/sys/dev/block/%u:%u/device/scsi_generic",
+	     major(buf.st_rdev), minor(buf.st_rdev));
+    dir = opendir(path);
+    if (dir == NULL) {
+	return -1;
+    }
+    while ((entry = readdir(dir)) != NULL) {
+	if (entry->d_name[0] != '.') {
+	    snprintf(path, sizeof(path), "/dev/%s", entry->d_name);
+	    sg = open(path, O_RDWR | O_NONBLOCK, 0);
+	    break;
+	}
+    }
+    closedir(dir);
+
+    /* Queueing with write() and read() needs the version 3 interface. */
+    if (sg >= 0 &&
+	(ioctl(sg, SG_GET_VERSION_NUM, &version) < 0 || version < 30000)) {
+	close(sg);
+	sg = -1;
+    }
+    return sg;
+}  /* open_scsi_generic */
+
+
 int cueify_device_open_unportable(cueify_device_private *d,
 				  const char *device) {
     int fd;
+    unsigned short max_sectors;
 
     /* TODO: Test if the file is actually a CD-ROM device. */
     fd = open(device, O_RDONLY | O_NONBLOCK, 0);
@@ -145,11 +243,23 @@ int cueify_device_open_unportable(cueify_device_private *d,
 	return CUEIFY_ERR_NO_DEVICE;
     }
     d->handle = fd;
+
+    /* The request queue limits how much a single READ CD can transfer. */
+    if (ioctl(fd, BLKSECTGET, &max_sectors) == 0 && max_sectors > 0) {
+	d->max_transfer = max_sectors * 512;
+    } else {
+	d->max_transfer = DEFAULT_MAX_TRANSFER;
+    }
+
+    d->async_handle = open_scsi_generic(fd);
     return CUEIFY_OK;
 }  /* cueify_device_open_unportable */
 
 
 int cueify_device_close_unportable(cueify_device_private *d) {
+    if (d->async_handle >= 0) {
+	close(d->async_handle);
+    }
     if (close(d->handle) == 0) {
 	return CUEIFY_OK;
     } else {
@@ -158,6 +268,12 @@ int cueify_device_close_unportable(cueify_device_private *d) {
 }  /* cueify_device_close_unportable */
 
 
+int cueify_device_media_changed_unportable(cueify_device_private *d) {
+    /* Treat a failed check as a change, so nothing stale is reused. */
+    return ioctl(d->handle, CDROM_MEDIA_CHANGED, CDSL_CURRENT) != 0;
+}  /* cueify_device_media_changed_unportable */
+
+
 int cueify_device_get_supported_apis_unportable(cueify_device_private *d) {
     /* Suppress error about d. */
     d++;
@@ -190,46 +306,36 @@ const char *cueify_device_get_default_device_unportable() {
 
 int cueify_device_read_toc_unportable(cueify_device_private *d,
 				      cueify_toc_private *t) {
-    struct cdrom_tochdr hdr;
-    struct cdrom_tocentry toc;
-    int i;
-
-    memset(&hdr, 0, sizeof(hdr));
-    memset(&toc, 0, sizeof(toc));
-
-    if (ioctl(d->handle, CDROMREADTOCHDR, &hdr) < 0) {
-	return CUEIFY_ERR_INTERNAL;
-    }
-
-    t->first_track_number = hdr.cdth_trk0;
-    t->last_track_number = hdr.cdth_trk1;
-
-    toc.cdte_format = CDROM_LBA;
-
-    for (i = t->first_track_number; i <= t->last_track_number; i++) {
-	toc.cdte_track = i;
+    /*
+     * The CDROMREADTOCENTRY ioctl reads one track at a time; one READ
+     * TOC/PMA/ATIP reads them all (and is a single command to trace).
+     */
+    struct cdrom_generic_command gpcmd;
+    struct scsi_read_toc *scsi_cmd;
+    struct request_sense sense;
+    /* At most 100 descriptors (99 tracks and lead-out), plus header. */
+    uint8_t data[100 * 8 + 4];
 
-	if (ioctl(d->handle, CDROMREADTOCENTRY, &toc) < 0) {
-	    return CUEIFY_ERR_INTERNAL;
-	}
+    memset(&gpcmd, 0, sizeof(gpcmd));
 
-	t->tracks[toc.cdte_track].control = toc.cdte_ctrl;
-	t->tracks[toc.cdte_track].adr = toc.cdte_adr;
-	t->tracks[toc.cdte_track].lba = toc.cdte_addr.lba;
-    }
+    scsi_cmd = (struct scsi_read_toc *)&gpcmd.cmd;
+    scsi_cmd->format |= 0x00;  /* 0000b = TOC */
+    scsi_cmd->data_len[0] = (sizeof(data) >> 8) & 0xFF;
+    scsi_cmd->data_len[1] = sizeof(data) & 0xFF;
+    scsi_cmd->op_code = GPCMD_READ_TOC_PMA_ATIP;
 
-    /* Finally, read lead-out track. */
-    toc.cdte_track = CDROM_LEADOUT;
+    gpcmd.buffer = data;
+    gpcmd.buflen = sizeof(data);
+    gpcmd.sense = &sense;
+    gpcmd.data_direction = CGC_DATA_READ;
+    gpcmd.timeout = 50000;
 
-    if (ioctl(d->handle, CDROMREADTOCENTRY, &toc) < 0) {
+    if (send_packet(d, &gpcmd, sizeof(*scsi_cmd)) != CUEIFY_OK) {
 	return CUEIFY_ERR_INTERNAL;
     }
 
-    t->tracks[0].control = toc.cdte_ctrl;
-    t->tracks[0].adr = toc.cdte_adr;
-    t->tracks[0].lba = toc.cdte_addr.lba;
-
-    return CUEIFY_OK;
+    /* We serialize to the format of the TOC response for a reason... */
+    return cueify_toc_deserialize((cueify_toc *)t, data, sizeof(data));
 }  /* cueify_device_read_toc_unportable */
 
 
@@ -255,7 +361,7 @@ int cueify_device_read_sessions_unportable(cueify_device_private *d,
     gpcmd.data_direction = CGC_DATA_READ;
     gpcmd.timeout = 50000;
 
-    if (ioctl(d->handle, CDROM_SEND_PACKET, &gpcmd) < 0) {
+    if (send_packet(d, &gpcmd, sizeof(*scsi_cmd)) != CUEIFY_OK) {
 	return CUEIFY_ERR_INTERNAL;
     }
 
@@ -286,7 +392,7 @@ int cueify_device_read_full_toc_unportable(cueify_device_private *d,
     gpcmd.data_direction = CGC_DATA_READ;
     gpcmd.timeout = 50000;
 
-    if (ioctl(d->handle, CDROM_SEND_PACKET, &gpcmd) < 0) {
+    if (send_packet(d, &gpcmd, sizeof(*scsi_cmd)) != CUEIFY_OK) {
 	return CUEIFY_ERR_INTERNAL;
     }
 
@@ -318,7 +424,7 @@ int cueify_device_read_cdtext_unportable(cueify_device_private *d,
     gpcmd.data_direction = CGC_DATA_READ;
     gpcmd.timeout = 50000;
 
-    if (ioctl(d->handle, CDROM_SEND_PACKET, &gpcmd) < 0) {
+    if (send_packet(d, &gpcmd, sizeof(*scsi_cmd)) != CUEIFY_OK) {
 	return CUEIFY_ERR_INTERNAL;
     }
 
@@ -351,7 +457,7 @@ int cueify_device_read_mcn_unportable(cueify_device_private *d,
     gpcmd.data_direction = CGC_DATA_READ;
     gpcmd.timeout = 50000;
 
-    if (ioctl(d->handle, CDROM_SEND_PACKET, &gpcmd) < 0) {
+    if (send_packet(d, &gpcmd, sizeof(*scsi_cmd)) != CUEIFY_OK) {
 	return CUEIFY_ERR_INTERNAL;
     }
 
@@ -376,6 +482,39 @@ int cueify_device_read_mcn_unportable(cueify_device_private *d,
 }  /* cueify_device_read_mcn_unportable */
 
 
+/**
+ * Copy the ISRC out of the response to a READ SUB-CHANNEL command.
+ *
+ * @param isrc the response to copy the ISRC from
+ * @param buffer a pointer to a buffer in which to write the ISRC
+ * @param size a pointer to the size of the buffer, set to the number
+ *             of bytes set in the buffer on output
+ * @return CUEIFY_OK if the ISRC was copied, or CUEIFY_NO_DATA if the
+ *         response holds no ISRC
+ */
+static int copy_isrc(struct subchannel_isrc *isrc, char *buffer,
+		     size_t *size) {
+    /* TCVAL (MSB in byte 8) must equal 1 if there is ISRC data. */
+    if (isrc->tcval != 0x80) {
+	/* No data. */
+	if (*size > 0) {
+	    *size = 1;
+	    buffer[0] = '\0';
+	}
+	return CUEIFY_NO_DATA;
+    }
+
+    /* OK.  Copy the ISRC (starts at byte 9) */
+    *size = min(sizeof(isrc->isrc), *size);
+    if (*size > 0) {
+	memcpy(buffer, isrc->isrc, *size - 1);
+	buffer[*size - 1] = '\0';
+    }
+
+    return CUEIFY_OK;
+}  /* copy_isrc */
+
+
 int cueify_device_read_isrc_unportable(cueify_device_private *d, uint8_t track,
 				       char *buffer, size_t *size) {
     struct cdrom_generic_command gpcmd;
@@ -399,28 +538,11 @@ int cueify_device_read_isrc_unportable(cueify_device_private *d, uint8_t track,
     gpcmd.data_direction = CGC_DATA_READ;
     gpcmd.timeout = 50000;
 
-    if (ioctl(d->handle, CDROM_SEND_PACKET, &gpcmd) < 0) {
+    if (send_packet(d, &gpcmd, sizeof(*scsi_cmd)) != CUEIFY_OK) {
 	return CUEIFY_ERR_INTERNAL;
     }
 
-    /* TCVAL (MSB in byte 8) must equal 1 if there is ISRC data. */
-    if (data.isrc.tcval != 0x80) {
-	/* No data. */
-	if (*size > 0) {
-	    *size = 1;
-	    buffer[0] = '\0';
-	}
-	return CUEIFY_NO_DATA;
-    }
-
-    /* OK.  Copy the ISRC (starts at byte 9) */
-    *size = min(sizeof(data.isrc.isrc), *size);
-    if (*size > 0) {
-	memcpy(buffer, data.isrc.isrc, *size - 1);
-	buffer[*size - 1] = '\0';
-    }
-
-    return CUEIFY_OK;
+    return copy_isrc(&data.isrc, buffer, size);
 }  /* cueify_device_read_isrc_unportable */
 
 
@@ -446,7 +568,7 @@ int cueify_device_read_position_unportable(cueify_device_private *d,
 	 * We can actually get the position from reading the Q subchannel
 	 * during our raw read, rather than doing a subchannel ioctl!
 	 */
-	if (cueify_device_read_raw_unportable(d, lba, &buffer) != CUEIFY_OK) {
+	if (cueify_sector_cache_read(d, lba, 1, &buffer) != CUEIFY_OK) {
 	    return CUEIFY_ERR_INTERNAL;
 	}
 	lba--;
@@ -462,7 +584,7 @@ int cueify_device_read_position_unportable(cueify_device_private *d,
 
     /* Adjust the absolute time by 2 seconds for the lead-in. */
     if (pos->abs.sec < 2) {
-	pos->abs.sec += 75;
+	pos->abs.sec += 60;
 	pos->abs.min--;
     }
     pos->abs.sec -= 2;
@@ -476,38 +598,210 @@ int cueify_device_read_position_unportable(cueify_device_private *d,
 }  /* cueify_device_read_position_unportable */
 
 
-int cueify_device_read_raw_unportable(cueify_device_private *d, uint32_t lba,
-				      cueify_raw_read_private *buffer) {
-    struct cdrom_generic_command gpcmd;
-    struct scsi_read_cd *scsi_cmd;
-    struct request_sense sense;
-
-    memset(&gpcmd, 0, sizeof(gpcmd));
-
-    scsi_cmd = (struct scsi_read_cd *)&gpcmd.cmd;
+/**
+ * Fill in a READ CD command for raw sectors with the sub-Q-channel.
+ *
+ * @param scsi_cmd the command to fill in, which must be zeroed
+ * @param lba the absolute address (LBA) of the first sector to read
+ * @param length the number of sectors to read
+ */
+static void fill_read_cd(struct scsi_read_cd *scsi_cmd, uint32_t lba,
+			 uint32_t length) {
     scsi_cmd->address[0] = (lba >> 24);
     scsi_cmd->address[1] = (lba >> 16) & 0xFF;
     scsi_cmd->address[2] = (lba >> 8) & 0xFF;
     scsi_cmd->address[3] = lba & 0xFF;
 
-    scsi_cmd->length[0] = 0;
-    scsi_cmd->length[1] = 0;
-    scsi_cmd->length[2] = 1;
+    scsi_cmd->length[0] = (length >> 16) & 0xFF;
+    scsi_cmd->length[1] = (length >> 8) & 0xFF;
+    scsi_cmd->length[2] = length & 0xFF;
 
     scsi_cmd->bitmask = 0xF8;  /* Read Sync bit, all headers, User Data, and ECC */
     scsi_cmd->subchannels = 0x02;  /* Support the Q subchannel */
 
     scsi_cmd->op_code = GPCMD_READ_CD;
+}  /* fill_read_cd */
 
-    gpcmd.buffer = (unsigned char *)buffer;
-    gpcmd.buflen = sizeof(cueify_raw_read_private);
-    gpcmd.sense = &sense;
-    gpcmd.data_direction = CGC_DATA_READ;
-    gpcmd.timeout = 50000;
 
-    if (ioctl(d->handle, CDROM_SEND_PACKET, &gpcmd) < 0) {
+int cueify_device_read_raw_unportable(cueify_device_private *d, uint32_t lba,
+				      cueify_raw_read_private *buffer) {
+    return cueify_device_read_raw_sectors_unportable(d, lba, 1, buffer);
+}  /* cueify_device_read_raw_unportable */
+
+
+int cueify_device_read_raw_sectors_unportable(cueify_device_private *d,
+					      uint32_t lba, uint32_t count,
+					      cueify_raw_read_private *buffer) {
+    struct cdrom_generic_command gpcmd;
+    struct request_sense sense;
+    uint32_t max_sectors, length;
+
+    /* Never ask for more than the device can transfer at once. */
+    max_sectors = d->max_transfer / sizeof(cueify_raw_read_private);
+    if (max_sectors == 0) {
+	max_sectors = 1;
+    }
+
+    while (count > 0) {
+	length = min(count, max_sectors);
+
+	memset(&gpcmd, 0, sizeof(gpcmd));
+	fill_read_cd((struct scsi_read_cd *)&gpcmd.cmd, lba, length);
+
+	gpcmd.buffer = (unsigned char *)buffer;
+	gpcmd.buflen = length * sizeof(cueify_raw_read_private);
+	gpcmd.sense = &sense;
+	gpcmd.data_direction = CGC_DATA_READ;
+	gpcmd.timeout = 50000;
+
+	if (send_packet(d, &gpcmd,
+			sizeof(struct scsi_read_cd)) != CUEIFY_OK) {
+	    return CUEIFY_ERR_INTERNAL;
+	}
+
+	lba += length;
+	count -= length;
+	buffer += length;
+    }
+
+    return CUEIFY_OK;
+}  /* cueify_device_read_raw_sectors_unportable */
+
+
+/** Command descriptor block of an asynchronous command. */
+union async_cdb {
+    struct scsi_read_cd read_cd;
+    struct scsi_read_subchannel read_subchannel;
+};
+
+
+/**
+ * Fill in the command descriptor block of an asynchronous command.
+ *
+ * @param c the command to describe
+ * @param scsi_cmd the command descriptor block to fill in
+ * @return the number of bytes in the command descriptor block
+ */
+static size_t fill_async_command(cueify_async_command_private *c,
+				 union async_cdb *scsi_cmd) {
+    memset(scsi_cmd, 0, sizeof(*scsi_cmd));
+
+    if (c->type == ASYNC_READ_RAW) {
+	fill_read_cd(&scsi_cmd->read_cd, c->lba, c->count);
+	return sizeof(scsi_cmd->read_cd);
+    } else {
+	scsi_cmd->read_subchannel.read_subq |= 0x40;  /* SUBQ = 1 */
+	scsi_cmd->read_subchannel.type = IOCTL_CDROM_TRACK_ISRC;
+	scsi_cmd->read_subchannel.track = c->track;
+	scsi_cmd->read_subchannel.data_len[1] = sizeof(c->response);
+	scsi_cmd->read_subchannel.op_code = GPCMD_READ_SUBCHANNEL;
+	return sizeof(scsi_cmd->read_subchannel);
+    }
+}  /* fill_async_command */
+
+
+int cueify_device_issue_unportable(cueify_device_private *d,
+				   cueify_async_command_private *c) {
+    struct sg_io_hdr hdr;
+    union async_cdb scsi_cmd;
+
+    if (d->async_handle < 0) {
+	return CUEIFY_ERR_NO_DEVICE;
+    }
+
+    memset(&hdr, 0, sizeof(hdr));
+    memset(c->sense, 0, sizeof(c->sense));
+
+    hdr.cmd_len = fill_async_command(c, &scsi_cmd);
+    if (c->type == ASYNC_READ_RAW) {
+	hdr.dxferp = c->sectors;
+	hdr.dxfer_len = c->count * sizeof(cueify_raw_read_private);
+    } else {
+	hdr.dxferp = c->response;
+	hdr.dxfer_len = sizeof(c->response);
+    }
+
+    /* The command block is copied by write(); the rest must persist. */
+    hdr.interface_id = 'S';
+    hdr.dxfer_direction = SG_DXFER_FROM_DEV;
+    hdr.cmdp = (unsigned char *)&scsi_cmd;
+    hdr.sbp = c->sense;
+    hdr.mx_sb_len = sizeof(c->sense);
+    hdr.timeout = 50000;
+    hdr.usr_ptr = c;
+
+    if (write(d->async_handle, &hdr, sizeof(hdr)) < 0) {
 	return CUEIFY_ERR_INTERNAL;
     }
+    return CUEIFY_OK;
+}  /* cueify_device_issue_unportable */
+
 
+int cueify_device_reap_unportable(cueify_device_private *d, int wait,
+				  cueify_async_command_private **c) {
+    struct sg_io_hdr hdr;
+    struct pollfd pfd;
+    union async_cdb scsi_cmd;
+    size_t cdb_length;
+    int status = CUEIFY_OK;
+
+    *c = NULL;
+    memset(&hdr, 0, sizeof(hdr));
+    hdr.interface_id = 'S';
+
+    while (read(d->async_handle, &hdr, sizeof(hdr)) < 0) {
+	if (errno == EAGAIN && wait) {
+	    pfd.fd = d->async_handle;
+	    pfd.events = POLLIN;
+	    poll(&pfd, 1, -1);
+	} else if (errno == EAGAIN) {
+	    return CUEIFY_OK;
+	} else if (errno != EINTR) {
+	    /* e.g. the device was removed; nothing more will complete. */
+	    return CUEIFY_ERR_INTERNAL;
+	}
+    }
+
+    *c = (cueify_async_command_private *)hdr.usr_ptr;
+    if ((hdr.info & SG_INFO_OK_MASK) != SG_INFO_OK) {
+	status = CUEIFY_ERR_INTERNAL;
+    }
+
+    /* The command block is gone, so describe the command again. */
+    cdb_length = fill_async_command(*c, &scsi_cmd);
+    (*c)->transferred = cueify_trace_response_length(
+	(uint8_t *)&scsi_cmd, hdr.dxferp, hdr.dxfer_len - hdr.resid);
+
+    if (d->trace != NULL) {
+	cueify_trace_record(d, (uint8_t *)&scsi_cmd, cdb_length,
+			    hdr.dxfer_len, hdr.dxferp, (*c)->sense,
+			    hdr.sb_len_wr, cueify_stats_start(d) - (*c)->start,
+			    status);
+    }
+
+    if (status != CUEIFY_OK) {
+	return status;
+    }
+    if ((*c)->type == ASYNC_READ_ISRC) {
+	return copy_isrc((struct subchannel_isrc *)(*c)->response,
+			 (*c)->isrc, (*c)->isrc_size);
+    }
     return CUEIFY_OK;
-}  /* cueify_device_read_raw_unportable */
+}  /* cueify_device_reap_unportable */
+
+
+void cueify_device_cancel_unportable(cueify_device_private *d) {
+    /*
+     * Commands are issued without SG_FLAG_DIRECT_IO, so their data is
+     * only copied out by read(); closing the handle discards them.
+     */
+    if (d->async_handle >= 0) {
+	close(d->async_handle);
+	d->async_handle = -1;
+    }
+}  /* cueify_device_cancel_unportable */
+
+
+int cueify_device_get_completion_fd_unportable(cueify_device_private *d) {
+    return d->async_handle;
+}  /* cueify_device_get_completion_fd_unportable */
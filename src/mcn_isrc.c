@@ -30,25 +30,41 @@
 #include <cueify/error.h>
 #include "device_private.h"
 #include "mcn_isrc_private.h"
+#include "backend_private.h"
+#include "stats_private.h"
 
 int cueify_device_read_mcn(cueify_device *d, char *buffer, size_t *size) {
     cueify_device_private *dev = (cueify_device_private *)d;
+    uint32_t start;
+    int retval;
 
     if (d == NULL || buffer == NULL || size == NULL) {
 	return CUEIFY_ERR_BADARG;
     }
 
-    return cueify_device_read_mcn_unportable(dev, buffer, size);
+    start = cueify_stats_start(dev);
+    dev->transferred = 0;
+    retval = dev->backend->read_mcn(dev, buffer, size);
+    cueify_stats_record(dev, CUEIFY_COMMAND_READ_SUBCHANNEL, start,
+			dev->transferred, retval);
+    return retval;
 }  /* cueify_device_read_mcn */
 
 
 int cueify_device_read_isrc(cueify_device *d, uint8_t track,
 			    char *buffer, size_t *size) {
     cueify_device_private *dev = (cueify_device_private *)d;
+    uint32_t start;
+    int retval;
 
     if (d == NULL || buffer == NULL || size == NULL) {
 	return CUEIFY_ERR_BADARG;
     }
 
-    return cueify_device_read_isrc_unportable(dev, track, buffer, size);
+    start = cueify_stats_start(dev);
+    dev->transferred = 0;
+    retval = dev->backend->read_isrc(dev, track, buffer, size);
+    cueify_stats_record(dev, CUEIFY_COMMAND_READ_SUBCHANNEL, start,
+			dev->transferred, retval);
+    return retval;
 }  /* cueify_device_read_isrc */
@@ -29,356 +29,187 @@
 #include "charsets.h"
 #include "msjis_tables.h"
 
-char *msjis_to_utf8(uint8_t *msjis, int size)
-{
-    int output_size = 0, i;
-    uint8_t hi, lo;
-    const char * const *table;
-    const char *character;
-    char *output = NULL, *output_ptr;
-
-    if (size < 0) {
-	/* Count output size until we find a terminator/bad char. */
-	output = (char *)msjis;
-	do {
-	    hi = *output++;
-	    lo = *output++;
-	    table = master_table[(unsigned char)hi];
-	    if (table == NULL) {
-		/* Don't know this table! */
-		break;
-	    } else if (table[(unsigned char)lo][0] != '\0') {
-		output_size += strlen(table[(unsigned char)lo]);
-	    }
-	} while (table[(unsigned char)lo] != '\0');
-	/* And also include the terminator. */
-	output_size++;
+/** Get the number of bytes in the UTF-8 encoding of a codepoint.
+ *
+ * @param codepoint the codepoint to encode
+ * @return the number of bytes in the encoding (0 for NUL)
+ */
+static inline size_t utf8_length(uint32_t codepoint) {
+    return (codepoint != 0) + (codepoint > 0x7F) +
+	(codepoint > 0x7FF) + (codepoint > 0xFFFF);
+}  /* utf8_length */
+
+
+/** Encode a (non-NUL) codepoint in UTF-8.
+ *
+ * @param codepoint the codepoint to encode
+ * @param utf8 a pointer to at least 4 bytes to write the encoding to
+ * @return the number of bytes in the encoding
+ */
+static inline size_t utf8_encode(uint32_t codepoint, char *utf8) {
+    if (codepoint <= 0x7F) {
+	utf8[0] = (char)codepoint;
+	return 1;
+    } else if (codepoint <= 0x7FF) {
+	utf8[0] = (char)(0xC0 | (codepoint >> 6));
+	utf8[1] = (char)(0x80 | (codepoint & 0x3F));
+	return 2;
+    } else if (codepoint <= 0xFFFF) {
+	utf8[0] = (char)(0xE0 | (codepoint >> 12));
+	utf8[1] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+	utf8[2] = (char)(0x80 | (codepoint & 0x3F));
+	return 3;
     } else {
-	/* Convert exactly size (wide) characters. */
-	output = (char *)msjis;
-	for (i = 0; i < size; i++) {
-	    hi = *output++;
-	    lo = *output++;
-	    table = master_table[(unsigned char)hi];
-	    if (table == NULL) {
-		/* Don't know this table! */
-		output_size++;
-	    } else if (table[(unsigned char)lo][0] == '\0') {
-		output_size++;
-	    } else {
-		output_size += strlen(table[(unsigned char)lo]);
-	    }
+	utf8[0] = (char)(0xF0 | (codepoint >> 18));
+	utf8[1] = (char)(0x80 | ((codepoint >> 12) & 0x3F));
+	utf8[2] = (char)(0x80 | ((codepoint >> 6) & 0x3F));
+	utf8[3] = (char)(0x80 | (codepoint & 0x3F));
+	return 4;
+    }
+}  /* utf8_encode */
+
+
+/** Translate a single (wide) MS-JIS character to UTF-8.
+ *
+ * Characters are looked up in a dense table of 16-bit codepoints, in
+ * which codepoints beyond 16 bits (and sequences of codepoints) are
+ * escaped with a surrogate indexing codepoint_sequences.
+ *
+ * @param hi the high byte of the MS-JIS character
+ * @param lo the low byte of the MS-JIS character
+ * @param utf8 a pointer to at least MSJIS_CHAR_UTF8_MAX bytes to write
+ *             the encoding to, or NULL to only count them
+ * @return the number of bytes in the encoding (0 if untranslatable)
+ */
+static inline size_t msjis_char_utf8(uint8_t hi, uint8_t lo, char *utf8) {
+    uint16_t value = codepoint_table[codepoint_rows[hi]][lo];
+    const uint32_t *sequence;
+    size_t length = 0;
+    int i;
+
+    if ((value & 0xF800) != 0xD800) {
+	if (value == 0) {
+	    return 0;
+	}
+	return utf8 == NULL ? utf8_length(value) : utf8_encode(value, utf8);
+    }
+
+    /* Escaped into a sequence (or a codepoint beyond 16 bits). */
+    sequence = codepoint_sequences[value - 0xD800];
+    for (i = 0; i < CODEPOINT_SEQUENCE_MAX && sequence[i] != 0; i++) {
+	if (utf8 == NULL) {
+	    length += utf8_length(sequence[i]);
+	} else {
+	    length += utf8_encode(sequence[i], utf8 + length);
 	}
-	/* And also add a terminator. */
-	output_size++;
     }
-    
-    /* Allocate space for the conversion... */
-    output = calloc(output_size, 1);
+    return length;
+}  /* msjis_char_utf8 */
+
+
+char *msjis_to_utf8(uint8_t *msjis, int size)
+{
+    size_t output_size;
+    char *output = NULL;
+
+    /* Allocate exactly enough space for the conversion... */
+    output_size = cueify_msjis_to_utf8_into(msjis, size, NULL, 0);
+    output = malloc(output_size);
     if (output == NULL) {
 	return NULL;
     }
-    output[--output_size] = '\0';
 
     /* Now do the conversion. */
-    output_ptr = output;
-    while (output_size > 0) {
-	hi = *msjis++;
-	lo = *msjis++;
-	table = master_table[(unsigned char)hi];
-	if (table == NULL) {
-	    /* Don't know this table! */
-	    *output_ptr++ = '\0';
-	    output_size--;
-	} else if (table[(unsigned char)lo][0] == '\0') {
-	    *output_ptr++ = '\0';
-	    output_size--;
-	} else {
-	    character = table[(unsigned char)lo];
-	    strcpy(output_ptr, character);
-	    output_ptr += strlen(character);
-	    output_size -= strlen(character);
-	}
-    }
+    cueify_msjis_to_utf8_into(msjis, size, output, output_size);
 
     return output;
-}
+}  /* msjis_to_utf8 */
 
 
-size_t msjis_byte_count(char *utf8) {
-    size_t size = 0;
-    uint8_t *bp = (uint8_t *)utf8;
-    uint8_t hi, mid, lo;
-    uint32_t character;
-    struct multibyte_codepoint codepoint;
-    const struct multibyte_codepoint * const * const *master_table;
-    const struct multibyte_codepoint * const *subtable;
-    const struct multibyte_codepoint *table;
-
-    master_table = reverse_master_table;
-    while (*bp != 0) {
-	character = 0;
-	if (*bp <= 0x7F) {
-	    /* 1-byte codepoint */
-	    character = *bp++;
-	} else if (*bp <= 0xBF) {
-	    /* Invalid codepoint */
-	    character = '?';
-	    bp++;
-	} else if (*bp <= 0xDF) {
-	    /* 2-byte codepoint */
-	    character  = (*bp++ & 0x1F) << 6;
-	    character |= (*bp++ & 0x3F);
-	    if (character <= 0x7F) {
-		character = '?';
+size_t cueify_msjis_to_utf8_into(const uint8_t *msjis, int size,
+				 char *utf8, size_t utf8_size)
+{
+    size_t output_size = 0, length;
+    char character[MSJIS_CHAR_UTF8_MAX];
+    const uint8_t *bp;
+    int i;
+
+    for (i = 0, bp = msjis; size < 0 || i < size; i++, bp += 2) {
+	if (utf8 != NULL &&
+	    output_size + MSJIS_CHAR_UTF8_MAX < utf8_size) {
+	    /* Plenty of room to translate in place. */
+	    length = msjis_char_utf8(bp[0], bp[1], utf8 + output_size);
+	} else if (utf8 != NULL) {
+	    /* Translate aside, and copy it if it fits. */
+	    length = msjis_char_utf8(bp[0], bp[1], character);
+	    if (output_size + length < utf8_size) {
+		memcpy(utf8 + output_size, character, length);
 	    }
-	} else if (*bp <= 0xEF) {
-	    /* 3-byte codepoint */
-	    character  = (*bp++ & 0x0F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	} else if (*bp <= 0xF7) {
-	    /* 4-byte codepoint */
-	    character  = (*bp++ & 0x07) << 18;
-	    character |= (*bp++ & 0x3F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	} else if (*bp <= 0xFB) {
-	    /* 5-byte codepoint */
-	    character  = (*bp++ & 0x03) << 24;
-	    character |= (*bp++ & 0x3F) << 18;
-	    character |= (*bp++ & 0x3F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	} else if (*bp <= 0xFD) {
-	    /* 6-byte codepoint */
-	    character  = (*bp++ & 0x01) << 30;
-	    character |= (*bp++ & 0x3F) << 24;
-	    character |= (*bp++ & 0x3F) << 18;
-	    character |= (*bp++ & 0x3F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	}
-	if (character > 0x10FFFF) {
-	    character = '?';
+	} else {
+	    length = msjis_char_utf8(bp[0], bp[1], NULL);
 	}
 
-	/* Convert the character to MS-JIS (or wait for another
-	 * character I guess) */
-	hi = (character >> 16) & 0xFF;
-	mid = (character >> 8) & 0xFF;
-	lo = character & 0xFF;
-    retry_encoding:
-	if (master_table[hi] == NULL) {
-	    /* No MS-JIS encoding. */
-	    if (codepoint.successor_master_table != NULL) {
-		/* We must have been trying to find a successor. */
-		size++;
-		/* Reset to look at the master table and try again. */
-		codepoint.successor_master_table = NULL;
-		master_table = reverse_master_table;
-		goto retry_encoding;
-	    } else {
-		codepoint = reverse_table0000['?'];
+	if (length == 0) {
+	    if (size < 0) {
+		/* Stop at the terminator (or a bad character). */
+		break;
 	    }
-	} else {
-	    subtable = master_table[hi];
-
-	    if (subtable[mid] == NULL) {
-		/* No MS-JIS encoding. */
-		if (codepoint.successor_master_table != NULL) {
-		    /* We must have been trying to find a successor. */
-		    size++;
-		    /* Reset to look at the master table and try again. */
-		    codepoint.successor_master_table = NULL;
-		    master_table = reverse_master_table;
-		    goto retry_encoding;
-		} else {
-		    codepoint = reverse_table0000['?'];
-		}
-	    } else {
-		table = subtable[mid];
-		if (table[lo].has_encoding == 0 &&
-		    table[lo].successor_master_table == NULL) {
-		    /* No MS-JIS encoding. */
-		    if (codepoint.successor_master_table != NULL) {
-			/* We must have been trying to find a successor. */
-			size++;
-			/* Reset to look at the master table and try again. */
-			codepoint.successor_master_table = NULL;
-			master_table = reverse_master_table;
-			goto retry_encoding;
-		    } else {
-			codepoint = reverse_table0000['?'];
-		    }
-		} else {
-		    codepoint = table[lo];
-		}
+	    /* Untranslatable characters are converted to NUL. */
+	    if (utf8 != NULL && output_size + 1 < utf8_size) {
+		utf8[output_size] = '\0';
 	    }
+	    length = 1;
 	}
-
-	if (codepoint.successor_master_table) {
-	    /* Check the successive character. */
-	    master_table = codepoint.successor_master_table;
-	} else {
-	    size++;
-	    /* Reset to look at the master table again. */
-	    master_table = reverse_master_table;
-	}
+	output_size += length;
     }
-    if (master_table != reverse_master_table) {
-	/* In this case, we must have read one character with no successor. */
-	size++;
+    /* And also add a terminator. */
+    if (utf8 != NULL && output_size < utf8_size) {
+	utf8[output_size] = '\0';
     }
-    /* Include the terminator */
-    size++;
+    output_size++;
+
+    return output_size;
+}  /* cueify_msjis_to_utf8_into */
 
-    return size * 2;  /* 2-byte character set */
+
+size_t msjis_char_to_utf8(uint8_t hi, uint8_t lo, char *utf8) {
+    return msjis_char_utf8(hi, lo, utf8);
+}  /* msjis_char_to_utf8 */
+
+
+size_t msjis_byte_count(char *utf8) {
+    /* Include the terminator */
+    return (charmap_encode(&reverse_charmap, utf8, NULL, 0, 2) + 1) * 2;
 }  /* msjis_byte_count */
 
 
 uint8_t *utf8_to_msjis(char *utf8, size_t *size) {
-    uint8_t *output = NULL, *output_ptr = NULL;
-    uint8_t *bp = (uint8_t *)utf8;
-    uint8_t hi, mid, lo;
-    uint32_t character;
-    struct multibyte_codepoint codepoint;
-    const struct multibyte_codepoint * const * const *master_table;
-    const struct multibyte_codepoint * const *subtable;
-    const struct multibyte_codepoint *table;
+    uint8_t *output = NULL;
 
     *size = (strlen(utf8) + 1) * 2;
     output = malloc(*size);
     if (output == NULL) {
 	return NULL;
     }
-    output_ptr = output;
-
-    master_table = reverse_master_table;
-    while (*bp != 0) {
-	character = 0;
-	if (*bp <= 0x7F) {
-	    /* 1-byte codepoint */
-	    character = *bp++;
-	} else if (*bp <= 0xBF) {
-	    /* Invalid codepoint */
-	    character = '?';
-	    bp++;
-	} else if (*bp <= 0xDF) {
-	    /* 2-byte codepoint */
-	    character  = (*bp++ & 0x1F) << 6;
-	    character |= (*bp++ & 0x3F);
-	    if (character <= 0x7F) {
-		character = '?';
-	    }
-	} else if (*bp <= 0xEF) {
-	    /* 3-byte codepoint */
-	    character  = (*bp++ & 0x0F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	} else if (*bp <= 0xF7) {
-	    /* 4-byte codepoint */
-	    character  = (*bp++ & 0x07) << 18;
-	    character |= (*bp++ & 0x3F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	} else if (*bp <= 0xFB) {
-	    /* 5-byte codepoint */
-	    character  = (*bp++ & 0x03) << 24;
-	    character |= (*bp++ & 0x3F) << 18;
-	    character |= (*bp++ & 0x3F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	} else if (*bp <= 0xFD) {
-	    /* 6-byte codepoint */
-	    character  = (*bp++ & 0x01) << 30;
-	    character |= (*bp++ & 0x3F) << 24;
-	    character |= (*bp++ & 0x3F) << 18;
-	    character |= (*bp++ & 0x3F) << 12;
-	    character |= (*bp++ & 0x3F) << 6;
-	    character |= (*bp++ & 0x3F);
-	}
-	if (character > 0x10FFFF) {
-	    character = '?';
-	}
 
-	/* Convert the character to MS-JIS (or wait for another
-	 * character I guess) */
-	/* TODO: What about successor characters (e.g. variation selectors)? */
-	hi = (character >> 16) & 0xFF;
-	mid = (character >> 8) & 0xFF;
-	lo = character & 0xFF;
-    retry_encoding:
-	if (master_table[hi] == NULL) {
-	    /* No MS-JIS encoding. */
-	    if (codepoint.successor_master_table != NULL) {
-		/* We must have been trying to find a successor. */
-		memcpy(output_ptr, codepoint.value, 2);
-		output_ptr += 2;
-		/* Reset to look at the master table and try again. */
-		codepoint.successor_master_table = NULL;
-		master_table = reverse_master_table;
-		goto retry_encoding;
-	    } else {
-		codepoint = reverse_table0000['?'];
-	    }
-	} else {
-	    subtable = master_table[hi];
-
-	    if (subtable[mid] == NULL) {
-		/* No MS-JIS encoding. */
-		if (codepoint.successor_master_table != NULL) {
-		    /* We must have been trying to find a successor. */
-		    memcpy(output_ptr, codepoint.value, 2);
-		    output_ptr += 2;
-		    /* Reset to look at the master table and try again. */
-		    codepoint.successor_master_table = NULL;
-		    master_table = reverse_master_table;
-		    goto retry_encoding;
-		} else {
-		    codepoint = reverse_table0000['?'];
-		}
-	    } else {
-		table = subtable[mid];
-		if (table[lo].has_encoding == 0 &&
-		    table[lo].successor_master_table == NULL) {
-		    /* No MS-JIS encoding. */
-		    if (codepoint.successor_master_table != NULL) {
-			/* We must have been trying to find a successor. */
-			memcpy(output_ptr, codepoint.value, 2);
-			output_ptr += 2;
-			/* Reset to look at the master table and try again. */
-			codepoint.successor_master_table = NULL;
-			master_table = reverse_master_table;
-			goto retry_encoding;
-		    } else {
-			codepoint = reverse_table0000['?'];
-		    }
-		} else {
-		    codepoint = table[lo];
-		}
-	    }
-	}
-
-	if (codepoint.successor_master_table) {
-	    /* Check the successive character. */
-	    master_table = codepoint.successor_master_table;
-	} else {
-	    memcpy(output_ptr, codepoint.value, 2);
-	    output_ptr += 2;
-	    /* Reset to look at the master table again. */
-	    master_table = reverse_master_table;
-	}
-    }
-    if (master_table != reverse_master_table) {
-	/* In this case, we must have read one character with no successor. */
-	memcpy(output_ptr, codepoint.value, 2);
-	output_ptr += 2;
-    }
-    /* Include the terminator */
-    *output_ptr++ = '\0';
-    *output_ptr = '\0';
-    *size = (output_ptr - output) + 1;
+    *size = cueify_utf8_to_msjis_into(utf8, output, *size);
 
     return output;
 }  /* utf8_to_msjis */
+
+
+size_t cueify_utf8_to_msjis_into(const char *utf8, uint8_t *output,
+				 size_t output_size) {
+    size_t characters;
+
+    /* Leave room for the terminator. */
+    characters = charmap_encode(&reverse_charmap, utf8, output,
+				output_size >= 2 ? output_size / 2 - 1 : 0, 2);
+    if (output != NULL && (characters + 1) * 2 <= output_size) {
+	output[characters * 2] = '\0';
+	output[characters * 2 + 1] = '\0';
+    }
+
+    /* Include the terminator */
+    return (characters + 1) * 2;
+}  /* cueify_utf8_to_msjis_into */
@@ -0,0 +1,323 @@
+/* sector_cache.c - Raw sector cache for optical disc devices
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <cueify/device.h>
+#include <cueify/error.h>
+#include "device_private.h"
+#include "sector_cache_private.h"
+#include "backend_private.h"
+#include "stats_private.h"
+
+/** Return the hash bucket of an LBA in a sector cache. */
+#define BUCKET(c, lba)  (((lba) * 2654435761U) & ((c)->num_buckets - 1))
+
+/**
+ * Find a sector in a sector cache.
+ *
+ * @param cache the sector cache to search
+ * @param lba the address of the sector to find
+ * @return the index of the entry holding the sector, or NO_ENTRY if
+ *         the sector is not cached
+ */
+static uint32_t cache_find(cueify_sector_cache_private *cache, uint32_t lba) {
+    uint32_t entry = cache->buckets[BUCKET(cache, lba)];
+
+    while (entry != NO_ENTRY && cache->entries[entry].lba != lba) {
+	entry = cache->entries[entry].hash_next;
+    }
+    return entry;
+}  /* cache_find */
+
+
+/**
+ * Remove an entry from the LRU list of a sector cache.
+ *
+ * @param cache the sector cache to modify
+ * @param entry the index of the entry to remove
+ */
+static void lru_unlink(cueify_sector_cache_private *cache, uint32_t entry) {
+    cueify_sector_cache_entry_private *e = &cache->entries[entry];
+
+    if (e->lru_prev != NO_ENTRY) {
+	cache->entries[e->lru_prev].lru_next = e->lru_next;
+    } else {
+	cache->lru_head = e->lru_next;
+    }
+    if (e->lru_next != NO_ENTRY) {
+	cache->entries[e->lru_next].lru_prev = e->lru_prev;
+    } else {
+	cache->lru_tail = e->lru_prev;
+    }
+}  /* lru_unlink */
+
+
+/**
+ * Make an entry the most recently used entry of a sector cache.
+ *
+ * @param cache the sector cache to modify
+ * @param entry the index of the entry, which must not be in the LRU list
+ */
+static void lru_push(cueify_sector_cache_private *cache, uint32_t entry) {
+    cueify_sector_cache_entry_private *e = &cache->entries[entry];
+
+    e->lru_prev = NO_ENTRY;
+    e->lru_next = cache->lru_head;
+    if (cache->lru_head != NO_ENTRY) {
+	cache->entries[cache->lru_head].lru_prev = entry;
+    } else {
+	cache->lru_tail = entry;
+    }
+    cache->lru_head = entry;
+}  /* lru_push */
+
+
+/**
+ * Remove an entry from its hash bucket in a sector cache.
+ *
+ * @param cache the sector cache to modify
+ * @param entry the index of the entry to remove
+ */
+static void hash_unlink(cueify_sector_cache_private *cache, uint32_t entry) {
+    uint32_t *link = &cache->buckets[BUCKET(cache,
+					      cache->entries[entry].lba)];
+
+    while (*link != entry) {
+	link = &cache->entries[*link].hash_next;
+    }
+    *link = cache->entries[entry].hash_next;
+}  /* hash_unlink */
+
+
+/**
+ * Store a sector in a sector cache, evicting the least recently used
+ * sector if the cache is full.
+ *
+ * @param cache the sector cache to store the sector in
+ * @param lba the address of the sector
+ * @param sector the raw sector to store
+ */
+static void cache_insert(cueify_sector_cache_private *cache, uint32_t lba,
+			 const cueify_raw_read_private *sector) {
+    uint32_t entry, bucket;
+
+    entry = cache_find(cache, lba);
+    if (entry != NO_ENTRY) {
+	/* Already cached; refresh it. */
+	lru_unlink(cache, entry);
+    } else {
+	if (cache->used < cache->capacity) {
+	    entry = cache->used++;
+	} else {
+	    entry = cache->lru_tail;
+	    lru_unlink(cache, entry);
+	    hash_unlink(cache, entry);
+	}
+	bucket = BUCKET(cache, lba);
+	cache->entries[entry].lba = lba;
+	cache->entries[entry].hash_next = cache->buckets[bucket];
+	cache->buckets[bucket] = entry;
+    }
+
+    memcpy(&cache->entries[entry].sector, sector,
+	   sizeof(cueify_raw_read_private));
+    lru_push(cache, entry);
+}  /* cache_insert */
+
+
+/**
+ * Read contiguous raw sectors from a device, counting the command.
+ *
+ * @param d the device handle to read from
+ * @param lba the address of the first sector to read
+ * @param count the number of sectors to read
+ * @param buffer an array of at least count raw sectors to read into
+ * @return CUEIFY_OK if the read succeeded; otherwise an error code
+ */
+static int read_device(cueify_device_private *d, uint32_t lba,
+		       uint32_t count, cueify_raw_read_private *buffer) {
+    uint32_t start = cueify_stats_start(d);
+    int retval;
+
+    d->transferred = 0;
+    retval = d->backend->read_raw_sectors(d, lba, count, buffer);
+    if (retval == CUEIFY_OK &&
+	d->transferred < count * sizeof(cueify_raw_read_private)) {
+	/* The rest of the buffer holds no sectors. */
+	retval = CUEIFY_ERR_INTERNAL;
+    }
+    cueify_stats_record(d, CUEIFY_COMMAND_READ_CD, start, d->transferred,
+			retval);
+    return retval;
+}  /* read_device */
+
+
+int cueify_sector_cache_read(cueify_device_private *d, uint32_t lba,
+			     uint32_t count, cueify_raw_read_private *buffer) {
+    cueify_sector_cache_private *cache = d->cache;
+    cueify_raw_read_private *ahead_buffer;
+    uint32_t i, j, run, ahead, entry;
+
+    if (cache == NULL) {
+	return read_device(d, lba, count, buffer);
+    }
+
+    for (i = 0; i < count; i += run) {
+	entry = cache_find(cache, lba + i);
+	if (entry != NO_ENTRY) {
+	    memcpy(&buffer[i], &cache->entries[entry].sector,
+		   sizeof(cueify_raw_read_private));
+	    lru_unlink(cache, entry);
+	    lru_push(cache, entry);
+	    cache->hits++;
+	    run = 1;
+	    continue;
+	}
+
+	/* Read the whole run of uncached sectors with one command. */
+	for (run = 1;
+	     i + run < count && cache_find(cache, lba + i + run) == NO_ENTRY;
+	     run++);
+	cache->misses += run;
+
+	/* Read ahead only as far as will fit in the cache. */
+	ahead = cache->read_ahead;
+	if (run + ahead > cache->capacity) {
+	    ahead = (run < cache->capacity) ? cache->capacity - run : 0;
+	}
+	if (ahead > 0) {
+	    ahead_buffer = malloc((run + ahead) *
+				  sizeof(cueify_raw_read_private));
+	    if (ahead_buffer != NULL &&
+		read_device(d, lba + i, run + ahead,
+			    ahead_buffer) == CUEIFY_OK) {
+		memcpy(&buffer[i], ahead_buffer,
+		       run * sizeof(cueify_raw_read_private));
+		for (j = 0; j < run + ahead; j++) {
+		    cache_insert(cache, lba + i + j, &ahead_buffer[j]);
+		}
+		free(ahead_buffer);
+		continue;
+	    }
+	    /* The read-ahead may run past the end of the disc; retry without. */
+	    free(ahead_buffer);
+	}
+
+	if (read_device(d, lba + i, run, &buffer[i]) != CUEIFY_OK) {
+	    return CUEIFY_ERR_INTERNAL;
+	}
+	for (j = 0; j < run; j++) {
+	    cache_insert(cache, lba + i + j, &buffer[i + j]);
+	}
+    }
+
+    return CUEIFY_OK;
+}  /* cueify_sector_cache_read */
+
+
+void cueify_sector_cache_flush(cueify_device_private *d) {
+    cueify_sector_cache_private *cache = d->cache;
+
+    if (cache == NULL) {
+	return;
+    }
+
+    memset(cache->buckets, 0xFF, cache->num_buckets * sizeof(uint32_t));
+    cache->used = 0;
+    cache->lru_head = NO_ENTRY;
+    cache->lru_tail = NO_ENTRY;
+}  /* cueify_sector_cache_flush */
+
+
+void cueify_sector_cache_free(cueify_device_private *d) {
+    if (d->cache != NULL) {
+	free(d->cache->buckets);
+	free(d->cache->entries);
+	free(d->cache);
+	d->cache = NULL;
+    }
+}  /* cueify_sector_cache_free */
+
+
+int cueify_device_set_sector_cache(cueify_device *d, uint32_t capacity,
+				   uint32_t read_ahead) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+    cueify_sector_cache_private *cache;
+
+    if (d == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    cueify_sector_cache_free(dev);
+    if (capacity == 0) {
+	return CUEIFY_OK;
+    }
+
+    cache = calloc(1, sizeof(cueify_sector_cache_private));
+    if (cache == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    /* Keep the hash chains short: at least two buckets per entry. */
+    for (cache->num_buckets = 1;
+	 cache->num_buckets < capacity * 2 && cache->num_buckets < 0x80000000;
+	 cache->num_buckets <<= 1);
+    cache->buckets = malloc(cache->num_buckets * sizeof(uint32_t));
+    cache->entries = malloc(capacity *
+			    sizeof(cueify_sector_cache_entry_private));
+    if (cache->buckets == NULL || cache->entries == NULL) {
+	free(cache->buckets);
+	free(cache->entries);
+	free(cache);
+	return CUEIFY_ERR_NOMEM;
+    }
+    cache->capacity = capacity;
+    cache->read_ahead = read_ahead;
+
+    dev->cache = cache;
+    cueify_sector_cache_flush(dev);
+
+    return CUEIFY_OK;
+}  /* cueify_device_set_sector_cache */
+
+
+int cueify_device_get_sector_cache_stats(cueify_device *d, uint32_t *hits,
+					 uint32_t *misses) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+
+    if (d == NULL || hits == NULL || misses == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    if (dev->cache == NULL) {
+	*hits = 0;
+	*misses = 0;
+    } else {
+	*hits = dev->cache->hits;
+	*misses = dev->cache->misses;
+    }
+
+    return CUEIFY_OK;
+}  /* cueify_device_get_sector_cache_stats */
@@ -0,0 +1,94 @@
+/* sector_cache_private.h - Private raw sector cache API
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CUEIFY_SECTOR_CACHE_PRIVATE_H
+#define _CUEIFY_SECTOR_CACHE_PRIVATE_H
+
+#include <cueify/types.h>
+#include "device_private.h"
+
+/** Marker for the absence of an entry in the sector cache. */
+#define NO_ENTRY  0xFFFFFFFF
+
+/** Internal structure to hold a cached raw sector. */
+typedef struct {
+    uint32_t lba;  /** Address of the cached sector. */
+    uint32_t hash_next;  /** Next entry in the same hash bucket. */
+    uint32_t lru_prev;  /** Next more recently used entry. */
+    uint32_t lru_next;  /** Next less recently used entry. */
+    cueify_raw_read_private sector;  /** The cached raw sector. */
+} cueify_sector_cache_entry_private;
+
+
+/** Internal structure to hold the raw sector cache of a device. */
+typedef struct cueify_sector_cache_private {
+    uint32_t capacity;  /** Maximum number of sectors to cache. */
+    /** Number of additional sectors to read after a cache miss. */
+    uint32_t read_ahead;
+    uint32_t used;  /** Number of entries in use. */
+    uint32_t num_buckets;  /** Number of hash buckets (a power of 2). */
+    uint32_t *buckets;  /** First entry in each hash bucket. */
+    uint32_t lru_head;  /** Most recently used entry. */
+    uint32_t lru_tail;  /** Least recently used entry. */
+    uint32_t hits;  /** Number of sectors served from the cache. */
+    uint32_t misses;  /** Number of sectors read from the device. */
+    cueify_sector_cache_entry_private *entries;  /** The cached sectors. */
+} cueify_sector_cache_private;
+
+
+/**
+ * Read contiguous raw sectors from a device, serving as many as
+ * possible from the sector cache of the device, and reading the rest
+ * (plus any read-ahead) into the cache.  If the device has no sector
+ * cache, this is equivalent to
+ * cueify_device_read_raw_sectors_unportable().
+ *
+ * @param d the cueify device handle to read from
+ * @param lba the absolute address (LBA) of the first sector to read
+ * @param count the number of sectors to read
+ * @param buffer an array of at least count raw sectors to read into
+ * @return CUEIFY_OK if the read succeeded; otherwise, an appropriate error code.
+ */
+int cueify_sector_cache_read(cueify_device_private *d, uint32_t lba,
+			     uint32_t count, cueify_raw_read_private *buffer);
+
+
+/**
+ * Discard every sector in the sector cache of a device, keeping its
+ * configuration and counters.
+ *
+ * @param d the device handle whose sector cache should be emptied
+ */
+void cueify_sector_cache_flush(cueify_device_private *d);
+
+
+/**
+ * Free the sector cache of a device, if any.
+ *
+ * @param d the device handle whose sector cache should be freed
+ */
+void cueify_sector_cache_free(cueify_device_private *d);
+
+#endif  /* _CUEIFY_SECTOR_CACHE_PRIVATE_H */
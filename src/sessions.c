@@ -30,6 +30,7 @@
 #include <cueify/error.h>
 #include "device_private.h"
 #include "sessions_private.h"
+#include "disc_private.h"
 
 cueify_sessions *cueify_sessions_new() {
     return calloc(1, sizeof(cueify_sessions_private));
@@ -39,14 +40,22 @@ cueify_sessions *cueify_sessions_new() {
 int cueify_device_read_sessions(cueify_device *d, cueify_sessions *s) {
     cueify_device_private *dev = (cueify_device_private *)d;
     cueify_sessions_private *sessions = (cueify_sessions_private *)s;
+    cueify_sessions_private *cached;
+    int retval;
 
     if (d == NULL || s == NULL) {
 	return CUEIFY_ERR_BADARG;
     }
 
-    memset(sessions, 0, sizeof(cueify_sessions_private));
+    cueify_device_check_media(dev);
+    retval = cueify_disc_get_sessions(dev, &cached);
+    if (retval != CUEIFY_OK) {
+	memset(sessions, 0, sizeof(cueify_sessions_private));
+	return retval;
+    }
+    memcpy(sessions, cached, sizeof(cueify_sessions_private));
 
-    return cueify_device_read_sessions_unportable(dev, sessions);
+    return CUEIFY_OK;
 }  /* cueify_device_read_sessions */
 
 
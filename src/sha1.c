@@ -76,29 +76,52 @@ A million repetitions of "a"
   34AA973C D4C4DAA4 F61EEB2B DBAD2731 6534016F
 */
 
-/* #define SHA1HANDSOFF  */
-
 #include <stdio.h>
 #include <string.h>
 #include <cueify/types.h>
 
 #include "sha1.h"
 
-void cueify_sha1_transform(uint32_t state[5], const uint8_t buffer[64]);
+#if defined(__GNUC__) && defined(__x86_64__)
+#define SHA1_ALGO_SHANI 1
+#include <immintrin.h>
+#endif
+
+#if defined(__GNUC__) && defined(__aarch64__) && defined(__linux__)
+#define SHA1_ALGO_ARMV8 1
+#include <arm_neon.h>
+#include <sys/auxv.h>
+#include <asm/hwcap.h>
+#ifdef __clang__
+#define SHA1_TARGET_ARMV8 __attribute__((target("crypto")))
+#else
+#define SHA1_TARGET_ARMV8 __attribute__((target("+crypto")))
+#endif
+#endif
+
+#ifdef __GNUC__
+/* Vectors of one word from each of several messages. */
+#define SHA1_ALGO_LANES 1
+typedef uint32_t sha1_lanes4 __attribute__((vector_size(16)));
+#ifdef SHA1_ALGO_SHANI
+#define SHA1_ALGO_AVX2 1
+#define SHA1_ALGO_AVX512 1
+typedef uint32_t sha1_lanes8 __attribute__((vector_size(32)));
+typedef uint32_t sha1_lanes16 __attribute__((vector_size(64)));
+#endif
+#endif
 
 #define rol(value, bits) (((value) << (bits)) | ((value) >> (32 - (bits))))
 
 /* blk0() and blk() perform the initial expand. */
 /* I got the idea of expanding during the round function from SSLeay */
-/* FIXME: can we do this in an endian-proof way? */
-#ifdef WORDS_BIGENDIAN
-#define blk0(i) block->l[i]
-#else
-#define blk0(i) (block->l[i] = (rol(block->l[i],24)&0xFF00FF00) \
-    |(rol(block->l[i],8)&0x00FF00FF))
-#endif
-#define blk(i) (block->l[i&15] = rol(block->l[(i+13)&15]^block->l[(i+8)&15] \
-    ^block->l[(i+2)&15]^block->l[i&15],1))
+/* blk0() reads the big-endian words a byte at a time, so the buffer
+   needs no alignment and is left as it was. */
+#define blk0(i) (block[i] = ((uint32_t)buffer[4*(i)] << 24) \
+    |((uint32_t)buffer[4*(i)+1] << 16)|((uint32_t)buffer[4*(i)+2] << 8) \
+    |buffer[4*(i)+3])
+#define blk(i) (block[i&15] = rol(block[(i+13)&15]^block[(i+8)&15] \
+    ^block[(i+2)&15]^block[i&15],1))
 
 /* (R0+R1), R2, R3, R4 are the different operations used in SHA1 */
 #define R0(v,w,x,y,z,i) z+=((w&(x^y))^y)+blk0(i)+0x5A827999+rol(v,5);w=rol(w,30);
@@ -107,6 +130,11 @@ void cueify_sha1_transform(uint32_t state[5], const uint8_t buffer[64]);
 #define R3(v,w,x,y,z,i) z+=(((w|x)&y)|(w&x))+blk(i)+0x8F1BBCDC+rol(v,5);w=rol(w,30);
 #define R4(v,w,x,y,z,i) z+=(w^x^y)+blk(i)+0xCA62C1D6+rol(v,5);w=rol(w,30);
 
+/* The round functions on their own, for the other implementations. */
+#define F0(w,x,y) ((w&(x^y))^y)
+#define F1(w,x,y) (w^x^y)
+#define F2(w,x,y) (((w|x)&y)|(w&x))
+
 
 #ifdef VERBOSE  /* SAK */
 void cueify_sha_print_context(SHA1_CTX *context, char *msg){
@@ -122,22 +150,12 @@ void cueify_sha_print_context(SHA1_CTX *context, char *msg){
 #endif /* VERBOSE */
 
 /* Hash a single 512-bit block. This is the core of the algorithm. */
-void cueify_sha1_transform(uint32_t state[5], const uint8_t buffer[64])
+static void cueify_sha1_transform_generic(uint32_t state[5],
+					  const uint8_t buffer[64])
 {
     uint32_t a, b, c, d, e;
-    typedef union {
-        uint8_t c[64];
-        uint32_t l[16];
-    } CHAR64LONG16;
-    CHAR64LONG16* block;
-
-#ifdef SHA1HANDSOFF
-    static uint8_t workspace[64];
-    block = (CHAR64LONG16*)workspace;
-    memcpy(block, buffer, 64);
-#else
-    block = (CHAR64LONG16*)buffer;
-#endif
+    /* The expanded message lives here, not in the caller's buffer. */
+    uint32_t block[16];
 
     /* Copy context->state[] to working vars */
     a = state[0];
@@ -177,6 +195,381 @@ void cueify_sha1_transform(uint32_t state[5], const uint8_t buffer[64])
 
     /* Wipe variables */
     a = b = c = d = e = 0;
+    memset(block, 0, sizeof(block));
+}
+
+
+#ifdef SHA1_ALGO_SHANI
+/* Four rounds of SHA-NI, scheduling the message words 16 rounds ahead. */
+#define SHANI4(e, e_next, m0, m1, m2, m3, f) \
+    e = _mm_sha1nexte_epu32(e, m0); \
+    e_next = abcd; \
+    m1 = _mm_sha1msg2_epu32(m1, m0); \
+    abcd = _mm_sha1rnds4_epu32(abcd, e, f); \
+    m3 = _mm_sha1msg1_epu32(m3, m0); \
+    m2 = _mm_xor_si128(m2, m0);
+
+/* Hash a single 512-bit block with the x86 SHA extensions. */
+__attribute__((target("sha,sse4.1")))
+static void cueify_sha1_transform_shani(uint32_t state[5],
+					const uint8_t buffer[64])
+{
+    const __m128i mask = _mm_set_epi64x(0x0001020304050607ULL,
+					0x08090a0b0c0d0e0fULL);
+    __m128i abcd, abcd_save, e0, e0_save, e1;
+    __m128i msg0, msg1, msg2, msg3;
+
+    /* The rounds want a in the top lane and e on its own. */
+    abcd = _mm_shuffle_epi32(_mm_loadu_si128((const __m128i *)state), 0x1B);
+    e0 = _mm_set_epi32((int)state[4], 0, 0, 0);
+    abcd_save = abcd;
+    e0_save = e0;
+
+    msg0 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)buffer), mask);
+    msg1 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buffer + 16)),
+			    mask);
+    msg2 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buffer + 32)),
+			    mask);
+    msg3 = _mm_shuffle_epi8(_mm_loadu_si128((const __m128i *)(buffer + 48)),
+			    mask);
+
+    /* Rounds 0-11 start the message schedule. */
+    e0 = _mm_add_epi32(e0, msg0);
+    e1 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+
+    e1 = _mm_sha1nexte_epu32(e1, msg1);
+    e0 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e1, 0);
+    msg0 = _mm_sha1msg1_epu32(msg0, msg1);
+
+    e0 = _mm_sha1nexte_epu32(e0, msg2);
+    e1 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, 0);
+    msg1 = _mm_sha1msg1_epu32(msg1, msg2);
+    msg0 = _mm_xor_si128(msg0, msg2);
+
+    /* Rounds 12-67 */
+    SHANI4(e1, e0, msg3, msg0, msg1, msg2, 0);
+    SHANI4(e0, e1, msg0, msg1, msg2, msg3, 0);
+    SHANI4(e1, e0, msg1, msg2, msg3, msg0, 1);
+    SHANI4(e0, e1, msg2, msg3, msg0, msg1, 1);
+    SHANI4(e1, e0, msg3, msg0, msg1, msg2, 1);
+    SHANI4(e0, e1, msg0, msg1, msg2, msg3, 1);
+    SHANI4(e1, e0, msg1, msg2, msg3, msg0, 1);
+    SHANI4(e0, e1, msg2, msg3, msg0, msg1, 2);
+    SHANI4(e1, e0, msg3, msg0, msg1, msg2, 2);
+    SHANI4(e0, e1, msg0, msg1, msg2, msg3, 2);
+    SHANI4(e1, e0, msg1, msg2, msg3, msg0, 2);
+    SHANI4(e0, e1, msg2, msg3, msg0, msg1, 2);
+    SHANI4(e1, e0, msg3, msg0, msg1, msg2, 3);
+    SHANI4(e0, e1, msg0, msg1, msg2, msg3, 3);
+
+    /* Rounds 68-79 finish the message schedule. */
+    e1 = _mm_sha1nexte_epu32(e1, msg1);
+    e0 = abcd;
+    msg2 = _mm_sha1msg2_epu32(msg2, msg1);
+    abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+    msg3 = _mm_xor_si128(msg3, msg1);
+
+    e0 = _mm_sha1nexte_epu32(e0, msg2);
+    e1 = abcd;
+    msg3 = _mm_sha1msg2_epu32(msg3, msg2);
+    abcd = _mm_sha1rnds4_epu32(abcd, e0, 3);
+
+    e1 = _mm_sha1nexte_epu32(e1, msg3);
+    e0 = abcd;
+    abcd = _mm_sha1rnds4_epu32(abcd, e1, 3);
+
+    /* Add the working vars back into state[] */
+    e0 = _mm_sha1nexte_epu32(e0, e0_save);
+    abcd = _mm_add_epi32(abcd, abcd_save);
+    _mm_storeu_si128((__m128i *)state, _mm_shuffle_epi32(abcd, 0x1B));
+    state[4] = (uint32_t)_mm_extract_epi32(e0, 3);
+}
+#endif
+
+
+#ifdef SHA1_ALGO_ARMV8
+/* Four rounds of the ARMv8 SHA1 extension, scheduling 16 rounds ahead. */
+#define ARMV8_4(op, e, e_next, tmp, k, m0, m1, m2, m3) \
+    e_next = vsha1h_u32(vgetq_lane_u32(abcd, 0)); \
+    abcd = op(abcd, e, tmp); \
+    tmp = vaddq_u32(m2, k); \
+    m3 = vsha1su1q_u32(m3, m2); \
+    m0 = vsha1su0q_u32(m0, m1, m2);
+
+/* Hash a single 512-bit block with the ARMv8 SHA1 extension. */
+SHA1_TARGET_ARMV8
+static void cueify_sha1_transform_armv8(uint32_t state[5],
+					const uint8_t buffer[64])
+{
+    const uint32x4_t k0 = vdupq_n_u32(0x5A827999);
+    const uint32x4_t k1 = vdupq_n_u32(0x6ED9EBA1);
+    const uint32x4_t k2 = vdupq_n_u32(0x8F1BBCDC);
+    const uint32x4_t k3 = vdupq_n_u32(0xCA62C1D6);
+    uint32x4_t abcd, abcd_save, tmp0, tmp1;
+    uint32x4_t msg0, msg1, msg2, msg3;
+    uint32_t e0, e0_save, e1;
+
+    abcd = vld1q_u32(state);
+    e0 = state[4];
+    abcd_save = abcd;
+    e0_save = e0;
+
+    msg0 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(buffer)));
+    msg1 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(buffer + 16)));
+    msg2 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(buffer + 32)));
+    msg3 = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(buffer + 48)));
+    tmp0 = vaddq_u32(msg0, k0);
+    tmp1 = vaddq_u32(msg1, k0);
+
+    /* Rounds 0-3 start the message schedule. */
+    e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+    abcd = vsha1cq_u32(abcd, e0, tmp0);
+    tmp0 = vaddq_u32(msg2, k0);
+    msg0 = vsha1su0q_u32(msg0, msg1, msg2);
+
+    /* Rounds 4-63 */
+    ARMV8_4(vsha1cq_u32, e1, e0, tmp1, k0, msg1, msg2, msg3, msg0);
+    ARMV8_4(vsha1cq_u32, e0, e1, tmp0, k0, msg2, msg3, msg0, msg1);
+    ARMV8_4(vsha1cq_u32, e1, e0, tmp1, k1, msg3, msg0, msg1, msg2);
+    ARMV8_4(vsha1cq_u32, e0, e1, tmp0, k1, msg0, msg1, msg2, msg3);
+    ARMV8_4(vsha1pq_u32, e1, e0, tmp1, k1, msg1, msg2, msg3, msg0);
+    ARMV8_4(vsha1pq_u32, e0, e1, tmp0, k1, msg2, msg3, msg0, msg1);
+    ARMV8_4(vsha1pq_u32, e1, e0, tmp1, k1, msg3, msg0, msg1, msg2);
+    ARMV8_4(vsha1pq_u32, e0, e1, tmp0, k2, msg0, msg1, msg2, msg3);
+    ARMV8_4(vsha1pq_u32, e1, e0, tmp1, k2, msg1, msg2, msg3, msg0);
+    ARMV8_4(vsha1mq_u32, e0, e1, tmp0, k2, msg2, msg3, msg0, msg1);
+    ARMV8_4(vsha1mq_u32, e1, e0, tmp1, k2, msg3, msg0, msg1, msg2);
+    ARMV8_4(vsha1mq_u32, e0, e1, tmp0, k2, msg0, msg1, msg2, msg3);
+    ARMV8_4(vsha1mq_u32, e1, e0, tmp1, k3, msg1, msg2, msg3, msg0);
+    ARMV8_4(vsha1mq_u32, e0, e1, tmp0, k3, msg2, msg3, msg0, msg1);
+    ARMV8_4(vsha1pq_u32, e1, e0, tmp1, k3, msg3, msg0, msg1, msg2);
+
+    /* Rounds 64-79 finish the message schedule. */
+    e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+    abcd = vsha1pq_u32(abcd, e0, tmp0);
+    tmp0 = vaddq_u32(msg2, k3);
+    msg3 = vsha1su1q_u32(msg3, msg2);
+
+    e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+    abcd = vsha1pq_u32(abcd, e1, tmp1);
+    tmp1 = vaddq_u32(msg3, k3);
+
+    e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+    abcd = vsha1pq_u32(abcd, e0, tmp0);
+
+    e0 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+    abcd = vsha1pq_u32(abcd, e1, tmp1);
+
+    /* Add the working vars back into state[] */
+    vst1q_u32(state, vaddq_u32(abcd, abcd_save));
+    state[4] = e0 + e0_save;
+}
+#endif
+
+
+size_t cueify_sha1_get_transforms(SHA1_TRANSFORM *transforms)
+{
+    size_t count = 0;
+
+    /* Fastest first. */
+#ifdef SHA1_ALGO_ARMV8
+    if (getauxval(AT_HWCAP) & HWCAP_SHA1) {
+	transforms[count].name = "armv8";
+	transforms[count++].transform = cueify_sha1_transform_armv8;
+    }
+#endif
+#ifdef SHA1_ALGO_SHANI
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("sha") && __builtin_cpu_supports("sse4.1")) {
+	transforms[count].name = "sha-ni";
+	transforms[count++].transform = cueify_sha1_transform_shani;
+    }
+#endif
+    transforms[count].name = "generic";
+    transforms[count++].transform = cueify_sha1_transform_generic;
+
+    return count;
+}
+
+
+/* Forwards the first call of cueify_sha1_transform() after choosing. */
+static void cueify_sha1_transform_first(uint32_t state[5],
+					const uint8_t buffer[64]);
+
+
+/* The implementation of cueify_sha1_transform() chosen for this processor. */
+static void (*cueify_sha1_transform_impl)(uint32_t state[5],
+					  const uint8_t buffer[64]) =
+    cueify_sha1_transform_first;
+
+/* Threads may race to choose, so the choice is stored atomically. */
+#ifdef __GNUC__
+#define load_impl() __atomic_load_n(&cueify_sha1_transform_impl, \
+				    __ATOMIC_RELAXED)
+#define store_impl(impl) __atomic_store_n(&cueify_sha1_transform_impl, \
+					  impl, __ATOMIC_RELAXED)
+#else
+#define load_impl() cueify_sha1_transform_impl
+#define store_impl(impl) (cueify_sha1_transform_impl = impl)
+#endif
+
+
+static void cueify_sha1_transform_first(uint32_t state[5],
+					const uint8_t buffer[64])
+{
+    SHA1_TRANSFORM transforms[SHA1_MAX_TRANSFORMS];
+
+    /* Every thread racing here chooses the same implementation. */
+    cueify_sha1_get_transforms(transforms);
+    store_impl(transforms[0].transform);
+    transforms[0].transform(state, buffer);
+}
+
+
+void cueify_sha1_transform(uint32_t state[5], const uint8_t buffer[64])
+{
+    load_impl()(state, buffer);
+}
+
+
+/* Hash one block of a single message, as a one-lane transform. */
+static void cueify_sha1_transform_lanes1(uint32_t *state,
+					 const uint8_t * const *blocks)
+{
+    cueify_sha1_transform(state, blocks[0]);
+}
+
+
+#ifdef SHA1_ALGO_LANES
+/* Read a big-endian word from a buffer with no alignment. */
+static inline uint32_t load_be32(const uint8_t *buffer)
+{
+    return ((uint32_t)buffer[0] << 24) | ((uint32_t)buffer[1] << 16) |
+	((uint32_t)buffer[2] << 8) | buffer[3];
+}
+
+/* As blk(), on the message words of every lane. */
+#define LBLK(i) ((i) < 16 ? block[i] : (block[(i)&15] = \
+    rol(block[((i)+13)&15]^block[((i)+8)&15]^block[((i)+2)&15] \
+	^block[(i)&15],1)))
+
+/* A round in every lane, given its function and K. */
+#define LR(f,k,v,w,x,y,z,i) z+=f(w,x,y)+LBLK(i)+k+rol(v,5);w=rol(w,30);
+
+/* Twenty rounds in every lane, from round i. */
+#define LR20(f,k,i) \
+    _Pragma("GCC unroll 4") for (j = i; j < i + 20; j += 5) { \
+	LR(f,k,a,b,c,d,e,j); LR(f,k,e,a,b,c,d,j+1); LR(f,k,d,e,a,b,c,j+2); \
+	LR(f,k,c,d,e,a,b,j+3); LR(f,k,b,c,d,e,a,j+4); \
+    }
+
+/*
+ * Define a transform hashing one block of each of as many messages as
+ * a vector (of type lanes) has lanes, one message to a lane.
+ */
+#define LANES_TRANSFORM(name, lanes) \
+static void name(uint32_t *state, const uint8_t * const *blocks) \
+{ \
+    enum { LANES = sizeof(lanes) / sizeof(uint32_t) }; \
+    uint32_t words[16][LANES]; \
+    lanes a, b, c, d, e, block[16], saved[5]; \
+    int i, j; \
+ \
+    for (i = 0; i < 16; i++) { \
+	for (j = 0; j < LANES; j++) { \
+	    words[i][j] = load_be32(blocks[j] + i * 4); \
+	} \
+	memcpy(&block[i], words[i], sizeof(lanes)); \
+    } \
+    memcpy(saved, state, sizeof(saved)); \
+    a = saved[0]; \
+    b = saved[1]; \
+    c = saved[2]; \
+    d = saved[3]; \
+    e = saved[4]; \
+ \
+    LR20(F0, 0x5A827999, 0); \
+    LR20(F1, 0x6ED9EBA1, 20); \
+    LR20(F2, 0x8F1BBCDC, 40); \
+    LR20(F1, 0xCA62C1D6, 60); \
+ \
+    saved[0] += a; \
+    saved[1] += b; \
+    saved[2] += c; \
+    saved[3] += d; \
+    saved[4] += e; \
+    memcpy(state, saved, sizeof(saved)); \
+}
+
+/* Hash one block of each of four messages with (e.g. SSE2 or NEON) vectors. */
+LANES_TRANSFORM(cueify_sha1_transform_lanes4, sha1_lanes4)
+#endif
+
+#ifdef SHA1_ALGO_AVX2
+/* Hash one block of each of eight messages with AVX2. */
+__attribute__((target("avx2")))
+LANES_TRANSFORM(cueify_sha1_transform_avx2, sha1_lanes8)
+#endif
+
+#ifdef SHA1_ALGO_AVX512
+/* Hash one block of each of sixteen messages with AVX-512. */
+__attribute__((target("avx512f")))
+LANES_TRANSFORM(cueify_sha1_transform_avx512, sha1_lanes16)
+#endif
+
+
+size_t cueify_sha1_get_lanes_transforms(SHA1_LANES_TRANSFORM *transforms)
+{
+    SHA1_TRANSFORM single[SHA1_MAX_TRANSFORMS];
+    size_t count = 0;
+    int hardware;
+
+    /* Fastest first. */
+#if defined(SHA1_ALGO_AVX2) || defined(SHA1_ALGO_AVX512)
+    __builtin_cpu_init();
+#endif
+#ifdef SHA1_ALGO_AVX512
+    if (__builtin_cpu_supports("avx512f")) {
+	transforms[count].name = "avx512";
+	transforms[count].lanes = 16;
+	transforms[count++].transform = cueify_sha1_transform_avx512;
+    }
+#endif
+#ifdef SHA1_ALGO_AVX2
+    if (__builtin_cpu_supports("avx2")) {
+	transforms[count].name = "avx2";
+	transforms[count].lanes = 8;
+	transforms[count++].transform = cueify_sha1_transform_avx2;
+    }
+#endif
+    /*
+     * AVX2 hashes eight messages in less time per block than the SHA
+     * extensions hash one, but the SHA extensions beat four lanes of
+     * SIMD and any software.
+     */
+    cueify_sha1_get_transforms(single);
+    hardware = strcmp(single[0].name, "sha-ni") == 0 ||
+	strcmp(single[0].name, "armv8") == 0;
+    if (hardware) {
+	transforms[count].name = single[0].name;
+	transforms[count].lanes = 1;
+	transforms[count++].transform = cueify_sha1_transform_lanes1;
+    }
+#ifdef SHA1_ALGO_LANES
+    transforms[count].name = "lanes4";
+    transforms[count].lanes = 4;
+    transforms[count++].transform = cueify_sha1_transform_lanes4;
+#endif
+    if (!hardware) {
+	transforms[count].name = single[0].name;
+	transforms[count].lanes = 1;
+	transforms[count++].transform = cueify_sha1_transform_lanes1;
+    }
+
+    return count;
 }
 
 
@@ -248,10 +641,6 @@ void cueify_sha1_final(SHA1_CTX* context, uint8_t digest[SHA1_DIGEST_SIZE])
     memset(context->state, 0, 20);
     memset(context->count, 0, 8);
     memset(finalcount, 0, 8);	/* SWR */
-
-#ifdef SHA1HANDSOFF  /* make SHA1Transform overwrite its own static vars */
-    cueify_sha1_transform(context->state, context->buffer);
-#endif
 }
   
 /*************************************************************/
@@ -16,7 +16,35 @@ typedef struct {
 
 #define SHA1_DIGEST_SIZE 20
 
+/* an implementation of cueify_sha1_transform() */
+typedef struct {
+    const char *name;
+    void (*transform)(uint32_t state[5], const uint8_t buffer[64]);
+} SHA1_TRANSFORM;
+
+#define SHA1_MAX_TRANSFORMS 3
+
+/* an implementation hashing one block of each of several messages at
+   once; word i of the state of the message in lane j is at
+   state[i * lanes + j] */
+typedef struct {
+    const char *name;
+    size_t lanes;
+    void (*transform)(uint32_t *state, const uint8_t * const *blocks);
+} SHA1_LANES_TRANSFORM;
+
+#define SHA1_MAX_LANES 16
+#define SHA1_MAX_LANES_TRANSFORMS 4
+
 void cueify_sha1_init(SHA1_CTX* context);
+void cueify_sha1_transform(uint32_t state[5], const uint8_t buffer[64]);
+/* the implementations this processor supports, fastest (the one used)
+   first; returns how many of SHA1_MAX_TRANSFORMS were filled in */
+size_t cueify_sha1_get_transforms(SHA1_TRANSFORM *transforms);
+/* the multi-message implementations this processor supports, fastest
+   per block (with every lane filled) first, one of them of a single
+   lane; returns how many of SHA1_MAX_LANES_TRANSFORMS were filled in */
+size_t cueify_sha1_get_lanes_transforms(SHA1_LANES_TRANSFORM *transforms);
 void cueify_sha1_update(SHA1_CTX* context, const uint8_t* data,
 			const size_t len);
 void cueify_sha1_final(SHA1_CTX* context, uint8_t digest[SHA1_DIGEST_SIZE]);
@@ -0,0 +1,348 @@
+/* simulated.c - Simulated optical disc drive with a latency model
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <cueify/device.h>
+#include <cueify/error.h>
+#include "device_private.h"
+#include "backend_private.h"
+#include "sector_cache_private.h"
+
+/** Number of sectors read per second at 1x. */
+#define SECTORS_PER_SECOND  75
+/** Number of sectors on the longest (99-minute) discs. */
+#define MAX_SECTORS  (99 * 60 * SECTORS_PER_SECOND)
+/** Number of sectors a full-stroke seek crosses (an 80-minute disc). */
+#define FULL_STROKE  (80 * 60 * SECTORS_PER_SECOND)
+/** Square of the radius of the start of the program area (0.1 mm). */
+#define INNER_RADIUS_SQUARED  62500
+/**
+ * Growth of the square of the radius per sector (in 0.01 mm^2 per
+ * 10000 sectors): the area of a sector (16 mm long, on a 1.6 um
+ * track pitch) divided by pi.
+ */
+#define RADIUS_SQUARED_PER_SECTOR  8149
+/**
+ * Time for half a revolution at 1x per 0.1 mm of radius
+ * (microseconds): pi * r / (16 mm * 75 / s), scaled by 10.
+ */
+#define HALF_REVOLUTION_US  2618
+
+/** Latencies of the default simulated drive (a typical 8x drive). */
+static const cueify_latency_t default_latency = {
+    200,     /* command_us */
+    10000,   /* toc_us */
+    2000,    /* min_seek_us */
+    100000,  /* max_seek_us */
+    8        /* speed */
+};
+
+/** Internal structure holding the state of a simulated drive. */
+typedef struct cueify_simulation_private {
+    cueify_latency_t latency;  /** Latencies of the drive. */
+    uint32_t head;  /** Sector the optical head will read next. */
+    uint32_t ms;  /** Simulated time consumed (milliseconds). */
+    uint32_t us;  /** Simulated time consumed beyond ms (microseconds). */
+} cueify_simulation_private;
+
+
+/**
+ * Charge simulated time to a drive.
+ *
+ * @param sim the simulated drive
+ * @param us the time to charge (in microseconds)
+ */
+static void charge(cueify_simulation_private *sim, uint32_t us) {
+    sim->ms += us / 1000;
+    sim->us += us % 1000;
+    if (sim->us >= 1000) {
+	sim->ms++;
+	sim->us -= 1000;
+    }
+}  /* charge */
+
+
+/**
+ * Compute the integer square root of a number.
+ *
+ * @param n the number
+ * @return the largest integer whose square is at most n
+ */
+static uint32_t isqrt(uint32_t n) {
+    uint32_t root = 0, bit = 1UL << 30;
+
+    while (bit > n) {
+	bit >>= 2;
+    }
+    while (bit != 0) {
+	if (n >= root + bit) {
+	    n -= root + bit;
+	    root = (root >> 1) + bit;
+	} else {
+	    root >>= 1;
+	}
+	bit >>= 2;
+    }
+    return root;
+}  /* isqrt */
+
+
+/**
+ * Charge the time to move the optical head of a drive to a sector
+ * and wait for it to come around.
+ *
+ * @param sim the simulated drive
+ * @param lba the sector to move to
+ */
+static void charge_seek(cueify_simulation_private *sim, uint32_t lba) {
+    uint32_t distance, radius;
+
+    if (lba == sim->head) {
+	/* Sequential reads continue without seeking. */
+	return;
+    }
+
+    distance = (lba > sim->head) ? lba - sim->head : sim->head - lba;
+    if (distance > FULL_STROKE) {
+	distance = FULL_STROKE;
+    }
+    charge(sim, sim->latency.min_seek_us +
+	   (uint32_t)((double)(sim->latency.max_seek_us -
+			       sim->latency.min_seek_us) *
+		      distance / FULL_STROKE));
+
+    /* On average, wait half a revolution, which is longer further out. */
+    if (lba > MAX_SECTORS) {
+	lba = MAX_SECTORS;
+    }
+    radius = isqrt(INNER_RADIUS_SQUARED +
+		   lba / 100 * RADIUS_SQUARED_PER_SECTOR / 100);
+    charge(sim, radius * HALF_REVOLUTION_US / 10 / sim->latency.speed);
+}  /* charge_seek */
+
+
+/**
+ * Charge the time to read sectors from the current position.
+ *
+ * @param sim the simulated drive
+ * @param lba the first sector to read
+ * @param count the number of sectors to read
+ */
+static void charge_read(cueify_simulation_private *sim, uint32_t lba,
+			uint32_t count) {
+    uint32_t rate = SECTORS_PER_SECOND * sim->latency.speed;
+
+    charge(sim, sim->latency.command_us);
+    charge_seek(sim, lba);
+    charge(sim, count / rate * 1000000 + count % rate * 1000000 / rate);
+    sim->head = lba + count;
+}  /* charge_read */
+
+
+/** Close a simulated drive. */
+static int simulated_close(cueify_device_private *d) {
+    free(d->simulation);
+    d->simulation = NULL;
+    return cueify_image_backend.close(d);
+}  /* simulated_close */
+
+
+/** Check whether the disc in a simulated drive has changed. */
+static int simulated_media_changed(cueify_device_private *d) {
+    return cueify_image_backend.media_changed(d);
+}  /* simulated_media_changed */
+
+
+/** Report the APIs a simulated drive supports. */
+static int simulated_get_supported_apis(cueify_device_private *d) {
+    return cueify_image_backend.get_supported_apis(d);
+}  /* simulated_get_supported_apis */
+
+
+/** Read the TOC of the disc in a simulated drive. */
+static int simulated_read_toc(cueify_device_private *d,
+			      cueify_toc_private *t) {
+    charge(d->simulation, d->simulation->latency.command_us +
+	   d->simulation->latency.toc_us);
+    return cueify_image_backend.read_toc(d, t);
+}  /* simulated_read_toc */
+
+
+/** Read the sessions of the disc in a simulated drive. */
+static int simulated_read_sessions(cueify_device_private *d,
+				   cueify_sessions_private *s) {
+    charge(d->simulation, d->simulation->latency.command_us +
+	   d->simulation->latency.toc_us);
+    return cueify_image_backend.read_sessions(d, s);
+}  /* simulated_read_sessions */
+
+
+/** Read the full TOC of the disc in a simulated drive. */
+static int simulated_read_full_toc(cueify_device_private *d,
+				   cueify_full_toc_private *t) {
+    charge(d->simulation, d->simulation->latency.command_us +
+	   d->simulation->latency.toc_us);
+    return cueify_image_backend.read_full_toc(d, t);
+}  /* simulated_read_full_toc */
+
+
+/** Read the CD-Text of the disc in a simulated drive. */
+static int simulated_read_cdtext(cueify_device_private *d,
+				 cueify_cdtext_private *t) {
+    charge(d->simulation, d->simulation->latency.command_us +
+	   d->simulation->latency.toc_us);
+    return cueify_image_backend.read_cdtext(d, t);
+}  /* simulated_read_cdtext */
+
+
+/** Read the MCN of the disc in a simulated drive. */
+static int simulated_read_mcn(cueify_device_private *d, char *buffer,
+			      size_t *size) {
+    charge(d->simulation, d->simulation->latency.command_us +
+	   d->simulation->latency.toc_us);
+    return cueify_image_backend.read_mcn(d, buffer, size);
+}  /* simulated_read_mcn */
+
+
+/** Read the ISRC of a track of the disc in a simulated drive. */
+static int simulated_read_isrc(cueify_device_private *d, uint8_t track,
+			       char *buffer, size_t *size) {
+    charge(d->simulation, d->simulation->latency.command_us +
+	   d->simulation->latency.toc_us);
+    return cueify_image_backend.read_isrc(d, track, buffer, size);
+}  /* simulated_read_isrc */
+
+
+/**
+ * Read the position of a sector of the disc in a simulated drive.
+ * Like the optical disc backends, this reads the raw sector (through
+ * the sector cache) once, and finds the position from it.
+ */
+static int simulated_read_position(cueify_device_private *d,
+				   uint8_t track, uint32_t lba,
+				   cueify_position_t *pos) {
+    cueify_raw_read_private buffer;
+
+    /* Suppress error about track. */
+    track++;
+    if (cueify_sector_cache_read(d, lba, 1, &buffer) != CUEIFY_OK) {
+	return CUEIFY_ERR_INTERNAL;
+    }
+    return cueify_image_sector_position(d, lba, &buffer, pos);
+}  /* simulated_read_position */
+
+
+/** Read raw sectors from the disc in a simulated drive. */
+static int simulated_read_raw_sectors(cueify_device_private *d,
+				      uint32_t lba, uint32_t count,
+				      cueify_raw_read_private *buffer) {
+    charge_read(d->simulation, lba, count);
+    return cueify_image_backend.read_raw_sectors(d, lba, count, buffer);
+}  /* simulated_read_raw_sectors */
+
+
+const cueify_device_backend cueify_simulated_backend = {
+    simulated_close,
+    simulated_media_changed,
+    simulated_get_supported_apis,
+    simulated_read_toc,
+    simulated_read_sessions,
+    simulated_read_full_toc,
+    simulated_read_cdtext,
+    simulated_read_mcn,
+    simulated_read_isrc,
+    simulated_read_position,
+    simulated_read_raw_sectors,
+    /* Commands complete as soon as they are charged. */
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+int cueify_device_open_simulated(cueify_device *d, const char *path,
+				 const cueify_latency_t *latency) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+    int retval;
+
+    if (latency != NULL &&
+	(latency->speed == 0 ||
+	 latency->min_seek_us > latency->max_seek_us)) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    retval = cueify_device_open_image(d, path);
+    if (retval != CUEIFY_OK) {
+	return retval;
+    }
+
+    retval = cueify_simulation_start(dev, (latency != NULL) ? latency :
+				     &default_latency);
+    if (retval != CUEIFY_OK) {
+	cueify_device_close(d);
+	return retval;
+    }
+    dev->backend = &cueify_simulated_backend;
+
+    return CUEIFY_OK;
+}  /* cueify_device_open_simulated */
+
+
+int cueify_simulation_start(cueify_device_private *d,
+			    const cueify_latency_t *latency) {
+    d->simulation = calloc(1, sizeof(cueify_simulation_private));
+    if (d->simulation == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    d->simulation->latency = *latency;
+    return CUEIFY_OK;
+}  /* cueify_simulation_start */
+
+
+void cueify_simulation_charge(cueify_device_private *d, uint32_t us) {
+    charge(d->simulation, us);
+}  /* cueify_simulation_charge */
+
+
+uint32_t cueify_simulation_now_us(cueify_device_private *d) {
+    return d->simulation->ms * 1000 + d->simulation->us;
+}  /* cueify_simulation_now_us */
+
+
+int cueify_device_get_simulated_time(cueify_device *d, uint32_t *ms,
+				     int reset) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+
+    if (dev == NULL || ms == NULL || dev->simulation == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    *ms = dev->simulation->ms;
+    if (reset) {
+	dev->simulation->ms = dev->simulation->us = 0;
+    }
+    return CUEIFY_OK;
+}  /* cueify_device_get_simulated_time */
@@ -0,0 +1,124 @@
+/* stats.c - Counters for the commands issued to devices
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <string.h>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <time.h>
+#include <sys/time.h>
+#endif
+#include <cueify/device.h>
+#include <cueify/error.h>
+#include "device_private.h"
+#include "backend_private.h"
+#include "stats_private.h"
+
+/**
+ * Read a clock which counts up in microseconds.
+ *
+ * @param d the device handle whose commands are being timed
+ * @return the current time (in microseconds, modulo 2^32)
+ */
+static uint32_t now_us(cueify_device_private *d) {
+#ifdef _WIN32
+    LARGE_INTEGER count, frequency;
+#elif defined(CLOCK_MONOTONIC)
+    struct timespec now;
+#else
+    struct timeval now;
+#endif
+
+    if (d->simulation != NULL) {
+	return cueify_simulation_now_us(d);
+    }
+
+#ifdef _WIN32
+    QueryPerformanceCounter(&count);
+    QueryPerformanceFrequency(&frequency);
+    return (uint32_t)(count.QuadPart * 1000000 / frequency.QuadPart);
+#elif defined(CLOCK_MONOTONIC)
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint32_t)now.tv_sec * 1000000 + now.tv_nsec / 1000;
+#else
+    gettimeofday(&now, NULL);
+    return (uint32_t)now.tv_sec * 1000000 + now.tv_usec;
+#endif
+}  /* now_us */
+
+
+uint32_t cueify_stats_start(cueify_device_private *d) {
+    return now_us(d);
+}  /* cueify_stats_start */
+
+
+void cueify_stats_record(cueify_device_private *d, int command,
+			 uint32_t start, size_t bytes, int status) {
+    cueify_command_stats_t *stats = &d->stats.commands[command];
+    uint32_t elapsed = now_us(d) - start;
+    int bucket = 0;
+
+    stats->count++;
+    if (status != CUEIFY_OK && status != CUEIFY_NO_DATA) {
+	stats->errors++;
+	bytes = 0;
+    }
+    stats->bytes += bytes;
+    stats->total_us += elapsed;
+    if (elapsed > stats->max_us) {
+	stats->max_us = elapsed;
+    }
+
+    /* Bucket by the position of the highest bit set. */
+    while (bucket < CUEIFY_LATENCY_BUCKETS - 1 && (elapsed >> 1) != 0) {
+	elapsed >>= 1;
+	bucket++;
+    }
+    stats->histogram[bucket]++;
+}  /* cueify_stats_record */
+
+
+int cueify_device_get_stats(cueify_device *d, cueify_device_stats_t *stats) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+
+    if (dev == NULL || stats == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    memcpy(stats, &dev->stats, sizeof(cueify_device_stats_t));
+    return CUEIFY_OK;
+}  /* cueify_device_get_stats */
+
+
+int cueify_device_reset_stats(cueify_device *d) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+
+    if (dev == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    memset(&dev->stats, 0, sizeof(cueify_device_stats_t));
+    return CUEIFY_OK;
+}  /* cueify_device_reset_stats */
@@ -0,0 +1,55 @@
+/* stats_private.h - Private API for counting device commands
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CUEIFY_STATS_PRIVATE_H
+#define _CUEIFY_STATS_PRIVATE_H
+
+#include <cueify/types.h>
+#include "device_private.h"
+
+/**
+ * Start timing a command issued to a device.
+ *
+ * @param d the device handle the command is issued to
+ * @return the time to pass to cueify_stats_record()
+ */
+uint32_t cueify_stats_start(cueify_device_private *d);
+
+
+/**
+ * Count a command issued to a device.
+ *
+ * @param d the device handle the command was issued to
+ * @param command the kind of command (one of CUEIFY_COMMAND_*)
+ * @param start the time returned by cueify_stats_start() when the
+ *              command was issued
+ * @param bytes the number of bytes of data the command returned (not
+ *              counted if the command failed)
+ * @param status the result of the command
+ */
+void cueify_stats_record(cueify_device_private *d, int command,
+			 uint32_t start, size_t bytes, int status);
+
+#endif  /* _CUEIFY_STATS_PRIVATE_H */
@@ -29,6 +29,7 @@
 #include <cueify/error.h>
 #include "device_private.h"
 #include "toc_private.h"
+#include "disc_private.h"
 
 cueify_toc *cueify_toc_new() {
     return calloc(1, sizeof(cueify_toc_private));
@@ -38,14 +39,22 @@ cueify_toc *cueify_toc_new() {
 int cueify_device_read_toc(cueify_device *d, cueify_toc *t) {
     cueify_device_private *dev = (cueify_device_private *)d;
     cueify_toc_private *toc = (cueify_toc_private *)t;
+    cueify_toc_private *cached;
+    int retval;
 
     if (d == NULL || t == NULL) {
 	return CUEIFY_ERR_BADARG;
     }
 
-    memset(toc, 0, sizeof(cueify_toc_private));
+    cueify_device_check_media(dev);
+    retval = cueify_disc_get_toc(dev, &cached);
+    if (retval != CUEIFY_OK) {
+	memset(toc, 0, sizeof(cueify_toc_private));
+	return retval;
+    }
+    memcpy(toc, cached, sizeof(cueify_toc_private));
 
-    return cueify_device_read_toc_unportable(dev, toc);
+    return CUEIFY_OK;
 }  /* cueify_device_read_toc */
 
 
@@ -0,0 +1,706 @@
+/* trace.c - Recording and replay of the commands sent to a device
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <cueify/device.h>
+#include <cueify/toc.h>
+#include <cueify/sessions.h>
+#include <cueify/full_toc.h>
+#include <cueify/cdtext.h>
+#include <cueify/error.h>
+#include "device_private.h"
+#include "backend_private.h"
+#include "sector_cache_private.h"
+#include "trace_private.h"
+
+/* Operation codes of the MMC commands which are replayed. */
+#define OP_READ_SUBCHANNEL  0x42  /** READ SUB-CHANNEL */
+#define OP_READ_TOC         0x43  /** READ TOC/PMA/ATIP */
+#define OP_READ_CD          0xBE  /** READ CD */
+
+/* Formats of READ TOC/PMA/ATIP (in byte 2 of the CDB). */
+#define TOC_FORMAT_TOC       0x00  /** TOC */
+#define TOC_FORMAT_SESSIONS  0x01  /** Session Info */
+#define TOC_FORMAT_FULL_TOC  0x02  /** Full TOC */
+#define TOC_FORMAT_CDTEXT    0x05  /** CD-TEXT */
+
+/* Types of READ SUB-CHANNEL (in byte 3 of the CDB). */
+#define SUBCHANNEL_MCN   0x02  /** Media Catalog Number */
+#define SUBCHANNEL_ISRC  0x03  /** Track ISRC */
+
+/** Offset of the validity flag in a READ SUB-CHANNEL response. */
+#define SUBCHANNEL_VALID  8
+/** Offset of the MCN or ISRC in a READ SUB-CHANNEL response. */
+#define SUBCHANNEL_CODE  9
+#define MCN_SIZE   14  /** Size of the MCN (with terminator) returned. */
+#define ISRC_SIZE  13  /** Size of the ISRC (with terminator) returned. */
+
+/** Match any track in find_record(). */
+#define ANY_TRACK  -1
+
+/** Return the binary representation of a binary-coded decimal. */
+#define BCD2BIN(x)  (((x >> 4) & 0xF) * 10 + (x & 0xF))
+
+/** Internal structure holding the trace a device is recorded to. */
+typedef struct cueify_trace_private {
+    FILE *file;  /** File the trace is written to. */
+    int failed;  /** Non-zero if a record could not be written. */
+} cueify_trace_private;
+
+/** A command read from a trace. */
+typedef struct {
+    const uint8_t *cdb;  /** Command descriptor block of the command. */
+    uint8_t cdb_length;  /** Number of bytes in cdb. */
+    uint8_t status;  /** Status of the command (0 if it succeeded). */
+    uint32_t elapsed;  /** Time the command took (microseconds). */
+    const uint8_t *data;  /** Data returned by the command. */
+    uint32_t data_length;  /** Number of bytes in data. */
+} trace_record_t;
+
+/** Internal structure holding a trace being replayed. */
+typedef struct {
+    uint8_t *file;  /** Contents of the trace file. */
+    trace_record_t *records;  /** Commands in the trace. */
+    size_t num_records;  /** Number of commands in the trace. */
+    /** Index of the record after the one last replayed. */
+    size_t next;
+} trace_replay_t;
+
+
+/**
+ * Write a 32-bit big-endian number.
+ *
+ * @param bp the buffer to write to
+ * @param value the number to write
+ */
+static void put_be32(uint8_t *bp, uint32_t value) {
+    bp[0] = (value >> 24) & 0xFF;
+    bp[1] = (value >> 16) & 0xFF;
+    bp[2] = (value >> 8) & 0xFF;
+    bp[3] = value & 0xFF;
+}  /* put_be32 */
+
+
+/**
+ * Read a 32-bit big-endian number.
+ *
+ * @param bp the buffer to read from
+ * @return the number read
+ */
+static uint32_t get_be32(const uint8_t *bp) {
+    return ((uint32_t)bp[0] << 24) | ((uint32_t)bp[1] << 16) |
+	((uint32_t)bp[2] << 8) | bp[3];
+}  /* get_be32 */
+
+
+int cueify_device_start_trace(cueify_device *d, const char *path) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+    uint8_t header[TRACE_MAGIC_SIZE + 1];
+
+    if (dev == NULL || path == NULL || dev->backend == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    cueify_trace_stop(dev);
+    dev->trace = calloc(1, sizeof(cueify_trace_private));
+    if (dev->trace == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    dev->trace->file = fopen(path, "wb");
+    if (dev->trace->file == NULL) {
+	free(dev->trace);
+	dev->trace = NULL;
+	return CUEIFY_ERR_NO_DEVICE;
+    }
+
+    memcpy(header, TRACE_MAGIC, TRACE_MAGIC_SIZE);
+    header[TRACE_MAGIC_SIZE] = TRACE_VERSION;
+    if (fwrite(header, sizeof(header), 1, dev->trace->file) != 1) {
+	dev->trace->failed = 1;
+    }
+
+    return CUEIFY_OK;
+}  /* cueify_device_start_trace */
+
+
+int cueify_device_stop_trace(cueify_device *d) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+
+    if (dev == NULL || dev->trace == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+
+    return cueify_trace_stop(dev);
+}  /* cueify_device_stop_trace */
+
+
+int cueify_trace_stop(cueify_device_private *d) {
+    int retval = CUEIFY_OK;
+
+    if (d->trace == NULL) {
+	return CUEIFY_OK;
+    }
+
+    if (fclose(d->trace->file) != 0 || d->trace->failed) {
+	retval = CUEIFY_ERR_INTERNAL;
+    }
+    free(d->trace);
+    d->trace = NULL;
+
+    return retval;
+}  /* cueify_trace_stop */
+
+
+size_t cueify_trace_response_length(const uint8_t *cdb, const uint8_t *data,
+				    size_t buffer_length) {
+    size_t length = buffer_length;
+
+    if (cdb[0] == OP_READ_TOC && buffer_length >= 2) {
+	length = ((data[0] << 8) | data[1]) + 2;
+    } else if (cdb[0] == OP_READ_SUBCHANNEL && buffer_length >= 4) {
+	length = ((data[2] << 8) | data[3]) + 4;
+    }
+    if (length > buffer_length) {
+	length = buffer_length;
+    }
+    return length;
+}  /* cueify_trace_response_length */
+
+
+void cueify_trace_record(cueify_device_private *d, const uint8_t *cdb,
+			 size_t cdb_length, size_t buffer_length,
+			 const uint8_t *data, const uint8_t *sense,
+			 size_t sense_length, uint32_t elapsed, int status) {
+    uint8_t header[TRACE_RECORD_HEADER_SIZE];
+    size_t data_length = 0;
+
+    if (status == CUEIFY_OK) {
+	/* Only keep as much of a response as its header says it has. */
+	data_length = cueify_trace_response_length(cdb, data, buffer_length);
+	sense_length = 0;
+    } else if (sense_length > 0xFF) {
+	sense_length = 0xFF;
+    }
+
+    header[0] = cdb_length;
+    header[1] = sense_length;
+    header[2] = (status != CUEIFY_OK);
+    put_be32(header + 3, buffer_length);
+    put_be32(header + 7, data_length);
+    put_be32(header + 11, elapsed);
+
+    if (fwrite(header, sizeof(header), 1, d->trace->file) != 1 ||
+	fwrite(cdb, cdb_length, 1, d->trace->file) != 1 ||
+	(data_length > 0 &&
+	 fwrite(data, data_length, 1, d->trace->file) != 1) ||
+	(sense_length > 0 &&
+	 fwrite(sense, sense_length, 1, d->trace->file) != 1)) {
+	d->trace->failed = 1;
+    }
+}  /* cueify_trace_record */
+
+
+/**
+ * Read the whole of a file.
+ *
+ * @param path the path of the file to read
+ * @param size a pointer to set to the number of bytes read
+ * @return the contents of the file (to be freed with free()), or NULL
+ *         if it could not be read
+ */
+static uint8_t *read_file(const char *path, size_t *size) {
+    FILE *file;
+    uint8_t *contents = NULL, *bigger;
+    size_t capacity = 0, length = 0;
+
+    file = fopen(path, "rb");
+    if (file == NULL) {
+	return NULL;
+    }
+
+    do {
+	if (length == capacity) {
+	    capacity = (capacity == 0) ? 65536 : capacity * 2;
+	    bigger = realloc(contents, capacity);
+	    if (bigger == NULL) {
+		free(contents);
+		fclose(file);
+		return NULL;
+	    }
+	    contents = bigger;
+	}
+	length += fread(contents + length, 1, capacity - length, file);
+    } while (length == capacity);
+
+    if (ferror(file)) {
+	free(contents);
+	contents = NULL;
+    }
+    fclose(file);
+    *size = length;
+    return contents;
+}  /* read_file */
+
+
+/**
+ * Split the contents of a trace file into records.
+ *
+ * @param replay the trace to fill in, whose file has been read
+ * @param size the number of bytes in the file
+ * @return CUEIFY_OK if the trace was understood; CUEIFY_ERR_NOMEM if
+ *         there was not enough memory; otherwise CUEIFY_ERR_CORRUPTED
+ */
+static int parse_trace(trace_replay_t *replay, size_t size) {
+    const uint8_t *bp, *end = replay->file + size;
+    trace_record_t *record;
+    size_t capacity = 0;
+    uint32_t sense_length;
+    void *bigger;
+
+    if (size < TRACE_MAGIC_SIZE + 1 ||
+	memcmp(replay->file, TRACE_MAGIC, TRACE_MAGIC_SIZE) != 0 ||
+	replay->file[TRACE_MAGIC_SIZE] != TRACE_VERSION) {
+	return CUEIFY_ERR_CORRUPTED;
+    }
+
+    bp = replay->file + TRACE_MAGIC_SIZE + 1;
+    while (bp < end) {
+	if (replay->num_records == capacity) {
+	    capacity = (capacity == 0) ? 64 : capacity * 2;
+	    bigger = realloc(replay->records,
+			     capacity * sizeof(trace_record_t));
+	    if (bigger == NULL) {
+		return CUEIFY_ERR_NOMEM;
+	    }
+	    replay->records = bigger;
+	}
+	record = &replay->records[replay->num_records];
+
+	if ((size_t)(end - bp) < TRACE_RECORD_HEADER_SIZE) {
+	    return CUEIFY_ERR_CORRUPTED;
+	}
+	record->cdb_length = bp[0];
+	sense_length = bp[1];
+	record->status = bp[2];
+	record->data_length = get_be32(bp + 7);
+	record->elapsed = get_be32(bp + 11);
+	bp += TRACE_RECORD_HEADER_SIZE;
+
+	if (record->cdb_length == 0 ||
+	    (size_t)(end - bp) < record->cdb_length ||
+	    (size_t)(end - bp) - record->cdb_length < record->data_length ||
+	    (size_t)(end - bp) - record->cdb_length - record->data_length <
+	    sense_length) {
+	    return CUEIFY_ERR_CORRUPTED;
+	}
+	record->cdb = bp;
+	bp += record->cdb_length;
+	record->data = bp;
+	bp += record->data_length + sense_length;
+	replay->num_records++;
+    }
+
+    return CUEIFY_OK;
+}  /* parse_trace */
+
+
+/**
+ * Find the next record of a kind of command in a trace, starting
+ * after the one last replayed and wrapping around, and charge the
+ * time it took.
+ *
+ * @param d a device handle replaying a trace
+ * @param opcode the operation code of the command
+ * @param format the format (READ TOC/PMA/ATIP) or type (READ
+ *               SUB-CHANNEL) of the command
+ * @param track the track of a READ SUB-CHANNEL, or ANY_TRACK
+ * @return the record found, or NULL if there is none
+ */
+static const trace_record_t *find_record(cueify_device_private *d,
+					 uint8_t opcode, uint8_t format,
+					 int track) {
+    trace_replay_t *replay = d->backend_data;
+    const trace_record_t *record;
+    size_t i, index;
+
+    for (i = 0; i < replay->num_records; i++) {
+	index = (replay->next + i) % replay->num_records;
+	record = &replay->records[index];
+
+	if (record->cdb[0] != opcode || record->cdb_length < 7) {
+	    continue;
+	}
+	if (opcode == OP_READ_TOC && (record->cdb[2] & 0x0F) != format) {
+	    continue;
+	}
+	if (opcode == OP_READ_SUBCHANNEL &&
+	    (record->cdb[3] != format ||
+	     (track != ANY_TRACK && record->cdb[6] != track))) {
+	    continue;
+	}
+
+	replay->next = index + 1;
+	cueify_simulation_charge(d, record->elapsed);
+	d->transferred += record->data_length;
+	return record;
+    }
+
+    return NULL;
+}  /* find_record */
+
+
+/**
+ * Find the next READ TOC/PMA/ATIP of a format which succeeded in a
+ * trace.
+ *
+ * @param d a device handle replaying a trace
+ * @param format the format of the command
+ * @return the record found, or NULL if there is none or it failed
+ */
+static const trace_record_t *find_toc(cueify_device_private *d,
+				      uint8_t format) {
+    const trace_record_t *record;
+
+    record = find_record(d, OP_READ_TOC, format, ANY_TRACK);
+    if (record == NULL || record->status != 0) {
+	return NULL;
+    }
+    return record;
+}  /* find_toc */
+
+
+/** Close a replayed trace. */
+static int trace_close(cueify_device_private *d) {
+    trace_replay_t *replay = d->backend_data;
+
+    free(replay->records);
+    free(replay->file);
+    free(replay);
+    d->backend_data = NULL;
+    free(d->simulation);
+    d->simulation = NULL;
+
+    return CUEIFY_OK;
+}  /* trace_close */
+
+
+/** Check whether the disc in a replayed trace has changed. */
+static int trace_media_changed(cueify_device_private *d) {
+    /* Suppress error about d. */
+    d++;
+    return 0;
+}  /* trace_media_changed */
+
+
+/** Report the APIs a replayed trace supports. */
+static int trace_get_supported_apis(cueify_device_private *d) {
+    /* Suppress error about d. */
+    d++;
+    /* Traces are recorded on Linux, which supports everything. */
+    return (CUEIFY_DEVICE_SUPPORTS_TOC       |
+	    CUEIFY_DEVICE_SUPPORTS_SESSIONS  |
+	    CUEIFY_DEVICE_SUPPORTS_FULL_TOC  |
+	    CUEIFY_DEVICE_SUPPORTS_CDTEXT    |
+	    CUEIFY_DEVICE_SUPPORTS_MCN_ISRC  |
+	    CUEIFY_DEVICE_SUPPORTS_INDICES   |
+	    CUEIFY_DEVICE_SUPPORTS_DATA_MODE |
+	    CUEIFY_DEVICE_SUPPORTS_TRACK_CONTROL);
+}  /* trace_get_supported_apis */
+
+
+/** Read the TOC of the disc in a replayed trace. */
+static int trace_read_toc(cueify_device_private *d, cueify_toc_private *t) {
+    const trace_record_t *record = find_toc(d, TOC_FORMAT_TOC);
+
+    if (record == NULL) {
+	return CUEIFY_ERR_INTERNAL;
+    }
+    return cueify_toc_deserialize((cueify_toc *)t, record->data,
+				  record->data_length);
+}  /* trace_read_toc */
+
+
+/** Read the sessions of the disc in a replayed trace. */
+static int trace_read_sessions(cueify_device_private *d,
+			       cueify_sessions_private *s) {
+    const trace_record_t *record = find_toc(d, TOC_FORMAT_SESSIONS);
+
+    if (record == NULL) {
+	return CUEIFY_ERR_INTERNAL;
+    }
+    return cueify_sessions_deserialize((cueify_sessions *)s, record->data,
+				       record->data_length);
+}  /* trace_read_sessions */
+
+
+/** Read the full TOC of the disc in a replayed trace. */
+static int trace_read_full_toc(cueify_device_private *d,
+			       cueify_full_toc_private *t) {
+    const trace_record_t *record = find_toc(d, TOC_FORMAT_FULL_TOC);
+
+    if (record == NULL) {
+	return CUEIFY_ERR_INTERNAL;
+    }
+    return cueify_full_toc_deserialize((cueify_full_toc *)t, record->data,
+				       record->data_length);
+}  /* trace_read_full_toc */
+
+
+/** Read the CD-Text of the disc in a replayed trace. */
+static int trace_read_cdtext(cueify_device_private *d,
+			     cueify_cdtext_private *t) {
+    const trace_record_t *record = find_toc(d, TOC_FORMAT_CDTEXT);
+
+    if (record == NULL) {
+	return CUEIFY_ERR_INTERNAL;
+    }
+    return cueify_cdtext_deserialize((cueify_cdtext *)t, record->data,
+				     record->data_length);
+}  /* trace_read_cdtext */
+
+
+/**
+ * Copy an MCN or ISRC out of a READ SUB-CHANNEL in a trace.
+ *
+ * @param record the command to copy the code from, or NULL if none
+ * @param code_size the size of the code (with terminator) returned
+ * @param buffer a pointer to a buffer in which to write the code
+ * @param size a pointer to the size of the buffer, set to the number
+ *             of bytes set in the buffer on output
+ * @return CUEIFY_OK if the code was copied; CUEIFY_NO_DATA if the disc
+ *         has no code; otherwise an appropriate error code
+ */
+static int copy_code(const trace_record_t *record, size_t code_size,
+		     char *buffer, size_t *size) {
+    if (record == NULL || record->status != 0) {
+	return CUEIFY_ERR_INTERNAL;
+    }
+    if (record->data_length < SUBCHANNEL_CODE + code_size - 1) {
+	return CUEIFY_ERR_CORRUPTED;
+    }
+
+    /* The MSB of byte 8 must equal 1 if there is a code. */
+    if (record->data[SUBCHANNEL_VALID] != 0x80) {
+	if (*size > 0) {
+	    *size = 1;
+	    buffer[0] = '\0';
+	}
+	return CUEIFY_NO_DATA;
+    }
+
+    if (*size > code_size) {
+	*size = code_size;
+    }
+    if (*size > 0) {
+	memcpy(buffer, record->data + SUBCHANNEL_CODE, *size - 1);
+	buffer[*size - 1] = '\0';
+    }
+    return CUEIFY_OK;
+}  /* copy_code */
+
+
+/** Read the MCN of the disc in a replayed trace. */
+static int trace_read_mcn(cueify_device_private *d, char *buffer,
+			  size_t *size) {
+    return copy_code(find_record(d, OP_READ_SUBCHANNEL, SUBCHANNEL_MCN,
+				 ANY_TRACK),
+		     MCN_SIZE, buffer, size);
+}  /* trace_read_mcn */
+
+
+/** Read the ISRC of a track of the disc in a replayed trace. */
+static int trace_read_isrc(cueify_device_private *d, uint8_t track,
+			   char *buffer, size_t *size) {
+    return copy_code(find_record(d, OP_READ_SUBCHANNEL, SUBCHANNEL_ISRC,
+				 track),
+		     ISRC_SIZE, buffer, size);
+}  /* trace_read_isrc */
+
+
+/**
+ * Read the position of a sector of the disc in a replayed trace from
+ * the sub-Q-channel recorded with it, as on Linux.
+ */
+static int trace_read_position(cueify_device_private *d, uint8_t track,
+			       uint32_t lba, cueify_position_t *pos) {
+    cueify_raw_read_private buffer;
+
+    /* Do nothing, but remove error where track is unused! */
+    buffer.data_mode = track;
+    memset(&buffer, 0, sizeof(buffer));
+
+    while (buffer.track == 0) {
+	if (cueify_sector_cache_read(d, lba, 1, &buffer) != CUEIFY_OK) {
+	    return CUEIFY_ERR_INTERNAL;
+	}
+	lba--;
+    }
+
+    pos->track = BCD2BIN(buffer.track);
+    pos->index = BCD2BIN(buffer.index);
+
+    /* Adjust the absolute time by 2 seconds for the lead-in. */
+    pos->abs.min = BCD2BIN(buffer.amin);
+    pos->abs.sec = BCD2BIN(buffer.asec);
+    pos->abs.frm = BCD2BIN(buffer.afrm);
+    if (pos->abs.sec < 2) {
+	pos->abs.sec += 60;
+	pos->abs.min--;
+    }
+    pos->abs.sec -= 2;
+
+    pos->rel.min = BCD2BIN(buffer.min);
+    pos->rel.sec = BCD2BIN(buffer.sec);
+    pos->rel.frm = BCD2BIN(buffer.frm);
+
+    return CUEIFY_OK;
+}  /* trace_read_position */
+
+
+/**
+ * Get the sectors read by a READ CD in a trace.
+ *
+ * @param record the command
+ * @param lba a pointer to set to the first sector read (0 if none)
+ * @return the number of sectors read
+ */
+static uint32_t read_cd_extent(const trace_record_t *record, uint32_t *lba) {
+    if (record->cdb[0] != OP_READ_CD || record->cdb_length < 9 ||
+	record->status != 0) {
+	*lba = 0;
+	return 0;
+    }
+    *lba = get_be32(record->cdb + 2);
+    return ((uint32_t)record->cdb[6] << 16) | (record->cdb[7] << 8) |
+	record->cdb[8];
+}  /* read_cd_extent */
+
+
+/**
+ * Read raw sectors from the disc in a replayed trace.  A read of the
+ * same sectors as a recorded READ CD is served from it; otherwise each
+ * sector is served from any READ CD which read it.
+ */
+static int trace_read_raw_sectors(cueify_device_private *d, uint32_t lba,
+				  uint32_t count,
+				  cueify_raw_read_private *buffer) {
+    trace_replay_t *replay = d->backend_data;
+    const trace_record_t *record;
+    const uint8_t *sector;
+    uint32_t start, length, elapsed;
+    size_t i, index;
+
+    /* Try the same command first. */
+    for (i = 0; i < replay->num_records; i++) {
+	index = (replay->next + i) % replay->num_records;
+	record = &replay->records[index];
+	length = read_cd_extent(record, &start);
+	if (length == count && start == lba &&
+	    record->data_length >= count * sizeof(cueify_raw_read_private)) {
+	    replay->next = index + 1;
+	    cueify_simulation_charge(d, record->elapsed);
+	    memcpy(buffer, record->data,
+		   count * sizeof(cueify_raw_read_private));
+	    d->transferred += count * sizeof(cueify_raw_read_private);
+	    return CUEIFY_OK;
+	}
+    }
+
+    /* Otherwise, piece the sectors together. */
+    for (; count > 0; lba++, count--, buffer++) {
+	sector = NULL;
+	elapsed = 0;
+	for (i = 0; i < replay->num_records && sector == NULL; i++) {
+	    record = &replay->records[i];
+	    length = read_cd_extent(record, &start);
+	    if (length > 0 && lba >= start && lba - start < length &&
+		record->data_length >=
+		(lba - start + 1) * sizeof(cueify_raw_read_private)) {
+		sector = record->data +
+		    (lba - start) * sizeof(cueify_raw_read_private);
+		elapsed = record->elapsed / length;
+	    }
+	}
+	if (sector == NULL) {
+	    return CUEIFY_ERR_INTERNAL;
+	}
+	cueify_simulation_charge(d, elapsed);
+	memcpy(buffer, sector, sizeof(cueify_raw_read_private));
+	d->transferred += sizeof(cueify_raw_read_private);
+    }
+
+    return CUEIFY_OK;
+}  /* trace_read_raw_sectors */
+
+
+const cueify_device_backend cueify_trace_backend = {
+    trace_close,
+    trace_media_changed,
+    trace_get_supported_apis,
+    trace_read_toc,
+    trace_read_sessions,
+    trace_read_full_toc,
+    trace_read_cdtext,
+    trace_read_mcn,
+    trace_read_isrc,
+    trace_read_position,
+    trace_read_raw_sectors,
+    /* Commands are replayed as soon as they are issued. */
+    NULL,
+    NULL,
+    NULL,
+    NULL
+};
+
+
+int cueify_trace_open(cueify_device_private *d, const char *path) {
+    static const cueify_latency_t no_latency = { 0, 0, 0, 0, 1 };
+    trace_replay_t *replay;
+    size_t size;
+    int retval;
+
+    replay = calloc(1, sizeof(trace_replay_t));
+    if (replay == NULL) {
+	return CUEIFY_ERR_NOMEM;
+    }
+    replay->file = read_file(path, &size);
+    if (replay->file == NULL) {
+	free(replay);
+	return CUEIFY_ERR_NO_DEVICE;
+    }
+    d->backend_data = replay;
+
+    retval = parse_trace(replay, size);
+    if (retval == CUEIFY_OK) {
+	/* Replayed commands take as long as they did when recorded. */
+	retval = cueify_simulation_start(d, &no_latency);
+    }
+    if (retval != CUEIFY_OK) {
+	trace_close(d);
+    }
+    return retval;
+}  /* cueify_trace_open */
@@ -0,0 +1,108 @@
+/* trace_private.h - Private API for recording and replaying command traces
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CUEIFY_TRACE_PRIVATE_H
+#define _CUEIFY_TRACE_PRIVATE_H
+
+#include <cueify/types.h>
+#include "device_private.h"
+
+/*
+ * A trace file starts with the 8 bytes "CUEIFYTR" and a version byte
+ * (TRACE_VERSION), followed by one record per command:
+ *
+ *   1 byte   length of the command descriptor block (CDB)
+ *   1 byte   length of the sense data
+ *   1 byte   status (0 if the command succeeded)
+ *   4 bytes  length of the buffer given to the command
+ *   4 bytes  length of the data returned
+ *   4 bytes  time taken by the command (microseconds)
+ *   the CDB, the data returned, and the sense data
+ *
+ * All lengths and times are big-endian.  Sense data is only recorded
+ * for failed commands (to diagnose them; replay just fails them), and
+ * data only for successful ones; the data of READ TOC/PMA/ATIP and
+ * READ SUB-CHANNEL commands is cut to the length given in its header.
+ */
+#define TRACE_MAGIC  "CUEIFYTR"  /** Magic number of a trace file. */
+#define TRACE_MAGIC_SIZE  8  /** Number of bytes in the magic number. */
+#define TRACE_VERSION  2  /** Version of the trace file format. */
+#define TRACE_RECORD_HEADER_SIZE  15  /** Number of bytes before the CDB. */
+
+/**
+ * Find how much of the data returned by a command is meaningful: as
+ * much as the header of a READ TOC/PMA/ATIP or READ SUB-CHANNEL
+ * response says it has, or else the whole buffer.
+ *
+ * @param cdb the command descriptor block of the command
+ * @param data the data returned by the command
+ * @param buffer_length the number of bytes the command transferred
+ * @return the number of bytes of data returned
+ */
+size_t cueify_trace_response_length(const uint8_t *cdb, const uint8_t *data,
+				    size_t buffer_length);
+
+
+/**
+ * Append a command sent to a device to the trace of the device, if
+ * it is being traced.
+ *
+ * @param d the device handle the command was sent to
+ * @param cdb the command descriptor block of the command
+ * @param cdb_length the number of bytes in cdb
+ * @param buffer_length the length of the buffer given to the command
+ * @param data the data returned by the command
+ * @param sense the sense data of the command
+ * @param sense_length the number of bytes in sense
+ * @param elapsed the time the command took (microseconds)
+ * @param status the result of the command
+ */
+void cueify_trace_record(cueify_device_private *d, const uint8_t *cdb,
+			 size_t cdb_length, size_t buffer_length,
+			 const uint8_t *data, const uint8_t *sense,
+			 size_t sense_length, uint32_t elapsed, int status);
+
+
+/**
+ * Stop tracing a device, if it is being traced.
+ *
+ * @param d the device handle to stop tracing
+ * @return CUEIFY_OK if the trace was completely written; otherwise
+ *         CUEIFY_ERR_INTERNAL
+ */
+int cueify_trace_stop(cueify_device_private *d);
+
+
+/**
+ * Open a trace file for the trace replay backend.
+ *
+ * @param d the cueify device handle to open
+ * @param path the path of the trace file
+ * @return CUEIFY_OK if the trace was opened; CUEIFY_ERR_NO_DEVICE if
+ *         it could not be read; otherwise CUEIFY_ERR_CORRUPTED
+ */
+int cueify_trace_open(cueify_device_private *d, const char *path);
+
+#endif  /* _CUEIFY_TRACE_PRIVATE_H */
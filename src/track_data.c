@@ -30,21 +30,24 @@
 #include <cueify/error.h>
 #include "device_private.h"
 #include "toc_private.h"
+#include "disc_private.h"
+#include "sector_cache_private.h"
 
 int cueify_device_read_data_mode(cueify_device *d, uint8_t track) {
     cueify_device_private *dev = (cueify_device_private *)d;
-    cueify_toc_private toc;
+    cueify_toc_private *toc;
     cueify_raw_read_private buffer;
 
-    if (cueify_device_read_toc_unportable(dev, &toc) != CUEIFY_OK) {
+    cueify_device_check_media(dev);
+    if (cueify_disc_get_toc(dev, &toc) != CUEIFY_OK) {
 	return CUEIFY_DATA_MODE_ERROR;
     }
 
-    if (track >= toc.first_track_number &&
-	track <= toc.last_track_number) {
-	if (toc.tracks[track].control & CUEIFY_TOC_TRACK_IS_DATA) {
-	    if (cueify_device_read_raw_unportable(dev, toc.tracks[track].lba,
-						  &buffer) != CUEIFY_OK) {
+    if (track >= toc->first_track_number &&
+	track <= toc->last_track_number) {
+	if (toc->tracks[track].control & CUEIFY_TOC_TRACK_IS_DATA) {
+	    if (cueify_sector_cache_read(dev, toc->tracks[track].lba, 1,
+					 &buffer) != CUEIFY_OK) {
 		return CUEIFY_DATA_MODE_ERROR;
 	    }
 	    return buffer.data_mode;
@@ -62,15 +65,16 @@ uint8_t cueify_device_read_track_control_flags(cueify_device *d,
     cueify_device_private *dev = (cueify_device_private *)d;
 #ifdef READ_RAW_SUPPORTS_SUBQ
     /* Must support sub-Q-channel. */
-    cueify_toc_private toc;
+    cueify_toc_private *toc;
     cueify_raw_read_private buffer;
 
-    if (cueify_device_read_toc_unportable(dev, &toc) != CUEIFY_OK) {
+    cueify_device_check_media(dev);
+    if (cueify_disc_get_toc(dev, &toc) != CUEIFY_OK) {
 	return 0xF;
     }
 
-    if (cueify_device_read_raw_unportable(dev, toc.tracks[track].lba,
-					  &buffer) != CUEIFY_OK) {
+    if (cueify_sector_cache_read(dev, toc->tracks[track].lba, 1,
+				 &buffer) != CUEIFY_OK) {
 	return 0xF;
     }
 
@@ -83,3 +87,21 @@ uint8_t cueify_device_read_track_control_flags(cueify_device *d,
     return 0xF;
 #endif
 }  /* cueify_device_read_track_control_flags */
+
+
+int cueify_device_read_raw_sectors(cueify_device *d, uint32_t lba,
+				   uint32_t count, uint8_t *buffer,
+				   size_t size) {
+    cueify_device_private *dev = (cueify_device_private *)d;
+
+    if (d == NULL || buffer == NULL) {
+	return CUEIFY_ERR_BADARG;
+    }
+    if (size / sizeof(cueify_raw_read_private) < count) {
+	return CUEIFY_ERR_TOOSMALL;
+    }
+
+    cueify_device_check_media(dev);
+    return cueify_sector_cache_read(dev, lba, count,
+				    (cueify_raw_read_private *)buffer);
+}  /* cueify_device_read_raw_sectors */
@@ -33,6 +33,7 @@
 #include "full_toc_private.h"
 #include "cdtext_private.h"
 #include "indices_private.h"
+#include "sector_cache_private.h"
 #include "win32.h"
 
 #if defined(__WIN32__) && !defined(__CYGWIN__)
@@ -103,6 +104,28 @@ int cueify_device_close_unportable(cueify_device_private *d) {
 }  /* cueify_device_close_unportable */
 
 
+int cueify_device_media_changed_unportable(cueify_device_private *d) {
+    DWORD dwReturned;
+    ULONG ulChangeCount;
+    int changed;
+
+    /* Treat a failed check as a change, so nothing stale is reused. */
+    if (!DeviceIoControl(d->handle,
+			 IOCTL_STORAGE_CHECK_VERIFY2,
+			 NULL, 0,
+			 &ulChangeCount, sizeof(ulChangeCount),
+			 &dwReturned, NULL) ||
+	dwReturned < sizeof(ulChangeCount)) {
+	return 1;
+    }
+
+    /* The OS counts media changes; compare with the last count seen. */
+    changed = (ulChangeCount != d->media_change_count);
+    d->media_change_count = ulChangeCount;
+    return changed;
+}  /* cueify_device_media_changed_unportable */
+
+
 int cueify_device_get_supported_apis_unportable(cueify_device_private *d) {
     /* Suppress error about d. */
     d++;
@@ -171,6 +194,7 @@ int cueify_device_read_toc_unportable(cueify_device_private *d,
     if (!succeeded) {
 	return CUEIFY_ERR_INTERNAL;
     } else {
+	d->transferred += dwReturned;
 	t->first_track_number = toc.FirstTrack;
 	t->last_track_number = toc.LastTrack;
 	for (i = 0; i < MAXIMUM_NUMBER_TRACKS; i++) {
@@ -223,6 +247,7 @@ int cueify_device_read_sessions_unportable(cueify_device_private *d,
     if (!succeeded) {
 	return CUEIFY_ERR_INTERNAL;
     } else {
+	d->transferred += dwReturned;
 	s->first_session_number = session.FirstCompleteSession;
 	s->last_session_number = session.LastCompleteSession;
 	s->track_control = session.TrackData[0].Control;
@@ -267,6 +292,7 @@ int cueify_device_read_full_toc_unportable(cueify_device_private *d,
 			 &dwReturned, NULL)) {
 	return CUEIFY_ERR_INTERNAL;
     } else {
+	d->transferred += dwReturned;
 	t->first_session_number = fulltoc->FirstCompleteSession;
 	t->last_session_number = fulltoc->LastCompleteSession;
 	t->first_track_number = t->last_track_number = 0;
@@ -399,6 +425,7 @@ int cueify_device_read_cdtext_unportable(cueify_device_private *d,
 		free(cdtext);
 		return CUEIFY_ERR_INTERNAL;
 	    }
+	    d->transferred += dwReturned;
 	}
     }
 
@@ -430,7 +457,10 @@ int cueify_device_read_mcn_unportable(cueify_device_private *d,
 			 &data, sizeof(data),
 			 &dwReturned, NULL)) {
 	return CUEIFY_ERR_INTERNAL;
-    } else if (!data.MediaCatalog.Mcval) {
+    }
+
+    d->transferred += dwReturned;
+    if (!data.MediaCatalog.Mcval) {
 	if (*size > 0) {
 	    *size = 1;
 	    buffer[0] = '\0';
@@ -463,7 +493,10 @@ int cueify_device_read_isrc_unportable(cueify_device_private *d, uint8_t track,
 			 &data, sizeof(data),
 			 &dwReturned, NULL)) {
 	return CUEIFY_ERR_INTERNAL;
-    } else if (!data.TrackIsrc.Tcval) {
+    }
+
+    d->transferred += dwReturned;
+    if (!data.TrackIsrc.Tcval) {
 	if (*size > 0) {
 	    *size = 1;
 	    buffer[0] = '\0';
@@ -504,7 +537,7 @@ int cueify_device_read_position_unportable(cueify_device_private *d,
 	 * We can actually get the position from reading the Q subchannel
 	 * during our raw read, rather than doing a subchannel ioctl!
 	 */
-	if (cueify_device_read_raw_unportable(d, lba, &buffer) != CUEIFY_OK) {
+	if (cueify_sector_cache_read(d, lba, 1, &buffer) != CUEIFY_OK) {
 	    return CUEIFY_ERR_INTERNAL;
 	}
 	lba--;
@@ -520,7 +553,7 @@ int cueify_device_read_position_unportable(cueify_device_private *d,
 
     /* Adjust the absolute time by 2 seconds for the lead-in. */
     if (pos->abs.sec < 2) {
-	pos->abs.sec += 75;
+	pos->abs.sec += 60;
 	pos->abs.min--;
     }
     pos->abs.sec -= 2;
@@ -615,6 +648,7 @@ int cueify_device_read_raw_unportable(cueify_device_private *d, uint32_t lba,
 	error = GetLastError();
 	return CUEIFY_ERR_INTERNAL;
     }
+    d->transferred += srb.Spt.DataTransferLength;
 
     return CUEIFY_OK;
 }  /* cueify_device_read_raw_unportable */
@@ -34,6 +34,7 @@
     (((DeviceType) << 16) | ((Access) << 14) | ((Function) << 2) | (Method))
 
 #define FILE_DEVICE_CD_ROM                0x00000002
+#define FILE_DEVICE_MASS_STORAGE          0x0000002d
 #define FILE_READ_ACCESS                  0x00000001
 #define FILE_WRITE_ACCESS                 0x00000002
 #define FILE_ANY_ACCESS                   0x00000000
@@ -41,6 +42,7 @@
 #define METHOD_OUT_DIRECT                 2
 
 #define IOCTL_CDROM_BASE                  FILE_DEVICE_CD_ROM
+#define IOCTL_STORAGE_BASE                FILE_DEVICE_MASS_STORAGE
 
 #define IOCTL_CDROM_READ_Q_CHANNEL \
     CTL_CODE(IOCTL_CDROM_BASE, 0x000B, METHOD_BUFFERED, FILE_READ_ACCESS)
@@ -50,6 +52,8 @@
     CTL_CODE(IOCTL_CDROM_BASE, 0x0001, METHOD_BUFFERED, FILE_READ_ACCESS)
 #define IOCTL_CDROM_RAW_READ \
     CTL_CODE(IOCTL_CDROM_BASE, 0x000F, METHOD_OUT_DIRECT, FILE_READ_ACCESS)
+#define IOCTL_STORAGE_CHECK_VERIFY2 \
+    CTL_CODE(IOCTL_STORAGE_BASE, 0x0200, METHOD_BUFFERED, FILE_ANY_ACCESS)
 
 #define MAXIMUM_NUMBER_TRACKS             100
 
@@ -0,0 +1,127 @@
+/* bench_charsets.c - Benchmark of the CD-Text character set encoders
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "charsets.h"
+
+/** Number of times to encode the corpus. */
+#define ITERATIONS 2000
+
+/** Japanese titles, as they might appear in MS-JIS CD-Text. */
+static char *japanese_titles[] = {
+    "\xE4\xB8\x8A\xE3\x82\x92\xE5\x90\x91\xE3\x81\x84\xE3\x81\xA6"
+    "\xE6\xAD\xA9\xE3\x81\x93\xE3\x81\x86",  /* Ue o Muite Arukou */
+    "\xE3\x81\x95\xE3\x81\x8F\xE3\x82\x89\xE3\x81\x95\xE3\x81\x8F"
+    "\xE3\x82\x89",  /* Sakura Sakura */
+    "\xE8\x8D\x92\xE5\x9F\x8E\xE3\x81\xAE\xE6\x9C\x88",  /* Kojo no Tsuki */
+    "\xE8\xB5\xA4\xE3\x81\xA8\xE3\x82\x93\xE3\x81\xBC",  /* Akatombo */
+    "\xE6\x95\x85\xE9\x83\xB7",  /* Furusato */
+    "\xE6\x98\xA5\xE3\x81\xAE\xE5\xB0\x8F\xE5\xB7\x9D",  /* Haru no Ogawa */
+    "\xE6\x9C\x88\xE3\x81\xAE\xE6\xB2\x99\xE6\xBC\xA0",  /* Tsuki no Sabaku */
+    "\xE6\xB5\x9C\xE8\xBE\xBA\xE3\x81\xAE\xE6\xAD\x8C",  /* Hamabe no Uta */
+    "\xE3\x81\xB5\xE3\x82\x8B\xE3\x81\x95\xE3\x81\xA8\xE3\x81\xAE"
+    "\xE7\xA9\xBA",  /* Furusato no Sora */
+    "\xE4\xBA\xA4\xE9\x9F\xBF\xE6\x9B\xB2\xE7\xAC\xAC\xEF\xBC\x99"
+    "\xE7\x95\xAA\xE3\x80\x8C\xE5\x90\x88\xE5\x94\xB1\xE3\x80\x8D",
+    /* Symphony No. 9 "Choral" */
+    "\xE3\x82\xA2\xE3\x83\xB4\xE3\x82\xA7\xE3\x83\xBB\xE3\x83\x9E"
+    "\xE3\x83\xAA\xE3\x82\xA2",  /* Ave Maria (in katakana) */
+    "\xE3\x83\x94\xE3\x82\xA2\xE3\x83\x8E\xE5\x8D\x94\xE5\xA5\x8F"
+    "\xE6\x9B\xB2\xE7\xAC\xAC\xEF\xBC\x91\xE7\x95\xAA \xE2\x99\xAD"
+    "\xE3\x83\xAD\xE7\x9F\xAD\xE8\xAA\xBF",  /* Piano Concerto No. 1 */
+    NULL
+};
+
+/** Western titles, as they might appear in ISO 8859-1 CD-Text. */
+static char *western_titles[] = {
+    "F\xC3\xBCr Elise",
+    "Clair de lune",
+    "Gymnop\xC3\xA9" "die No. 1",
+    "Le Tombeau de Couperin: I. Pr\xC3\xA9lude",
+    "St\xC3\xA4ndchen (Schwanengesang, D. 957)",
+    "Die Forelle",
+    "Sinfon\xC3\xAD" "a No. 9 \"Del Nuevo Mundo\"",
+    "Caf\xC3\xA9 de Flore",
+    "L'apr\xC3\xA8s-midi d'un faune",
+    "Ma m\xC3\xA8re l'Oye",
+    "Eine kleine Nachtmusik",
+    "\xC3\x80 la claire fontaine",
+    NULL
+};
+
+
+/** Time encoding a corpus of titles.
+ *
+ * @param name the name of the benchmark
+ * @param titles the corpus (terminated by NULL)
+ * @param byte_count the function counting the bytes of an encoding
+ * @param encode the function encoding a title
+ */
+static void benchmark(const char *name, char **titles,
+		      size_t (*byte_count)(char *),
+		      uint8_t *(*encode)(char *, size_t *)) {
+    clock_t start, end;
+    size_t characters = 0, total = 0, size;
+    uint8_t *encoded;
+    int i, j;
+
+    for (j = 0; titles[j] != NULL; j++) {
+	characters += strlen(titles[j]);
+    }
+
+    start = clock();
+    for (i = 0; i < ITERATIONS; i++) {
+	for (j = 0; titles[j] != NULL; j++) {
+	    total += byte_count(titles[j]);
+	    encoded = encode(titles[j], &size);
+	    if (encoded == NULL) {
+		fprintf(stderr, "Could not encode %s\n", titles[j]);
+		exit(1);
+	    }
+	    total += size;
+	    free(encoded);
+	}
+    }
+    end = clock();
+
+    printf("%-8s %8.1f ns per UTF-8 byte (%lu bytes encoded)\n", name,
+	   (double)(end - start) / CLOCKS_PER_SEC * 1e9 /
+	   ((double)characters * ITERATIONS),
+	   (unsigned long)total);
+}  /* benchmark */
+
+
+int main(int argc, char *argv[]) {
+    (void)argc;
+    (void)argv;
+
+    benchmark("MS-JIS", japanese_titles, msjis_byte_count, utf8_to_msjis);
+    benchmark("Latin-1", western_titles, latin1_byte_count, utf8_to_latin1);
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+/* bench_sha1.c - Benchmark of the SHA-1 block transforms
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include "sha1.h"
+
+/** Number of blocks to transform with each implementation. */
+#define ITERATIONS 2000000
+
+/** Padded SHA-1 block of "abc". */
+static const uint8_t abc_block[64] = {
+    'a', 'b', 'c', 0x80, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0,
+    0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0x18
+};
+
+/** SHA-1 state after hashing "abc" (FIPS PUB 180-1). */
+static const uint32_t abc_state[5] = {
+    0xA9993E36, 0x4706816A, 0xBA3E2571, 0x7850C26C, 0x9CD0D89D
+};
+
+
+/** Time an implementation of cueify_sha1_transform().
+ *
+ * @param transform the implementation to time
+ * @return zero if the implementation hashed "abc" correctly
+ */
+static int benchmark(SHA1_TRANSFORM *transform) {
+    SHA1_CTX context;
+    clock_t start, end;
+    long i;
+
+    cueify_sha1_init(&context);
+    transform->transform(context.state, abc_block);
+    if (memcmp(context.state, abc_state, sizeof(abc_state)) != 0) {
+	printf("%-8s FAILED\n", transform->name);
+	return 1;
+    }
+
+    start = clock();
+    for (i = 0; i < ITERATIONS; i++) {
+	transform->transform(context.state, abc_block);
+    }
+    end = clock();
+
+    printf("%-8s %8.1f ns per block\n", transform->name,
+	   (double)(end - start) / CLOCKS_PER_SEC * 1e9 / ITERATIONS);
+    return 0;
+}  /* benchmark */
+
+
+/** Time an implementation hashing several messages at once.
+ *
+ * @param transform the implementation to time
+ * @return zero if the implementation hashed "abc" correctly in every lane
+ */
+static int benchmark_lanes(SHA1_LANES_TRANSFORM *transform) {
+    uint32_t state[5 * SHA1_MAX_LANES];
+    const uint8_t *blocks[SHA1_MAX_LANES];
+    SHA1_CTX context;
+    clock_t start, end;
+    size_t lanes = transform->lanes, i, j;
+    long k;
+
+    cueify_sha1_init(&context);
+    for (i = 0; i < lanes; i++) {
+	blocks[i] = abc_block;
+	for (j = 0; j < 5; j++) {
+	    state[j * lanes + i] = context.state[j];
+	}
+    }
+    transform->transform(state, blocks);
+    for (i = 0; i < lanes; i++) {
+	for (j = 0; j < 5; j++) {
+	    if (state[j * lanes + i] != abc_state[j]) {
+		printf("%-8s x%-2lu FAILED\n", transform->name,
+		       (unsigned long)lanes);
+		return 1;
+	    }
+	}
+    }
+
+    start = clock();
+    for (k = 0; k < ITERATIONS / (long)lanes; k++) {
+	transform->transform(state, blocks);
+    }
+    end = clock();
+
+    printf("%-8s x%-2lu %8.1f ns per block\n", transform->name,
+	   (unsigned long)lanes,
+	   (double)(end - start) / CLOCKS_PER_SEC * 1e9 / ITERATIONS);
+    return 0;
+}  /* benchmark_lanes */
+
+int main(int argc, char *argv[]) {
+    SHA1_TRANSFORM transforms[SHA1_MAX_TRANSFORMS];
+    SHA1_LANES_TRANSFORM lanes_transforms[SHA1_MAX_LANES_TRANSFORMS];
+    size_t count, i;
+    int failed = 0;
+
+    (void)argc;
+    (void)argv;
+
+    count = cueify_sha1_get_transforms(transforms);
+    for (i = 0; i < count; i++) {
+	failed += benchmark(&transforms[i]);
+    }
+    printf("\n");
+    count = cueify_sha1_get_lanes_transforms(lanes_transforms);
+    for (i = 0; i < count; i++) {
+	failed += benchmark_lanes(&lanes_transforms[i]);
+    }
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,257 @@
+/* check_async.c - Unit tests for libcueify asynchronous command queue
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <check.h>
+#include <cueify/types.h>
+#include <cueify/error.h>
+#include <cueify/device.h>
+#include <cueify/async.h>
+#include <cueify/track_data.h>
+#include "device_private.h"
+#include "async_private.h"
+#include "backend_private.h"
+
+/** Number of reads to submit; more than fit in the queue at once. */
+#define READS  (ASYNC_QUEUE_DEPTH + 4)
+
+/* Behaviours of the fake device. */
+#define FAKE_WORKING  0  /** Commands complete in the order issued. */
+#define FAKE_REMOVED  1  /** Reaping fails, as for a removed device. */
+#define FAKE_STALLED  2  /** Commands never complete. */
+
+int fake_mode;
+cueify_async_command_private *fake_queue[ASYNC_QUEUE_DEPTH];
+int fake_queued, fake_cancelled, fake_handle_open;
+cueify_device *dev;
+uint8_t buffers[READS][CUEIFY_RAW_READ_SIZE];
+int statuses[READS], callbacks;
+
+
+int fake_close(cueify_device_private *d) {
+    (void)d;
+    return CUEIFY_OK;
+}
+
+
+int fake_read_raw_sectors(cueify_device_private *d, uint32_t lba,
+			  uint32_t count, cueify_raw_read_private *buffer) {
+    if (fake_mode != FAKE_WORKING) {
+	return CUEIFY_ERR_INTERNAL;
+    }
+    memset(buffer, lba & 0xFF, count * sizeof(cueify_raw_read_private));
+    d->transferred += count * sizeof(cueify_raw_read_private);
+    return CUEIFY_OK;
+}
+
+
+int fake_issue(cueify_device_private *d, cueify_async_command_private *c) {
+    (void)d;
+    if (!fake_handle_open) {
+	return CUEIFY_ERR_NO_DEVICE;
+    }
+    fail_unless(fake_queued < ASYNC_QUEUE_DEPTH,
+		"More commands issued than fit in the queue");
+    fake_queue[fake_queued++] = c;
+    return CUEIFY_OK;
+}
+
+
+int fake_reap(cueify_device_private *d, int wait,
+	      cueify_async_command_private **c) {
+    (void)wait;
+    *c = NULL;
+    if (fake_mode == FAKE_REMOVED) {
+	return CUEIFY_ERR_INTERNAL;
+    } else if (fake_mode == FAKE_STALLED || fake_queued == 0) {
+	return CUEIFY_OK;
+    }
+
+    *c = fake_queue[0];
+    memmove(fake_queue, fake_queue + 1,
+	    --fake_queued * sizeof(cueify_async_command_private *));
+    (*c)->transferred = (*c)->count * sizeof(cueify_raw_read_private);
+    return fake_read_raw_sectors(d, (*c)->lba, (*c)->count, (*c)->sectors);
+}
+
+
+void fake_cancel(cueify_device_private *d) {
+    (void)d;
+    fake_cancelled += fake_queued;
+    fake_queued = 0;
+    fake_handle_open = 0;
+}
+
+
+const cueify_device_backend fake_backend = {
+    fake_close, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL, NULL,
+    fake_read_raw_sectors, fake_issue, fake_reap, fake_cancel, NULL
+};
+
+
+void read_done(void *context, int status) {
+    statuses[((uint8_t *)context - buffers[0]) / CUEIFY_RAW_READ_SIZE] =
+	status;
+    callbacks++;
+}
+
+
+void setup() {
+    cueify_device_private *d;
+    int i;
+
+    fake_mode = FAKE_WORKING;
+    fake_queued = 0;
+    fake_cancelled = 0;
+    fake_handle_open = 1;
+    callbacks = 0;
+    for (i = 0; i < READS; i++) {
+	statuses[i] = -1;
+    }
+    memset(buffers, 0xFF, sizeof(buffers));
+
+    dev = cueify_device_new();
+    fail_unless(dev != NULL, "Failed to create cueify_device object");
+    d = (cueify_device_private *)dev;
+    d->backend = &fake_backend;
+    d->max_transfer = CUEIFY_RAW_READ_SIZE;
+}
+
+
+void teardown() {
+    cueify_device_free(dev);
+}
+
+
+/** Submit READS single-sector reads, one into each buffer. */
+void submit_reads() {
+    int i;
+
+    for (i = 0; i < READS; i++) {
+	fail_unless(cueify_device_submit_read_raw_sectors(
+			dev, i, 1, buffers[i], sizeof(buffers[i]),
+			read_done, buffers[i]) == CUEIFY_OK,
+		    "Failed to submit read %d", i);
+    }
+}
+
+
+START_TEST (test_close_full_queue)
+{
+    int i;
+
+    submit_reads();
+    fail_unless(fake_queued == ASYNC_QUEUE_DEPTH,
+		"Queue of the device was not full");
+
+    fail_unless(cueify_device_close(dev) == CUEIFY_OK,
+		"Failed to close device");
+    fail_unless(fake_queued == 0 && fake_cancelled == 0,
+		"Commands were left in flight on the device");
+    fail_unless(callbacks == READS, "Not every request was called back");
+    for (i = 0; i < READS; i++) {
+	fail_unless(statuses[i] == CUEIFY_OK && buffers[i][0] == i,
+		    "Read %d did not complete", i);
+    }
+}
+END_TEST
+
+
+START_TEST (test_removed_device)
+{
+    int i;
+
+    /* Filling the queue must not wait forever for a removed device. */
+    fake_mode = FAKE_REMOVED;
+    submit_reads();
+    fail_unless(fake_cancelled == ASYNC_QUEUE_DEPTH,
+		"Commands in flight were not cancelled");
+
+    fail_unless(cueify_device_complete(dev, 1) == CUEIFY_OK,
+		"Failed to complete requests");
+    fail_unless(callbacks == READS, "Not every request was called back");
+    fail_unless(cueify_device_get_pending(dev) == 0,
+		"Requests are still pending");
+    for (i = 0; i < READS; i++) {
+	fail_unless(statuses[i] == CUEIFY_ERR_INTERNAL,
+		    "Read %d did not fail", i);
+    }
+    fail_unless(cueify_device_close(dev) == CUEIFY_OK,
+		"Failed to close device");
+}
+END_TEST
+
+
+START_TEST (test_stalled_device)
+{
+    int i;
+
+    fake_mode = FAKE_STALLED;
+    for (i = 0; i < ASYNC_QUEUE_DEPTH; i++) {
+	fail_unless(cueify_device_submit_read_raw_sectors(
+			dev, i, 1, buffers[i], sizeof(buffers[i]),
+			read_done, buffers[i]) == CUEIFY_OK,
+		    "Failed to submit read %d", i);
+    }
+
+    /* Closing must not wait forever for commands which never complete. */
+    fail_unless(cueify_device_close(dev) == CUEIFY_OK,
+		"Failed to close device");
+    fail_unless(fake_cancelled == ASYNC_QUEUE_DEPTH,
+		"Commands in flight were not cancelled");
+    fail_unless(callbacks == ASYNC_QUEUE_DEPTH,
+		"Not every request was called back");
+    for (i = 0; i < ASYNC_QUEUE_DEPTH; i++) {
+	fail_unless(statuses[i] == CUEIFY_ERR_INTERNAL,
+		    "Read %d did not fail", i);
+    }
+}
+END_TEST
+
+
+Suite *async_suite() {
+    Suite *s = suite_create("async");
+    TCase *tc_core = tcase_create("core");
+
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_close_full_queue);
+    tcase_add_test(tc_core, test_removed_device);
+    tcase_add_test(tc_core, test_stalled_device);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+
+int main() {
+    int number_failed;
+    Suite *s = async_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
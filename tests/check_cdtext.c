@@ -29,7 +29,9 @@
 #include <cueify/constants.h>
 #include <cueify/error.h>
 #include <cueify/cdtext.h>
+#include <cueify/charsets.h>
 #include "cdtext_private.h"
+#include "charsets.h"
 
 #include "check_cdtext.cdt.h"
 
@@ -204,6 +206,54 @@ START_TEST (test_serialize)
 END_TEST
 
 
+START_TEST (test_serialize_alloc)
+{
+    cueify_cdtext *cdtext = (cueify_cdtext *)&mock_cdtext;
+    size_t size;
+    uint8_t *buffer;
+    uint8_t small_buffer[sizeof(serialized_mock_cdtext) - 1];
+
+    fail_unless(cueify_cdtext_serialize_alloc(cdtext, &buffer, &size) ==
+		CUEIFY_OK,
+		"Could not serialize CD-Text");
+    fail_unless(size == sizeof(serialized_mock_cdtext),
+		"Serialized CD-Text size incorrect");
+    fail_unless(memcmp(buffer, serialized_mock_cdtext,
+		       sizeof(serialized_mock_cdtext)) == 0,
+		"Serialized CD-Text incorrect");
+    free(buffer);
+
+    /* Too small a buffer should not be written beyond. */
+    size = sizeof(small_buffer);
+    fail_unless(cueify_cdtext_serialize(cdtext, small_buffer, &size) ==
+		CUEIFY_ERR_TOOSMALL,
+		"Serialized CD-Text into too small a buffer");
+    fail_unless(size == sizeof(serialized_mock_cdtext),
+		"Serialized CD-Text size incorrect");
+}
+END_TEST
+
+
+START_TEST (test_serialize_bad_tocinfo)
+{
+    cueify_cdtext *cdtext = (cueify_cdtext *)&mock_cdtext;
+    size_t size;
+    uint8_t *buffer;
+
+    /* A TOCINFO whose first track is after its last can't be written. */
+    mock_cdtext.toc.first_track_number = 13;
+    mock_cdtext.toc.last_track_number = 1;
+
+    fail_unless(cueify_cdtext_serialize(cdtext, NULL, &size) ==
+		CUEIFY_ERR_CORRUPTED,
+		"Sized CD-Text with a backwards TOCINFO");
+    fail_unless(cueify_cdtext_serialize_alloc(cdtext, &buffer, &size) ==
+		CUEIFY_ERR_CORRUPTED && buffer == NULL,
+		"Serialized CD-Text with a backwards TOCINFO");
+}
+END_TEST
+
+
 START_TEST (test_deserialize)
 {
     cueify_cdtext_private deserialized_mock_cdtext;
@@ -346,6 +396,460 @@ START_TEST (test_deserialize)
 			   mock_block->genre_name) == 0,
 		    "Deserialized CD-Text block genre name incorrect");
     }
+
+    /* Free the arena the deserialized strings and intervals live in. */
+    cueify_cdtext_clear(&deserialized_mock_cdtext);
+}
+END_TEST
+
+
+START_TEST (test_arena)
+{
+    cueify_cdtext_private *cdtext;
+    const char *title;
+    int i;
+
+    cdtext = (cueify_cdtext_private *)cueify_cdtext_new();
+    /* Deserializing again must replace (not leak or keep) the strings. */
+    for (i = 0; i < 2; i++) {
+	fail_unless(cueify_cdtext_deserialize((cueify_cdtext *)cdtext,
+					      serialized_mock_cdtext,
+					      sizeof(serialized_mock_cdtext)) ==
+		    CUEIFY_OK,
+		    "Could not deserialize CD-Text");
+    }
+
+    fail_unless(cdtext->arena != NULL && cdtext->arena->next == NULL,
+		"CD-Text strings were not allocated from a single chunk");
+    title = cdtext->blocks[0].titles[1];
+    fail_unless(title != NULL &&
+		strcmp(title, mock_cdtext.blocks[0].titles[1]) == 0,
+		"Deserialized CD-Text title incorrect");
+    fail_unless(title >= cdtext->arena->data &&
+		title < cdtext->arena->data + cdtext->arena->used,
+		"CD-Text title was not allocated from the arena");
+
+    cueify_cdtext_free((cueify_cdtext *)cdtext);
+}
+END_TEST
+
+
+START_TEST (test_view)
+{
+    cueify_cdtext *cdtext;
+    cueify_cdtext_view *view;
+    cueify_cdtext_block *b;
+    const char *(*getters[8])(cueify_cdtext_block *, uint8_t) = {
+	cueify_cdtext_block_get_title,
+	cueify_cdtext_block_get_performer,
+	cueify_cdtext_block_get_songwriter,
+	cueify_cdtext_block_get_composer,
+	cueify_cdtext_block_get_arranger,
+	cueify_cdtext_block_get_message,
+	cueify_cdtext_block_get_private,
+	cueify_cdtext_block_get_upc_isrc
+    };
+    uint8_t types[8] = {
+	CUEIFY_CDTEXT_PACK_TITLE, CUEIFY_CDTEXT_PACK_PERFORMER,
+	CUEIFY_CDTEXT_PACK_SONGWRITER, CUEIFY_CDTEXT_PACK_COMPOSER,
+	CUEIFY_CDTEXT_PACK_ARRANGER, CUEIFY_CDTEXT_PACK_MESSAGE,
+	CUEIFY_CDTEXT_PACK_PRIVATE, CUEIFY_CDTEXT_PACK_UPC_ISRC
+    };
+    const char *expected;
+    char buffer[256];
+    size_t size;
+    int block, i, track, result;
+
+    cdtext = cueify_cdtext_new();
+    fail_unless(cueify_cdtext_deserialize(cdtext, serialized_mock_cdtext,
+					  sizeof(serialized_mock_cdtext)) ==
+		CUEIFY_OK,
+		"Could not deserialize CD-Text");
+    view = cueify_cdtext_view_new();
+    fail_unless(cueify_cdtext_view_index(view, serialized_mock_cdtext,
+					 sizeof(serialized_mock_cdtext)) ==
+		CUEIFY_OK,
+		"Could not index CD-Text");
+
+    fail_unless(cueify_cdtext_view_get_num_blocks(view) ==
+		cueify_cdtext_get_num_blocks(cdtext),
+		"Number of blocks in CD-Text view did not match");
+    for (block = 0; block < cueify_cdtext_get_num_blocks(cdtext); block++) {
+	b = cueify_cdtext_get_block(cdtext, block);
+	fail_unless(cueify_cdtext_view_get_charset(view, block) ==
+		    cueify_cdtext_block_get_charset(b),
+		    "Character set of CD-Text view block did not match");
+	fail_unless(cueify_cdtext_view_get_language(view, block) ==
+		    cueify_cdtext_block_get_language(b),
+		    "Language of CD-Text view block did not match");
+
+	/* Every string must decode as it does when deserialized. */
+	for (i = 0; i < 8; i++) {
+	    for (track = CUEIFY_CDTEXT_ALBUM; track <= 12; track++) {
+		expected = getters[i](b, track);
+		size = sizeof(buffer);
+		result = cueify_cdtext_view_get_string(view, block, types[i],
+						       track, buffer, &size);
+		if (expected == NULL) {
+		    fail_unless(result == CUEIFY_NO_DATA,
+				"CD-Text view decoded a missing string");
+		} else {
+		    fail_unless(result == CUEIFY_OK &&
+				strcmp(buffer, expected) == 0 &&
+				size == strlen(expected) + 1,
+				"CD-Text view string did not match");
+		}
+	    }
+	}
+    }
+
+    b = cueify_cdtext_get_block(cdtext, 0);
+    size = sizeof(buffer);
+    fail_unless(cueify_cdtext_view_get_string(view, 0,
+					      CUEIFY_CDTEXT_PACK_DISCID,
+					      CUEIFY_CDTEXT_ALBUM,
+					      buffer, &size) == CUEIFY_OK &&
+		strcmp(buffer, cueify_cdtext_block_get_discid(b)) == 0,
+		"CD-Text view disc ID did not match");
+    size = sizeof(buffer);
+    fail_unless(cueify_cdtext_view_get_string(view, 0,
+					      CUEIFY_CDTEXT_PACK_GENRE,
+					      CUEIFY_CDTEXT_ALBUM,
+					      buffer, &size) == CUEIFY_OK &&
+		strcmp(buffer, cueify_cdtext_block_get_genre_name(b)) == 0,
+		"CD-Text view genre name did not match");
+
+    /* Query the size, then try a buffer which is too small. */
+    expected = cueify_cdtext_block_get_title(b, 8);
+    fail_unless(cueify_cdtext_view_get_string(view, 0,
+					      CUEIFY_CDTEXT_PACK_TITLE, 8,
+					      NULL, &size) == CUEIFY_OK &&
+		size == strlen(expected) + 1,
+		"CD-Text view string size incorrect");
+    size = 4;
+    fail_unless(cueify_cdtext_view_get_string(view, 0,
+					      CUEIFY_CDTEXT_PACK_TITLE, 8,
+					      buffer, &size) ==
+		CUEIFY_ERR_TOOSMALL &&
+		size == strlen(expected) + 1,
+		"CD-Text view did not report a buffer as too small");
+    size = sizeof(buffer);
+    fail_unless(cueify_cdtext_view_get_string(view, 0,
+					      CUEIFY_CDTEXT_PACK_TITLE, 13,
+					      buffer, &size) == CUEIFY_NO_DATA,
+		"CD-Text view decoded a string for a missing track");
+
+    cueify_cdtext_view_free(view);
+    cueify_cdtext_free(cdtext);
+}
+END_TEST
+
+
+START_TEST (test_crc)
+{
+    cueify_cdtext *cdtext;
+    uint8_t buffer[sizeof(serialized_mock_cdtext)];
+    cueify_cdtext_block *b;
+
+    /* Corrupt the text of the second title PACK. */
+    memcpy(buffer, serialized_mock_cdtext, sizeof(buffer));
+    buffer[4 + 18 + 4] ^= 0xFF;
+
+    cdtext = cueify_cdtext_new();
+    fail_unless(cueify_cdtext_deserialize(cdtext, serialized_mock_cdtext,
+					  sizeof(serialized_mock_cdtext)) ==
+		CUEIFY_OK &&
+		cueify_cdtext_get_num_bad_packs(cdtext) == 0,
+		"Valid CD-Text failed its CRC check");
+
+    fail_unless(cueify_cdtext_deserialize(cdtext, buffer, sizeof(buffer)) ==
+		CUEIFY_OK &&
+		cueify_cdtext_get_num_bad_packs(cdtext) == 1,
+		"Corrupted CD-Text PACK was not counted");
+    b = cueify_cdtext_get_block(cdtext, 0);
+    fail_unless(strcmp(cueify_cdtext_block_get_title(b, 1),
+		       mock_cdtext.blocks[0].titles[1]) != 0,
+		"Corrupted CD-Text PACK was not used");
+
+    fail_unless(cueify_cdtext_set_crc_mode(cdtext,
+					   CUEIFY_CDTEXT_CRC_STRICT) ==
+		CUEIFY_OK,
+		"Could not set CD-Text CRC mode");
+    fail_unless(cueify_cdtext_deserialize(cdtext, buffer, sizeof(buffer)) ==
+		CUEIFY_ERR_CORRUPTED &&
+		cueify_cdtext_get_num_blocks(cdtext) == 0,
+		"Corrupted CD-Text PACK was accepted in strict mode");
+
+    fail_unless(cueify_cdtext_set_crc_mode(cdtext,
+					   CUEIFY_CDTEXT_CRC_DROP) ==
+		CUEIFY_OK,
+		"Could not set CD-Text CRC mode");
+    fail_unless(cueify_cdtext_deserialize(cdtext, buffer, sizeof(buffer)) ==
+		CUEIFY_OK &&
+		cueify_cdtext_get_num_bad_packs(cdtext) == 1,
+		"Corrupted CD-Text PACK was not counted");
+    b = cueify_cdtext_get_block(cdtext, 0);
+    fail_unless(strcmp(cueify_cdtext_block_get_title(b, CUEIFY_CDTEXT_ALBUM),
+		       mock_cdtext.blocks[0].titles[0]) == 0,
+		"CD-Text PACK before the corrupted PACK was not used");
+    fail_unless(strcmp(cueify_cdtext_block_get_title(b, 1),
+		       mock_cdtext.blocks[0].titles[1]) != 0,
+		"Corrupted CD-Text PACK was not dropped");
+
+    fail_unless(cueify_cdtext_set_crc_mode(cdtext, 3) == CUEIFY_ERR_BADARG,
+		"Invalid CD-Text CRC mode was accepted");
+
+    cueify_cdtext_free(cdtext);
+}
+END_TEST
+
+
+START_TEST (test_check_packs)
+{
+    uint8_t buffer[sizeof(serialized_mock_cdtext)];
+    size_t num_packs = (sizeof(buffer) - 4) / 18, i;
+    uint8_t bitmap[(sizeof(buffer) - 4) / 18 / 8 + 1];
+
+    memcpy(buffer, serialized_mock_cdtext, sizeof(buffer));
+    memset(bitmap, 0xFF, sizeof(bitmap));
+    fail_unless(cueify_cdtext_check_packs(buffer + 4, num_packs, bitmap) == 0,
+		"Valid CD-Text PACKs failed their CRC check");
+    for (i = 0; i < num_packs; i++) {
+	fail_unless((bitmap[i / 8] & (1 << (i % 8))) == 0,
+		    "Valid CD-Text PACK marked as failing its CRC check");
+    }
+
+    /* Corrupt the data of one PACK and the CRC of another. */
+    buffer[4 + 18 * 1 + 4] ^= 0x01;
+    buffer[4 + 18 * 9 + 17] ^= 0x80;
+    fail_unless(cueify_cdtext_check_packs(buffer + 4, num_packs, bitmap) == 2,
+		"Corrupted CD-Text PACKs passed their CRC check");
+    for (i = 0; i < num_packs; i++) {
+	fail_unless(((bitmap[i / 8] >> (i % 8)) & 1) == (i == 1 || i == 9),
+		    "Wrong CD-Text PACK marked as failing its CRC check");
+    }
+    fail_unless(cueify_cdtext_check_packs(buffer + 4, 7, NULL) == 1,
+		"Corrupted CD-Text PACKs not counted without a bitmap");
+}
+END_TEST
+
+
+/** Results of parsing CD-Text with a CD-Text parser. */
+struct parsed_cdtext {
+    int count;  /** Number of CD-Text parsed. */
+    int status;  /** Status of the last CD-Text parsed. */
+    size_t size;  /** Size of the last CD-Text parsed, once serialized. */
+    uint8_t buffer[sizeof(serialized_mock_cdtext)];  /** Serialized. */
+};
+
+
+static void parsed(void *context, int status, cueify_cdtext *t) {
+    struct parsed_cdtext *results = (struct parsed_cdtext *)context;
+
+    results->count++;
+    results->status = status;
+    results->size = sizeof(results->buffer);
+    if (cueify_cdtext_serialize(t, results->buffer,
+				&results->size) != CUEIFY_OK) {
+	results->size = 0;
+    }
+}
+
+
+START_TEST (test_parser)
+{
+    cueify_cdtext_parser *parser;
+    struct parsed_cdtext results;
+    uint8_t buffer[sizeof(serialized_mock_cdtext) * 2];
+    size_t i, chunk;
+
+    memcpy(buffer, serialized_mock_cdtext, sizeof(serialized_mock_cdtext));
+    memcpy(buffer + sizeof(serialized_mock_cdtext), serialized_mock_cdtext,
+	   sizeof(serialized_mock_cdtext));
+
+    memset(&results, 0, sizeof(results));
+    parser = cueify_cdtext_parser_new(parsed, &results);
+    fail_unless(parser != NULL, "Could not create CD-Text parser");
+
+    /* Feed two concatenated CD-Texts in ragged chunks. */
+    for (i = 0; i < sizeof(buffer); i += chunk) {
+	chunk = i % 23 + 1;
+	if (chunk > sizeof(buffer) - i) {
+	    chunk = sizeof(buffer) - i;
+	}
+	fail_unless(cueify_cdtext_parser_feed(parser, buffer + i, chunk) ==
+		    CUEIFY_OK,
+		    "Could not feed CD-Text parser");
+	if (i + chunk <= sizeof(serialized_mock_cdtext)) {
+	    fail_unless(results.count == 0 ||
+			i + chunk == sizeof(serialized_mock_cdtext),
+			"CD-Text parsed before its last PACK");
+	}
+    }
+    fail_unless(results.count == 2, "CD-Text parser did not parse all CD-Text");
+    fail_unless(results.status == CUEIFY_OK &&
+		results.size == sizeof(serialized_mock_cdtext) &&
+		memcmp(results.buffer, serialized_mock_cdtext,
+		       results.size) == 0,
+		"Parsed CD-Text did not match");
+    fail_unless(cueify_cdtext_parser_finish(parser) == CUEIFY_OK,
+		"CD-Text parser did not end with a complete CD-Text");
+
+    /* Feed it all at once, then a partial CD-Text. */
+    fail_unless(cueify_cdtext_parser_feed(parser, buffer, sizeof(buffer)) ==
+		CUEIFY_OK && results.count == 4,
+		"Could not feed CD-Text parser");
+    fail_unless(cueify_cdtext_parser_feed(parser, buffer, 100) ==
+		CUEIFY_OK && results.count == 4,
+		"Could not feed CD-Text parser");
+    fail_unless(cueify_cdtext_parser_finish(parser) == CUEIFY_ERR_TRUNCATED,
+		"CD-Text parser ended with a partial CD-Text");
+
+    /* Strict CRC checks apply to each CD-Text separately. */
+    buffer[4 + 18 + 4] ^= 0xFF;
+    fail_unless(cueify_cdtext_parser_set_crc_mode(
+		    parser, CUEIFY_CDTEXT_CRC_STRICT) == CUEIFY_OK,
+		"Could not set CD-Text parser CRC mode");
+    fail_unless(cueify_cdtext_parser_feed(parser, buffer,
+					  sizeof(serialized_mock_cdtext)) ==
+		CUEIFY_OK && results.count == 5 &&
+		results.status == CUEIFY_ERR_CORRUPTED,
+		"Corrupted CD-Text PACK was accepted in strict mode");
+    fail_unless(cueify_cdtext_parser_feed(parser,
+					  buffer +
+					  sizeof(serialized_mock_cdtext),
+					  sizeof(serialized_mock_cdtext)) ==
+		CUEIFY_OK && results.count == 6 &&
+		results.status == CUEIFY_OK,
+		"CD-Text after a corrupted CD-Text was not parsed");
+
+    cueify_cdtext_parser_free(parser);
+}
+END_TEST
+
+
+START_TEST (test_charsets)
+{
+    uint8_t *encoded;
+    size_t size;
+
+    /* A sequence encoded as a single MS-JIS character. */
+    encoded = utf8_to_msjis("\xC2\xA0\xF3\xA0\x87\xAF", &size);
+    fail_unless(encoded != NULL && size == 4 &&
+		memcmp(encoded, "\xF6\x40\0\0", 4) == 0,
+		"MS-JIS encoding of a sequence did not match");
+    free(encoded);
+
+    /* The first codepoint of a sequence on its own. */
+    encoded = utf8_to_msjis("\xC2\xA0" "a", &size);
+    fail_unless(encoded != NULL && size == 6 &&
+		memcmp(encoded, "\xF8\xA0\xF8\x82\0\0", 6) == 0,
+		"MS-JIS encoding of a partial sequence did not match");
+    fail_unless(msjis_byte_count("\xC2\xA0" "a") == size,
+		"MS-JIS byte count did not match");
+    free(encoded);
+
+    /* Truncated and unencodable characters become '?'. */
+    encoded = utf8_to_latin1("Caf\xC3\xA9 \xE3\x81", &size);
+    fail_unless(encoded != NULL && size == 7 &&
+		memcmp(encoded, "Caf\xE9 ?", 7) == 0,
+		"ISO 8859-1 encoding did not match");
+    fail_unless(latin1_byte_count("Caf\xC3\xA9 \xE3\x81") == size,
+		"ISO 8859-1 byte count did not match");
+    free(encoded);
+}
+END_TEST
+
+
+START_TEST (test_ascii_runs)
+{
+    const char *text = "A long run of ASCII, longer than any one vector.";
+    char buffer[128], *decoded;
+    uint8_t *encoded;
+    size_t size, i;
+
+    /* Runs end at the first byte of DEL or above, wherever it is. */
+    for (i = 0; i < strlen(text); i++) {
+	strcpy(buffer, text);
+	buffer[i] = '\x7F';
+	fail_unless(ascii_span((uint8_t *)buffer, strlen(text)) == i,
+		    "Run of ASCII did not end at DEL");
+	buffer[i] = '\xE9';
+	fail_unless(ascii_span((uint8_t *)buffer, strlen(text)) == i,
+		    "Run of ASCII did not end at a non-ASCII byte");
+    }
+    fail_unless(ascii_span((uint8_t *)text, strlen(text)) == strlen(text),
+		"Run of ASCII did not span the whole string");
+
+    /* DEL is FULL BLOCK in the CD-Text variant of ISO 8859-1. */
+    sprintf(buffer, "%s\x7F%s\xE9", text, text);
+    decoded = latin1_to_utf8((uint8_t *)buffer, -1);
+    fail_unless(decoded != NULL && strlen(decoded) == 2 * strlen(text) + 5 &&
+		memcmp(decoded + strlen(text), "\xE2\x96\x88", 3) == 0 &&
+		strcmp(decoded + 2 * strlen(text) + 3, "\xC3\xA9") == 0,
+		"ISO 8859-1 decoding did not match");
+
+    encoded = utf8_to_latin1(decoded, &size);
+    fail_unless(encoded != NULL && size == strlen(buffer) + 1 &&
+		strcmp((char *)encoded, buffer) == 0,
+		"ISO 8859-1 encoding did not round-trip");
+    free(encoded);
+    free(decoded);
+
+    encoded = utf8_to_ascii("\x7F" "Caf\xC3\xA9 au lait", &size);
+    fail_unless(encoded != NULL && size == 14 &&
+		strcmp((char *)encoded, "\x7F" "Caf? au lait") == 0,
+		"ASCII encoding did not match");
+    fail_unless(ascii_byte_count("\x7F" "Caf\xC3\xA9 au lait") == size,
+		"ASCII byte count did not match");
+    free(encoded);
+}
+END_TEST
+
+
+START_TEST (test_charsets_into)
+{
+    uint8_t buffer[32];
+    char utf8[32];
+    size_t size;
+
+    /* Too small a buffer gets the size needed. */
+    size = cueify_utf8_to_msjis_into("\xC2\xA0" "a", buffer, 4);
+    fail_unless(size == 6, "MS-JIS size needed did not match");
+    size = cueify_utf8_to_msjis_into("\xC2\xA0" "a", buffer, size);
+    fail_unless(size == 6 && memcmp(buffer, "\xF8\xA0\xF8\x82\0\0", 6) == 0,
+		"MS-JIS encoding into a buffer did not match");
+
+    fail_unless(cueify_utf8_to_latin1_into("Caf\xC3\xA9", NULL, 0) == 5,
+		"ISO 8859-1 size needed did not match");
+    size = cueify_utf8_to_latin1_into("Caf\xC3\xA9", buffer, 5);
+    fail_unless(size == 5 && memcmp(buffer, "Caf\xE9", 5) == 0,
+		"ISO 8859-1 encoding into a buffer did not match");
+
+    size = cueify_utf8_to_ascii_into("Caf\xC3\xA9", buffer, 4);
+    fail_unless(size == 5, "ASCII size needed did not match");
+    size = cueify_utf8_to_ascii_into("Caf\xC3\xA9", buffer,
+				     sizeof(buffer));
+    fail_unless(size == 5 && memcmp(buffer, "Caf?", 5) == 0,
+		"ASCII encoding into a buffer did not match");
+
+    /* And the same for decoding. */
+    size = cueify_latin1_to_utf8_into((uint8_t *)"Caf\xE9\0Th\xE9", 8,
+				      utf8, 6);
+    fail_unless(size == 11, "ISO 8859-1 size needed did not match");
+    size = cueify_latin1_to_utf8_into((uint8_t *)"Caf\xE9\0Th\xE9", 8,
+				      utf8, size);
+    fail_unless(size == 11 &&
+		memcmp(utf8, "Caf\xC3\xA9\0Th\xC3\xA9", 11) == 0,
+		"ISO 8859-1 decoding into a buffer did not match");
+
+    fail_unless(cueify_msjis_to_utf8_into((uint8_t *)"\xF6\x40\0\0", -1,
+					  NULL, 0) == 7,
+		"MS-JIS size needed did not match");
+    size = cueify_msjis_to_utf8_into((uint8_t *)"\xF6\x40\0\0", -1,
+				     utf8, 7);
+    fail_unless(size == 7 && strcmp(utf8, "\xC2\xA0\xF3\xA0\x87\xAF") == 0,
+		"MS-JIS decoding into a buffer did not match");
 }
 END_TEST
 
@@ -542,7 +1046,17 @@ Suite *toc_suite() {
 
     tcase_add_checked_fixture(tc_core, setup, teardown);
     tcase_add_test(tc_core, test_serialize);
+    tcase_add_test(tc_core, test_serialize_alloc);
+    tcase_add_test(tc_core, test_serialize_bad_tocinfo);
     tcase_add_test(tc_core, test_deserialize);
+    tcase_add_test(tc_core, test_arena);
+    tcase_add_test(tc_core, test_view);
+    tcase_add_test(tc_core, test_crc);
+    tcase_add_test(tc_core, test_check_packs);
+    tcase_add_test(tc_core, test_parser);
+    tcase_add_test(tc_core, test_charsets);
+    tcase_add_test(tc_core, test_ascii_runs);
+    tcase_add_test(tc_core, test_charsets_into);
     tcase_add_test(tc_core, test_getters);
     tcase_add_test(tc_core, test_block_getters);
     tcase_add_test(tc_core, test_french);
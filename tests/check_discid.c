@@ -24,6 +24,8 @@
  */
 
 #include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
 #include <check.h>
 #include <cueify/types.h>
 #include <cueify/error.h>
@@ -34,6 +36,7 @@
 #include "toc_private.h"
 #include "sessions_private.h"
 #include "full_toc_private.h"
+#include "sha1.h"
 
 cueify_toc_private cdda_toc, data_first_toc, data_last_toc;
 cueify_sessions_private cdda_sessions, data_first_sessions, data_last_sessions;
@@ -473,6 +476,221 @@ START_TEST (test_full_toc_musicbrainz_data_last)
 END_TEST
 
 
+START_TEST (test_musicbrainz_into)
+{
+    char mbid[CUEIFY_MUSICBRAINZ_ID_SIZE];
+
+    fail_unless(cueify_toc_get_musicbrainz_id_into(
+		    (cueify_toc *)&data_last_toc,
+		    (cueify_sessions *)&data_last_sessions,
+		    mbid, sizeof(mbid) - 1) == CUEIFY_ERR_TOOSMALL,
+		"Did not reject too small a buffer for a MusicBrainz ID");
+    fail_unless(cueify_toc_get_musicbrainz_id_into(
+		    (cueify_toc *)&data_last_toc,
+		    (cueify_sessions *)&data_last_sessions,
+		    mbid, sizeof(mbid)) == CUEIFY_OK &&
+		strcmp(mbid, DATA_LAST_MUSICBRAINZ_ID) == 0,
+		"Did not get correct MusicBrainz ID from data-last TOC/Sessions");
+    fail_unless(cueify_full_toc_get_musicbrainz_id_into(
+		    (cueify_full_toc *)&data_first_full_toc,
+		    mbid, sizeof(mbid)) == CUEIFY_OK &&
+		strcmp(mbid, DATA_FIRST_MUSICBRAINZ_ID) == 0,
+		"Did not get correct MusicBrainz ID from data-first full TOC");
+}
+END_TEST
+
+
+START_TEST (test_musicbrainz_batch)
+{
+    /* Enough discs to fill several sets of lanes and leave some over. */
+    const char *expected[3] = {
+	CDDA_MUSICBRAINZ_ID, DATA_FIRST_MUSICBRAINZ_ID, DATA_LAST_MUSICBRAINZ_ID
+    };
+    cueify_toc *tocs[37];
+    cueify_sessions *sessions[37];
+    cueify_full_toc *full_tocs[37];
+    char ids[37 * CUEIFY_MUSICBRAINZ_ID_SIZE];
+    int i;
+
+    for (i = 0; i < 37; i++) {
+	switch (i % 3) {
+	case 0:
+	    tocs[i] = (cueify_toc *)&cdda_toc;
+	    sessions[i] = (cueify_sessions *)&cdda_sessions;
+	    full_tocs[i] = (cueify_full_toc *)&cdda_full_toc;
+	    break;
+	case 1:
+	    tocs[i] = (cueify_toc *)&data_first_toc;
+	    sessions[i] = (cueify_sessions *)&data_first_sessions;
+	    full_tocs[i] = (cueify_full_toc *)&data_first_full_toc;
+	    break;
+	default:
+	    tocs[i] = (cueify_toc *)&data_last_toc;
+	    sessions[i] = (cueify_sessions *)&data_last_sessions;
+	    full_tocs[i] = (cueify_full_toc *)&data_last_full_toc;
+	    break;
+	}
+    }
+
+    fail_unless(cueify_toc_get_musicbrainz_id_batch(tocs, sessions, 37,
+						    ids) == CUEIFY_OK,
+		"Could not get MusicBrainz IDs of a batch of TOCs");
+    for (i = 0; i < 37; i++) {
+	fail_unless(strcmp(ids + i * CUEIFY_MUSICBRAINZ_ID_SIZE,
+			   expected[i % 3]) == 0,
+		    "Did not get correct MusicBrainz ID %d from batch of TOCs",
+		    i);
+    }
+
+    fail_unless(cueify_full_toc_get_musicbrainz_id_batch(full_tocs, 37,
+							 ids) == CUEIFY_OK,
+		"Could not get MusicBrainz IDs of a batch of full TOCs");
+    for (i = 0; i < 37; i++) {
+	fail_unless(strcmp(ids + i * CUEIFY_MUSICBRAINZ_ID_SIZE,
+			   expected[i % 3]) == 0,
+		    "Did not get correct MusicBrainz ID %d from batch of "
+		    "full TOCs", i);
+    }
+
+    /* A single disc, which fills only one lane. */
+    fail_unless(cueify_toc_get_musicbrainz_id_batch(tocs + 2, NULL, 1,
+						    ids) == CUEIFY_OK &&
+		strcmp(ids, DATA_LAST_MUSICBRAINZ_ID) == 0,
+		"Did not get correct MusicBrainz ID from batch of one TOC");
+
+    fail_unless(cueify_toc_get_musicbrainz_id_batch(NULL, NULL, 0,
+						    NULL) == CUEIFY_OK,
+		"Could not get MusicBrainz IDs of an empty batch");
+    tocs[20] = NULL;
+    fail_unless(cueify_toc_get_musicbrainz_id_batch(tocs, sessions, 37,
+						    ids) == CUEIFY_ERR_BADARG,
+		"Did not reject a batch of TOCs containing NULL");
+}
+END_TEST
+
+
+START_TEST (test_freedb_batch)
+{
+    cueify_toc_private *fixtures[3] = {
+	&cdda_toc, &data_first_toc, &data_last_toc
+    };
+    uint32_t expected[5] = {
+	CDDA_FREEDB_ID, DATA_FIRST_FREEDB_ID, DATA_LAST_FREEDB_ID,
+	DATA_LAST_LIBDISCID_FREEDB_ID, 0
+    };
+    cueify_toc_private long_toc;
+    uint8_t track_counts[5];
+    uint32_t track_lbas[13 + 10 + 13 + 12 + 99], leadout_lbas[5], ids[5];
+    cueify_msf_t address;
+    int i, j, n = 0, track_lba_count = 0, freedb_address, time;
+
+    for (i = 0; i < 3; i++) {
+	track_counts[i] = fixtures[i]->last_track_number -
+	    fixtures[i]->first_track_number + 1;
+	leadout_lbas[i] = fixtures[i]->tracks[0].lba;
+	for (j = 1; j <= track_counts[i]; j++) {
+	    track_lbas[track_lba_count++] = fixtures[i]->tracks[j].lba;
+	}
+    }
+
+    /* Like the data-last TOC with its multisession data. */
+    track_counts[3] = data_last_sessions.track_number - 1;
+    leadout_lbas[3] = data_last_sessions.track_lba - 11400;
+    for (j = 1; j <= track_counts[3]; j++) {
+	track_lbas[track_lba_count++] = data_last_toc.tracks[j].lba;
+    }
+
+    /* A disc of 99 tracks, whose digits sum to well over 255. */
+    memset(&long_toc, 0, sizeof(long_toc));
+    long_toc.first_track_number = 1;
+    long_toc.last_track_number = 99;
+    long_toc.tracks[0].lba = 99 * 3333 + 150;
+    track_counts[4] = 99;
+    leadout_lbas[4] = long_toc.tracks[0].lba;
+    for (j = 1; j <= 99; j++) {
+	long_toc.tracks[j].lba = (j - 1) * 3333 + 150;
+	track_lbas[track_lba_count++] = long_toc.tracks[j].lba;
+
+	/* The reference freedb algorithm. */
+	lba_to_msf(long_toc.tracks[j].lba, &address);
+	freedb_address = (address.min * 60) + address.sec;
+	while (freedb_address > 0) {
+	    n += freedb_address % 10;
+	    freedb_address /= 10;
+	}
+    }
+    fail_unless(n > 255, "Long disc does not overflow a byte");
+    lba_to_msf(long_toc.tracks[0].lba, &address);
+    time = (address.min * 60) + address.sec;
+    lba_to_msf(long_toc.tracks[1].lba, &address);
+    time -= (address.min * 60) + address.sec;
+    expected[4] = (uint32_t)(n % 0xff) << 24 | (uint32_t)time << 8 | 99;
+    fail_unless(cueify_toc_get_freedb_id((cueify_toc *)&long_toc, NULL) ==
+		expected[4],
+		"Did not get correct freedb ID from 99-track TOC");
+
+    fail_unless(cueify_get_freedb_id_batch(5, track_counts, track_lbas,
+					   leadout_lbas, ids) == CUEIFY_OK,
+		"Could not get freedb IDs of a batch of discs");
+    for (i = 0; i < 5; i++) {
+	fail_unless(ids[i] == expected[i],
+		    "Did not get correct freedb ID %d from batch of discs", i);
+    }
+
+    fail_unless(cueify_get_freedb_id_batch(0, NULL, NULL, NULL,
+					   NULL) == CUEIFY_OK,
+		"Could not get freedb IDs of an empty batch");
+    fail_unless(cueify_get_freedb_id_batch(5, track_counts, NULL,
+					   leadout_lbas,
+					   ids) == CUEIFY_ERR_BADARG,
+		"Did not reject a batch of discs without tracks");
+    track_counts[2] = 0;
+    fail_unless(cueify_get_freedb_id_batch(5, track_counts, track_lbas,
+					   leadout_lbas,
+					   ids) == CUEIFY_ERR_BADARG,
+		"Did not reject a batch containing a disc of no tracks");
+}
+END_TEST
+
+START_TEST (test_sha1_transforms)
+{
+    /* The two-block test vector from FIPS PUB 180-1. */
+    const char *message =
+	"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    const uint32_t digest[5] = {
+	0x84983E44, 0x1C3BD26E, 0xBAAE4AA1, 0xF95129E5, 0xE54670F1
+    };
+    SHA1_TRANSFORM transforms[SHA1_MAX_TRANSFORMS];
+    SHA1_CTX context;
+    uint8_t blocks[129];
+    size_t count, i;
+
+    /* Misalign the blocks. */
+    memset(blocks, 0, sizeof(blocks));
+    memcpy(blocks + 1, message, 56);
+    blocks[1 + 56] = 0x80;
+    blocks[1 + 126] = 0x01;
+    blocks[1 + 127] = 0xC0;
+
+    count = cueify_sha1_get_transforms(transforms);
+    fail_unless(count >= 1 && count <= SHA1_MAX_TRANSFORMS,
+		"Did not get any SHA-1 transforms");
+    for (i = 0; i < count; i++) {
+	cueify_sha1_init(&context);
+	transforms[i].transform(context.state, blocks + 1);
+	transforms[i].transform(context.state, blocks + 1 + 64);
+	fail_unless(memcmp(context.state, digest, sizeof(digest)) == 0,
+		    "Did not get correct SHA-1 digest from %s transform",
+		    transforms[i].name);
+	fail_unless(memcmp(blocks + 1, message, 56) == 0 &&
+		    blocks[1 + 56] == 0x80 && blocks[1 + 127] == 0xC0,
+		    "SHA-1 %s transform modified the blocks",
+		    transforms[i].name);
+    }
+}
+END_TEST
+
+
 Suite *toc_suite() {
     Suite *s = suite_create("discid");
     TCase *tc_core = tcase_create("core");
@@ -490,6 +708,10 @@ Suite *toc_suite() {
     tcase_add_test(tc_core, test_full_toc_musicbrainz_cdda);
     tcase_add_test(tc_core, test_full_toc_musicbrainz_data_first);
     tcase_add_test(tc_core, test_full_toc_musicbrainz_data_last);
+    tcase_add_test(tc_core, test_musicbrainz_into);
+    tcase_add_test(tc_core, test_musicbrainz_batch);
+    tcase_add_test(tc_core, test_freedb_batch);
+    tcase_add_test(tc_core, test_sha1_transforms);
     suite_add_tcase(s, tc_core);
 
     return s;
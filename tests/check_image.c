@@ -0,0 +1,707 @@
+/* check_image.c - Unit tests for libcueify disc image APIs
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <check.h>
+#include <cueify/types.h>
+#include <cueify/error.h>
+#include <cueify/device.h>
+#include <cueify/toc.h>
+#include <cueify/sessions.h>
+#include <cueify/cdtext.h>
+#include <cueify/mcn_isrc.h>
+#include <cueify/track_data.h>
+#include <cueify/constants.h>
+
+/*
+ * A disc of a 300-sector data track, a 450-sector audio track with a
+ * 150-sector pregap and an index 2, and a 150-sector audio track with
+ * a 150-sector pregap not stored in the image.
+ */
+#define CUE_SHEET \
+    "REM A test image\r\n" \
+    "CATALOG 0123456789012\r\n" \
+    "TITLE \"Album Title\"\r\n" \
+    "PERFORMER \"Album Performer\"\r\n" \
+    "FILE \"image.bin\" BINARY\r\n" \
+    "  TRACK 01 MODE1/2352\r\n" \
+    "    INDEX 01 00:00:00\r\n" \
+    "  TRACK 02 AUDIO\r\n" \
+    "    TITLE \"Track Title\"\r\n" \
+    "    FLAGS DCP\r\n" \
+    "    ISRC USRC17607839\r\n" \
+    "    INDEX 00 00:04:00\r\n" \
+    "    INDEX 01 00:06:00\r\n" \
+    "    INDEX 02 00:08:00\r\n" \
+    "  TRACK 03 AUDIO\r\n" \
+    "    PREGAP 00:02:00\r\n" \
+    "    INDEX 01 00:10:00\r\n"
+#define IMAGE_SECTORS  900
+#define LEADOUT  1050
+
+char dir[32];
+char cue_path[64], bin_path[64], iso_path[64], trace_path[64];
+cueify_device *dev;
+
+
+/** Write a file of a given size, with each sector holding its number. */
+void write_file(const char *path, const char *text, uint32_t sectors,
+		size_t sector_size) {
+    uint8_t sector[2352];
+    FILE *fp = fopen(path, "wb");
+    uint32_t i;
+
+    fail_unless(fp != NULL, "Failed to create test file");
+    if (text != NULL) {
+	fputs(text, fp);
+    }
+    for (i = 0; i < sectors; i++) {
+	memset(sector, i & 0xFF, sizeof(sector));
+	if (sector_size == 2352 && i < 300) {
+	    /* Give the data track a real sector header. */
+	    memset(sector, 0xFF, 12);
+	    sector[0] = sector[11] = 0;
+	    sector[15] = 1;
+	}
+	fwrite(sector, sector_size, 1, fp);
+    }
+    fclose(fp);
+}
+
+
+void setup() {
+    strcpy(dir, "/tmp/check_imageXXXXXX");
+    fail_unless(mkdtemp(dir) != NULL, "Failed to create test directory");
+    sprintf(cue_path, "%s/image.cue", dir);
+    sprintf(bin_path, "%s/image.bin", dir);
+    sprintf(iso_path, "%s/image.iso", dir);
+    sprintf(trace_path, "%s/image.trace", dir);
+    write_file(cue_path, CUE_SHEET, 0, 0);
+    write_file(bin_path, NULL, IMAGE_SECTORS, 2352);
+    write_file(iso_path, NULL, 100, 2048);
+
+    dev = cueify_device_new();
+    fail_unless(dev != NULL, "Failed to create cueify_device");
+    fail_unless(cueify_device_open_image(dev, cue_path) == CUEIFY_OK,
+		"Failed to open image");
+}
+
+
+void teardown() {
+    fail_unless(cueify_device_close(dev) == CUEIFY_OK,
+		"Failed to close image");
+    cueify_device_free(dev);
+    unlink(cue_path);
+    unlink(bin_path);
+    unlink(iso_path);
+    unlink(trace_path);
+    rmdir(dir);
+}
+
+
+START_TEST (test_toc)
+{
+    cueify_toc *toc = cueify_toc_new();
+    cueify_sessions *sessions = cueify_sessions_new();
+
+    fail_unless(cueify_device_read_toc(dev, toc) == CUEIFY_OK,
+		"Failed to read TOC from image");
+    fail_unless(cueify_toc_get_first_track(toc) == 1,
+		"First track of image is not 1");
+    fail_unless(cueify_toc_get_last_track(toc) == 3,
+		"Last track of image is not 3");
+    fail_unless(cueify_toc_get_track_address(toc, 1) == 0,
+		"Track 1 of image does not start at 0");
+    fail_unless(cueify_toc_get_track_address(toc, 2) == 450,
+		"Track 2 of image does not start after its pregap");
+    fail_unless(cueify_toc_get_track_address(toc, 3) == 900,
+		"Track 3 of image does not start after its virtual pregap");
+    fail_unless(cueify_toc_get_disc_length(toc) == LEADOUT,
+		"Lead-out of image is in the wrong place");
+    fail_unless(cueify_toc_get_track_control_flags(toc, 1) ==
+		CUEIFY_TOC_TRACK_IS_DATA,
+		"Track 1 of image is not a data track");
+    fail_unless(cueify_toc_get_track_control_flags(toc, 2) ==
+		CUEIFY_TOC_TRACK_PERMITS_COPYING,
+		"FLAGS of track 2 of image were not read");
+
+    fail_unless(cueify_device_read_sessions(dev, sessions) == CUEIFY_OK,
+		"Failed to read sessions from image");
+    fail_unless(cueify_sessions_get_last_session(sessions) == 1,
+		"Image does not have a single session");
+
+    cueify_sessions_free(sessions);
+    cueify_toc_free(toc);
+}
+END_TEST
+
+
+START_TEST (test_mcn_isrc)
+{
+    char buffer[16];
+    size_t size = sizeof(buffer);
+
+    fail_unless(cueify_device_read_mcn(dev, buffer, &size) == CUEIFY_OK,
+		"Failed to read MCN from image");
+    fail_unless(strcmp(buffer, "0123456789012") == 0,
+		"MCN of image does not match the cue sheet");
+
+    size = sizeof(buffer);
+    fail_unless(cueify_device_read_isrc(dev, 2, buffer, &size) == CUEIFY_OK,
+		"Failed to read ISRC from image");
+    fail_unless(strcmp(buffer, "USRC17607839") == 0,
+		"ISRC of image does not match the cue sheet");
+
+    size = sizeof(buffer);
+    fail_unless(cueify_device_read_isrc(dev, 1, buffer, &size) ==
+		CUEIFY_NO_DATA && size == 1,
+		"Track without an ISRC returned one");
+}
+END_TEST
+
+
+START_TEST (test_indices)
+{
+    cueify_indices *indices = cueify_indices_new();
+    cueify_msf_t offset;
+
+    fail_unless(cueify_device_read_track_indices(dev, indices, 2) ==
+		CUEIFY_OK, "Failed to read indices from image");
+    fail_unless(cueify_indices_get_num_indices(indices) == 3,
+		"Track 2 of image has the wrong number of indices");
+    offset = cueify_indices_get_index_offset(indices, 1);
+    fail_unless(offset.min == 0 && offset.sec == 10 && offset.frm == 0,
+		"Index 2 of track 2 of image is in the wrong place");
+    offset = cueify_indices_get_index_offset(indices, 2);
+    fail_unless(cueify_indices_get_index_number(indices, 2) == 0 &&
+		offset.min == 0 && offset.sec == 12 && offset.frm == 0,
+		"Pregap of track 3 of image is in the wrong place");
+
+    cueify_indices_free(indices);
+}
+END_TEST
+
+
+START_TEST (test_raw_sectors)
+{
+    uint8_t buffer[2 * CUEIFY_RAW_READ_SIZE];
+
+    fail_unless(cueify_device_read_raw_sectors(dev, 301, 2, buffer,
+					       sizeof(buffer)) == CUEIFY_OK,
+		"Failed to read raw sectors from image");
+    fail_unless(buffer[0] == 301 % 256 &&
+		buffer[CUEIFY_RAW_READ_SIZE] == 302 % 256,
+		"Raw sectors of image hold the wrong data");
+    fail_unless(cueify_device_read_raw_sectors(dev, 800, 1, buffer,
+					       sizeof(buffer)) == CUEIFY_OK &&
+		buffer[0] == 0,
+		"Virtual pregap of image is not silent");
+    fail_unless(cueify_device_read_raw_sectors(dev, LEADOUT, 1, buffer,
+					       sizeof(buffer)) != CUEIFY_OK,
+		"Read past the lead-out of image succeeded");
+    fail_unless(cueify_device_read_data_mode(dev, 1) ==
+		CUEIFY_DATA_MODE_MODE_1,
+		"Data mode of track 1 of image is not mode 1");
+}
+END_TEST
+
+
+START_TEST (test_cdtext)
+{
+    cueify_cdtext *cdtext = cueify_cdtext_new();
+    cueify_cdtext_block *block;
+
+    fail_unless(cueify_device_read_cdtext(dev, cdtext) == CUEIFY_OK,
+		"Failed to read CD-Text from image");
+    block = cueify_cdtext_get_block(cdtext, 0);
+    fail_unless(block != NULL, "CD-Text of image has no block");
+    fail_unless(strcmp(cueify_cdtext_block_get_title(block, 0),
+		       "Album Title") == 0,
+		"Album title of image does not match the cue sheet");
+    fail_unless(strcmp(cueify_cdtext_block_get_title(block, 2),
+		       "Track Title") == 0,
+		"Track title of image does not match the cue sheet");
+    fail_unless(strcmp(cueify_cdtext_block_get_performer(block, 0),
+		       "Album Performer") == 0,
+		"Album performer of image does not match the cue sheet");
+
+    cueify_cdtext_free(cdtext);
+}
+END_TEST
+
+
+START_TEST (test_cdtext_crc)
+{
+    cueify_device *img = cueify_device_new();
+    cueify_cdtext *cdtext = cueify_cdtext_new();
+    cueify_cdtext_block *block;
+    char crc_cue_path[64], cdt_path[64];
+    uint8_t *buffer;
+    size_t size;
+    FILE *fp;
+
+    /* Corrupt the text of the first PACK of the image's CD-Text. */
+    fail_unless(cueify_device_read_cdtext(dev, cdtext) == CUEIFY_OK &&
+		cueify_cdtext_serialize_alloc(cdtext, &buffer, &size) ==
+		CUEIFY_OK, "Failed to serialize CD-Text of image");
+    buffer[4 + 4] ^= 0x01;
+
+    sprintf(crc_cue_path, "%s/crc.cue", dir);
+    sprintf(cdt_path, "%s/image.cdt", dir);
+    fp = fopen(cdt_path, "wb");
+    fail_unless(fp != NULL, "Failed to create CD-Text file");
+    fwrite(buffer, size, 1, fp);
+    fclose(fp);
+    free(buffer);
+    write_file(crc_cue_path, "CDTEXTFILE \"image.cdt\"\r\n" CUE_SHEET, 0, 0);
+    fail_unless(cueify_device_open_image(img, crc_cue_path) == CUEIFY_OK,
+		"Failed to open image with a CD-Text file");
+
+    fail_unless(cueify_device_read_cdtext(img, cdtext) == CUEIFY_OK &&
+		cueify_cdtext_get_num_bad_packs(cdtext) == 1,
+		"Bad PACK from image was not counted");
+    block = cueify_cdtext_get_block(cdtext, 0);
+    fail_unless(block != NULL &&
+		strcmp(cueify_cdtext_block_get_title(block, 0),
+		       "@lbum Title") == 0,
+		"Counted bad PACK was not used");
+
+    /* The CD-Text already read must not hide the bad PACK. */
+    fail_unless(cueify_cdtext_set_crc_mode(cdtext,
+					   CUEIFY_CDTEXT_CRC_STRICT) ==
+		CUEIFY_OK &&
+		cueify_device_read_cdtext(img, cdtext) == CUEIFY_ERR_CORRUPTED,
+		"Bad PACK from image did not fail a strict read");
+
+    fail_unless(cueify_cdtext_set_crc_mode(cdtext, CUEIFY_CDTEXT_CRC_DROP) ==
+		CUEIFY_OK &&
+		cueify_device_read_cdtext(img, cdtext) == CUEIFY_OK &&
+		cueify_cdtext_get_num_bad_packs(cdtext) == 1,
+		"Failed to read CD-Text from image dropping bad PACKs");
+    block = cueify_cdtext_get_block(cdtext, 0);
+    fail_unless(block != NULL &&
+		strcmp(cueify_cdtext_block_get_performer(block, 0),
+		       "Album Performer") == 0,
+		"Dropping a bad PACK lost the good ones");
+    fail_unless(cueify_cdtext_block_get_title(block, 0) == NULL ||
+		strcmp(cueify_cdtext_block_get_title(block, 0),
+		       "@lbum Title") != 0,
+		"Bad PACK was not dropped");
+
+    cueify_cdtext_free(cdtext);
+    fail_unless(cueify_device_close(img) == CUEIFY_OK,
+		"Failed to close image with a CD-Text file");
+    cueify_device_free(img);
+    unlink(crc_cue_path);
+    unlink(cdt_path);
+}
+END_TEST
+
+
+START_TEST (test_skipped_track)
+{
+    cueify_device *img = cueify_device_new();
+    char skip_cue_path[64];
+
+    /* The tracks of a disc are numbered without gaps. */
+    sprintf(skip_cue_path, "%s/skip.cue", dir);
+    write_file(skip_cue_path,
+	       "FILE \"image.bin\" BINARY\r\n"
+	       "  TRACK 01 AUDIO\r\n"
+	       "    INDEX 01 00:00:00\r\n"
+	       "FILE \"image.bin\" BINARY\r\n"
+	       "  TRACK 02 AUDIO\r\n"
+	       "    INDEX 01 00:00:00\r\n"
+	       "  TRACK 04 AUDIO\r\n"
+	       "    INDEX 01 00:05:00\r\n", 0, 0);
+    fail_unless(cueify_device_open_image(img, skip_cue_path) ==
+		CUEIFY_ERR_CORRUPTED,
+		"Opened image with a skipped track number");
+
+    cueify_device_free(img);
+    unlink(skip_cue_path);
+}
+END_TEST
+
+
+START_TEST (test_raw_image)
+{
+    cueify_device *iso = cueify_device_new();
+    cueify_toc *toc = cueify_toc_new();
+    uint8_t buffer[CUEIFY_RAW_READ_SIZE];
+
+    fail_unless(cueify_device_open_image(iso, iso_path) == CUEIFY_OK,
+		"Failed to open raw image");
+    fail_unless(cueify_device_read_toc(iso, toc) == CUEIFY_OK,
+		"Failed to read TOC from raw image");
+    fail_unless(cueify_toc_get_last_track(toc) == 1 &&
+		cueify_toc_get_disc_length(toc) == 100,
+		"Raw image is not a single 100-sector track");
+    fail_unless(cueify_device_read_raw_sectors(iso, 5, 1, buffer,
+					       sizeof(buffer)) == CUEIFY_OK,
+		"Failed to read raw sector from raw image");
+    fail_unless(buffer[1] == 0xFF && buffer[15] == 1 && buffer[16] == 5,
+		"Raw sector of cooked image was not given a header");
+
+    cueify_toc_free(toc);
+    fail_unless(cueify_device_close(iso) == CUEIFY_OK,
+		"Failed to close raw image");
+    cueify_device_free(iso);
+}
+END_TEST
+
+
+START_TEST (test_simulated)
+{
+    cueify_latency_t latency = { 1000, 20000, 5000, 80000, 1 };
+    cueify_device *sim = cueify_device_new();
+    cueify_toc *toc = cueify_toc_new();
+    uint8_t buffer[75 * CUEIFY_RAW_READ_SIZE];
+    uint32_t ms;
+
+    latency.min_seek_us = latency.max_seek_us + 1;
+    fail_unless(cueify_device_open_simulated(sim, cue_path, &latency) ==
+		CUEIFY_ERR_BADARG, "Opened drive with a backwards seek model");
+    latency.min_seek_us = 5000;
+
+    fail_unless(cueify_device_open_simulated(sim, cue_path, &latency) ==
+		CUEIFY_OK, "Failed to open simulated drive");
+    fail_unless(cueify_device_get_simulated_time(dev, &ms, 0) ==
+		CUEIFY_ERR_BADARG, "Image has a simulated time");
+
+    fail_unless(cueify_device_read_toc(sim, toc) == CUEIFY_OK,
+		"Failed to read TOC from simulated drive");
+    fail_unless(cueify_device_read_toc(sim, toc) == CUEIFY_OK,
+		"Failed to read TOC from simulated drive");
+    fail_unless(cueify_device_get_simulated_time(sim, &ms, 1) == CUEIFY_OK &&
+		ms == 21,
+		"Reading the TOC twice did not cost a single TOC read");
+
+    fail_unless(cueify_device_read_raw_sectors(sim, 0, 75, buffer,
+					       sizeof(buffer)) == CUEIFY_OK,
+		"Failed to read raw sectors from simulated drive");
+    fail_unless(cueify_device_get_simulated_time(sim, &ms, 1) == CUEIFY_OK &&
+		ms == 1001,
+		"Sequential read at 1x did not cost a second");
+
+    fail_unless(cueify_device_read_raw_sectors(sim, 0, 1, buffer,
+					       sizeof(buffer)) == CUEIFY_OK,
+		"Failed to read raw sector from simulated drive");
+    fail_unless(cueify_device_get_simulated_time(sim, &ms, 0) == CUEIFY_OK &&
+		ms > 1 + 5 + 13,
+		"Read after a seek did not cost a seek");
+
+    cueify_toc_free(toc);
+    fail_unless(cueify_device_close(sim) == CUEIFY_OK,
+		"Failed to close simulated drive");
+    cueify_device_free(sim);
+}
+END_TEST
+
+
+START_TEST (test_stats)
+{
+    cueify_latency_t latency = { 1000, 20000, 5000, 80000, 1 };
+    cueify_device *sim = cueify_device_new();
+    cueify_toc *toc = cueify_toc_new();
+    uint8_t buffer[75 * CUEIFY_RAW_READ_SIZE];
+    cueify_device_stats_t stats;
+    cueify_command_stats_t *command;
+    char isrc[13];
+    size_t size;
+
+    fail_unless(cueify_device_open_simulated(sim, cue_path, &latency) ==
+		CUEIFY_OK, "Failed to open simulated drive");
+    fail_unless(cueify_device_read_toc(sim, toc) == CUEIFY_OK &&
+		cueify_device_read_toc(sim, toc) == CUEIFY_OK,
+		"Failed to read TOC from simulated drive");
+    fail_unless(cueify_device_read_raw_sectors(sim, 0, 75, buffer,
+					       sizeof(buffer)) == CUEIFY_OK,
+		"Failed to read raw sectors from simulated drive");
+    size = sizeof(isrc);
+    fail_unless(cueify_device_read_isrc(sim, 2, isrc, &size) == CUEIFY_OK,
+		"Failed to read ISRC from simulated drive");
+    size = sizeof(isrc);
+    fail_unless(cueify_device_read_isrc(sim, 99, isrc, &size) ==
+		CUEIFY_ERR_BADARG,
+		"Read ISRC of a track not on the simulated disc");
+    fail_unless(cueify_device_get_stats(sim, &stats) == CUEIFY_OK,
+		"Failed to get stats of simulated drive");
+
+    command = &stats.commands[CUEIFY_COMMAND_READ_TOC];
+    fail_unless(command->count == 1 && command->errors == 0,
+		"Cached TOC read was counted as a command");
+    fail_unless(command->bytes == 4 + 4 * 8,
+		"Wrong number of bytes counted for TOC read");
+    fail_unless(command->total_us == 21000 && command->max_us == 21000,
+		"Wrong time counted for TOC read");
+    fail_unless(command->histogram[14] == 1,
+		"TOC read counted in the wrong histogram bucket");
+
+    command = &stats.commands[CUEIFY_COMMAND_READ_CD];
+    fail_unless(command->count == 1 &&
+		command->bytes == 75 * CUEIFY_RAW_READ_SIZE,
+		"Raw sector read was counted incorrectly");
+    command = &stats.commands[CUEIFY_COMMAND_READ_SUBCHANNEL];
+    fail_unless(command->count == 2 && command->errors == 1,
+		"Sub-channel reads were counted incorrectly");
+    fail_unless(command->bytes == 24,
+		"Bytes counted for a failed sub-channel read");
+
+    fail_unless(cueify_device_reset_stats(sim) == CUEIFY_OK &&
+		cueify_device_get_stats(sim, &stats) == CUEIFY_OK &&
+		stats.commands[CUEIFY_COMMAND_READ_CD].count == 0,
+		"Failed to reset stats of simulated drive");
+
+    cueify_toc_free(toc);
+    fail_unless(cueify_device_close(sim) == CUEIFY_OK,
+		"Failed to close simulated drive");
+    cueify_device_free(sim);
+}
+END_TEST
+
+/**
+ * Read the indices of track 2 from a simulated drive.
+ *
+ * @param ms a pointer to set to the simulated time taken
+ * @param reads a pointer to set to the number of READ CD commands issued
+ */
+void simulate_indices(uint32_t *ms, uint32_t *reads) {
+    cueify_latency_t latency = { 1000, 20000, 5000, 80000, 1 };
+    cueify_device *sim = cueify_device_new();
+    cueify_indices *indices = cueify_indices_new();
+    cueify_device_stats_t stats;
+
+    fail_unless(cueify_device_open_simulated(sim, cue_path, &latency) ==
+		CUEIFY_OK, "Failed to open simulated drive");
+    fail_unless(cueify_device_read_track_indices(sim, indices, 2) ==
+		CUEIFY_OK &&
+		cueify_indices_get_num_indices(indices) == 3,
+		"Failed to read indices from simulated drive");
+    fail_unless(cueify_device_get_simulated_time(sim, ms, 0) == CUEIFY_OK &&
+		cueify_device_get_stats(sim, &stats) == CUEIFY_OK,
+		"Failed to get costs of simulated drive");
+    *reads = stats.commands[CUEIFY_COMMAND_READ_CD].count;
+
+    cueify_indices_free(indices);
+    fail_unless(cueify_device_close(sim) == CUEIFY_OK,
+		"Failed to close simulated drive");
+    cueify_device_free(sim);
+}
+
+
+START_TEST (test_simulated_subchannel)
+{
+    uint8_t sector[CUEIFY_RAW_READ_SIZE];
+    char sub_path[64];
+    uint32_t ms, reads, sub_ms, sub_reads, lba;
+    FILE *fp;
+
+    simulate_indices(&ms, &reads);
+
+    /* Subchannel data matching the cue sheet, as a .sub file. */
+    sprintf(sub_path, "%s/image.sub", dir);
+    fp = fopen(sub_path, "wb");
+    fail_unless(fp != NULL, "Failed to create subchannel file");
+    for (lba = 0; lba < LEADOUT; lba++) {
+	fail_unless(cueify_device_read_raw_sectors(dev, lba, 1, sector,
+						   sizeof(sector)) ==
+		    CUEIFY_OK, "Failed to read raw sector from image");
+	fseek(fp, lba * 96 + 12, SEEK_SET);
+	fwrite(sector + 2352, 1, 12, fp);
+    }
+    fseek(fp, LEADOUT * 96 - 1, SEEK_SET);
+    fputc(0, fp);
+    fclose(fp);
+
+    /* Reading positions from it must cost the same as before. */
+    simulate_indices(&sub_ms, &sub_reads);
+    unlink(sub_path);
+    fail_unless(sub_reads == reads,
+		"Subchannel data changed the number of sectors read");
+    fail_unless(sub_ms == ms,
+		"Subchannel data changed the simulated time taken");
+}
+END_TEST
+
+
+/** Append a command to a trace file (see src/trace_private.h). */
+void write_record(FILE *fp, const uint8_t *cdb, uint8_t cdb_length,
+		  uint8_t status, const uint8_t *data, uint32_t data_length,
+		  const uint8_t *sense, uint8_t sense_length, uint32_t elapsed) {
+    uint8_t header[15];
+
+    header[0] = cdb_length;
+    header[1] = sense_length;
+    header[2] = status;
+    header[3] = header[7] = data_length >> 24;
+    header[4] = header[8] = (data_length >> 16) & 0xFF;
+    header[5] = header[9] = (data_length >> 8) & 0xFF;
+    header[6] = header[10] = data_length & 0xFF;
+    header[11] = elapsed >> 24;
+    header[12] = (elapsed >> 16) & 0xFF;
+    header[13] = (elapsed >> 8) & 0xFF;
+    header[14] = elapsed & 0xFF;
+    fwrite(header, sizeof(header), 1, fp);
+    fwrite(cdb, cdb_length, 1, fp);
+    fwrite(data, data_length, 1, fp);
+    fwrite(sense, sense_length, 1, fp);
+}
+
+
+START_TEST (test_trace)
+{
+    /* A one-track disc of 300 sectors. */
+    uint8_t toc_cdb[10] = { 0x43, 0, 0, 0, 0, 0, 0, 0x03, 0x24, 0 };
+    uint8_t toc_data[20] = {
+	0, 18, 1, 1,
+	0, 0x14, 1, 0, 0, 0, 0, 0,
+	0, 0x14, 0xAA, 0, 0, 0, 0x01, 0x2C
+    };
+    uint8_t mcn_cdb[10] = { 0x42, 0, 0x40, 0x02, 0, 0, 0, 0, 24, 0 };
+    uint8_t mcn_data[24] = {
+	0, 0, 0, 20, 0x02, 0, 0, 0, 0x80,
+	'0', '1', '2', '3', '4', '5', '6', '7', '8', '9', '0', '1', '2'
+    };
+    uint8_t isrc_cdb[10] = { 0x42, 0, 0x40, 0x03, 0, 0, 1, 0, 24, 0 };
+    /* ILLEGAL REQUEST, INVALID FIELD IN CDB */
+    uint8_t isrc_sense[18] = { 0x70, 0, 0x05, 0, 0, 0, 0, 10,
+			       0, 0, 0, 0, 0x24, 0 };
+    uint8_t read_cd_cdb[12] = { 0xBE, 0, 0, 0, 0, 10, 0, 0, 2, 0xF8, 2, 0 };
+    uint8_t sectors[2 * CUEIFY_RAW_READ_SIZE];
+    uint8_t buffer[2 * CUEIFY_RAW_READ_SIZE];
+    cueify_device *replay = cueify_device_new();
+    cueify_toc *toc = cueify_toc_new();
+    char code[14];
+    size_t size = sizeof(code);
+    uint32_t ms;
+    FILE *fp;
+
+    /* Images send no commands, so their traces are empty. */
+    fail_unless(cueify_device_start_trace(dev, trace_path) == CUEIFY_OK,
+		"Failed to start tracing image");
+    fail_unless(cueify_device_read_toc(dev, toc) == CUEIFY_OK,
+		"Failed to read TOC from traced image");
+    fail_unless(cueify_device_stop_trace(dev) == CUEIFY_OK,
+		"Failed to stop tracing image");
+    fail_unless(cueify_device_open_trace(replay, trace_path) == CUEIFY_OK,
+		"Failed to open empty trace");
+    fail_unless(cueify_device_read_toc(replay, toc) != CUEIFY_OK,
+		"Read TOC which was not in trace");
+    fail_unless(cueify_device_close(replay) == CUEIFY_OK,
+		"Failed to close empty trace");
+    fail_unless(cueify_device_open_trace(replay, cue_path) ==
+		CUEIFY_ERR_CORRUPTED, "Opened cue sheet as a trace");
+
+    memset(sectors, 10, CUEIFY_RAW_READ_SIZE);
+    memset(sectors + CUEIFY_RAW_READ_SIZE, 11, CUEIFY_RAW_READ_SIZE);
+    fp = fopen(trace_path, "wb");
+    fail_unless(fp != NULL, "Failed to create trace");
+    fwrite("CUEIFYTR\2", 9, 1, fp);
+    write_record(fp, toc_cdb, sizeof(toc_cdb), 0, toc_data, sizeof(toc_data),
+		 NULL, 0, 5000);
+    write_record(fp, mcn_cdb, sizeof(mcn_cdb), 0, mcn_data, sizeof(mcn_data),
+		 NULL, 0, 3000);
+    /* The sense data of a failed command is skipped over. */
+    write_record(fp, isrc_cdb, sizeof(isrc_cdb), 1, NULL, 0,
+		 isrc_sense, sizeof(isrc_sense), 1000);
+    write_record(fp, read_cd_cdb, sizeof(read_cd_cdb), 0, sectors,
+		 sizeof(sectors), NULL, 0, 7000);
+    fclose(fp);
+
+    fail_unless(cueify_device_open_trace(replay, trace_path) == CUEIFY_OK,
+		"Failed to open trace");
+    fail_unless(cueify_device_read_toc(replay, toc) == CUEIFY_OK,
+		"Failed to read TOC from trace");
+    fail_unless(cueify_toc_get_last_track(toc) == 1 &&
+		cueify_toc_get_disc_length(toc) == 300,
+		"TOC from trace does not match recorded TOC");
+    fail_unless(cueify_device_read_mcn(replay, code, &size) == CUEIFY_OK &&
+		strcmp(code, "0123456789012") == 0,
+		"MCN from trace does not match recorded MCN");
+    size = sizeof(code);
+    fail_unless(cueify_device_read_isrc(replay, 1, code, &size) ==
+		CUEIFY_ERR_INTERNAL, "Failed ISRC read did not fail again");
+
+    fail_unless(cueify_device_read_raw_sectors(replay, 10, 2, buffer,
+					       sizeof(buffer)) == CUEIFY_OK &&
+		memcmp(buffer, sectors, sizeof(sectors)) == 0,
+		"Raw sectors from trace do not match recorded sectors");
+    fail_unless(cueify_device_read_raw_sectors(replay, 11, 1, buffer,
+					       sizeof(buffer)) == CUEIFY_OK &&
+		buffer[0] == 11,
+		"Failed to piece raw sector together from trace");
+    fail_unless(cueify_device_read_raw_sectors(replay, 12, 1, buffer,
+					       sizeof(buffer)) != CUEIFY_OK,
+		"Read raw sector which was not in trace");
+
+    /* 5 + 3 + 1 + 7 + 3.5 ms, as recorded. */
+    fail_unless(cueify_device_get_simulated_time(replay, &ms, 0) ==
+		CUEIFY_OK && ms == 19,
+		"Replayed commands did not take their recorded time");
+
+    cueify_toc_free(toc);
+    fail_unless(cueify_device_close(replay) == CUEIFY_OK,
+		"Failed to close trace");
+    cueify_device_free(replay);
+}
+END_TEST
+
+
+Suite *image_suite() {
+    Suite *s = suite_create("image");
+    TCase *tc_core = tcase_create("core");
+
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_toc);
+    tcase_add_test(tc_core, test_mcn_isrc);
+    tcase_add_test(tc_core, test_indices);
+    tcase_add_test(tc_core, test_raw_sectors);
+    tcase_add_test(tc_core, test_cdtext);
+    tcase_add_test(tc_core, test_cdtext_crc);
+    tcase_add_test(tc_core, test_skipped_track);
+    tcase_add_test(tc_core, test_raw_image);
+    tcase_add_test(tc_core, test_simulated);
+    tcase_add_test(tc_core, test_stats);
+    tcase_add_test(tc_core, test_simulated_subchannel);
+    tcase_add_test(tc_core, test_trace);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+
+int main() {
+    int number_failed;
+    Suite *s = image_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
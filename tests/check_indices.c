@@ -31,6 +31,7 @@
 #include <cueify/error.h>
 #include <cueify/device.h>
 #include <cueify/track_data.h>
+#include "test_device.h"
 
 
 cueify_device *dev;
@@ -39,8 +40,7 @@ cueify_device *dev;
 void setup() {
     dev = cueify_device_new();
     fail_unless(dev != NULL, "Failed to create cueify_device");
-    fail_unless(cueify_device_open(dev, NULL) == CUEIFY_OK,
-		"Failed to open device");
+    open_test_device(dev);
 }
 
 
@@ -194,6 +194,50 @@ START_TEST (test_indices)
 END_TEST
 
 
+START_TEST (test_all_indices)
+{
+    cueify_disc_indices *all_indices;
+    cueify_indices *indices;
+    int i, j;
+
+    all_indices = cueify_disc_indices_new();
+    fail_unless(all_indices != NULL,
+		"Failed to create cueify_disc_indices object");
+    fail_unless(cueify_device_read_all_indices(dev,
+					       all_indices) == CUEIFY_OK,
+		"Failed to read all indices from device");
+    fail_unless(cueify_disc_indices_get_first_track(all_indices) == 1,
+		"First track of indices was incorrect");
+    fail_unless(cueify_disc_indices_get_last_track(all_indices) == 15,
+		"Last track of indices was incorrect");
+    for (i = 0; i < 15; i++) {
+	indices = cueify_disc_indices_get_track_indices(all_indices, i + 1);
+	fail_unless(indices != NULL, "Failed to get indices of track");
+	fail_unless(cueify_indices_get_num_indices(indices) ==
+		    expected_num_indices[i],
+		    "Number of indices read was incorrect");
+	if (cueify_indices_get_num_indices(indices) ==
+	    expected_num_indices[i]) {
+	    for (j = 0; j < expected_num_indices[i]; j++) {
+		fail_unless(cueify_indices_get_index_number(indices, j) ==
+			    j + 1,
+			    "Index number was incorrect");
+		fail_unless(offsets_equal_within_epsilon(
+				cueify_indices_get_index_offset(indices, j),
+				expected_indices[i][j],
+				EPSILON_FRAMES),
+			    "Index offset was incorrect");
+	    }
+	}
+    }
+    fail_unless(cueify_disc_indices_get_track_indices(all_indices, 16) ==
+		NULL,
+		"Got indices of a track not on the disc");
+    cueify_disc_indices_free(all_indices);
+}
+END_TEST
+
+
 Suite *toc_suite() {
     Suite *s = suite_create("indices");
     TCase *tc_core = tcase_create("core");
@@ -202,6 +246,7 @@ Suite *toc_suite() {
     /* Reading indices is slow */
     tcase_set_timeout(tc_core, 60);
     tcase_add_test(tc_core, test_indices);
+    tcase_add_test(tc_core, test_all_indices);
     suite_add_tcase(s, tc_core);
 
     return s;
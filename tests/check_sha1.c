@@ -0,0 +1,274 @@
+/* check_sha1.c - Unit tests for libcueify SHA-1 functions
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ * 
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <pthread.h>
+#include <check.h>
+#include "sha1.h"
+
+/** Number of threads hashing at once in the stress test. */
+#define NUM_THREADS 8
+/** Number of times each thread hashes every message. */
+#define ITERATIONS 200
+/** Number of messages (of lengths 0, 7, 14, ...) to hash. */
+#define NUM_MESSAGES 64
+/** Length of the longest message. */
+#define MAX_MESSAGE_SIZE (7 * (NUM_MESSAGES - 1))
+
+/** Messages hashed by every thread, with their digests. */
+uint8_t messages[NUM_MESSAGES][MAX_MESSAGE_SIZE];
+uint8_t digests[NUM_MESSAGES][SHA1_DIGEST_SIZE];
+
+
+/** Hash a message, fed to the context in pieces from an unaligned copy.
+ *
+ * @param message the message to hash
+ * @param size the size of the message
+ * @param seed the seed deciding how the message is split up
+ * @param digest the resulting digest
+ */
+static void hash_pieces(const uint8_t *message, size_t size,
+			unsigned int seed, uint8_t digest[SHA1_DIGEST_SIZE]) {
+    uint8_t copy[MAX_MESSAGE_SIZE + 8];
+    uint8_t *unaligned = copy + 1 + seed % 7;
+    SHA1_CTX context;
+    size_t i, piece;
+
+    memcpy(unaligned, message, size);
+    cueify_sha1_init(&context);
+    for (i = 0; i < size; i += piece) {
+	piece = 1 + (size_t)rand_r(&seed) % 130;
+	if (piece > size - i) {
+	    piece = size - i;
+	}
+	cueify_sha1_update(&context, unaligned + i, piece);
+    }
+    cueify_sha1_final(&context, digest);
+}  /* hash_pieces */
+
+
+void setup() {
+    SHA1_CTX context;
+    unsigned int seed = 1;
+    int i, j;
+
+    for (i = 0; i < NUM_MESSAGES; i++) {
+	for (j = 0; j < MAX_MESSAGE_SIZE; j++) {
+	    messages[i][j] = (uint8_t)rand_r(&seed);
+	}
+	cueify_sha1_init(&context);
+	cueify_sha1_update(&context, messages[i], (size_t)i * 7);
+	cueify_sha1_final(&context, digests[i]);
+    }
+}
+
+
+void teardown() {
+}
+
+
+START_TEST (test_vectors)
+{
+    /* The test vectors from FIPS PUB 180-1. */
+    const char *abc = "abc";
+    const uint8_t abc_digest[SHA1_DIGEST_SIZE] = {
+	0xA9, 0x99, 0x3E, 0x36, 0x47, 0x06, 0x81, 0x6A, 0xBA, 0x3E,
+	0x25, 0x71, 0x78, 0x50, 0xC2, 0x6C, 0x9C, 0xD0, 0xD8, 0x9D
+    };
+    const char *abcdbcde =
+	"abcdbcdecdefdefgefghfghighijhijkijkljklmklmnlmnomnopnopq";
+    const uint8_t abcdbcde_digest[SHA1_DIGEST_SIZE] = {
+	0x84, 0x98, 0x3E, 0x44, 0x1C, 0x3B, 0xD2, 0x6E, 0xBA, 0xAE,
+	0x4A, 0xA1, 0xF9, 0x51, 0x29, 0xE5, 0xE5, 0x46, 0x70, 0xF1
+    };
+    const uint8_t million_a_digest[SHA1_DIGEST_SIZE] = {
+	0x34, 0xAA, 0x97, 0x3C, 0xD4, 0xC4, 0xDA, 0xA4, 0xF6, 0x1E,
+	0xEB, 0x2B, 0xDB, 0xAD, 0x27, 0x31, 0x65, 0x34, 0x01, 0x6F
+    };
+    uint8_t a[1001];
+    uint8_t digest[SHA1_DIGEST_SIZE];
+    SHA1_CTX context;
+    int i;
+
+    cueify_sha1_init(&context);
+    cueify_sha1_update(&context, (const uint8_t *)abc, strlen(abc));
+    cueify_sha1_final(&context, digest);
+    fail_unless(memcmp(digest, abc_digest, sizeof(digest)) == 0,
+		"Did not get correct SHA-1 digest of \"abc\"");
+
+    cueify_sha1_init(&context);
+    cueify_sha1_update(&context, (const uint8_t *)abcdbcde,
+		       strlen(abcdbcde));
+    cueify_sha1_final(&context, digest);
+    fail_unless(memcmp(digest, abcdbcde_digest, sizeof(digest)) == 0,
+		"Did not get correct SHA-1 digest of \"abcdbcde...\"");
+
+    /* Whole blocks are hashed straight from the (unaligned) input. */
+    memset(a, 'a', sizeof(a));
+    cueify_sha1_init(&context);
+    for (i = 0; i < 1000; i++) {
+	cueify_sha1_update(&context, a + 1, 1000);
+    }
+    cueify_sha1_final(&context, digest);
+    fail_unless(memcmp(digest, million_a_digest, sizeof(digest)) == 0,
+		"Did not get correct SHA-1 digest of a million \"a\"s");
+    for (i = 0; i < (int)sizeof(a); i++) {
+	fail_unless(a[i] == 'a', "SHA-1 modified the data it hashed");
+    }
+}
+END_TEST
+
+
+START_TEST (test_pieces)
+{
+    uint8_t digest[SHA1_DIGEST_SIZE];
+    int i;
+
+    for (i = 0; i < NUM_MESSAGES; i++) {
+	hash_pieces(messages[i], (size_t)i * 7, (unsigned int)i, digest);
+	fail_unless(memcmp(digest, digests[i], sizeof(digest)) == 0,
+		    "Did not get same SHA-1 digest of message %d in pieces",
+		    i);
+    }
+}
+END_TEST
+
+
+START_TEST (test_lanes)
+{
+    SHA1_LANES_TRANSFORM transforms[SHA1_MAX_LANES_TRANSFORMS];
+    uint32_t state[5 * SHA1_MAX_LANES], expected[SHA1_MAX_LANES][5];
+    const uint8_t *blocks[SHA1_MAX_LANES];
+    size_t count, lanes, i, j, k;
+
+    count = cueify_sha1_get_lanes_transforms(transforms);
+    fail_unless(count >= 1 && count <= SHA1_MAX_LANES_TRANSFORMS,
+		"Did not get any multi-message SHA-1 transforms");
+    for (i = 0; i < count; i++) {
+	lanes = transforms[i].lanes;
+	fail_unless(lanes >= 1 && lanes <= SHA1_MAX_LANES,
+		    "Got %lu lanes from %s transform",
+		    (unsigned long)lanes, transforms[i].name);
+
+	/* Hash the first blocks of some messages (from unaligned data). */
+	for (j = 0; j < lanes; j++) {
+	    for (k = 0; k < 5; k++) {
+		expected[j][k] = (uint32_t)(j * 5 + k) * 0x9E3779B9;
+		state[k * lanes + j] = expected[j][k];
+	    }
+	}
+	for (k = 0; k + 65 <= MAX_MESSAGE_SIZE; k += 64) {
+	    for (j = 0; j < lanes; j++) {
+		blocks[j] = messages[NUM_MESSAGES - 1 - j] + k + 1;
+		cueify_sha1_transform(expected[j], blocks[j]);
+	    }
+	    transforms[i].transform(state, blocks);
+	}
+	for (j = 0; j < lanes; j++) {
+	    for (k = 0; k < 5; k++) {
+		fail_unless(state[k * lanes + j] == expected[j][k],
+			    "Did not get same SHA-1 state in lane %lu of %s "
+			    "transform", (unsigned long)j, transforms[i].name);
+	    }
+	}
+    }
+}
+END_TEST
+
+/** Hash every message ITERATIONS times, split up differently each time.
+ *
+ * @param arg a pointer to the thread's number
+ * @return the number of incorrect digests (cast to a pointer)
+ */
+static void *hash_messages(void *arg) {
+    unsigned int seed = (unsigned int)*(int *)arg;
+    uint8_t digest[SHA1_DIGEST_SIZE];
+    size_t failed = 0;
+    int i, j;
+
+    for (i = 0; i < ITERATIONS; i++) {
+	for (j = 0; j < NUM_MESSAGES; j++) {
+	    hash_pieces(messages[j], (size_t)j * 7, (unsigned int)rand_r(&seed),
+			digest);
+	    if (memcmp(digest, digests[j], sizeof(digest)) != 0) {
+		failed++;
+	    }
+	}
+    }
+
+    return (void *)failed;
+}  /* hash_messages */
+
+
+START_TEST (test_threads)
+{
+    pthread_t threads[NUM_THREADS];
+    int thread_numbers[NUM_THREADS];
+    void *failed;
+    int i;
+
+    for (i = 0; i < NUM_THREADS; i++) {
+	thread_numbers[i] = i;
+	fail_unless(pthread_create(&threads[i], NULL, hash_messages,
+				   &thread_numbers[i]) == 0,
+		    "Could not create thread %d", i);
+    }
+    for (i = 0; i < NUM_THREADS; i++) {
+	fail_unless(pthread_join(threads[i], &failed) == 0,
+		    "Could not join thread %d", i);
+	fail_unless(failed == NULL,
+		    "Got %lu incorrect SHA-1 digests in thread %d",
+		    (unsigned long)(size_t)failed, i);
+    }
+}
+END_TEST
+
+
+Suite *sha1_suite() {
+    Suite *s = suite_create("sha1");
+    TCase *tc_core = tcase_create("core");
+
+    tcase_add_checked_fixture(tc_core, setup, teardown);
+    tcase_add_test(tc_core, test_vectors);
+    tcase_add_test(tc_core, test_pieces);
+    tcase_add_test(tc_core, test_lanes);
+    tcase_add_test(tc_core, test_threads);
+    suite_add_tcase(s, tc_core);
+
+    return s;
+}
+
+
+int main() {
+    int number_failed;
+    Suite *s = sha1_suite();
+    SRunner *sr = srunner_create(s);
+    srunner_run_all(sr, CK_NORMAL);
+    number_failed = srunner_ntests_failed(sr);
+    srunner_free(sr);
+    return (number_failed == 0) ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -32,6 +32,7 @@
 #include <cueify/device.h>
 #include <cueify/toc.h>
 #include <cueify/track_data.h>
+#include "test_device.h"
 
 
 cueify_device *dev;
@@ -40,8 +41,7 @@ cueify_device *dev;
 void setup() {
     dev = cueify_device_new();
     fail_unless(dev != NULL, "Failed to create cueify_device");
-    fail_unless(cueify_device_open(dev, NULL) == CUEIFY_OK,
-		"Failed to open device");
+    open_test_device(dev);
 }
 
 
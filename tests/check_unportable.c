@@ -27,6 +27,7 @@
 #include <stdlib.h>
 #include <check.h>
 #include <cueify/cueify.h>
+#include "test_device.h"
 
 #include "check_unportable.cdt.h"
 
@@ -103,8 +104,7 @@ cueify_device *dev;
 void setup() {
     dev = cueify_device_new();
     fail_unless(dev != NULL, "Failed to create cueify_device");
-    fail_unless(cueify_device_open(dev, NULL) == CUEIFY_OK,
-		"Failed to open device");
+    open_test_device(dev);
 }
 
 
@@ -250,6 +250,111 @@ START_TEST (test_data_mode)
 END_TEST
 
 
+/** Return the binary representation of a binary-coded decimal. */
+#define BCD2BIN(x)  (((x >> 4) & 0xF) * 10 + (x & 0xF))
+
+
+START_TEST (test_raw_sectors)
+{
+    uint8_t buffer[64 * CUEIFY_RAW_READ_SIZE];
+    uint8_t *subq;
+    uint32_t lba = 10000;
+    int i;
+
+    fail_unless(cueify_device_read_raw_sectors(dev, lba, 64, buffer,
+					       sizeof(buffer) - 1) ==
+		CUEIFY_ERR_TOOSMALL,
+		"Read raw sectors into too small a buffer");
+    fail_unless(cueify_device_read_raw_sectors(dev, lba, 64, buffer,
+					       sizeof(buffer)) == CUEIFY_OK,
+		"Failed to read raw sectors from device");
+
+    /* Each sector should carry the absolute time of its own address. */
+    for (i = 0; i < 64; i++) {
+	subq = buffer + i * CUEIFY_RAW_READ_SIZE + 2352;
+	if (subq[1] == 0) {
+	    /* Some drives return an empty sub-Q-channel. */
+	    continue;
+	}
+	fail_unless((BCD2BIN(subq[7]) * 60 + BCD2BIN(subq[8])) * 75 +
+		    BCD2BIN(subq[9]) - 150 == (int)(lba + i),
+		    "Raw sector was read from the wrong address");
+    }
+}
+END_TEST
+
+
+START_TEST (test_sector_cache)
+{
+    uint8_t first[8 * CUEIFY_RAW_READ_SIZE], second[8 * CUEIFY_RAW_READ_SIZE];
+    uint32_t hits, misses;
+
+    fail_unless(cueify_device_set_sector_cache(dev, 32, 8) == CUEIFY_OK,
+		"Failed to enable the sector cache");
+    fail_unless(cueify_device_read_raw_sectors(dev, 10000, 8, first,
+					       sizeof(first)) == CUEIFY_OK,
+		"Failed to read raw sectors from device");
+    /* The read-ahead should already have fetched these. */
+    fail_unless(cueify_device_read_raw_sectors(dev, 10008, 8, second,
+					       sizeof(second)) == CUEIFY_OK,
+		"Failed to read raw sectors from device");
+    fail_unless(cueify_device_read_raw_sectors(dev, 10000, 8, second,
+					       sizeof(second)) == CUEIFY_OK,
+		"Failed to read raw sectors from device");
+    fail_unless(memcmp(first, second, sizeof(first)) == 0,
+		"Cached sectors differ from those read from the device");
+
+    fail_unless(cueify_device_get_sector_cache_stats(dev, &hits,
+						     &misses) == CUEIFY_OK,
+		"Failed to get sector cache counters");
+    fail_unless(hits == 16 && misses == 8,
+		"Sector cache counted the wrong number of hits and misses");
+}
+END_TEST
+
+
+/** Count the completions of asynchronous reads. */
+static void count_completion(void *context, int status) {
+    int *completed = (int *)context;
+
+    if (status == CUEIFY_OK) {
+	(*completed)++;
+    }
+}
+
+
+START_TEST (test_async_raw_sectors)
+{
+    uint8_t sync_buffer[64 * CUEIFY_RAW_READ_SIZE];
+    uint8_t async_buffer[64 * CUEIFY_RAW_READ_SIZE];
+    int completed = 0, i;
+
+    fail_unless(cueify_device_read_raw_sectors(dev, 10000, 64, sync_buffer,
+					       sizeof(sync_buffer)) ==
+		CUEIFY_OK,
+		"Failed to read raw sectors from device");
+
+    /* Queue the same sectors as four separate reads. */
+    for (i = 0; i < 4; i++) {
+	fail_unless(cueify_device_submit_read_raw_sectors(
+			dev, 10000 + i * 16, 16,
+			async_buffer + i * 16 * CUEIFY_RAW_READ_SIZE,
+			16 * CUEIFY_RAW_READ_SIZE,
+			count_completion, &completed) == CUEIFY_OK,
+		    "Failed to queue raw sectors read");
+    }
+    while (cueify_device_get_pending(dev) > 0) {
+	fail_unless(cueify_device_complete(dev, 1) == CUEIFY_OK,
+		    "Failed to complete queued reads");
+    }
+
+    fail_unless(completed == 4, "Queued reads did not all succeed");
+    fail_unless(memcmp(sync_buffer, async_buffer, sizeof(sync_buffer)) == 0,
+		"Queued reads returned different sectors");
+}
+END_TEST
+
+
 START_TEST (test_discid)
 {
     char *mbid;
@@ -284,6 +389,9 @@ Suite *toc_suite() {
     tcase_add_checked_fixture(tc_seekbased, setup, teardown);
     tcase_add_test(tc_seekbased, test_mcn_isrc);
     tcase_add_test(tc_seekbased, test_data_mode);
+    tcase_add_test(tc_seekbased, test_raw_sectors);
+    tcase_add_test(tc_seekbased, test_sector_cache);
+    tcase_add_test(tc_seekbased, test_async_raw_sectors);
     suite_add_tcase(s, tc_seekbased);
 
     return s;
@@ -0,0 +1,53 @@
+/* test_device.h - Device of the test disc for the libcueify unit tests
+ *
+ * Copyright (c) 2011 Ian Jacobi <pipian@pipian.com>
+ *
+ * Permission is hereby granted, free of charge, to any person
+ * obtaining a copy of this software and associated documentation
+ * files (the "Software"), to deal in the Software without
+ * restriction, including without limitation the rights to use, copy,
+ * modify, merge, publish, distribute, sublicense, and/or sell copies
+ * of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be
+ * included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+ * EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+ * MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS
+ * BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN
+ * ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+ * CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef _CUEIFY_TEST_DEVICE_H
+#define _CUEIFY_TEST_DEVICE_H
+
+#include <stdlib.h>
+#include <check.h>
+#include <cueify/error.h>
+#include <cueify/device.h>
+
+/**
+ * Open the device holding the test disc: an image of it in a simulated
+ * drive if CUEIFY_TEST_IMAGE names one, or else the default device.
+ *
+ * @param dev the device handle to open
+ */
+static void open_test_device(cueify_device *dev) {
+    if (getenv("CUEIFY_TEST_IMAGE") != NULL) {
+	/* Run against an image of the test disc in a simulated drive. */
+	fail_unless(cueify_device_open_simulated(dev,
+						 getenv("CUEIFY_TEST_IMAGE"),
+						 NULL) == CUEIFY_OK,
+		    "Failed to open simulated drive");
+    } else {
+	fail_unless(cueify_device_open(dev, NULL) == CUEIFY_OK,
+		    "Failed to open device");
+    }
+}
+
+#endif  /* _CUEIFY_TEST_DEVICE_H */